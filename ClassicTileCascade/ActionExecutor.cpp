@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <iterator>
+#include "ActionExecutor.h"
+
+CTAction::ActionExecutor::~ActionExecutor()
+{
+    Stop();
+}
+
+void CTAction::ActionExecutor::Start(NotifyFunc notify)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_thread.joinable()) {
+        return;
+    }
+
+    m_notify = std::move(notify);
+    m_thread = std::jthread([this](std::stop_token stopToken) { Run(stopToken); });
+}
+
+void CTAction::ActionExecutor::Stop()
+{
+    std::jthread thread;
+    {
+        std::lock_guard lock(m_mutex);
+        thread = std::move(m_thread);
+        m_stopRunning.request_stop();
+    }
+
+    //Joins once the running action (if any) returns
+    if (thread.joinable()) {
+        thread.request_stop();
+        thread.join();
+    }
+}
+
+bool CTAction::ActionExecutor::IsRunning() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_thread.joinable();
+}
+
+void CTAction::ActionExecutor::SetCoalesceDelay(std::chrono::milliseconds delay)
+{
+    std::lock_guard lock(m_mutex);
+    m_coalesceDelay = delay;
+}
+
+bool CTAction::ActionExecutor::Post(Action action)
+{
+    std::vector<ActionResult> vSuperseded;
+    {
+        std::lock_guard lock(m_mutex);
+        if (!m_thread.joinable()) {
+            return false;
+        }
+
+        const Clock::time_point tpNow = Clock::now();
+        bool bHold = false;
+
+        //Only the latest intent survives
+        if (action.bCoalesce) {
+            bHold = (tpNow < m_tpLastCoalesced + m_coalesceDelay);
+            m_tpLastCoalesced = tpNow;
+
+            std::erase_if(m_queue, [&vSuperseded](const QueuedAction& queued) {
+                if (queued.action.bCoalesce) {
+                    vSuperseded.push_back(NotRun(queued, ActionStatus::Superseded));
+                    return true;
+                }
+                return false;
+            });
+
+            if (m_bRunningCoalesce) {
+                m_stopRunning.request_stop();
+            }
+        }
+        m_queue.push_back({ std::move(action), tpNow, bHold });
+    }
+    m_cv.notify_one();
+
+    for (const ActionResult& result : vSuperseded) {
+        AddResult(result);
+    }
+    return true;
+}
+
+std::size_t CTAction::ActionExecutor::Pending() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_queue.size();
+}
+
+void CTAction::ActionExecutor::TakeResults(std::vector<ActionResult>& vResults)
+{
+    std::lock_guard lock(m_mutex);
+    std::move(m_vResults.begin(), m_vResults.end(), std::back_inserter(vResults));
+    m_vResults.clear();
+}
+
+void CTAction::ActionExecutor::Run(std::stop_token stopToken)
+{
+    std::unique_lock lock(m_mutex);
+    for (;;) {
+        m_cv.wait(lock, stopToken, [this] { return !m_queue.empty(); });
+        if (stopToken.stop_requested()) {
+            break;
+        }
+
+        //Wait for the end of the burst. If a newer action supersedes this one in the 
+        //meantime, the newer one is held in turn
+        if (m_queue.front().bHold) {
+            const Clock::time_point tpRelease = m_queue.front().tpPosted + m_coalesceDelay;
+            if (Clock::now() < tpRelease) {
+                m_cv.wait_until(lock, stopToken, tpRelease, [] { return false; });
+                continue;
+            }
+        }
+
+        QueuedAction queued = std::move(m_queue.front());
+        m_queue.pop_front();
+        m_stopRunning = std::stop_source();
+        m_bRunningCoalesce = queued.action.bCoalesce;
+        std::stop_token stopRunning = m_stopRunning.get_token();
+
+        lock.unlock();
+        ActionResult result = Execute(queued, stopRunning);
+        lock.lock();
+
+        m_bRunningCoalesce = false;
+        lock.unlock();
+        AddResult(result);
+        lock.lock();
+    }
+
+    //Whatever is still queued won't run
+    std::deque<QueuedAction> queue = std::move(m_queue);
+    m_queue.clear();
+    lock.unlock();
+
+    for (const QueuedAction& queued : queue) {
+        AddResult(NotRun(queued, ActionStatus::Dropped));
+    }
+}
+
+CTAction::ActionResult CTAction::ActionExecutor::NotRun(const QueuedAction& queued, ActionStatus status)
+{
+    ActionResult result;
+    result.nId = queued.action.nId;
+    result.status = status;
+    result.usQueued = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - queued.tpPosted);
+    return result;
+}
+
+CTAction::ActionResult CTAction::ActionExecutor::Execute(QueuedAction& queued, std::stop_token stopToken)
+{
+    ActionResult result;
+    result.nId = queued.action.nId;
+
+    const Clock::time_point tpDeadline = queued.tpPosted + queued.action.timeout;
+    const Clock::time_point tpStart = Clock::now();
+    result.usQueued = std::chrono::duration_cast<std::chrono::microseconds>(tpStart - queued.tpPosted);
+    if (tpStart >= tpDeadline) {
+        result.status = ActionStatus::Expired;
+        return result;
+    }
+
+    try {
+        if (queued.action.fnRun) {
+            queued.action.fnRun(ActionContext(tpDeadline, stopToken));
+        }
+
+        if (stopToken.stop_requested()) {
+            result.status = ActionStatus::Cancelled;
+        } else {
+            result.status = (Clock::now() > tpDeadline) ? ActionStatus::TimedOut : ActionStatus::Completed;
+        }
+    } catch (...) {
+        result.status = ActionStatus::Failed;
+    }
+    result.usRun = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - tpStart);
+    return result;
+}
+
+void CTAction::ActionExecutor::AddResult(const ActionResult& result)
+{
+    NotifyFunc notify;
+    {
+        std::lock_guard lock(m_mutex);
+        m_vResults.push_back(result);
+        notify = m_notify;
+    }
+
+    if (notify) {
+        notify();
+    }
+}
@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `ActionExecutor.cpp` for details.
+ */
+#pragma once
+
+// Runs the tile/cascade/minimize actions on a thread of their own, so that a slow
+// cross-process move never blocks the message loop (tray icon, menus, log viewer).
+// Actions run one at a time, in the order they were posted. Every action has a
+// timeout that counts from when it was posted: an action still queued when its
+// timeout passes is not run at all (it would act on a desktop the user has moved
+// on from), and one that runs past it is reported as timed out. The result of
+// every posted action is queued for the posting thread, which is woken up by a
+// caller-supplied notification (on Windows, a posted message) and then collects
+// the results with TakeResults. The executor has no dependency on Windows headers.
+// Actions that express the same kind of intent (e.g. rearranging the desktop) can
+// be coalesced: posting one drops the coalesced actions still queued and asks the
+// running one to stop at its next safe point. A coalesced action posted less than
+// the coalesce delay after the one before it is part of a burst (e.g. a double or
+// triple click) and is held until the delay has passed without a newer one, so that
+// a burst results in at most two runs: its first action and its last.
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace CTAction
+{
+	using Clock = std::chrono::steady_clock;
+
+	enum class ActionStatus
+	{
+		Completed,		// Ran to the end within its timeout
+		TimedOut,		// Ran to the end, but took longer than its timeout
+		Expired,		// The timeout passed while it was queued, it did not run
+		Failed,			// Threw an exception
+		Dropped,		// The executor was stopped before it ran
+		Superseded,		// A newer coalesced action was posted before it ran
+		Cancelled		// A newer coalesced action was posted (or the executor stopped) while it ran
+	};
+
+	struct ActionResult
+	{
+		int nId = 0;
+		ActionStatus status = ActionStatus::Completed;
+		std::chrono::microseconds usQueued{};
+		std::chrono::microseconds usRun{};
+	};
+
+	// Passed to a running action, e.g. to give up before a long step once the result
+	// would be reported as timed out anyway, or once a newer action replaced it
+	class ActionContext
+	{
+	public:
+		explicit ActionContext(Clock::time_point tpDeadline, std::stop_token stopToken = {}) 
+			: m_tpDeadline(tpDeadline), m_stopToken(std::move(stopToken)) {}
+
+		Clock::time_point Deadline() const { return m_tpDeadline; }
+		bool IsPastDeadline() const { return Clock::now() >= m_tpDeadline; }
+		bool IsCancelled() const { return m_stopToken.stop_requested(); }
+
+	protected:
+		Clock::time_point m_tpDeadline;
+		std::stop_token m_stopToken;
+	};
+
+	struct Action
+	{
+		// Caller-defined, returned in ActionResult (e.g. the menu command)
+		int nId = 0;
+		std::function<void(const ActionContext&)> fnRun;
+		std::chrono::milliseconds timeout{ 5000 };
+
+		// Supersede the coalesced actions posted before this one
+		bool bCoalesce = false;
+	};
+
+	class ActionExecutor
+	{
+	public:
+		// Called on the executor thread after a result was queued
+		using NotifyFunc = std::function<void()>;
+
+		ActionExecutor() = default;
+		virtual ~ActionExecutor();
+		ActionExecutor(const ActionExecutor&) = delete;
+		ActionExecutor(ActionExecutor&&) noexcept = delete;
+		ActionExecutor& operator=(const ActionExecutor&) = delete;
+		ActionExecutor& operator=(ActionExecutor&&) noexcept = delete;
+
+		// Start the executor thread. Does nothing if it is already running
+		void Start(NotifyFunc notify);
+
+		// Cancel the running action, wait for it to return and stop the thread. Actions still
+		// queued are reported as Dropped. Results not yet taken stay available to TakeResults
+		void Stop();
+
+		bool IsRunning() const;
+
+		// Gap between coalesced actions below which they are treated as one burst.
+		// Should be well below the actions' timeouts. The default (0) disables holding
+		void SetCoalesceDelay(std::chrono::milliseconds delay);
+
+		// Queue action. If action.bCoalesce, the coalesced actions still queued are reported
+		// as Superseded and the running one (if coalesced) is cancelled. Returns false
+		// (and does not queue it) if the executor isn't running
+		bool Post(Action action);
+
+		// Number of actions queued but not started yet
+		std::size_t Pending() const;
+
+		// Move the results queued since the last call to the end of vResults, oldest first
+		void TakeResults(std::vector<ActionResult>& vResults);
+
+	protected:
+		struct QueuedAction
+		{
+			Action action;
+			Clock::time_point tpPosted;
+
+			// Part of a burst, not started before tpPosted + m_coalesceDelay
+			bool bHold = false;
+		};
+
+		void Run(std::stop_token stopToken);
+		ActionResult Execute(QueuedAction& queued, std::stop_token stopToken);
+		void AddResult(const ActionResult& result);
+		static ActionResult NotRun(const QueuedAction& queued, ActionStatus status);
+
+		mutable std::mutex m_mutex;
+		std::condition_variable_any m_cv;
+		std::deque<QueuedAction> m_queue;
+		std::vector<ActionResult> m_vResults;
+		NotifyFunc m_notify;
+		std::jthread m_thread;
+
+		// Cancels the running action. m_bRunningCoalesce tells whether it is coalesced
+		std::stop_source m_stopRunning{ std::nostopstate };
+		bool m_bRunningCoalesce = false;
+
+		std::chrono::milliseconds m_coalesceDelay{ 0 };
+		Clock::time_point m_tpLastCoalesced = Clock::time_point::min();
+	};
+}
@@ -32,7 +32,8 @@
 
 
 CLogViewer::CLogViewer(bool bQuitOnDestroy)
-    : BaseWnd(bQuitOnDestroy) {}
+    : BaseWnd(bQuitOnDestroy),
+      m_tailReader(m_tailSource) {}
 
 bool CLogViewer::InitInstance(HINSTANCE hInstance, std::wstring_view szFilePath)
 {
@@ -50,9 +51,11 @@ bool CLogViewer::BeforeWndCreate(bool bRanPrior)
 {
     constexpr static std::wstring_view CLASS_NAME = L"ClassicTileWndLogViewer";
 
-    if (!bRanPrior) {
-        const static SPHMODULE hRtfLib ( eval_fatal_nz(::LoadLibraryW(L"Msftedit.dll")) );
+    if (!m_hRtfLib) {
+        m_hRtfLib.reset(eval_fatal_nz(::LoadLibraryW(L"Msftedit.dll")));
+    }
 
+    if (!bRanPrior) {
         m_wcex.style = CS_HREDRAW | CS_VREDRAW;
         m_wcex.hIcon = eval_fatal_nz(::LoadIcon(m_hInst, reinterpret_cast<LPCWSTR>(IDI_CLASSICTILECASCADE)));
         m_wcex.hCursor = eval_fatal_nz(::LoadCursor(NULL, IDC_ARROW));
@@ -100,11 +103,21 @@ bool CLogViewer::OpenFile()
     bool bRetVal = false;
     
     try {
-        _variant_t varFile(m_szFilePath.c_str());
+        //Map the file instead of loading all of it into the rich edit 
+        //control. Only the last page of lines is handed to the control
+        m_logDoc.Detach();
+        m_mappedFile.Open(m_szFilePath);
+        m_logDoc.Attach(m_mappedFile);
+        m_logSearch.ResetIndex();
 
-        eval_fatal_hr(m_spTextDoc->Open(&varFile, tomReadOnly | tomOpenExisting | tomText, 0));
+        m_logIndex.Reset();
+        UpdateFilterLines(true);
 
-        SetLineNumbers(m_hWnd);
+        LoadPage(PageStartBefore(ViewLineCount()));
+
+        //Follow the file from the end of what is mapped
+        m_tailSource.SetPath(m_szFilePath);
+        m_tailReader.Reset(m_logDoc.Size());
 
         //Move cursor to end of Rich Edit control
         ITextSelectionPtr spTextSelection;
@@ -121,6 +134,146 @@ bool CLogViewer::OpenFile()
     return bRetVal;
 }
 
+std::size_t CLogViewer::PageStartBefore(std::size_t nEndLine)
+{
+    if (IsFiltered()) {
+        //Add lines before nEndLine for as long as they fit
+        std::size_t nFirstLine = nEndLine, nBytes = 0;
+        while ((nFirstLine > 0) && ((nEndLine - nFirstLine) < PAGE_LINES)) {
+            nBytes += m_logIndex.LineSize(m_vFilterLines[nFirstLine - 1]);
+            if ((nBytes > PAGE_BYTES) && (nFirstLine < nEndLine)) {
+                break;
+            }
+            nFirstLine--;
+        }
+        return nFirstLine;
+    }
+
+    std::size_t nFirstLine = (nEndLine > PAGE_LINES) ? nEndLine - PAGE_LINES : 0;
+
+    //If those lines are more than a page's worth of bytes, start 
+    //at the first line that still fits
+    std::size_t nEndOffset = m_logDoc.LineOffset(nEndLine);
+    if ((nEndLine > 0) && ((nEndOffset - m_logDoc.LineOffset(nFirstLine)) > PAGE_BYTES)) {
+        nFirstLine = std::min(m_logDoc.LineFromOffset(nEndOffset - PAGE_BYTES) + 1, nEndLine - 1);
+    }
+    return nFirstLine;
+}
+
+void CLogViewer::LoadPage(std::size_t nFirstLine)
+{
+    std::string szFiltered;
+    std::string_view szPage;
+    std::size_t nPageLines = 0;
+    if (IsFiltered()) {
+        //Gather the lines that pass the filter, with the same limits as an unfiltered page
+        for (std::size_t n = nFirstLine; (n < m_vFilterLines.size()) && (nPageLines < PAGE_LINES); n++, nPageLines++) {
+            const CTLogView::LineInfo& info = m_logIndex.Line(m_vFilterLines[n]);
+            std::size_t nSize = std::min(m_logIndex.LineSize(m_vFilterLines[n]), PAGE_BYTES);
+            if (nPageLines && ((szFiltered.size() + nSize) > PAGE_BYTES)) {
+                break;
+            }
+            szFiltered.append(m_logDoc.GetText(static_cast<std::size_t>(info.nOffset), nSize));
+            if (szFiltered.back() != '\n') {
+                szFiltered += '\n';
+            }
+        }
+        szPage = szFiltered;
+    } else {
+        szPage = m_logDoc.GetLines(nFirstLine, PAGE_LINES, PAGE_BYTES);
+        nPageLines = static_cast<std::size_t>(std::ranges::count(szPage, '\n'));
+        if (!szPage.empty() && (szPage.back() != '\n')) {
+            nPageLines++;
+        }
+    }
+
+    //The log is written by the CRT in the ANSI code page, which is
+    //also what ITextDocument::Open used to assume for tomText
+    std::wstring szText;
+    CTWinUtils::Ansi2wstring(szText, szPage);
+
+    //EM_SETTEXTEX, unlike the TOM range functions, also works on a read-only control
+    SETTEXTEX stex = { ST_DEFAULT, 1200 };
+    eval_error_nz(::SendMessageW(m_hEdit, EM_SETTEXTEX, reinterpret_cast<WPARAM>(&stex), reinterpret_cast<LPARAM>(szText.c_str())));
+
+    m_nPageFirstLine = nFirstLine;
+    m_nPageLines = nPageLines;
+
+    SetLineNumbers(m_hWnd);
+}
+
+void CLogViewer::AppendToPage(std::string_view szText)
+{
+    //Let paging and Go To see the new lines. Only the appended range gets mapped,
+    //when it is first read
+    if (!m_mappedFile.Refresh()) {
+        OpenFile();
+        return;
+    }
+    m_logDoc.Extend();
+
+    if (IsFiltered()) {
+        //Only some of the new lines may pass the filter. Show the last page of them
+        std::size_t nShown = m_vFilterLines.size();
+        UpdateFilterLines(false);
+        if (m_vFilterLines.size() != nShown) {
+            LoadPage(PageStartBefore(ViewLineCount()));
+
+            ITextSelectionPtr spTextSelection;
+            eval_error_hr(m_spTextDoc->GetSelection(&spTextSelection));
+            eval_error_hr(spTextSelection->EndKey(tomStory, tomMove, nullptr));
+        }
+        return;
+    }
+
+    std::uint64_t nConsumed = m_tailReader.Consumed();
+    std::size_t nLastLine = m_logDoc.LineFromOffset(static_cast<std::size_t>(nConsumed) - 1);
+    std::size_t nPageBytes = static_cast<std::size_t>(nConsumed) - m_logDoc.LineOffset(m_nPageFirstLine);
+
+    if (((nLastLine + 1 - m_nPageFirstLine) > (PAGE_LINES + PAGE_LINES / 2)) || (nPageBytes > PAGE_BYTES)) {
+        //The page has grown by half again: reload, which starts 
+        //a new page at the end of the file
+        OpenFile();
+        return;
+    }
+
+    std::wstring szWText;
+    CTWinUtils::Ansi2wstring(szWText, szText);
+
+    ITextSelectionPtr spTextSelection;
+    eval_error_hr(m_spTextDoc->GetSelection(&spTextSelection));
+    eval_error_hr(spTextSelection->EndKey(tomStory, tomMove, nullptr));
+
+    SETTEXTEX stex = { ST_SELECTION, 1200 };
+    ::SendMessageW(m_hEdit, EM_SETTEXTEX, reinterpret_cast<WPARAM>(&stex), reinterpret_cast<LPARAM>(szWText.c_str()));
+
+    eval_error_hr(spTextSelection->EndKey(tomStory, tomMove, nullptr));
+
+    m_nPageLines = nLastLine + 1 - m_nPageFirstLine;
+
+    //The appended lines are numbered on from the page, which may now go past what can be numbered
+    if (m_bLineNumbers && !CanNumberLines()) {
+        SetLineNumbers(m_hWnd);
+    }
+}
+
+void CLogViewer::SetFollowTail(bool bFollowTail)
+{
+    if (bFollowTail == m_bFollowTail) {
+        return;
+    }
+
+    m_bFollowTail = bFollowTail;
+    if (m_bFollowTail) {
+        //Start at the end of the file, as it is now
+        OpenFile();
+        eval_error_nz(::SetTimer(m_hWnd, IDT_FOLLOWTAIL, FOLLOW_TAIL_MS, nullptr));
+    } else {
+        ::KillTimer(m_hWnd, IDT_FOLLOWTAIL);
+        m_tailSource.Close();
+    }
+}
+
 LRESULT CLogViewer::ClassWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     const static UINT ID_FINDMSGSTRING = ::RegisterWindowMessage(FINDMSGSTRING);
@@ -135,6 +288,7 @@ LRESULT CLogViewer::ClassWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lPa
         HANDLE_MSG(hwnd, WM_INITMENUPOPUP, OnInitMenuPopup);
         HANDLE_MSG(hwnd, WM_SETFOCUS, OnSetFocus);
         HANDLE_MSG(hwnd, WM_NOTIFY, OnNotify);
+        HANDLE_MSG(hwnd, WM_TIMER, OnTimer);
 
     default:
         if (uMsg == ID_FINDMSGSTRING) {
@@ -270,7 +424,8 @@ void CLogViewer::OnSelChange(HWND hwnd)
 
                 switch (static_cast<StatSection>(i)) {
                 case StatSection::LINE:
-                    FormatSection(L"Line", nLine, nLineEnd);
+                    //Lines are counted from the start of the file, not the page
+                    FormatSection(L"Line", nLine, nLineEnd, static_cast<long>(FileLine(m_nPageFirstLine + nLine - 1)) + 1, static_cast<long>(FileLine(m_nPageFirstLine + nLineEnd - 1)) + 1);
                     break;
 
                 case StatSection::CHARACTER:
@@ -324,6 +479,7 @@ BOOL CLogViewer::OnCreate(HWND hwnd, LPCREATESTRUCT lpCreateStruct)
                                     m_hInst,
                                     nullptr));
         ::SendMessageW(m_hEdit, EM_SETEVENTMASK, 0, ENM_SELCHANGE);
+        ::SendMessageW(m_hEdit, EM_EXLIMITTEXT, 0, static_cast<LPARAM>(PAGE_BYTES));
         eval_error_nz(::SetWindowSubclass(m_hEdit, s_RESubClass, 0, reinterpret_cast<DWORD_PTR>(this)));
         eval_error_nz(::SetFocus(m_hEdit));
         fRetVal = TRUE;
@@ -408,6 +564,27 @@ void CLogViewer::OnCommand(HWND hwnd, int id, HWND hwndCtl, UINT codeNotify)
         OnStatusBar(hwnd);
         break;
 
+    case ID_VIEW_PREVIOUSPAGE:
+    case ID_VIEW_NEXTPAGE:
+        OnPage(hwnd, id);
+        break;
+
+    case ID_VIEW_FOLLOWTAIL:
+        OnFollowTail(hwnd);
+        break;
+
+    case ID_FILTER_TRACE:
+    case ID_FILTER_DEBUG:
+    case ID_FILTER_INFO:
+    case ID_FILTER_WARN:
+    case ID_FILTER_ERROR:
+    case ID_FILTER_FATAL:
+    case ID_FILTER_SOURCE:
+    case ID_FILTER_TIME:
+    case ID_FILTER_CLEAR:
+        OnFilter(hwnd, id);
+        break;
+
     default:
         FORWARD_WM_COMMAND(hwnd, id, hwndCtl, codeNotify, __super::ClassWndProc);
         break;
@@ -489,6 +666,11 @@ void CLogViewer::OnInitMenuPopup(HWND hWnd, HMENU hMenu, UINT item, BOOL fSystem
             OnInitZoomMenu(hMenu);
             bHandled = true;
             break;
+
+        case ID_FILTER:
+            OnInitFilterMenu(hMenu);
+            bHandled = true;
+            break;
         }
     }
 
@@ -497,74 +679,189 @@ void CLogViewer::OnInitMenuPopup(HWND hWnd, HMENU hMenu, UINT item, BOOL fSystem
     }
 }
 
+std::size_t CLogViewer::ViewLineCount()
+{
+    return IsFiltered() ? m_vFilterLines.size() : m_logDoc.LineCount();
+}
+
+std::size_t CLogViewer::FileLine(std::size_t nViewLine)
+{
+    if (!IsFiltered()) {
+        return nViewLine;
+    }
+    return (nViewLine < m_vFilterLines.size()) ? m_vFilterLines[nViewLine] : m_logDoc.LineCount();
+}
+
+std::size_t CLogViewer::ViewLine(std::size_t nFileLine)
+{
+    if (!IsFiltered()) {
+        return nFileLine;
+    }
+
+    std::size_t nViewLine = static_cast<std::size_t>(std::ranges::lower_bound(m_vFilterLines, nFileLine) - m_vFilterLines.begin());
+    return ((nViewLine == m_vFilterLines.size()) && nViewLine) ? nViewLine - 1 : nViewLine;
+}
+
+std::size_t CLogViewer::CursorFileLine()
+{
+    ITextSelectionPtr spTextSelection;
+    eval_error_hr(m_spTextDoc->GetSelection(&spTextSelection));
+
+    long nLine = 0;
+    eval_error_hr(spTextSelection->GetIndex(tomLine, &nLine));
+    return FileLine(m_nPageFirstLine + static_cast<std::size_t>(std::max(nLine - 1, 0L)));
+}
+
+void CLogViewer::UpdateFilterLines(bool bRebuild)
+{
+    if (bRebuild) {
+        m_vFilterLines.clear();
+    }
+
+    if (!IsFiltered()) {
+        return;
+    }
+
+    //A last line without '\n' is parsed again, so it is selected again
+    std::size_t nFirst = bRebuild ? 0 : m_logIndex.CompleteLines();
+    m_vFilterLines.erase(std::ranges::lower_bound(m_vFilterLines, nFirst), m_vFilterLines.end());
+
+    m_logIndex.Update(m_mappedFile);
+    m_logIndex.Select(m_filter, nFirst, m_vFilterLines);
+}
+
+void CLogViewer::ApplyFilter(std::size_t nFileLine)
+{
+    UpdateFilterLines(true);
+
+    if (m_bFollowTail) {
+        LoadPage(PageStartBefore(ViewLineCount()));
+
+        ITextSelectionPtr spTextSelection;
+        eval_error_hr(m_spTextDoc->GetSelection(&spTextSelection));
+        eval_error_hr(spTextSelection->EndKey(tomStory, tomMove, nullptr));
+    } else {
+        //The page in the box no longer matches the view lines
+        m_nPageFirstLine = 0;
+        m_nPageLines = 0;
+        ShowLine(nFileLine);
+
+        ITextSelectionPtr spTextSelection;
+        eval_error_hr(m_spTextDoc->GetSelection(&spTextSelection));
+        eval_error_hr(spTextSelection->SetIndex(tomLine, static_cast<long>(ViewLine(nFileLine) - m_nPageFirstLine) + 1, 0));
+    }
+}
+
+bool CLogViewer::ShowLine(std::size_t nLine)
+{
+    nLine = ViewLine(nLine);
+    if ((nLine >= m_nPageFirstLine) && (nLine < (m_nPageFirstLine + m_nPageLines))) {
+        return false;
+    }
+
+    //Leaving the last page ends "Follow Tail"
+    SetFollowTail(false);
+
+    //Load the page with the line in the middle of it
+    LoadPage((nLine > (PAGE_LINES / 2)) ? nLine - (PAGE_LINES / 2) : 0);
+    if (nLine >= (m_nPageFirstLine + m_nPageLines)) {
+        LoadPage(nLine);
+    }
+    return true;
+}
+
+std::size_t CLogViewer::OffsetFromCp(long cp)
+{
+    ITextRangePtr spRange;
+    eval_error_hr(m_spTextDoc->Range(cp, cp, &spRange));
+
+    long nLine = 0, cpLine = 0;
+    eval_error_hr(spRange->GetIndex(tomLine, &nLine));
+    eval_error_hr(spRange->SetIndex(tomLine, nLine, 0));
+    eval_error_hr(spRange->GetStart(&cpLine));
+
+    //The box holds UTF-16 text: map the column back to 
+    //bytes of the (ANSI) line in the file
+    std::size_t nFileLine = FileLine(m_nPageFirstLine + static_cast<std::size_t>(std::max(nLine - 1, 0L)));
+    std::string_view szLine = m_logDoc.GetLines(nFileLine, 1);
+
+    std::wstring szWLine;
+    CTWinUtils::Ansi2wstring(szWLine, szLine);
+    szWLine.resize(std::min(szWLine.size(), static_cast<std::size_t>(cp - cpLine)));
+
+    std::string szPrefix;
+    CTWinUtils::Wstring2ansi(szPrefix, szWLine);
+    return m_logDoc.LineOffset(nFileLine) + szPrefix.size();
+}
+
+void CLogViewer::SelectOffsets(std::size_t nStart, std::size_t nEnd)
+{
+    std::size_t nLine = m_logDoc.LineFromOffset(nStart);
+    ShowLine(nLine);
+
+    ITextRangePtr spRange;
+    long cpLine = 0;
+    eval_error_hr(m_spTextDoc->Range(0, 0, &spRange));
+    eval_error_hr(spRange->SetIndex(tomLine, static_cast<long>(ViewLine(nLine) - m_nPageFirstLine) + 1, 0));
+    eval_error_hr(spRange->GetStart(&cpLine));
+
+    std::size_t nLineOffset = m_logDoc.LineOffset(nLine);
+    std::string_view szText = m_logDoc.GetText(nLineOffset, nEnd - nLineOffset);
+    std::wstring szWBefore, szWMatch;
+    CTWinUtils::Ansi2wstring(szWBefore, szText.substr(0, nStart - nLineOffset));
+    CTWinUtils::Ansi2wstring(szWMatch, szText.substr(nStart - nLineOffset));
+
+    long cpStart = cpLine + static_cast<long>(szWBefore.size());
+    ITextSelectionPtr spSelection;
+    eval_error_hr(m_spTextDoc->GetSelection(&spSelection));
+    eval_error_hr(spSelection->SetRange(cpStart, cpStart + static_cast<long>(szWMatch.size())));
+    eval_error_hr(spSelection->ScrollIntoView(tomStart));
+}
+
 void CLogViewer::FindString(LPFINDREPLACEW lpfr)
 {
     try{
+        //The file is written in the ANSI code page. Text that can't be
+        //represented in it can't be in the file either
+        std::string szFind;
+        if (!CTWinUtils::Wstring2ansi(szFind, lpfr->lpstrFindWhat) || szFind.empty()) {
+            return;
+        }
+
+        m_logSearch.SetPattern(szFind, (lpfr->Flags & FR_MATCHCASE) != 0, (lpfr->Flags & FR_WHOLEWORD) != 0);
+
+        //The whole file is searched, not just the page in the rich edit box
+        m_logSearch.UpdateIndex(m_mappedFile, SEARCH_INDEX_BYTES);
+
         ITextSelectionPtr spSelection;
         eval_error_hr(m_spTextDoc->GetSelection(&spSelection));
 
-        long nFlags = 0;
-        if (lpfr->Flags & FR_MATCHCASE) {
-            nFlags |= tomMatchCase;
-        }
-
-        if (lpfr->Flags & FR_WHOLEWORD) {
-            nFlags |= tomMatchWord;
+        //As before, a forward search starts after the current selection
+        //and a backward search before it. If the text is not found, the
+        //selection stays as it is
+        std::size_t nFound = CTLogView::LogSearch::npos;
+        bool bDown = (lpfr->Flags & FR_DOWN) != 0;
+        if (bDown) {
+            long cpEnd = 0;
+            eval_error_hr(spSelection->GetEnd(&cpEnd));
+            nFound = m_logSearch.FindNext(m_mappedFile, OffsetFromCp(cpEnd));
+        } else {
+            long cpStart = 0;
+            eval_error_hr(spSelection->GetStart(&cpStart));
+            nFound = m_logSearch.FindPrev(m_mappedFile, OffsetFromCp(cpStart));
         }
 
-        _bstr_t szFind = lpfr->lpstrFindWhat;
-
-
-        long nLength = 0;
-        HRESULT hr = E_UNEXPECTED;
-        if (lpfr->Flags & FR_DOWN) {
-            //We want to find text in szFind after the end of the current
-            //selection. In order to do this, we store the start
-            //and end indexes of the current selection, move (collapse)
-            //the selection to right after the end of the selection
-            //and search for the text. 
-            long nCheckStart = 0, nCheckEnd = 0;
-            eval_error_hr(spSelection->GetStart(&nCheckStart));
-            eval_error_hr(spSelection->GetEnd(&nCheckEnd));
-            eval_error_hr(spSelection->Collapse(tomEnd));
-
-
-            //If text is found, spSelection->FindText will update the cursor to beginning 
-            //of the found text. We need to capture nLength of the found text to set 
-            //the end of the selection below
-#pragma push_macro("FindText") 
-#undef FindText
-            hr = eval_error_hr(spSelection->FindText(szFind, tomForward, nFlags, &nLength));
-#pragma pop_macro("FindText") 
-            
-            //If text is not found, spSelection->FindText returns S_FALSE
-            //and we use the values captured to restore the current selection
-            if (hr != S_OK) {
-                eval_error_hr(spSelection->SetStart(nCheckStart));
-                eval_error_hr(spSelection->SetEnd(nCheckEnd));
+        //Skip the lines that the filter hides
+        while ((nFound != CTLogView::LogSearch::npos) && IsFiltered()) {
+            std::size_t nLine = m_logDoc.LineFromOffset(nFound);
+            if (std::ranges::binary_search(m_vFilterLines, nLine)) {
+                break;
             }
-            
-        } else {
-            //Backward (upward) search will search starting before the current selection
-            //For backward search we need to provide spSelection->FindTextStart with
-            //the # of characters to search backwards for. We want the search to go back 
-            //to the beginning of the RE Control, so we use the current character position of the 
-            //start of the selection as the # of characters
-            long nStart = 0;
-            eval_error_hr(spSelection->GetStart(&nStart));
-
-            //If text is found, spSelection->FindText will update the cursor to beginning 
-            //of the found text. We need to capture nLength of the found text to set 
-            //the end of the selection below
-            hr = eval_error_hr(spSelection->FindTextStart(szFind, -nStart, nFlags, &nLength));
+            nFound = bDown ? m_logSearch.FindNext(m_mappedFile, m_logDoc.LineOffset(nLine + 1)) : m_logSearch.FindPrev(m_mappedFile, m_logDoc.LineOffset(nLine));
         }
 
-        //If spSelection->FindTextStart found the text, it returns S_OK
-        //set the end of the selection to highlight the found text
-        if (hr == S_OK) {
-            long nSelStart = 0;
-            eval_error_hr(spSelection->GetStart(&nSelStart));
-            eval_error_hr(spSelection->SetEnd(nSelStart + nLength));
+        if (nFound != CTLogView::LogSearch::npos) {
+            SelectOffsets(nFound, nFound + szFind.size());
         }
     } catch (const LoggingException& le) {
         le.Log();
@@ -717,11 +1014,33 @@ void CLogViewer::OnInitZoomMenu(HMENU hMenu)
 
 }
 
+void CLogViewer::OnInitFilterMenu(HMENU hMenu)
+{
+    try{
+        for (int id = ID_FILTER_TRACE; id <= ID_FILTER_FATAL; id++) {
+            eval_error_nz(CTWinUtils::CheckMenuItem(hMenu, id, ((m_filter.nLevels >> (id - ID_FILTER_TRACE)) & 1) != 0));
+        }
+        eval_error_nz(CTWinUtils::CheckMenuItem(hMenu, ID_FILTER_SOURCE, m_filter.nFile != CTLogView::LineFilter::ANY_FILE));
+        eval_error_nz(CTWinUtils::CheckMenuItem(hMenu, ID_FILTER_TIME, m_filter.nTimeFrom != std::numeric_limits<std::int64_t>::min()));
+
+        ::EnableMenuItem(hMenu, ID_FILTER_CLEAR, MF_BYCOMMAND | (IsFiltered() ? MF_ENABLED : MF_DISABLED));
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+}
+
 void CLogViewer::OnInitViewMenu(HMENU hMenu)
 {
     try{
         eval_error_nz( CTWinUtils::CheckMenuItem(hMenu, ID_VIEW_LINENUMBERS, m_bLineNumbers));
+        ::EnableMenuItem(hMenu, ID_VIEW_LINENUMBERS, MF_BYCOMMAND | (CanNumberLines() ? MF_ENABLED : MF_DISABLED));
         eval_error_nz(CTWinUtils::CheckMenuItem(hMenu, ID_VIEW_STATUSBAR, m_bStatusBar));
+        eval_error_nz(CTWinUtils::CheckMenuItem(hMenu, ID_VIEW_FOLLOWTAIL, m_bFollowTail));
+
+        ::EnableMenuItem(hMenu, ID_VIEW_PREVIOUSPAGE, MF_BYCOMMAND | ((m_nPageFirstLine > 0) ? MF_ENABLED : MF_DISABLED));
+        ::EnableMenuItem(hMenu, ID_VIEW_NEXTPAGE, MF_BYCOMMAND | (((m_nPageFirstLine + m_nPageLines) < ViewLineCount()) ? MF_ENABLED : MF_DISABLED));
     } catch (const LoggingException& le) {
         le.Log();
     } catch (...) {
@@ -739,21 +1058,21 @@ void CLogViewer::OnGoto(HWND hwnd)
         long nCurrLine = 0;
         eval_error_hr(spTextSelection->GetIndex(tomLine, &nCurrLine));
 
-        m_nGotoLine = nCurrLine;
+        //Line numbers in the dialog are file line numbers
+        m_nGotoLine = static_cast<long>(FileLine(m_nPageFirstLine + nCurrLine - 1)) + 1;
 
         if (DoModal(hwnd, IDD_GOTO) ) {
             //User clicked OK button in Goto dialog
-
-            //Get a range pointing to the end of the RE control
             ITextRangePtr spRange;
-            eval_error_hr(m_spTextDoc->Range(0, 0, &spRange));
-            eval_error_hr(spRange->MoveStart(tomStory, 1, nullptr));
-
-            //Get the current line, which will yield the # of lines
-            //in the RE control b/c we are at the end of the control
-            long nCount = 0;
-            eval_error_hr(spRange->GetIndex(tomLine, &nCount));
-            if (m_nGotoLine > 0 && m_nGotoLine <= nCount) {
+
+            //The line may be anywhere in the file, not just on the current page
+            std::size_t nCount = m_logDoc.LineCount();
+            if (m_nGotoLine > 0 && static_cast<std::size_t>(m_nGotoLine) <= nCount) {
+                std::size_t nTarget = static_cast<std::size_t>(m_nGotoLine) - 1;
+                if (ShowLine(nTarget)) {
+                    eval_error_hr(spTextSelection->GetIndex(tomLine, &nCurrLine));
+                }
+
                 //We want the cursor to be at the beginning of the
                 //line selected in the Goto dialog. The way to accomplish
                 //this is to move the cursor to the beginning of the current line 
@@ -774,7 +1093,8 @@ void CLogViewer::OnGoto(HWND hwnd)
                     eval_error_hr(spTextSelection->HomeKey(tomLine, tomMove, nullptr));
                 }
 
-                eval_error_hr(spTextSelection->SetIndex(tomLine, m_nGotoLine, 0));
+                //With a filter, this is the next line shown
+                eval_error_hr(spTextSelection->SetIndex(tomLine, static_cast<long>(ViewLine(nTarget) - m_nPageFirstLine) + 1, 0));
             } else {
                 eval_error_nz(::MessageBoxW(hwnd, L"The line number is beyond the total number of lines", m_szWinTitle.c_str(), MB_OK | MB_ICONWARNING | MB_APPLMODAL));
             }
@@ -946,10 +1266,13 @@ void CLogViewer::SetLineNumbers(HWND hwnd)
     PARAFORMAT2 pf = { 0 };
     pf.cbSize = sizeof(pf);
     pf.dwMask = PFM_NUMBERING | PFM_NUMBERINGSTYLE | PFM_NUMBERINGSTART;
-    if (m_bLineNumbers) {
+    //Numbers that would be wrong (filtered lines aren't consecutive, pages past
+    //line 0xFFFF would wrap) aren't shown: the status bar has the file line
+    if (m_bLineNumbers && CanNumberLines()) {
         pf.wNumbering = PFN_ARABIC;
         pf.wNumberingStyle = PFNS_PERIOD;
-        pf.wNumberingStart = 1;
+        //Number from the first line of the page
+        pf.wNumberingStart = static_cast<WORD>(m_nPageFirstLine + 1);
     }
 
     eval_error_nz(::SendMessageW(m_hEdit, EM_SETPARAFORMAT, 0, reinterpret_cast<LPARAM>(&pf)));
@@ -959,6 +1282,120 @@ void CLogViewer::SetLineNumbers(HWND hwnd)
     eval_error_hr(spTextSelection->SetEnd(nEnd));
 }
 
+void CLogViewer::OnPage(HWND hwnd, int id)
+{
+    try{
+        ITextSelectionPtr spTextSelection;
+        eval_error_hr(m_spTextDoc->GetSelection(&spTextSelection));
+
+        //Leaving the last page ends "Follow Tail"
+        SetFollowTail(false);
+
+        if ((id == ID_VIEW_PREVIOUSPAGE) && (m_nPageFirstLine > 0)) {
+            //The page before ends where the current one starts, keep the 
+            //cursor at the seam
+            LoadPage(PageStartBefore(m_nPageFirstLine));
+            eval_error_hr(spTextSelection->EndKey(tomStory, tomMove, nullptr));
+        } else if ((id == ID_VIEW_NEXTPAGE) && ((m_nPageFirstLine + m_nPageLines) < ViewLineCount())) {
+            LoadPage(m_nPageFirstLine + m_nPageLines);
+            eval_error_hr(spTextSelection->HomeKey(tomStory, tomMove, nullptr));
+        }
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+}
+
+void CLogViewer::OnFilter(HWND hwnd, int id)
+{
+    try{
+        //The cursor's line as seen with the current filter
+        std::size_t nCursorLine = CursorFileLine();
+
+        switch (id) {
+        case ID_FILTER_SOURCE:
+        case ID_FILTER_TIME: {
+            bool bSet = (id == ID_FILTER_SOURCE) ? (m_filter.nFile != CTLogView::LineFilter::ANY_FILE) : (m_filter.nTimeFrom != std::numeric_limits<std::int64_t>::min());
+            if (bSet) {
+                m_filter.nFile = (id == ID_FILTER_SOURCE) ? CTLogView::LineFilter::ANY_FILE : m_filter.nFile;
+                m_filter.nTimeFrom = (id == ID_FILTER_TIME) ? std::numeric_limits<std::int64_t>::min() : m_filter.nTimeFrom;
+            } else {
+                //Take the source file or the time from the cursor's line
+                m_logIndex.Update(m_mappedFile);
+                if (nCursorLine >= m_logIndex.LineCount()) {
+                    return;
+                }
+
+                const CTLogView::LineInfo& info = m_logIndex.Line(nCursorLine);
+                if (id == ID_FILTER_SOURCE) {
+                    m_filter.nFile = (info.nFile != UINT32_MAX) ? info.nFile : m_filter.nFile;
+                } else {
+                    m_filter.nTimeFrom = info.nTime;
+                }
+            }
+            break;
+        }
+
+        case ID_FILTER_CLEAR:
+            m_filter = CTLogView::LineFilter();
+            break;
+
+        default:
+            //ID_FILTER_TRACE...ID_FILTER_FATAL are in the order of the log levels
+            m_filter.nLevels ^= (1u << (id - ID_FILTER_TRACE));
+            break;
+        }
+
+        ApplyFilter(nCursorLine);
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+}
+
+void CLogViewer::OnFollowTail(HWND hwnd)
+{
+    try{
+        SetFollowTail(!m_bFollowTail);
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+}
+
+void CLogViewer::OnTimer(HWND hwnd, UINT id)
+{
+    if (id != IDT_FOLLOWTAIL) {
+        FORWARD_WM_TIMER(hwnd, id, __super::ClassWndProc);
+        return;
+    }
+
+    try{
+        std::string szAppended;
+        switch (m_tailReader.Poll(FOLLOW_TAIL_BYTES, szAppended)) {
+        case CTLogView::TailEvent::Appended:
+            AppendToPage(szAppended);
+            break;
+
+        case CTLogView::TailEvent::Truncated:
+        case CTLogView::TailEvent::Rotated:
+            //Start over with the file now at the path
+            OpenFile();
+            break;
+
+        default:
+            break;
+        }
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+}
+
 void CLogViewer::OnStatusBar(HWND hwnd)
 {
     try{
@@ -1025,6 +1462,18 @@ void CLogViewer::OnDestroy(HWND hwnd)
     m_hStatus = nullptr;
     m_spTextDoc.Release();
 
+    ::KillTimer(hwnd, IDT_FOLLOWTAIL);
+    m_bFollowTail = false;
+    m_tailSource.Close();
+
+    m_logSearch.ResetIndex();
+    m_logIndex.Reset();
+    m_vFilterLines.clear();
+    m_logDoc.Detach();
+    m_mappedFile.Close();
+    m_nPageFirstLine = 0;
+    m_nPageLines = 0;
+
     m_pFR = nullptr;
 
     m_hDlgFind = nullptr;
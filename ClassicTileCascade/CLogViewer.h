@@ -9,6 +9,10 @@
 #include "MemMgmt.h"
 #include "win_log.h"
 #include "BaseWnd.h"
+#include "WinPlatform.h"
+#include "LogDocument.h"
+#include "LogSearch.h"
+#include "LogIndex.h"
 
 class CLogViewer : public BaseWnd<CLogViewer>
 {
@@ -62,12 +66,58 @@ protected:
 	////////////////////
 	//Helper functions
 	////////////////////
-	//(Re)open the file indicated in m_szFilePath 
-	//and move the rich edit box cursor to the end of the 
-	//box
+	//(Re)open the file indicated in m_szFilePath, load the 
+	//last page of lines and move the rich edit box cursor 
+	//to the end of the box
 	bool OpenFile();
 
+	//Replace the contents of the rich edit box with the page 
+	//of lines starting at (0-based) view line nFirstLine
+	void LoadPage(std::size_t nFirstLine);
 
+	//First view line of the page that ends right before (0-based) view line nEndLine
+	std::size_t PageStartBefore(std::size_t nEndLine);
+
+	//Without a filter, view lines are file lines. With a filter, view
+	//line n is the n-th file line that passes the filter
+	bool IsFiltered() const { return m_filter.IsActive(); }
+	std::size_t ViewLineCount();
+
+	//File line of (0-based) view line nViewLine. LineCount() past the last view line
+	std::size_t FileLine(std::size_t nViewLine);
+
+	//View line of (0-based) file line nFileLine or, if the filter hides it, 
+	//of the next line shown (the last one if there is none)
+	std::size_t ViewLine(std::size_t nFileLine);
+
+	//(0-based) file line of the cursor
+	std::size_t CursorFileLine();
+
+	//Parse the lines of the log that m_logIndex hasn't seen yet and select 
+	//the ones that pass m_filter. bRebuild starts over with all lines
+	void UpdateFilterLines(bool bRebuild);
+
+	//Show the lines that pass m_filter, keeping (0-based) file line nFileLine in view
+	void ApplyFilter(std::size_t nFileLine);
+
+	//Append lines read by the tail reader to the page and keep the 
+	//cursor at the end. Starts a new page when this one has grown too big
+	void AppendToPage(std::string_view szText);
+
+	//Start or stop following the end of the file
+	void SetFollowTail(bool bFollowTail);
+
+	//Load the page around (0-based) file line nLine unless it is on the 
+	//current page. Returns true if a page was loaded
+	bool ShowLine(std::size_t nLine);
+
+	//File offset of the character at position cp of the rich edit box
+	std::size_t OffsetFromCp(long cp);
+
+	//Select the file bytes [nStart, nEnd), loading their page if necessary
+	void SelectOffsets(std::size_t nStart, std::size_t nEnd);
+
+	//Search the mapped file (not the rich edit box) with m_logSearch
 	void FindString(LPFINDREPLACEW lpfr);
 
 	//Get the entire range of the doc
@@ -87,6 +137,10 @@ protected:
 
 	void SetLineNumbers(HWND hwnd);
 
+	//Whether the rich edit box can number the lines of the page: they have to be
+	//consecutive (no filter) and PARAFORMAT2 numbers them with a WORD
+	bool CanNumberLines() const { return !IsFiltered() && ((m_nPageFirstLine + m_nPageLines) <= MAX_NUMBERED_LINE); }
+
 	////////////////////////
 	//Top-level msg handlers
 	////////////////////////
@@ -97,6 +151,7 @@ protected:
 	void OnFindMsg(HWND hwnd, LPFINDREPLACEW lpfr);
 	void OnSetFocus(HWND hwnd, HWND hwndOldFocus);
 	LRESULT OnNotify(HWND hwnd, int uControl, NMHDR* lpNMHDR);
+	void OnTimer(HWND hwnd, UINT id);
 	void OnDestroy(HWND hwnd) override;
 
 	////////////////////////
@@ -110,6 +165,9 @@ protected:
 	void OnGoto(HWND hwnd);
 	void OnLineNumbers(HWND hwnd);
 	void OnStatusBar(HWND hwnd);
+	void OnPage(HWND hwnd, int id);
+	void OnFollowTail(HWND hwnd);
+	void OnFilter(HWND hwnd, int id);
 
 	////////////////////////
 	//WM_NOTIFY handlers
@@ -122,6 +180,7 @@ protected:
 	void OnInitEditMenu(HMENU hMenu);
 	void OnInitZoomMenu(HMENU hMenu);
 	void OnInitViewMenu(HMENU hMenu);
+	void OnInitFilterMenu(HMENU hMenu);
 
 	//////////////////////////////
 	//"Go to Line" dialog function
@@ -159,14 +218,59 @@ protected:
 	constexpr static UINT MIN_NUMERATOR = 10;
 	constexpr static UINT MAX_NUMERATOR = 500;
 
+	//Only a page of the log is loaded in the rich edit box at 
+	//a time. A page is at most PAGE_LINES lines and PAGE_BYTES bytes
+	constexpr static std::size_t PAGE_LINES = 10000;
+	constexpr static std::size_t PAGE_BYTES = 4 * 1024 * 1024;
+
+	//Largest line number PARAFORMAT2::wNumberingStart and the numbering can show
+	constexpr static std::size_t MAX_NUMBERED_LINE = 0xFFFF;
+
+	//"Follow Tail" polls the file every FOLLOW_TAIL_MS and appends at most
+	//FOLLOW_TAIL_BYTES per poll, so a burst of logging can't stall the UI
+	constexpr static UINT_PTR IDT_FOLLOWTAIL = 1;
+	constexpr static UINT FOLLOW_TAIL_MS = 500;
+	constexpr static std::size_t FOLLOW_TAIL_BYTES = 256 * 1024;
+
+	//Each search extends the search index by at most SEARCH_INDEX_BYTES, so the 
+	//cost of indexing a large log is spread over the first searches
+	constexpr static std::size_t SEARCH_INDEX_BYTES = 64 * 1024 * 1024;
+
 
 	//////////////////
 	//instance members
 	//////////////////
 	
+	//Msftedit.dll, which implements the rich edit box. Loaded for each viewer and 
+	//declared first, so that it is freed after everything that uses it
+	SPHMODULE m_hRtfLib;
+
 	//File to view
 	std::wstring m_szFilePath;
 
+	//Read-only mapping of m_szFilePath and the line index over it
+	Win32MappedFile m_mappedFile;
+	CTLogView::LogDocument m_logDoc;
+
+	//(0-based) view line of the first line in the rich edit box and
+	//the number of lines in the box
+	std::size_t m_nPageFirstLine = 0;
+	std::size_t m_nPageLines = 0;
+
+	//Reads what gets appended to m_szFilePath in "Follow Tail" mode
+	Win32TailSource m_tailSource;
+	CTLogView::TailReader m_tailReader;
+	bool m_bFollowTail = false;
+
+	//Find dialog searches over m_logDoc
+	CTLogView::LogSearch m_logSearch;
+
+	//Parsed line prefixes, built the first time a filter is set. 
+	//m_vFilterLines are the file lines that pass m_filter
+	CTLogView::LogIndex m_logIndex;
+	CTLogView::LineFilter m_filter;
+	std::vector<std::size_t> m_vFilterLines;
+
 	HWND m_hEdit = nullptr;
 	HWND m_hStatus = nullptr;
 
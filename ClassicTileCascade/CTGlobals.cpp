@@ -26,9 +26,8 @@
 #include "WinUtils.h"
 #include "CTGlobals.h"
 
-const  std::wstring CTGlobals::LOG_PATH = []() {
-    constexpr static std::wstring_view LOG_NAME = L"ClassicTileCascade.log";
-
+static std::wstring LocalAppDataPath(std::wstring_view szName)
+{
     std::wstring szLogPath;
 
     LPWSTR lpwstrPath = nullptr;
@@ -37,11 +36,24 @@ const  std::wstring CTGlobals::LOG_PATH = []() {
         std::wstring szPath = lpwstrPath;
         ::CoTaskMemFree(lpwstrPath);
 
-        CTWinUtils::PathCombineEx(szLogPath, static_cast<std::wstring_view>(szPath), LOG_NAME);
+        CTWinUtils::PathCombineEx(szLogPath, static_cast<std::wstring_view>(szPath), szName);
     }
 
     return szLogPath;
-}();
+}
+
+const  std::wstring CTGlobals::LOG_PATH = LocalAppDataPath(L"ClassicTileCascade.log");
+
+// Binary log, written instead of LOG_PATH when the "BinaryLog" registry value is set.
+// Decode with "ClassicTileCascade.exe /DECODELOG"
+const  std::wstring CTGlobals::BIN_LOG_PATH = LocalAppDataPath(L"ClassicTileCascade.blog");
+
+// Text rendering of BIN_LOG_PATH, decoded when the log viewer opens the binary log
+const  std::wstring CTGlobals::DECODED_LOG_PATH = BIN_LOG_PATH + L".log";
+
+// Chrome trace-event JSON of the start-up spans, written when logging is on.
+// Open it in Perfetto (ui.perfetto.dev) or about:tracing
+const  std::wstring CTGlobals::TRACE_PATH = LocalAppDataPath(L"ClassicTileCascade-startup.json");
 
 const std::wstring CTGlobals::CURR_MODULE_PATH = []() {
     std::wstring szCurrModulePath;
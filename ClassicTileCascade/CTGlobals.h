@@ -9,5 +9,8 @@
 namespace CTGlobals
 {
 	extern const std::wstring LOG_PATH;
+	extern const std::wstring BIN_LOG_PATH;
+	extern const std::wstring DECODED_LOG_PATH;
+	extern const std::wstring TRACE_PATH;
 	extern const std::wstring CURR_MODULE_PATH;
 }
\ No newline at end of file
@@ -32,11 +32,32 @@
 #include "ClassicTileWnd.h"
 #include "ClassicTileRegUtil.h"
 #include "CTGlobals.h"
+#include "SpanRecorder.h"
+#include "PerfCounters.h"
+#include "WinPlatform.h"
 
 constexpr static std::wstring_view MUTEX_GUID = L"{436805EB-7307-4A82-A1AB-C87DC5EE85B6";
-
-bool CheckAlreadyRunning(UINT uRetries);
+constexpr static std::wstring_view READY_EVENT_NAME = L"{436805EB-7307-4A82-A1AB-C87DC5EE85B6}Ready";
+constexpr static size_t LOG_ASYNC_CAPACITY = 4096;
+
+// How long a second launch waits for the running instance to create its window
+// or to exit, and how long it waits for it to answer a forwarded command line
+constexpr static DWORD INSTANCE_WAIT_MS = 2500;
+constexpr static UINT FORWARD_TIMEOUT_MS = 2000;
+
+// Owned by the process that runs the notification icon (or registers the app) for
+// its whole lifetime. The ready event is set once its window can receive commands
+static SPHANDLE_EX s_hInstanceMutex;
+static SPHANDLE_EX s_hReadyEvent;
+
+void GetArgs(CTInstance::ArgVector& vArgs);
+bool AcquireInstance(const CTInstance::ArgVector& vArgs, int& nExitCode);
+void ReleaseInstance();
+std::optional<CTInstance::Reply> ForwardArgs(HWND hwnd, const CTInstance::ArgVector& vArgs);
+bool DecodeLog(bool& fSuccess);
+bool PrintCounters(bool& fSuccess);
 bool RegUnReg(bool& fSuccess);
+void WriteStartupTrace();
 bool RegUnRegAsUser(std::wstring_view szFirstArg);
 bool Unregister();
 bool Register();
@@ -50,29 +71,83 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
     // In InitInstance, the ClassicTileWnd class will determine whether file 
     // logging is on or off based on thesetting in "Settings | Logging" menu item
     log_set_quiet(true);
+    log_set_bytes_fn([](size_t nBytes) { CTCounters::PerfCounters::Global().Add(CTCounters::Counter::LogBytes, nBytes); });
+
+    // Ends once the message loop is about to start
+    std::optional<CTTrace::ScopedSpan> startupSpan;
+    startupSpan.emplace("Startup");
+
+    // "/DECODELOG [binary log [text log]]" renders a binary log as text. It
+    // doesn't touch the running instance, so it's handled before the mutex check
+    bool bDecoded = false;
+    if (DecodeLog(bDecoded)) {
+        return bDecoded ? 0 : 1;
+    }
+
+    // "/COUNTERS" prints the counters of the running instance (see PerfCounters.h)
+    // to the standard output or to the console it was started from
+    if (PrintCounters(bDecoded)) {
+        return bDecoded ? 0 : 1;
+    }
+
+    CTInstance::ArgVector vArgs;
+    GetArgs(vArgs);
+    const CTInstance::Command command = CTInstance::ParseCommand(vArgs);
+
+    // /REGISTER and /UNREGISTER only start /REGISTERUSER or /UNREGISTERUSER as 
+    // the logged in user, which goes through the single instance check below
+    bool bSuccess = false;
+    if (((command == CTInstance::Command::Register) || (command == CTInstance::Command::Unregister)) && RegUnReg(bSuccess)) {
+        return bSuccess ? 0 : 1;
+    }
 
     // Letting the application run more than once would create multiple 
-    // notification icons. This function uses a mutex to determine whether
-    // app is already running. ABEND if another instance is running.
-    if (CheckAlreadyRunning(5)) {
-        return 1;
+    // notification icons. If another instance is running, hand the command
+    // line over to it and exit
+    int nExitCode = 0;
+    if (!AcquireInstance(vArgs, nExitCode)) {
+        return nExitCode;
+    }
+
+    // An action with no instance running is done right here, without the notification
+    // icon. Later launches shouldn't wait for it, so it doesn't keep the instance
+    if (CTInstance::IsAction(command)) {
+        ReleaseInstance();
+        return ClassicTileWnd::RunHeadless(command) ? 0 : 1;
     }
 
-    // Check whether the /REGISTER,/UNREGISTER, /REGISTERUSER
-    // or /UNREGISTERUSER command line parameters have been passed
-    // These are passed by the Windows installer to orchestrate the 
+    // Check whether the /REGISTERUSER or /UNREGISTERUSER command line parameters
+    // have been passed. These are passed by the Windows installer to orchestrate the 
     // creation or deletion of the registry entries for the application
-    bool bSuccess = false;
     if (RegUnReg(bSuccess)) {
         return bSuccess ? 0 : 1;
     }
     
+    // From here on the file log is written by a background thread so that
+    // logging never blocks the UI thread on disk I/O. Messages are dropped
+    // (and the drop is reported in the log) rather than stalling the UI
+    log_start_async(LOG_ASYNC_CAPACITY, LOG_OVERFLOW_DROP);
+
     // No command line parameters passed - create notification icon and
     // wire the message handlers for the notification icon
     if(!ClassicTileWnd::Run(hInstance)){
+        log_stop_async();
         return 1;
     }
 
+    // Later launches can forward their command lines from now on
+    if (s_hReadyEvent) {
+        ::SetEvent(s_hReadyEvent.get());
+    }
+
+    // Monitoring tools read the counters from shared memory from now on
+    if (!CTCounters::PerfCounters::Global().Publish(std::make_unique<Win32SharedMemory>(), CTCounters::SHARED_NAME, ::GetCurrentProcessId(), static_cast<std::uint64_t>(time(nullptr)), Win32SharedMemory::IsProcessRunning)) {
+        log_warn("Unable to publish the performance counters, or another running instance has published them <%lu>.", ::GetLastError());
+    }
+
+    startupSpan.reset();
+    WriteStartupTrace();
+
     // if we made it to here, our notification icon is created and 
     // message handlers are set up. Run a normal windows msg loop
     MSG msg = { 0 };
@@ -85,29 +160,191 @@ int APIENTRY wWinMain(_In_ HINSTANCE hInstance,
         }
     }
 
+    log_stop_async();
     return static_cast<int>(msg.wParam);
 }
 
-bool CheckAlreadyRunning(UINT uRetries)
+void GetArgs(CTInstance::ArgVector& vArgs)
 {
-    bool bRetVal = true;
-    for (UINT i = 0; bRetVal && (i < uRetries); i++) {
-        HANDLE hFirst = ::CreateMutexW(nullptr, FALSE, MUTEX_GUID.data());
-        bRetVal = (hFirst && (::GetLastError() == ERROR_ALREADY_EXISTS));
-        if (bRetVal ) {
-            ::CloseHandle(hFirst);
-            if (i != (uRetries - 1)) {
-                ::Sleep(500);
+    vArgs.clear();
+    int nArgs = 0;
+    LPWSTR* lpszArglist = ::CommandLineToArgvW(GetCommandLineW(), &nArgs);
+    if (lpszArglist) {
+        //Skip the program name
+        for (int i = 1; i < nArgs; i++) {
+            vArgs.emplace_back(reinterpret_cast<const char16_t*>(lpszArglist[i]));
+        }
+        LocalFree(lpszArglist);
+    }
+}
+
+bool AcquireInstance(const CTInstance::ArgVector& vArgs, int& nExitCode)
+{
+    CT_SPAN("AcquireInstance");
+    using CTInstance::Reply;
+
+    nExitCode = 0;
+    s_hReadyEvent.reset(::CreateEventW(nullptr, TRUE, FALSE, READY_EVENT_NAME.data()));
+    s_hInstanceMutex.reset(::CreateMutexW(nullptr, TRUE, MUTEX_GUID.data()));
+    if (!s_hInstanceMutex || (::GetLastError() != ERROR_ALREADY_EXISTS)) {
+        return true;
+    }
+
+    //Another process owns the mutex. It is either running the notification icon 
+    //(perhaps still starting up), registering the app, or exiting
+    const ULONGLONG ullGiveUp = ::GetTickCount64() + INSTANCE_WAIT_MS;
+    bool bForward = true;
+    for (;;) {
+        HWND hwnd = bForward ? ::FindWindowW(ClassicTileWnd::CLASS_NAME.data(), nullptr) : nullptr;
+        if (hwnd) {
+            const std::optional<Reply> reply = ForwardArgs(hwnd, vArgs);
+            if (reply == Reply::Handled) {
+                return false;
+            }
+            if (reply == Reply::Rejected) {
+                nExitCode = 1;
+                return false;
+            }
+
+            //The running instance is exiting (Yield), or went away before it answered. 
+            //Wait for the mutex only from now on
+            bForward = false;
+        }
+
+        const ULONGLONG ullNow = ::GetTickCount64();
+        const DWORD dwTimeout = (ullNow < ullGiveUp) ? static_cast<DWORD>(ullGiveUp - ullNow) : 0;
+        HANDLE hObjects[] = { s_hInstanceMutex.get(), s_hReadyEvent.get() };
+        const DWORD nObjects = (bForward && s_hReadyEvent) ? 2 : 1;
+        switch (::WaitForMultipleObjects(nObjects, hObjects, FALSE, dwTimeout)) {
+        case WAIT_OBJECT_0:
+        case WAIT_ABANDONED_0:
+            //The other process exited, this one takes over. The ready event may still
+            //be set by it, until this process has its own window
+            if (s_hReadyEvent) {
+                ::ResetEvent(s_hReadyEvent.get());
+            }
+            return true;
+
+        case WAIT_OBJECT_0 + 1:
+            //The window exists now. If it still can't be found, the ready event is 
+            //left over from an instance that is exiting
+            if (!::FindWindowW(ClassicTileWnd::CLASS_NAME.data(), nullptr)) {
+                bForward = false;
             }
+            break;
+
+        default:
+            nExitCode = 1;
+            return false;
+        }
+    }
+}
+
+void ReleaseInstance()
+{
+    if (s_hInstanceMutex) {
+        ::ReleaseMutex(s_hInstanceMutex.get());
+        s_hInstanceMutex.reset();
+    }
+    s_hReadyEvent.reset();
+}
+
+std::optional<CTInstance::Reply> ForwardArgs(HWND hwnd, const CTInstance::ArgVector& vArgs)
+{
+    std::vector<std::uint8_t> vPayload;
+    if (!CTInstance::EncodeArgs(vArgs, vPayload)) {
+        return CTInstance::Reply::Rejected;
+    }
+
+    COPYDATASTRUCT cds = { 0 };
+    cds.dwData = CTInstance::COMMAND_TAG;
+    cds.cbData = static_cast<DWORD>(vPayload.size());
+    cds.lpData = vPayload.data();
+
+    DWORD_PTR dwResult = 0;
+    if (!::SendMessageTimeoutW(hwnd, WM_COPYDATA, 0, reinterpret_cast<LPARAM>(&cds), SMTO_ABORTIFHUNG | SMTO_ERRORONEXIT, FORWARD_TIMEOUT_MS, &dwResult)) {
+        return std::nullopt;
+    }
+    return static_cast<CTInstance::Reply>(dwResult);
+}
+
+
+
+bool DecodeLog(bool& fSuccess)
+{
+    static constexpr std::wstring_view DECODELOG = L"/DECODELOG";
+
+    bool fRetVal = false;
+    fSuccess = false;
+    int nArgs = 0;
+    LPWSTR* lpszArglist = ::CommandLineToArgvW(GetCommandLineW(), &nArgs);
+    if (lpszArglist) {
+        std::vector<std::wstring> vArgs(lpszArglist, lpszArglist + nArgs);
+        LocalFree(lpszArglist);
+
+        if ((vArgs.size() > 1) && (::lstrcmpiW(vArgs[1].c_str(), DECODELOG.data()) == 0)) {
+            fRetVal = true;
+
+            std::wstring szIn = (vArgs.size() > 2) ? vArgs[2] : CTGlobals::BIN_LOG_PATH;
+            std::wstring szOut = (vArgs.size() > 3) ? vArgs[3] : szIn + L".log";
+
+            SPFILE pIn(_wfsopen(szIn.c_str(), L"rb", _SH_DENYNO));
+            SPFILE pOut(pIn ? _wfopen(szOut.c_str(), L"w") : nullptr);
+            fSuccess = pIn && pOut && (log_decode_bin(pIn.get(), pOut.get()) == 0);
         }
     }
-    return bRetVal;
+
+    return fRetVal;
 }
 
+bool PrintCounters(bool& fSuccess)
+{
+    static constexpr std::wstring_view COUNTERS = L"/COUNTERS";
 
+    bool fRetVal = false;
+    fSuccess = false;
+    int nArgs = 0;
+    LPWSTR* lpszArglist = ::CommandLineToArgvW(GetCommandLineW(), &nArgs);
+    if (lpszArglist) {
+        const bool bCounters = (nArgs > 1) && (::lstrcmpiW(lpszArglist[1], COUNTERS.data()) == 0);
+        LocalFree(lpszArglist);
+
+        if (bCounters) {
+            fRetVal = true;
+
+            std::string szText;
+            Win32SharedMemory memory;
+            CTCounters::CounterSnapshot snapshot;
+            if (CTCounters::ReadCounters(memory.Open(CTCounters::SHARED_NAME, sizeof(CTCounters::CounterBlock)), sizeof(CTCounters::CounterBlock), snapshot)) {
+                CTCounters::FormatCounters(snapshot, szText);
+                fSuccess = true;
+            } else {
+                szText = "ClassicTileCascade is not running.\n";
+            }
+
+            //This is a GUI app: its standard output is only there if it was redirected
+            HANDLE hOut = ::GetStdHandle(STD_OUTPUT_HANDLE);
+            SPHANDLE_EX hConsole;
+            if ((!hOut || (hOut == INVALID_HANDLE_VALUE)) && ::AttachConsole(ATTACH_PARENT_PROCESS)) {
+                hOut = ::CreateFileW(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, 0, nullptr);
+                if (hOut != INVALID_HANDLE_VALUE) {
+                    hConsole.reset(hOut);
+                }
+            }
+
+            DWORD dwWritten = 0;
+            if (!hOut || (hOut == INVALID_HANDLE_VALUE) || !::WriteFile(hOut, szText.data(), static_cast<DWORD>(szText.size()), &dwWritten, nullptr)) {
+                fSuccess = false;
+            }
+        }
+    }
+
+    return fRetVal;
+}
 
 bool RegUnReg(bool& fSuccess)
 {
+    CT_SPAN("RegUnReg");
     static constexpr std::wstring_view REG = L"/REGISTER";
     static constexpr std::wstring_view UNREG = L"/UNREGISTER";
     static constexpr std::wstring_view REGUSER = L"/REGISTERUSER";
@@ -159,6 +396,25 @@ bool RegUnReg(bool& fSuccess)
 
 }
 
+void WriteStartupTrace()
+{
+    bool bLogging = false;
+    ClassicTileRegUtil::GetRegLogging(bLogging);
+    if (!bLogging) {
+        return;
+    }
+
+    std::string szJson;
+    CTTrace::SpanRecorder::Global().ExportChromeTrace(szJson, ::GetCurrentProcessId());
+
+    SPFILE pFile(_wfopen(CTGlobals::TRACE_PATH.c_str(), L"wb"));
+    if (pFile && (fwrite(szJson.data(), 1, szJson.size(), pFile.get()) == szJson.size())) {
+        log_info("Start-up trace written to <%S>.", CTGlobals::TRACE_PATH.c_str());
+    } else {
+        log_warn("Unable to write the start-up trace to <%S>.", CTGlobals::TRACE_PATH.c_str());
+    }
+}
+
 bool RegUnRegAsUser(std::wstring_view szFirstArg)
 {
     bool fSuccess = false;
@@ -241,6 +497,9 @@ bool Register()
         eval_error_es(ClassicTileRegUtil::SetRegStatusBar(true));
         log_info_procid("Added Status Bar registry value.");
 
+        eval_error_es(ClassicTileRegUtil::SetRegBinaryLog(false));
+        log_info_procid("Added Binary Log registry value.");
+
         eval_error_es(ClassicTileRegUtil::SetRegRun());
         log_info_procid("Added Auto Run registry value.");
 
@@ -40,6 +40,10 @@ constexpr static std::wstring_view REG_RUN_NAME = L"ClassicTileCascade";
 constexpr static std::wstring_view REG_LOGGING_VAL = L"Logging";
 constexpr static std::wstring_view REG_DEFWNDTILE_VAL = L"DefWndTile";
 constexpr static std::wstring_view REG_STATUSBAR_VAL = L"StatusBar";
+constexpr static std::wstring_view REG_BINARYLOG_VAL = L"BinaryLog";
+constexpr static std::wstring_view REG_MINIMIZEANIMATIONS_VAL = L"MinimizeAnimations";
+constexpr static std::wstring_view REG_MINANIMATETORESTORE_VAL = L"MinAnimateToRestore";
+constexpr static std::wstring_view REG_HOTKEY_VAL_PREFIX = L"Hotkey";
 
 
 //LONG OpenOrCreateRegKey(const std::wstring& szPath, bool bCreate, SPHKEY& hKey)
@@ -182,3 +186,56 @@ LONG ClassicTileRegUtil::SetRegStatusBar(bool bStatusBar)
 {
     return SetBoolRegValue(REG_KEY_PATH, REG_STATUSBAR_VAL, bStatusBar, true);
 }
+
+LONG ClassicTileRegUtil::GetRegBinaryLog(bool& bBinaryLog)
+{
+    return GetBoolRegValue(REG_KEY_PATH, REG_BINARYLOG_VAL, bBinaryLog);
+}
+
+LONG ClassicTileRegUtil::SetRegBinaryLog(bool bBinaryLog)
+{
+    return SetBoolRegValue(REG_KEY_PATH, REG_BINARYLOG_VAL, bBinaryLog, true);
+}
+
+LONG ClassicTileRegUtil::GetRegMinimizeAnimations(bool& bMinimizeAnimations)
+{
+    return GetBoolRegValue(REG_KEY_PATH, REG_MINIMIZEANIMATIONS_VAL, bMinimizeAnimations);
+}
+
+LONG ClassicTileRegUtil::SetRegMinimizeAnimations(bool bMinimizeAnimations)
+{
+    return SetBoolRegValue(REG_KEY_PATH, REG_MINIMIZEANIMATIONS_VAL, bMinimizeAnimations, true);
+}
+
+LONG ClassicTileRegUtil::GetRegMinAnimateToRestore(DWORD& dwMinAnimate)
+{
+    return GetDWORDRegValue(REG_KEY_PATH, REG_MINANIMATETORESTORE_VAL, dwMinAnimate);
+}
+
+LONG ClassicTileRegUtil::SetRegMinAnimateToRestore(DWORD dwMinAnimate)
+{
+    return SetDWORDRegValue(REG_KEY_PATH, REG_MINANIMATETORESTORE_VAL, dwMinAnimate, true);
+}
+
+LONG ClassicTileRegUtil::DeleteRegMinAnimateToRestore()
+{
+    SPHKEY hKey;
+    LONG lReturnValue = OpenOrCreateRegKey(REG_KEY_PATH, false, hKey);
+    if (lReturnValue == ERROR_SUCCESS) {
+        lReturnValue = ::RegDeleteValueW(hKey.get(), REG_MINANIMATETORESTORE_VAL.data());
+    }
+    return lReturnValue;
+}
+
+LONG ClassicTileRegUtil::GetRegHotkey(std::wstring_view szAction, DWORD& dwHotkey)
+{
+    dwHotkey = 0;
+    const std::wstring szValueName = std::wstring(REG_HOTKEY_VAL_PREFIX) + std::wstring(szAction);
+    return GetDWORDRegValue(REG_KEY_PATH, szValueName, dwHotkey);
+}
+
+LONG ClassicTileRegUtil::SetRegHotkey(std::wstring_view szAction, DWORD dwHotkey)
+{
+    const std::wstring szValueName = std::wstring(REG_HOTKEY_VAL_PREFIX) + std::wstring(szAction);
+    return SetDWORDRegValue(REG_KEY_PATH, szValueName, dwHotkey, true);
+}
@@ -22,4 +22,17 @@ namespace ClassicTileRegUtil
 	LONG SetRegDefWndTile(bool bDefWndTile);
 	LONG GetRegStatusBar(bool& bStatusBar);
 	LONG SetRegStatusBar(bool bStatusBar);
+	LONG GetRegBinaryLog(bool& bBinaryLog);
+	LONG SetRegBinaryLog(bool bBinaryLog);
+	LONG GetRegMinimizeAnimations(bool& bMinimizeAnimations);
+	LONG SetRegMinimizeAnimations(bool bMinimizeAnimations);
+	// Session's iMinAnimate (SPI_GETANIMATION) to put back at the next start if the process
+	// ends while Show Desktop/Undo Minimize has the animation turned off
+	LONG GetRegMinAnimateToRestore(DWORD& dwMinAnimate);
+	LONG SetRegMinAnimateToRestore(DWORD dwMinAnimate);
+	LONG DeleteRegMinAnimateToRestore();
+	// Global hotkey of the action named szAction (value "Hotkey<szAction>"). The low word
+	// is the virtual-key code, the high word the MOD_* flags of RegisterHotKey. 0 means none
+	LONG GetRegHotkey(std::wstring_view szAction, DWORD& dwHotkey);
+	LONG SetRegHotkey(std::wstring_view szAction, DWORD dwHotkey);
 }
\ No newline at end of file
@@ -28,8 +28,12 @@
 #include "WinUtils.h"
 #include "CTGlobals.h"
 #include "ClassicTileWnd.h"
+#include "SpanRecorder.h"
+#include "PerfCounters.h"
 
 #define SWM_TRAYMSG	WM_APP //the message ID sent to our window
+#define SWM_ACTIONDONE	(WM_APP + 1) //posted by the action executor when it has results
+#define SWM_ACTIVATE	(WM_APP + 2) //posted by Undo Minimize with the window to activate
 
 //Message Handlers
 /* BOOL Cls_OnSWMTrayMsg(HWND hwnd, WORD wNotifEvent, WORD wIconId, int x, int y) */
@@ -37,19 +41,56 @@
     ((fn)((hwnd), LOWORD(lParam), HIWORD(lParam), GET_X_LPARAM(wParam), GET_Y_LPARAM(wParam)), 0L)
 #define FORWARD_SWM_TRAYMSG(hwnd, wNotifEvent, wIconId, x, y, fn) \
 	(void)(fn)((hwnd), SWM_TRAYMSG, MAKEWPARAM((x), (y)), MAKELPARAM((wNotifEvent), (wIconId)))
+/* void Cls_OnSWMActionDone(HWND hwnd) */
+#define HANDLE_SWM_ACTIONDONE(hwnd, wParam, lParam, fn) \
+    ((fn)(hwnd), 0L)
+/* void Cls_OnSWMActivate(HWND hwnd, HWND hwndActivate) */
+#define HANDLE_SWM_ACTIVATE(hwnd, wParam, lParam, fn) \
+    ((fn)((hwnd), reinterpret_cast<HWND>(wParam)), 0L)
+
+//Actions that can have a hotkey: the registry value name (after "Hotkey") and the control
+//of the Hotkeys dialog
+struct HotkeyAction
+{
+    int id;
+    std::wstring_view szValue;
+    int idControl;
+};
+constexpr static HotkeyAction HOTKEY_ACTIONS[] = {
+    {ID_FILE_CASCADEWINDOWS, L"Cascade", IDC_HOTKEY_CASCADE},
+    {ID_FILE_SHOWWINDOWSSTACKED, L"Stacked", IDC_HOTKEY_STACKED},
+    {ID_FILE_SHOWWINDOWSSIDEBYSIDE, L"SideBySide", IDC_HOTKEY_SIDEBYSIDE},
+    {ID_FILE_SHOWTHEDESKTOP, L"ShowDesktop", IDC_HOTKEY_SHOWDESKTOP},
+    {ID_FILE_UNDOMINIMIZE, L"UndoMinimize", IDC_HOTKEY_UNDOMINIMIZE}
+};
+
+//Modifiers of RegisterHotKey (MOD_*) and of the hotkey control (HOTKEYF_*). The control
+//has no Windows key
+constexpr static std::pair<WORD, BYTE> HOTKEY_MODIFIERS[] = {
+    {MOD_ALT, HOTKEYF_ALT},
+    {MOD_CONTROL, HOTKEYF_CONTROL},
+    {MOD_SHIFT, HOTKEYF_SHIFT}
+};
 
 ClassicTileWnd ClassicTileWnd::s_classicTileWnd;
 
 ClassicTileWnd::ClassicTileWnd()
-    : BaseWnd(true){}
+    : BaseWnd(true),
+      m_filterPipeline(m_attributeSource, &m_attributeCache),
+      m_desktopMinimizer(m_minimizeBackend)
+{
+    m_filterPipeline.AddTileableStages();
+}
 
 
 bool ClassicTileWnd::BeforeWndCreate(bool bRanPrior) 
 {
-    constexpr static std::wstring_view CLASS_NAME = L"ClassicTileWndClass";
+    CT_SPAN("BeforeWndCreate");
 
     ClassicTileRegUtil::GetRegLogging(m_bLogging);
+    ClassicTileRegUtil::GetRegBinaryLog(m_bBinaryLog);
     if (m_bLogging) {
+        CT_SPAN("EnableLogging");
         EnableLogging();
     }
 
@@ -90,6 +131,12 @@ bool ClassicTileWnd::BeforeWndCreate(bool bRanPrior)
     m_bAutoStart = (ClassicTileRegUtil::CheckRegRun() == ERROR_SUCCESS);
 
     ClassicTileRegUtil::GetRegDefWndTile(m_bDefWndTile);
+    //Animated unless turned off, like the shell's Show Desktop
+    if (ClassicTileRegUtil::GetRegMinimizeAnimations(m_bMinimizeAnimations) != ERROR_SUCCESS) {
+        m_bMinimizeAnimations = true;
+    }
+    m_desktopMinimizer.SetAnimate(m_bMinimizeAnimations);
+    Win32MinimizeBackend::RestoreAnimation();
 
     m_wcex.lpszClassName = CLASS_NAME.data();
 
@@ -98,13 +145,45 @@ bool ClassicTileWnd::BeforeWndCreate(bool bRanPrior)
 
 bool ClassicTileWnd::AfterWndCreate(bool bRanPrior)
 {
-    eval_fatal_nz(AddTrayIcon(m_hWnd));
+    CT_SPAN("AfterWndCreate");
+
+    {
+        CT_SPAN("AddTrayIcon");
+        eval_fatal_nz(AddTrayIcon(m_hWnd));
+    }
+
+    {
+        CT_SPAN("LoadMenu");
+        m_hMenu.reset(eval_error_nz(::LoadMenuW(m_hInst, MAKEINTRESOURCEW(IDR_MENUPOPUP))));
+        m_hPopupMenu = eval_error_nz(::GetSubMenu(m_hMenu.get(), 0));
+        eval_error_nz(CTWinUtils::SetSubMenuDataFromItemData(m_hPopupMenu));
+    }
+
+    StartWindowRegistry();
+
+    //Falls back to CTWinUtils::ShellHelper if it doesn't start
+    {
+        CT_SPAN("ShellWorker::Start");
+        m_shellWorker.Start();
+    }
 
-    m_hMenu.reset(eval_error_nz(::LoadMenuW(m_hInst, MAKEINTRESOURCEW(IDR_MENUPOPUP))));
-    m_hPopupMenu = eval_error_nz(::GetSubMenu(m_hMenu.get(), 0));
-    eval_error_nz(CTWinUtils::SetSubMenuDataFromItemData(m_hPopupMenu));
+    ReportHotkeyFailures(RegisterHotkeys(), nullptr);
 
-    log_info("ClassicTileCascade starting.");
+    //Let later launches forward their command lines even if this process is elevated
+    if (!::ChangeWindowMessageFilterEx(m_hWnd, WM_COPYDATA, MSGFLT_ALLOW, nullptr)) {
+        log_warn("Unable to allow WM_COPYDATA <%lu>, later launches may not reach this instance.", ::GetLastError());
+    }
+
+    try {
+        //Clicks on the notification icon closer together than a double-click are one burst
+        m_actionExecutor.SetCoalesceDelay(std::chrono::milliseconds(::GetDoubleClickTime()));
+        m_actionExecutor.Start([hwnd = m_hWnd] { ::PostMessageW(hwnd, SWM_ACTIONDONE, 0, 0); });
+    } catch (...) {
+        log_error("Unable to start the action executor, actions will run on the UI thread");
+    }
+
+    log_info("ClassicTileCascade starting <%lld> us after process creation.", CTWinUtils::GetProcessAgeUs());
+    LogFootprint("startup");
     
     return true;
 }
@@ -120,8 +199,14 @@ LRESULT ClassicTileWnd::ClassWndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM
         HANDLE_MSG(hwnd, WM_CLOSE, OnClose);
         HANDLE_MSG(hwnd, WM_DESTROY, OnDestroy);
         HANDLE_MSG(hwnd, WM_INITMENUPOPUP, OnInitMenuPopup);
+        HANDLE_MSG(hwnd, SWM_ACTIONDONE, OnActionDone);
+        HANDLE_MSG(hwnd, SWM_ACTIVATE, OnSWMActivate);
+        HANDLE_MSG(hwnd, WM_HOTKEY, OnHotKey);
+        HANDLE_MSG(hwnd, WM_COPYDATA, OnCopyData);
     default:
         if (uMsg == WM_TASKBARCREATED) {
+            //Explorer restarted, so the cached shell object belongs to the old one
+            m_shellWorker.Reset();
             try {
                 eval_fatal_nz(AddTrayIcon(hwnd));
             } catch (const LoggingException& le) {
@@ -201,37 +286,14 @@ void ClassicTileWnd::OnSWMTrayMsg(HWND hwnd, WORD wNotifEvent, WORD wIconId, int
 
 void ClassicTileWnd::OnCommand(HWND hwnd, int id, HWND hwndCtl, UINT codeNotify)
 {
-    using TILE_CASCADE_FUNC = WORD(WINAPI*)(HWND, UINT, const RECT*, UINT, const HWND*);
-    
-    auto TileCascadeHelper = [this](TILE_CASCADE_FUNC pTileCascadeFunc, UINT uHow){
-        HwndVector hwndVector;
-        if (!m_bDefWndTile && EnumWindows(s_EnumProc, reinterpret_cast<LPARAM>(&hwndVector)) && (hwndVector.size() > 0)) {
-            (*pTileCascadeFunc)(nullptr, uHow, nullptr, static_cast<UINT>(hwndVector.size()), hwndVector.data());
-        } else {
-            (*pTileCascadeFunc)(nullptr, uHow, nullptr, 0, nullptr);
-        }
-    };
-
     switch (id)
     {
     case ID_FILE_CASCADEWINDOWS:
-        TileCascadeHelper(&CascadeWindows, MDITILE_ZORDER);
-        break;
-
     case ID_FILE_SHOWWINDOWSSTACKED:
-        TileCascadeHelper(&TileWindows, MDITILE_HORIZONTAL);
-        break;
-
     case ID_FILE_SHOWWINDOWSSIDEBYSIDE:
-        TileCascadeHelper(&TileWindows, MDITILE_VERTICAL);
-        break;
-
     case ID_FILE_SHOWTHEDESKTOP:
-        CTWinUtils::ShellHelper(&IShellDispatch::MinimizeAll);
-        break;
-
     case ID_FILE_UNDOMINIMIZE:
-        CTWinUtils::ShellHelper(&IShellDispatch::UndoMinimizeALL);
+        PostAction(id);
         break;
 
     case IDM_EXIT:
@@ -262,8 +324,20 @@ void ClassicTileWnd::OnCommand(HWND hwnd, int id, HWND hwndCtl, UINT codeNotify)
         OnSettingsDefWndTile();
         break;
 
+    case ID_SETTINGS_MINANIMATIONS:
+        OnSettingsMinAnimations();
+        break;
+
     case ID_SETTINGS_OPENLOGFILE:
-        OnSettingsOpenLogFile(hwnd, CTGlobals::LOG_PATH);
+        OnSettingsOpenLogFile(hwnd, LogPath());
+        break;
+
+    case ID_SETTINGS_DIAGNOSTICS:
+        OnSettingsDiagnostics(hwnd);
+        break;
+
+    case ID_SETTINGS_HOTKEYS:
+        OnSettingsHotkeys(hwnd);
         break;
 
     default:
@@ -274,11 +348,224 @@ void ClassicTileWnd::OnCommand(HWND hwnd, int id, HWND hwndCtl, UINT codeNotify)
 
 }
 
+void ClassicTileWnd::PostAction(int id, std::optional<std::chrono::steady_clock::time_point> tpHotkey)
+{
+    //The action runs later, on another thread, with the settings as they are now
+    const bool bDefWndTile = m_bDefWndTile;
+    CTAction::Action action;
+    action.nId = id;
+    action.fnRun = [this, id, bDefWndTile, tpHotkey](const CTAction::ActionContext& context) {
+        RunAction(id, bDefWndTile, context);
+        if (tpHotkey && !context.IsCancelled()) {
+            const auto usElapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - *tpHotkey).count();
+            log_info("Hotkey action <%d> done <%lld> us after the key press.", id, static_cast<long long>(usElapsed));
+        }
+    };
+    action.timeout = std::chrono::milliseconds(ACTION_TIMEOUT_MS);
+
+    //All of these rearrange the whole desktop, only the latest one counts
+    action.bCoalesce = true;
+
+    if (!m_actionExecutor.Post(std::move(action))) {
+        RunAction(id, bDefWndTile, CTAction::ActionContext(CTAction::Clock::now() + std::chrono::milliseconds(ACTION_TIMEOUT_MS)));
+    }
+}
+
+bool ClassicTileWnd::RunAction(int id, bool bDefWndTile, const CTAction::ActionContext& context)
+{
+    using TILE_CASCADE_FUNC = WORD(WINAPI*)(HWND, UINT, const RECT*, UINT, const HWND*);
+
+    const auto tpStart = std::chrono::steady_clock::now();
+    StageTimes times;
+    times.fill(-1);
+    bool bRetVal = true;
+    
+    auto TileCascadeHelper = [this, bDefWndTile, &context, &times](TILE_CASCADE_FUNC pTileCascadeFunc, UINT uHow, CTLayout::Arrangement arrangement){
+        HwndVector hwndVector;
+        if (!bDefWndTile && GetTileableWindows(hwndVector, &times) && (hwndVector.size() > 0)) {
+            return !context.IsCancelled() && TileCascadeCustom(hwndVector, arrangement, context, &times);
+        }
+
+        //Windows does all the stages at once. It returns 0 both on failure and when
+        //there is nothing to arrange, only the error tells them apart
+        const auto tpPlace = std::chrono::steady_clock::now();
+        ::SetLastError(ERROR_SUCCESS);
+        const bool bArranged = ((*pTileCascadeFunc)(nullptr, uHow, nullptr, 0, nullptr) != 0) || (::GetLastError() == ERROR_SUCCESS);
+        times[static_cast<std::size_t>(ActionStage::Placement)] = ElapsedUs(tpPlace);
+        if (!bArranged) {
+            log_warn("Windows could not arrange the windows: error <%u>", ::GetLastError());
+        }
+        return bArranged;
+    };
+
+    auto ShellHelper = [this, &times](CTWinUtils::LPSHELLFUNC lpShellFunc) {
+        const auto tpPlace = std::chrono::steady_clock::now();
+        bool bCalled = false;
+        if (m_shellWorker.IsRunning()) {
+            bCalled = SUCCEEDED(m_shellWorker.Call(lpShellFunc, ACTION_TIMEOUT_MS));
+        } else {
+            bCalled = CTWinUtils::ShellHelper(lpShellFunc);
+        }
+        times[static_cast<std::size_t>(ActionStage::Placement)] = ElapsedUs(tpPlace);
+        return bCalled;
+    };
+
+    switch (id)
+    {
+    case ID_FILE_CASCADEWINDOWS:
+        bRetVal = TileCascadeHelper(&CascadeWindows, MDITILE_ZORDER, CTLayout::Arrangement::Cascade);
+        break;
+
+    case ID_FILE_SHOWWINDOWSSTACKED:
+        bRetVal = TileCascadeHelper(&TileWindows, MDITILE_HORIZONTAL, CTLayout::Arrangement::Stacked);
+        break;
+
+    case ID_FILE_SHOWWINDOWSSIDEBYSIDE:
+        bRetVal = TileCascadeHelper(&TileWindows, MDITILE_VERTICAL, CTLayout::Arrangement::SideBySide);
+        break;
+
+    case ID_FILE_SHOWTHEDESKTOP:
+        if (HwndVector hwndVector; !bDefWndTile && GetTileableWindows(hwndVector, &times)) {
+            std::vector<CTLayout::WindowId> vWindows(hwndVector.size());
+            std::ranges::transform(hwndVector, vWindows.begin(), [](HWND hwnd) { return reinterpret_cast<CTLayout::WindowId>(hwnd); });
+            const auto tpPlace = std::chrono::steady_clock::now();
+            const std::size_t nMinimized = m_desktopMinimizer.MinimizeAll(vWindows);
+            times[static_cast<std::size_t>(ActionStage::Placement)] = ElapsedUs(tpPlace);
+            CTCounters::PerfCounters::Global().Add(CTCounters::Counter::WindowsMoved, nMinimized);
+            log_debug("Show Desktop minimized <%zu> of <%zu> windows, <%zu> recorded.", nMinimized, vWindows.size(), m_desktopMinimizer.Records().size());
+        } else {
+            bRetVal = ShellHelper(&IShellDispatch::MinimizeAll);
+        }
+        break;
+
+    case ID_FILE_UNDOMINIMIZE:
+        //Windows minimized by the shell (e.g. Win+D) are the shell's to restore
+        if (!bDefWndTile && (m_desktopMinimizer.GetState() == CTPlacement::DesktopMinimizer::State::Minimized)) {
+            const std::size_t nRecorded = m_desktopMinimizer.Records().size();
+            const auto tpPlace = std::chrono::steady_clock::now();
+            CTLayout::WindowId idTopmost = 0;
+            const std::size_t nRestored = m_desktopMinimizer.RestoreAll(&idTopmost);
+            times[static_cast<std::size_t>(ActionStage::Placement)] = ElapsedUs(tpPlace);
+            CTCounters::PerfCounters::Global().Add(CTCounters::Counter::WindowsMoved, nRestored);
+            log_debug("Undo Minimize restored <%zu> of <%zu> recorded windows.", nRestored, nRecorded);
+
+            //The foreground lock only lets the thread that received the click or the hotkey
+            //activate another window, and this may be the executor thread
+            if (idTopmost && !::PostMessageW(m_hWnd, SWM_ACTIVATE, static_cast<WPARAM>(idTopmost), 0)) {
+                log_warn("Unable to post the activation of window <0X%p>: error <%u>", reinterpret_cast<HWND>(idTopmost), ::GetLastError());
+            }
+        } else {
+            bRetVal = ShellHelper(&IShellDispatch::UndoMinimizeALL);
+        }
+        break;
+
+    default:
+        bRetVal = false;
+        break;
+    }
+
+    //Runs that were replaced by a newer action stopped part way, they'd skew the numbers
+    if (!context.IsCancelled()) {
+        times[static_cast<std::size_t>(ActionStage::Total)] = ElapsedUs(tpStart);
+        RecordLatency(id, times);
+
+        //The action counters are in ActionIndex order
+        if (const std::size_t nAction = ActionIndex(id); nAction < ACTION_COUNT) {
+            CTCounters::PerfCounters::Global().Add(static_cast<CTCounters::Counter>(static_cast<std::size_t>(CTCounters::Counter::CascadeActions) + nAction));
+        }
+    }
+    return bRetVal && !context.IsCancelled();
+}
+
+bool ClassicTileWnd::TileCascadeCustom(const HwndVector& hwndVector, CTLayout::Arrangement arrangement, const CTAction::ActionContext& context, StageTimes* pTimes)
+{
+    try {
+        const auto tpLayout = std::chrono::steady_clock::now();
+
+        //Every monitor gets a layout of its own, within its own work area, 
+        //for the windows that are (mostly) on it
+        CTLayout::MonitorDescVector vMonitors;
+        CTWinUtils::GetMonitors(vMonitors);
+        if (vMonitors.empty()) {
+            //Fall back to the work area of the primary monitor
+            RECT rWorkArea = { 0 };
+            eval_error_nz(::SystemParametersInfoW(SPI_GETWORKAREA, 0, &rWorkArea, 0));
+            vMonitors.push_back({ CTWinUtils::Rect2LayoutRect(rWorkArea), CTWinUtils::Rect2LayoutRect(rWorkArea) });
+        }
+
+        CTLayout::WindowDescVector vWindows;
+        vWindows.reserve(hwndVector.size());
+        for (HWND hwnd : hwndVector) {
+            //Layouts are in visible frames, so compare the targets to those
+            RECT r = { 0 };
+            if (CTWinUtils::GetVisibleRect(hwnd, r)) {
+                vWindows.push_back({ reinterpret_cast<CTLayout::WindowId>(hwnd), CTWinUtils::Rect2LayoutRect(r), ::IsZoomed(hwnd) != FALSE });
+            }
+        }
+
+        //Offset cascaded windows by the height of the caption and sizing frame
+        //so that the title bar of every window remains visible
+        CTLayout::LayoutOptions options;
+        options.arrangement = arrangement;
+        options.nCascadeStepY = ::GetSystemMetrics(SM_CYCAPTION) + ::GetSystemMetrics(SM_CYSIZEFRAME) + ::GetSystemMetrics(SM_CXPADDEDBORDER);
+        options.nCascadeStepX = options.nCascadeStepY;
+
+        //Leave windows that are already tiled where they are
+        options.bMinimizeMovement = true;
+
+        std::vector<CTLayout::PlacementVector> vPlacementsPerMonitor;
+        CTLayout::CalcLayoutPerMonitor(vMonitors, vWindows, options, vPlacementsPerMonitor);
+
+        //Only move the windows that aren't in place yet
+        std::size_t nSkipped = 0, nMoved = 0;
+        for (CTLayout::PlacementVector& vPlacements : vPlacementsPerMonitor) {
+            nSkipped += CTPlacement::SkipUnchanged(vWindows, vPlacements);
+            nMoved += vPlacements.size();
+        }
+        log_info("Placing <%zu> windows: <%zu> to move, <%zu> already in place", nSkipped + nMoved, nMoved, nSkipped);
+        if (pTimes) {
+            (*pTimes)[static_cast<std::size_t>(ActionStage::Layout)] = ElapsedUs(tpLayout);
+        }
+
+        //The last point at which the action can be abandoned without leaving 
+        //the desktop half arranged
+        if (context.IsCancelled()) {
+            log_debug("Action was replaced by a newer one, not moving the windows");
+            return false;
+        }
+
+        //Enumerating the windows took so long that the user has likely moved on
+        if (context.IsPastDeadline()) {
+            log_warn("Action is past its deadline, not moving the windows");
+            return false;
+        }
+
+        //Commit the moves of each monitor as one transaction, so that every
+        //monitor repaints once, and the monitors concurrently
+        const auto tpPlace = std::chrono::steady_clock::now();
+        CTPlacement::PlacementResult result = CTPlacement::ApplyPlacementsParallel(
+            [] { return std::make_unique<Win32PlacementBackend>(); }, vPlacementsPerMonitor);
+        if (pTimes) {
+            (*pTimes)[static_cast<std::size_t>(ActionStage::Placement)] = ElapsedUs(tpPlace);
+        }
+        if (nMoved && !result.bBatched) {
+            log_warn("Deferred window placement failed, moved <%zu> windows individually (<%zu> failed)", result.nMovedIndividually, result.nFailed);
+        }
+        CTCounters::PerfCounters::Global().Add(CTCounters::Counter::WindowsMoved, nMoved - std::min(nMoved, result.nFailed));
+        return result.nFailed == 0;
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+    return false;
+}
+
 void ClassicTileWnd::OnClose(HWND hwnd)
 {
 
-    if (m_logViewer.GetHWND()) {
-        ::SendMessageW(m_logViewer.GetHWND(), WM_CLOSE, 0, 0);
+    if (m_pLogViewer && m_pLogViewer->GetHWND()) {
+        ::SendMessageW(m_pLogViewer->GetHWND(), WM_CLOSE, 0, 0);
     }
 
     ::HtmlHelpW(nullptr, nullptr, HH_CLOSE_ALL, 0);
@@ -308,7 +595,17 @@ void ClassicTileWnd::OnDestroy(HWND hwnd)
         log_error("Unhandled exception");
     }
 
+    //The log viewer was closed in OnClose, so the running action can't be waiting 
+    //for a message to a window of this thread. Report what was dropped
+    UnregisterHotkeys();
+    m_actionExecutor.Stop();
+    OnActionDone(hwnd);
+    m_shellWorker.Stop();
+
+    StopWindowRegistry();
+
     if (m_bQuitOnDestory) {
+        LogLatency();
         log_info("ClassicTileCascade ending.");
     }
 
@@ -388,7 +685,7 @@ void ClassicTileWnd::OnSettingsLogging(HWND hwnd)
     static constexpr std::wstring_view MSG_BOX_MAIN = L"Logging enabled.";
     
     static constexpr wchar_t MSG_BOX_FMT_LOGGING[] = L"Log files are stored at: <A HREF=\"{0}\">{0}</A>.";
-    static const std::wstring MSG_BOX_CONTENT = std::format(MSG_BOX_FMT_LOGGING, CTGlobals::LOG_PATH);
+    const std::wstring MSG_BOX_CONTENT = std::format(MSG_BOX_FMT_LOGGING, LogPath());
 
     try {
         m_bLogging = !m_bLogging;
@@ -442,6 +739,20 @@ void ClassicTileWnd::OnSettingsDefWndTile()
     }
 }
 
+void ClassicTileWnd::OnSettingsMinAnimations()
+{
+    try{
+        m_bMinimizeAnimations = !m_bMinimizeAnimations;
+        m_desktopMinimizer.SetAnimate(m_bMinimizeAnimations);
+
+        eval_error_es(ClassicTileRegUtil::SetRegMinimizeAnimations(m_bMinimizeAnimations));
+    }catch (const LoggingException& le) {
+        le.Log();
+    }catch (...) {
+        log_error("Unhandled exception");
+    }
+}
+
 
 void ClassicTileWnd::GetToolTip()
 {
@@ -480,53 +791,486 @@ HRESULT CALLBACK ClassicTileWnd::s_TaskDlgProc(HWND hwnd, UINT msg, WPARAM, LPAR
     return S_OK;
 }
 
+INT_PTR CALLBACK ClassicTileWnd::s_HotkeysDlgProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM)
+{
+    switch (uMsg)
+    {
+    case WM_INITDIALOG:
+        s_classicTileWnd.OnHotkeysDlgInit(hwnd);
+        return TRUE;
+
+    case WM_COMMAND:
+        switch (LOWORD(wParam)) {
+        case IDOK:
+            if (s_classicTileWnd.OnHotkeysDlgOK(hwnd)) {
+                ::EndDialog(hwnd, IDOK);
+            }
+            return TRUE;
+
+        case IDCANCEL:
+            ::EndDialog(hwnd, IDCANCEL);
+            return TRUE;
+        }
+        break;
+    }
+    return FALSE;
+}
+
 
 
 
 BOOL CALLBACK ClassicTileWnd::s_EnumProc(HWND hwnd, LPARAM lParam)
 {
-    if (!hwnd) {
-        return TRUE;
+    //Only collect the windows here. Filtering happens afterwards in the
+    //filter pipeline, which can spread the work across threads
+    if (hwnd) {
+        HwndVector* pHwndVector = reinterpret_cast<HwndVector*>(lParam);
+        pHwndVector->push_back(hwnd);
     }
+    return TRUE;
+}
 
-    DWORD cloaked = 0;
-    HRESULT hrTemp = ::DwmGetWindowAttribute(hwnd, DWMWA_CLOAKED, &cloaked, sizeof(cloaked));
+BOOL CALLBACK ClassicTileWnd::s_SeedProc(HWND hwnd, LPARAM lParam)
+{
+    if (hwnd) {
+        WindowRegistry::WindowFlags flags;
+        flags.bVisible = (::IsWindowVisible(hwnd) == TRUE);
+        flags.bIconic = (::IsIconic(hwnd) == TRUE);
+        flags.bCloaked = Win32AttributeSource::IsShellCloaked(hwnd);
+
+        WindowRegistry* pRegistry = reinterpret_cast<WindowRegistry*>(lParam);
+        pRegistry->Seed(reinterpret_cast<WindowRegistry::WindowId>(hwnd), flags);
+    }
+    return TRUE;
+}
 
-    //See: https://devblogs.microsoft.com/oldnewthing/20071008-00/?p=24863
-    //Which windows appear in the Alt+Tab list?
-    //Old New Thing blog from October 8th, 2007
-    HWND  hwndWalk = nullptr;
-    HWND hwndTry = ::GetAncestor(hwnd, GA_ROOTOWNER);
-    while (hwndTry != hwndWalk)
-    {
-        hwndWalk = hwndTry;
-        hwndTry = ::GetLastActivePopup(hwndWalk);
-        if (::IsWindowVisible(hwndTry))
+void CALLBACK ClassicTileWnd::s_WinEventProc(HWINEVENTHOOK, DWORD dwEvent, HWND hwnd, LONG idObject, LONG idChild, DWORD, DWORD)
+{
+    //Only interested in events about windows themselves, not about their
+    //child objects (caret, scroll bars, etc.)
+    if (hwnd && (idObject == OBJID_WINDOW) && (idChild == CHILDID_SELF)) {
+        s_classicTileWnd.OnWinEvent(dwEvent, hwnd);
+    }
+}
+
+void ClassicTileWnd::StartWindowRegistry()
+{
+    CT_SPAN("StartWindowRegistry");
+
+    //Ranges of events that affect the tileable state or z-order of a window. Kept narrow
+    //on purpose: a single range from EVENT_SYSTEM_FOREGROUND to EVENT_OBJECT_UNCLOAKED would
+    //also deliver high-frequency events such as EVENT_OBJECT_LOCATIONCHANGE
+    constexpr static std::pair<DWORD, DWORD> EVENT_RANGES[] = {
+        {EVENT_SYSTEM_FOREGROUND, EVENT_SYSTEM_FOREGROUND},
+        {EVENT_SYSTEM_MINIMIZESTART, EVENT_SYSTEM_MINIMIZEEND},
+        {EVENT_OBJECT_CREATE, EVENT_OBJECT_HIDE},
+        {EVENT_OBJECT_NAMECHANGE, EVENT_OBJECT_NAMECHANGE},
+        {EVENT_OBJECT_CLOAKED, EVENT_OBJECT_UNCLOAKED}
+    };
+
+    try {
+        StopWindowRegistry();
+
+        {
+            std::lock_guard lock(m_mtxRegistry);
+            m_attributeCache.Clear();
+
+            //Our own windows are included: the log viewer is created after seeding and has
+            //to be tiled like any other window. This is safe because no thread holds
+            //m_mtxRegistry across a call that sends to another thread (the classifier
+            //releases it before it queries a window), so OnWinEvent never waits on a
+            //thread that waits on the UI thread
+            for (const auto& [dwMin, dwMax] : EVENT_RANGES) {
+                m_vEventHooks.emplace_back(eval_error_nz(::SetWinEventHook(dwMin, dwMax, nullptr, s_WinEventProc, 0, 0, WINEVENT_OUTOFCONTEXT)));
+            }
+
+            //Seed after the hooks are in place so that no window created in between is missed.
+            //Seeding only marks the windows, they are classified by m_registryClassifier
+            eval_error_nz(::EnumWindows(s_SeedProc, reinterpret_cast<LPARAM>(&m_windowRegistry)));
+
+            log_debug("Window registry started with <%zu> windows.", m_windowRegistry.Size());
+        }
+
+        //The attribute cache and the filter pipeline are thread-safe, so the classifier
+        //thread and the executor thread (through Flush) can both run the pipeline
+        m_registryClassifier.Start([this](WindowRegistry::WindowId id) {
+            return m_filterPipeline.IsEligible(id);
+        });
+    } catch (const LoggingException& le) {
+        le.Log();
+        StopWindowRegistry();
+    } catch (...) {
+        log_error("Unhandled exception");
+        StopWindowRegistry();
+    }
+}
+
+void ClassicTileWnd::StopWindowRegistry()
+{
+    //Stopped first so that no classification is in flight when the registry is cleared
+    m_registryClassifier.Stop();
+
+    std::lock_guard lock(m_mtxRegistry);
+    m_vEventHooks.clear();
+    m_windowRegistry.Clear();
+}
+
+void ClassicTileWnd::OnWinEvent(DWORD dwEvent, HWND hwnd)
+{
+    using Event = WindowRegistry::Event;
+
+    std::optional<Event> event;
+    switch (dwEvent) {
+    case EVENT_OBJECT_CREATE:           event = Event::Create;          break;
+    case EVENT_OBJECT_DESTROY:          event = Event::Destroy;         break;
+    case EVENT_OBJECT_SHOW:             event = Event::Show;            break;
+    case EVENT_OBJECT_HIDE:             event = Event::Hide;            break;
+    case EVENT_SYSTEM_MINIMIZESTART:    event = Event::MinimizeStart;   break;
+    case EVENT_SYSTEM_MINIMIZEEND:      event = Event::MinimizeEnd;     break;
+    case EVENT_OBJECT_CLOAKED:          event = Event::Cloak;           break;
+    case EVENT_OBJECT_UNCLOAKED:        event = Event::Uncloak;         break;
+    case EVENT_SYSTEM_FOREGROUND:       event = Event::Foreground;      break;
+    case EVENT_OBJECT_NAMECHANGE:       event = Event::NameChange;      break;
+    }
+
+    std::unique_lock lock(m_mtxRegistry);
+    if (!event || !m_windowRegistry.IsSeeded()) {
+        return;
+    }
+
+    //A destroyed window can no longer be queried, so destroy events are passed through
+    //as-is (the registry ignores windows it does not know). Everything else is
+    //limited to top-level windows
+    if ((*event != Event::Destroy) && (::GetAncestor(hwnd, GA_PARENT) != ::GetDesktopWindow())) {
+        return;
+    }
+
+    //Only shell cloaking (e.g. windows on another virtual desktop) makes a window untileable
+    if ((*event == Event::Cloak) && !Win32AttributeSource::IsShellCloaked(hwnd)) {
+        return;
+    }
+
+    //The event may have changed the cached attributes of the window, so drop them
+    //before m_registryClassifier classifies the window again
+    m_attributeCache.Invalidate(reinterpret_cast<CTFilter::WindowId>(hwnd));
+    m_windowRegistry.OnEvent(*event, reinterpret_cast<WindowRegistry::WindowId>(hwnd));
+
+    //Showing or hiding an owned window (e.g. a dialog) changes which window of the 
+    //owner chain appears in Alt-Tab, so the root owner has to be classified again
+    if ((*event == Event::Show) || (*event == Event::Hide)) {
+        HWND hwndRootOwner = ::GetAncestor(hwnd, GA_ROOTOWNER);
+        if (hwndRootOwner && (hwndRootOwner != hwnd)) {
+            m_attributeCache.Invalidate(reinterpret_cast<CTFilter::WindowId>(hwndRootOwner));
+            m_windowRegistry.Reclassify(reinterpret_cast<WindowRegistry::WindowId>(hwndRootOwner));
+        }
+    }
+
+    const bool bPending = m_windowRegistry.HasPending();
+    lock.unlock();
+    if (bPending) {
+        m_registryClassifier.Notify();
+    }
+}
+
+ClassicTileWnd::HotkeyFailureVector ClassicTileWnd::RegisterHotkeys()
+{
+    CT_SPAN("RegisterHotkeys");
+
+    HotkeyFailureVector vFailed;
+    UnregisterHotkeys();
+    for (const HotkeyAction& action : HOTKEY_ACTIONS) {
+        DWORD dwHotkey = 0;
+        if ((ClassicTileRegUtil::GetRegHotkey(action.szValue, dwHotkey) != ERROR_SUCCESS) || (LOWORD(dwHotkey) == 0)) {
+            continue;
+        }
+
+        //Holding the keys down triggers the action once
+        const UINT fsModifiers = (HIWORD(dwHotkey) & (MOD_ALT | MOD_CONTROL | MOD_SHIFT | MOD_WIN)) | MOD_NOREPEAT;
+        if (::RegisterHotKey(m_hWnd, action.id, fsModifiers, LOWORD(dwHotkey))) {
+            m_vHotkeys.push_back(action.id);
+            log_debug("Registered hotkey <0X%08X> for <%S>.", dwHotkey, action.szValue.data());
+        } else {
+            const DWORD dwError = ::GetLastError();
+            log_warn("Unable to register hotkey <0X%08X> for <%S>: error <%u>", dwHotkey, action.szValue.data(), dwError);
+            vFailed.push_back({ action.id, dwError });
+        }
+    }
+
+    //Hotkeys are the latency-sensitive path, so don't leave the shell object to the first one
+    if (!m_vHotkeys.empty()) {
+        m_shellWorker.Prewarm();
+    }
+    return vFailed;
+}
+
+void ClassicTileWnd::ReportHotkeyFailures(const HotkeyFailureVector& vFailed, HWND hwndOwner)
+{
+    if (vFailed.empty()) {
+        return;
+    }
+
+    try {
+        //Only a conflict is fixed by choosing other keys, anything else is reported as it is
+        std::wstring szList;
+        bool bAllInUse = true;
+        for (const HotkeyFailure& failure : vFailed) {
+            DWORD dwHotkey = 0;
+            const HotkeyAction& action = *std::ranges::find(HOTKEY_ACTIONS, failure.id, &HotkeyAction::id);
+            ClassicTileRegUtil::GetRegHotkey(action.szValue, dwHotkey);
+
+            const bool bInUse = (failure.dwError == ERROR_HOTKEY_ALREADY_REGISTERED);
+            bAllInUse = bAllInUse && bInUse;
+            szList += std::format(L"{}{} ({}): {}", szList.empty() ? L"" : L"\r\n", FindMenuId2MenuItem(MenuId2MenuItemDir::File2DefaultMap, failure.id).szFileString,
+                FormatHotkey(dwHotkey), bInUse ? std::wstring(L"in use by another program") : CTWinUtils::FormatErrorMessage(failure.dwError));
+        }
+
+        if (hwndOwner) {
+            const std::wstring szText = std::format(L"{}\r\n\r\n{}", bAllInUse ? 
+                L"These hotkeys are already in use by another program, choose other keys for them:" : L"These hotkeys could not be registered:", szList);
+            eval_error_nz(::MessageBoxW(hwndOwner, szText.c_str(), APP_NAME.data(), MB_OK | MB_ICONWARNING));
+        } else {
+            NOTIFYICONDATAW niData = m_niData;
+            niData.uFlags = NIF_INFO;
+            niData.dwInfoFlags = NIIF_WARNING;
+            ::wcsncpy_s(niData.szInfoTitle, bAllInUse ? L"Hotkeys already in use" : L"Hotkeys could not be registered", _TRUNCATE);
+            ::wcsncpy_s(niData.szInfo, szList.c_str(), _TRUNCATE);
+            eval_error_nz(::Shell_NotifyIconW(NIM_MODIFY, &niData));
+        }
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+}
+
+std::wstring ClassicTileWnd::FormatHotkey(DWORD dwHotkey)
+{
+    constexpr static std::pair<WORD, std::wstring_view> MODIFIER_NAMES[] = {
+        {MOD_WIN, L"Win+"},
+        {MOD_CONTROL, L"Ctrl+"},
+        {MOD_ALT, L"Alt+"},
+        {MOD_SHIFT, L"Shift+"}
+    };
+
+    std::wstring szHotkey;
+    for (const auto& [wModifier, szName] : MODIFIER_NAMES) {
+        if (HIWORD(dwHotkey) & wModifier) {
+            szHotkey += szName;
+        }
+    }
+
+    wchar_t szKey[64] = {};
+    const LONG lScanCode = static_cast<LONG>(::MapVirtualKeyW(LOWORD(dwHotkey), MAPVK_VK_TO_VSC)) << 16;
+    if (::GetKeyNameTextW(lScanCode, szKey, _countof(szKey)) > 0) {
+        szHotkey += szKey;
+    } else {
+        szHotkey += std::format(L"0X{:02X}", LOWORD(dwHotkey));
+    }
+    return szHotkey;
+}
+
+void ClassicTileWnd::UnregisterHotkeys()
+{
+    for (int id : m_vHotkeys) {
+        ::UnregisterHotKey(m_hWnd, id);
+    }
+    m_vHotkeys.clear();
+}
+
+void ClassicTileWnd::OnHotKey(HWND, int idHotKey, UINT, UINT)
+{
+    //Count from the key press rather than from when the message loop got to the message
+    const DWORD dwQueuedMs = ::GetTickCount() - static_cast<DWORD>(::GetMessageTime());
+    const auto tpPressed = std::chrono::steady_clock::now() - std::chrono::milliseconds(dwQueuedMs);
+
+    if (std::ranges::find(m_vHotkeys, idHotKey) != m_vHotkeys.end()) {
+        PostAction(idHotKey, tpPressed);
+    }
+}
+
+BOOL ClassicTileWnd::OnCopyData(HWND hwnd, HWND, PCOPYDATASTRUCT pcds)
+{
+    using CTInstance::Reply;
+
+    Reply reply = Reply::Rejected;
+    try {
+        CTInstance::ArgVector vArgs;
+        if (!pcds || (pcds->dwData != CTInstance::COMMAND_TAG) || !CTInstance::DecodeArgs(pcds->lpData, pcds->cbData, vArgs)) {
+            log_warn("Ignoring a malformed command line from another launch.");
+            return FALSE;
+        }
+
+        const CTInstance::Command command = CTInstance::ParseCommand(vArgs);
+        reply = CTInstance::ReplyFor(command);
+        switch (reply) {
+        case Reply::Handled:
+            if (const int id = CommandId(command); id != 0) {
+                log_debug("Running action <%d> forwarded by another launch.", id);
+                PostAction(id);
+            } else {
+                log_info("Another launch was started while running, keeping this instance.");
+            }
+            break;
+
+        case Reply::Yield:
+            //The installer registers or unregisters the app as the user, which replaces this instance
+            log_info("Another launch is registering or unregistering the app, exiting.");
+            ::PostMessageW(hwnd, WM_CLOSE, 0, 0);
             break;
+
+        default:
+            log_warn("Another launch passed a command line this instance doesn't accept.");
+            break;
+        }
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
     }
 
-    TITLEBARINFO ti = { 0 };
-    ti.cbSize = sizeof(ti);
-    ::GetTitleBarInfo(hwnd, &ti);
-
-    //Get maximized windows that would appear in ALT-TAB window and Task Manager "Apps"
-    if (    ::IsWindowVisible(hwnd) 
-            && (hwndWalk == hwnd)
-            && (::GetShellWindow() != hwnd) //exclude desktop
-            && ((::GetWindowLong(hwnd, GWL_STYLE) & WS_DISABLED) != WS_DISABLED) 
-            && ((::GetWindowLong(hwnd, GWL_EXSTYLE) & WS_EX_TOOLWINDOW) != WS_EX_TOOLWINDOW) //exclude tool windows
-            && (cloaked != DWM_CLOAKED_SHELL)
-            && (::GetWindowTextLengthW(hwnd) > 0)
-            && ((ti.rgstate[0] & STATE_SYSTEM_INVISIBLE) != STATE_SYSTEM_INVISIBLE)
-            && ! ::IsIconic(hwnd)
-        )
+    return static_cast<BOOL>(reply);
+}
+
+void ClassicTileWnd::OnActionDone(HWND)
+{
+    using CTAction::ActionStatus;
+
+    std::vector<CTAction::ActionResult> vResults;
+    m_actionExecutor.TakeResults(vResults);
+    for (const CTAction::ActionResult& result : vResults) {
+        const long long nQueuedUs = static_cast<long long>(result.usQueued.count());
+        const long long nRunUs = static_cast<long long>(result.usRun.count());
+        switch (result.status) {
+        case ActionStatus::Completed:
+            log_debug("Action <%d> completed in <%lld> us after <%lld> us in the queue.", result.nId, nRunUs, nQueuedUs);
+            break;
+
+        case ActionStatus::TimedOut:
+            log_warn("Action <%d> took <%lld> us after <%lld> us in the queue, longer than <%u> ms.", result.nId, nRunUs, nQueuedUs, ACTION_TIMEOUT_MS);
+            break;
+
+        case ActionStatus::Expired:
+            log_warn("Action <%d> not run, it waited <%lld> us in the queue.", result.nId, nQueuedUs);
+            break;
+
+        case ActionStatus::Failed:
+            log_error("Action <%d> failed with an unhandled exception.", result.nId);
+            break;
+
+        case ActionStatus::Dropped:
+            log_info("Action <%d> not run, shutting down.", result.nId);
+            break;
+
+        case ActionStatus::Superseded:
+            log_debug("Action <%d> not run, replaced by a newer one.", result.nId);
+            break;
+
+        case ActionStatus::Cancelled:
+            log_debug("Action <%d> cancelled after <%lld> us, replaced by a newer one.", result.nId, nRunUs);
+            break;
+        }
+    }
+}
+
+void ClassicTileWnd::OnSWMActivate(HWND, HWND hwndActivate)
+{
+    //A window that stopped responding since it was restored would ignore the activation
+    if (::IsWindow(hwndActivate) && !::IsHungAppWindow(hwndActivate) && !::SetForegroundWindow(hwndActivate)) {
+        log_debug("Unable to activate window <0X%p>.", hwndActivate);
+    }
+}
+
+bool ClassicTileWnd::GetTileableWindows(HwndVector& hwndVector, StageTimes* pTimes)
+{
+    hwndVector.clear();
+
+    auto SetTime = [pTimes](ActionStage stage, long long usElapsed) {
+        if (pTimes) {
+            (*pTimes)[static_cast<std::size_t>(stage)] = usElapsed;
+        }
+        if (stage == ActionStage::Enumerate) {
+            CTCounters::PerfCounters::Global().Add(CTCounters::Counter::Enumerations);
+            CTCounters::PerfCounters::Global().Add(CTCounters::Counter::EnumerationUs, static_cast<std::uint64_t>(usElapsed));
+        }
+    };
+    const auto tpEnumerate = std::chrono::steady_clock::now();
+
+    //Classify what the hooks marked since the last classification (usually nothing),
+    //then copy the registry's answer so that the window checks below don't hold up
+    //OnWinEvent
+    m_registryClassifier.Flush();
+
+    WindowRegistry::WindowIdVector vTileable;
+    bool bSeeded = false;
     {
-        HwndVector* pHwndVector = reinterpret_cast<HwndVector*>(lParam);
-        pHwndVector->push_back(hwnd);
+        std::lock_guard lock(m_mtxRegistry);
+        bSeeded = m_windowRegistry.IsSeeded();
+        if (bSeeded) {
+            vTileable = m_windowRegistry.GetTileable();
+        }
     }
-    return TRUE;
+
+    if (!bSeeded) {
+        HwndVector hwndAll;
+        if (!::EnumWindows(s_EnumProc, reinterpret_cast<LPARAM>(&hwndAll))) {
+            return false;
+        }
+
+        const auto tpStart = std::chrono::steady_clock::now();
+        SetTime(ActionStage::Enumerate, ElapsedUs(tpEnumerate));
+        const size_t nHits = m_attributeCache.GetHits();
+
+        CTFilter::WindowIdVector vIn(hwndAll.size());
+        std::ranges::transform(hwndAll, vIn.begin(), [](HWND hwnd) { return reinterpret_cast<CTFilter::WindowId>(hwnd); });
+
+        CTFilter::WindowIdVector vOut;
+        CTFilter::FilterPipeline::RejectionVector vSkipped;
+        m_filterPipeline.Filter(vIn, vOut, CTFilter::FilterPipeline::PARALLEL_THRESHOLD, &vSkipped);
+        for (const CTFilter::FilterPipeline::Rejection& skipped : vSkipped) {
+            LogSkippedWindow(reinterpret_cast<HWND>(skipped.id), skipped.szStage);
+        }
+
+        hwndVector.reserve(vOut.size());
+        std::ranges::transform(vOut, std::back_inserter(hwndVector), [](CTFilter::WindowId id) { return reinterpret_cast<HWND>(id); });
+
+        const long long usElapsed = ElapsedUs(tpStart);
+        log_debug("Filtered <%zu> windows to <%zu> in <%lld> us (<%zu> attribute cache hits).", 
+            vIn.size(), vOut.size(), usElapsed, m_attributeCache.GetHits() - nHits);
+        SetTime(ActionStage::Filter, usElapsed);
+        return true;
+    }
+
+    //The registry answers from its cache. Re-check the cheap, in-process window state in
+    //case an event was missed; none of these calls send messages to the target window
+    const auto tpFilter = std::chrono::steady_clock::now();
+    SetTime(ActionStage::Enumerate, ElapsedUs(tpEnumerate));
+    hwndVector.reserve(vTileable.size());
+    for (WindowRegistry::WindowId id : vTileable) {
+        HWND hwnd = reinterpret_cast<HWND>(id);
+        if (::IsWindow(hwnd) && ::IsWindowVisible(hwnd) && !::IsIconic(hwnd)) {
+            //Moving a hung window would block until it responds again
+            if (::IsHungAppWindow(hwnd)) {
+                LogSkippedWindow(hwnd, "not hung");
+            } else {
+                hwndVector.push_back(hwnd);
+            }
+        }
+    }
+    SetTime(ActionStage::Filter, ElapsedUs(tpFilter));
+    return true;
 }
 
+void ClassicTileWnd::LogSkippedWindow(HWND hwnd, std::string_view szReason)
+{
+    //GetClassName and GetWindowThreadProcessId read the window's data in win32k, 
+    //GetWindowText would send WM_GETTEXT to the (possibly hung) window
+    wchar_t szClass[256] = L"";
+    ::GetClassNameW(hwnd, szClass, static_cast<int>(std::size(szClass)));
+    DWORD dwProcessId = 0;
+    ::GetWindowThreadProcessId(hwnd, &dwProcessId);
+    log_info("Skipped window <0X%p> (class <%S>, process <%lu>): failed the <%.*s> check", 
+        hwnd, szClass, dwProcessId, static_cast<int>(szReason.size()), szReason.data());
+}
 
 const ClassicTileWnd::File2DefaultStruct& ClassicTileWnd::FindMenuId2MenuItem(MenuId2MenuItemDir menuID2MenuItemDir, UINT uSought)
 {
@@ -640,9 +1384,10 @@ void ClassicTileWnd::OnSettingsPopup(HMENU hMenu)
     try {
         eval_error_nz(CTWinUtils::CheckMenuItem(hMenu, ID_SETTINGS_AUTOSTART, m_bAutoStart));
         eval_error_nz(CTWinUtils::CheckMenuItem(hMenu, ID_SETTINGS_DEFWNDTILE, m_bDefWndTile));
+        eval_error_nz(CTWinUtils::CheckMenuItem(hMenu, ID_SETTINGS_MINANIMATIONS, m_bMinimizeAnimations));
         eval_error_nz(CTWinUtils::CheckMenuItem(hMenu, ID_SETTINGS_LOGGING, m_bLogging));
 
-        eval_error_nz(::EnableMenuItem(hMenu, ID_SETTINGS_OPENLOGFILE, MF_BYCOMMAND | (CTWinUtils::FileExists(CTGlobals::LOG_PATH) ? MF_ENABLED : MF_GRAYED)) >= 0);
+        eval_error_nz(::EnableMenuItem(hMenu, ID_SETTINGS_OPENLOGFILE, MF_BYCOMMAND | (CTWinUtils::FileExists(LogPath()) ? MF_ENABLED : MF_GRAYED)) >= 0);
     } catch (const LoggingException& le) {
         le.Log();
     } catch (...) {
@@ -670,32 +1415,329 @@ void ClassicTileWnd::OnLeftClickDoesPopup(HMENU hMenu)
 
 void ClassicTileWnd::EnableLogging()
 {
-    if (!enable_logging(CTGlobals::LOG_PATH, m_pLogFP)) {
+    if (!enable_logging(LogPath(), m_pLogFP, m_bBinaryLog)) {
         generate_fatal("Invalid log file stream.");
     }
 }
 
+const std::wstring& ClassicTileWnd::LogPath() const
+{
+    return m_bBinaryLog ? CTGlobals::BIN_LOG_PATH : CTGlobals::LOG_PATH;
+}
+
+std::wstring ClassicTileWnd::ViewablePath(std::wstring_view szPath)
+{
+    if (szPath != CTGlobals::BIN_LOG_PATH) {
+        return std::wstring(szPath);
+    }
+
+    SPFILE pIn(eval_error_nz(_wfsopen(CTGlobals::BIN_LOG_PATH.c_str(), L"rb", _SH_DENYNO)));
+    SPFILE pOut(eval_error_nz(_wfopen(CTGlobals::DECODED_LOG_PATH.c_str(), L"w")));
+
+    // The log may still be midway through a record: what was decoded up to it is shown
+    if (log_decode_bin(pIn.get(), pOut.get()) != 0) {
+        log_debug("Decoded <%S> up to an incomplete or invalid record.", CTGlobals::BIN_LOG_PATH.c_str());
+    }
+    return CTGlobals::DECODED_LOG_PATH;
+}
+
 
 bool ClassicTileWnd::Run(HINSTANCE hInst)
 {
+    CT_SPAN("ClassicTileWnd::Run");
     return s_classicTileWnd.InitInstance(hInst);
 }
 
+bool ClassicTileWnd::RunHeadless(CTInstance::Command command)
+{
+    const auto tpStart = std::chrono::steady_clock::now();
+    ClassicTileWnd& wnd = s_classicTileWnd;
+
+    const int id = CommandId(command);
+    if (id == 0) {
+        return false;
+    }
+
+    //Only open the log if the user turned logging on
+    ClassicTileRegUtil::GetRegLogging(wnd.m_bLogging);
+    ClassicTileRegUtil::GetRegBinaryLog(wnd.m_bBinaryLog);
+    if (wnd.m_bLogging) {
+        try {
+            wnd.EnableLogging();
+        } catch (...) {
+            wnd.m_bLogging = false;
+        }
+    }
+
+    //The layouts are computed in physical pixels, as in the notification icon process
+    ::SetProcessDpiAwarenessContext(DPI_AWARENESS_CONTEXT_PER_MONITOR_AWARE_V2);
+
+    ClassicTileRegUtil::GetRegDefWndTile(wnd.m_bDefWndTile);
+    if (ClassicTileRegUtil::GetRegMinimizeAnimations(wnd.m_bMinimizeAnimations) != ERROR_SUCCESS) {
+        wnd.m_bMinimizeAnimations = true;
+    }
+    wnd.m_desktopMinimizer.SetAnimate(wnd.m_bMinimizeAnimations);
+
+    //This process is gone before Undo Minimize could use its records, so both
+    //Show Desktop and Undo Minimize go through the shell
+    const bool bShell = (id == ID_FILE_SHOWTHEDESKTOP) || (id == ID_FILE_UNDOMINIMIZE);
+
+    //Startup is counted from the creation of the process, which includes loading the image and the DLLs
+    const auto tpReady = std::chrono::steady_clock::now();
+    const long long usStartup = CTWinUtils::GetProcessAgeUs();
+
+    bool bRetVal = false;
+    try {
+        bRetVal = wnd.RunAction(id, wnd.m_bDefWndTile || bShell, CTAction::ActionContext(CTAction::Clock::now() + std::chrono::milliseconds(ACTION_TIMEOUT_MS)));
+    } catch (const LoggingException& le) {
+        le.Log();
+        return false;
+    } catch (...) {
+        log_error("Unhandled exception");
+        return false;
+    }
+
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    log_info("Headless action <%d> %s: started <%lld> us after process creation (<%lld> us in RunHeadless), ran <%lld> us.", id,
+        bRetVal ? "succeeded" : "failed", usStartup,
+        static_cast<long long>(duration_cast<microseconds>(tpReady - tpStart).count()),
+        static_cast<long long>(duration_cast<microseconds>(std::chrono::steady_clock::now() - tpReady).count()));
+
+    return bRetVal;
+}
+
+std::size_t ClassicTileWnd::ActionIndex(int id)
+{
+    //Same order as ACTION_NAMES in FormatLatency
+    constexpr static int ACTION_IDS[ACTION_COUNT] = {
+        ID_FILE_CASCADEWINDOWS,
+        ID_FILE_SHOWWINDOWSSTACKED,
+        ID_FILE_SHOWWINDOWSSIDEBYSIDE,
+        ID_FILE_SHOWTHEDESKTOP,
+        ID_FILE_UNDOMINIMIZE
+    };
+
+    return static_cast<std::size_t>(std::ranges::find(ACTION_IDS, id) - std::ranges::begin(ACTION_IDS));
+}
+
+long long ClassicTileWnd::ElapsedUs(std::chrono::steady_clock::time_point tpStart)
+{
+    return static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tpStart).count());
+}
+
+void ClassicTileWnd::RecordLatency(int id, const StageTimes& times)
+{
+    const std::size_t nAction = ActionIndex(id);
+    if (nAction >= ACTION_COUNT) {
+        return;
+    }
+
+    for (std::size_t nStage = 0; nStage < STAGE_COUNT; ++nStage) {
+        if (times[nStage] >= 0) {
+            m_actionLatency[nAction][nStage].Record(static_cast<std::uint64_t>(times[nStage]));
+        }
+    }
+}
+
+void ClassicTileWnd::FormatLatency(std::wstring& szText) const
+{
+    constexpr static std::wstring_view ACTION_NAMES[ACTION_COUNT] = { L"Cascade", L"Stacked", L"Side by side", L"Show desktop", L"Undo minimize" };
+    constexpr static std::wstring_view STAGE_NAMES[STAGE_COUNT] = { L"enumerate", L"filter", L"layout", L"placement", L"total" };
+
+    //Microseconds below 10 ms, milliseconds above
+    auto Duration = [](std::uint64_t us) {
+        return (us < 10000) ? std::format(L"{} us", us) : std::format(L"{:.1f} ms", static_cast<double>(us) / 1000.0);
+    };
+
+    szText.clear();
+    for (std::size_t nAction = 0; nAction < ACTION_COUNT; ++nAction) {
+        if (m_actionLatency[nAction][static_cast<std::size_t>(ActionStage::Total)].Count() == 0) {
+            continue;
+        }
+
+        szText += std::format(L"{}:\n", ACTION_NAMES[nAction]);
+        for (std::size_t nStage = 0; nStage < STAGE_COUNT; ++nStage) {
+            const CTMetrics::LatencySummary summary = m_actionLatency[nAction][nStage].Summarize();
+            if (summary.nCount) {
+                szText += std::format(L"    {}: n={} p50 {}, p90 {}, p99 {}, max {}\n", STAGE_NAMES[nStage], summary.nCount,
+                    Duration(summary.nP50), Duration(summary.nP90), Duration(summary.nP99), Duration(summary.nMax));
+            }
+        }
+    }
+}
+
+void ClassicTileWnd::LogLatency() const
+{
+    std::wstring szText;
+    FormatLatency(szText);
+    if (szText.empty()) {
+        return;
+    }
+
+    std::string szAnsi;
+    CTWinUtils::Wstring2ansi(szAnsi, szText);
+    log_info("Action latency since start-up:\n%s", szAnsi.c_str());
+}
+
+void ClassicTileWnd::OnSettingsDiagnostics(HWND hwnd)
+{
+    try {
+        std::wstring szText;
+        FormatLatency(szText);
+        if (szText.empty()) {
+            szText = L"No tile, cascade or minimize action has run yet.";
+        }
+
+        ::MessageBoxW(hwnd, szText.c_str(), std::format(L"{} Diagnostics", APP_NAME).c_str(), MB_OK | MB_ICONINFORMATION);
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+}
+
+void ClassicTileWnd::OnSettingsHotkeys(HWND hwnd)
+{
+    try {
+        CloseTaskDlg();
+        eval_error_nz(::DialogBoxParamW(m_hInst, MAKEINTRESOURCEW(IDD_HOTKEYS), hwnd, s_HotkeysDlgProc, 0) > 0);
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+}
+
+void ClassicTileWnd::OnHotkeysDlgInit(HWND hwndDlg)
+{
+    for (const HotkeyAction& action : HOTKEY_ACTIONS) {
+        DWORD dwHotkey = 0;
+        ClassicTileRegUtil::GetRegHotkey(action.szValue, dwHotkey);
+
+        BYTE bModifiers = 0;
+        for (const auto& [wModifier, bControlModifier] : HOTKEY_MODIFIERS) {
+            if (HIWORD(dwHotkey) & wModifier) {
+                bModifiers |= bControlModifier;
+            }
+        }
+        ::SendDlgItemMessageW(hwndDlg, action.idControl, HKM_SETHOTKEY, MAKEWORD(LOBYTE(LOWORD(dwHotkey)), bModifiers), 0);
+    }
+
+    //The dialog is opened from the notification icon's menu, whose window is hidden
+    ::SetForegroundWindow(hwndDlg);
+}
+
+bool ClassicTileWnd::OnHotkeysDlgOK(HWND hwndDlg)
+{
+    try {
+        for (const HotkeyAction& action : HOTKEY_ACTIONS) {
+            const WORD wControl = LOWORD(::SendDlgItemMessageW(hwndDlg, action.idControl, HKM_GETHOTKEY, 0, 0));
+
+            WORD wModifiers = 0;
+            for (const auto& [wModifier, bControlModifier] : HOTKEY_MODIFIERS) {
+                if (HIBYTE(wControl) & bControlModifier) {
+                    wModifiers |= wModifier;
+                }
+            }
+
+            //A hotkey without a modifier would take the key away from every other program
+            const WORD wKey = LOBYTE(wControl);
+            if (wKey && !wModifiers) {
+                const std::wstring szText = std::format(L"The hotkey for {} needs Ctrl, Alt or Shift.", FindMenuId2MenuItem(MenuId2MenuItemDir::File2DefaultMap, action.id).szFileString);
+                eval_error_nz(::MessageBoxW(hwndDlg, szText.c_str(), APP_NAME.data(), MB_OK | MB_ICONWARNING));
+                ::SetFocus(::GetDlgItem(hwndDlg, action.idControl));
+                return false;
+            }
+
+            //The control has no Windows key, so a stored hotkey that uses it is only
+            //replaced if its row was changed
+            DWORD dwStored = 0;
+            ClassicTileRegUtil::GetRegHotkey(action.szValue, dwStored);
+            const DWORD dwHotkey = wKey ? MAKELONG(wKey, wModifiers) : 0;
+            if (dwHotkey != (dwStored & ~(static_cast<DWORD>(MOD_WIN) << 16))) {
+                if (const LONG lStatus = ClassicTileRegUtil::SetRegHotkey(action.szValue, dwHotkey); lStatus != ERROR_SUCCESS) {
+                    log_warn("Unable to save hotkey <0X%08X> for <%S>: error <%d>", dwHotkey, action.szValue.data(), lStatus);
+
+                    //The rows saved so far are in effect, the rest can be saved again with OK
+                    RegisterHotkeys();
+                    const std::wstring szText = std::format(L"The hotkey for {} could not be saved:\r\n\r\n{}", 
+                        FindMenuId2MenuItem(MenuId2MenuItemDir::File2DefaultMap, action.id).szFileString, CTWinUtils::FormatErrorMessage(static_cast<DWORD>(lStatus)));
+                    eval_error_nz(::MessageBoxW(hwndDlg, szText.c_str(), APP_NAME.data(), MB_OK | MB_ICONERROR));
+                    return false;
+                }
+            }
+        }
+
+        const HotkeyFailureVector vFailed = RegisterHotkeys();
+        ReportHotkeyFailures(vFailed, hwndDlg);
+        return vFailed.empty();
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+
+    //Keep the dialog open, the hotkeys may only be partly saved
+    ::MessageBoxW(hwndDlg, L"The hotkeys could not be saved. See the log for details.", APP_NAME.data(), MB_OK | MB_ICONERROR);
+    return false;
+}
+
+void ClassicTileWnd::LogFootprint(std::string_view szWhen)
+{
+    SIZE_T nWorkingSet = 0;
+    SIZE_T nPrivateBytes = 0;
+    if (CTWinUtils::GetProcessFootprint(nWorkingSet, nPrivateBytes)) {
+        log_info("Memory at <%.*s>: working set <%zu> KB, private <%zu> KB.", static_cast<int>(szWhen.size()), szWhen.data(), nWorkingSet / 1024, nPrivateBytes / 1024);
+    }
+}
+
+int ClassicTileWnd::CommandId(CTInstance::Command command)
+{
+    using CTInstance::Command;
+
+    switch (command) {
+    case Command::Cascade:
+        return ID_FILE_CASCADEWINDOWS;
+    case Command::Stacked:
+        return ID_FILE_SHOWWINDOWSSTACKED;
+    case Command::SideBySide:
+        return ID_FILE_SHOWWINDOWSSIDEBYSIDE;
+    case Command::ShowDesktop:
+        return ID_FILE_SHOWTHEDESKTOP;
+    case Command::UndoMinimize:
+        return ID_FILE_UNDOMINIMIZE;
+    default:
+        return 0;
+    }
+}
+
 void ClassicTileWnd::OnSettingsOpenLogFile(HWND hwnd, std::wstring_view szPath)
 {
     try {
         constexpr static wchar_t FMT_FILE_NOT_FOUND[] = L"Log file <{0}> does not exist yet.";
 
+        // The viewer reads the file from disk, so write out whatever is still queued
+        log_flush();
+
         if (!CTWinUtils::FileExists(szPath)) {
             ::MessageBoxW(hwnd, std::format(FMT_FILE_NOT_FOUND, szPath).c_str(), APP_NAME.data(), MB_OK | MB_ICONINFORMATION);
-        } else if (m_logViewer.GetHWND() ){
-            if (::IsIconic(m_logViewer.GetHWND())) {
-                eval_error_nz(::ShowWindow(m_logViewer.GetHWND(), SW_RESTORE));
+        } else if (m_pLogViewer && m_pLogViewer->GetHWND() ){
+            if (::IsIconic(m_pLogViewer->GetHWND())) {
+                eval_error_nz(::ShowWindow(m_pLogViewer->GetHWND(), SW_RESTORE));
             }
-            eval_error_nz(m_logViewer.SetFile(szPath));
-            eval_error_nz(::SetForegroundWindow(m_logViewer.GetHWND()));
+            eval_error_nz(m_pLogViewer->SetFile(ViewablePath(szPath)));
+            eval_error_nz(::SetForegroundWindow(m_pLogViewer->GetHWND()));
         }else{
-            eval_error_nz(m_logViewer.InitInstance(m_hInst, szPath));
+            //Created (and Msftedit.dll loaded) on first use, released by ProcessDlgMsg once closed
+            const auto tpStart = std::chrono::steady_clock::now();
+            m_pLogViewer = std::make_unique<CLogViewer>();
+            eval_error_nz(m_pLogViewer->InitInstance(m_hInst, ViewablePath(szPath)));
+            const long long usOpen = ElapsedUs(tpStart);
+            log_debug("Log viewer opened in <%lld> us.", usOpen);
+            CTCounters::PerfCounters::Global().Add(CTCounters::Counter::ViewerOpens);
+            CTCounters::PerfCounters::Global().Add(CTCounters::Counter::ViewerOpenUs, static_cast<std::uint64_t>(usOpen));
+            LogFootprint("log viewer open");
         }
     } catch (const LoggingException& le) {
         le.Log();
@@ -707,8 +1749,15 @@ void ClassicTileWnd::OnSettingsOpenLogFile(HWND hwnd, std::wstring_view szPath)
 bool ClassicTileWnd::ProcessDlgMsg(LPMSG lpMsg)
 {
     bool bRetVal = false;
-    if (m_logViewer.GetHWND()) {
-        bRetVal = m_logViewer.ProcessDlgMsg(lpMsg);
+    if (m_pLogViewer) {
+        if (m_pLogViewer->GetHWND()) {
+            bRetVal = m_pLogViewer->ProcessDlgMsg(lpMsg);
+        } else {
+            //The viewer's windows are all gone by the time the loop gets the next 
+            //message, so the viewer and Msftedit.dll can go too
+            m_pLogViewer.reset();
+            LogFootprint("log viewer closed");
+        }
     }
 
     return bRetVal;
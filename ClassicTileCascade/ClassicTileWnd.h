@@ -12,13 +12,28 @@
 // state from the registry, set up logging, and create the Shell Notification Icon. Once InitInstance returns 
 // successfully, caller should start a Windows messaging loop.
 #include "CLogViewer.h"
+#include "WinPlatform.h"
+#include "WindowRegistry.h"
+#include "RegistryClassifier.h"
+#include "ActionExecutor.h"
+#include "ShellWorker.h"
+#include "InstanceProtocol.h"
+#include "LatencyHistogram.h"
 
 class ClassicTileWnd : public BaseWnd< ClassicTileWnd>
 {
 public:
 	static bool Run(HINSTANCE hInst);
+
+	// Run the action command once, without a window, the notification icon, the menus
+	// or the background threads, for command lines when no instance is running.
+	// Returns false, which becomes the exit code 1, if the action failed
+	static bool RunHeadless(CTInstance::Command command);
 	static bool CTWProcessDlgMsg(LPMSG lpMsg);
 
+	// Later launches find the running instance by its window class
+	constexpr static std::wstring_view CLASS_NAME = L"ClassicTileWndClass";
+
 protected:
 	////////////////////////////
 	//helper classes & typedefs
@@ -48,6 +63,21 @@ protected:
 		File2DefaultMap
 	};
 
+	// Stages of an action timed into m_actionLatency. Total is the whole of RunAction
+	enum class ActionStage
+	{
+		Enumerate,
+		Filter,
+		Layout,
+		Placement,
+		Total
+	};
+	constexpr static std::size_t STAGE_COUNT = static_cast<std::size_t>(ActionStage::Total) + 1;
+	constexpr static std::size_t ACTION_COUNT = 5;
+
+	// Microseconds spent in each stage by one run of an action, -1 for the stages it skipped
+	using StageTimes = std::array<long long, STAGE_COUNT>;
+
 	
 	//////////////////
 	//Main functions
@@ -73,17 +103,91 @@ protected:
 	void GetToolTip();
 	void CloseTaskDlg();
 	void EnableLogging();
+	// The log file of the current mode (CTGlobals::LOG_PATH or CTGlobals::BIN_LOG_PATH)
+	const std::wstring& LogPath() const;
+	// Path of a text rendering of the log at szPath: the binary log is decoded into
+	// CTGlobals::DECODED_LOG_PATH, any other file is returned as is
+	static std::wstring ViewablePath(std::wstring_view szPath);
+	// Tile or cascade the windows in hwndVector using the CTLayout engine instead
+	// of TileWindows/CascadeWindows. Nothing is moved once context is past its deadline.
+	// Returns false if the windows weren't (all) moved
+	bool TileCascadeCustom(const HwndVector& hwndVector, CTLayout::Arrangement arrangement, const CTAction::ActionContext& context, StageTimes* pTimes = nullptr);
+
+	// Queue the tile/cascade/minimize action id on m_actionExecutor, replacing the ones
+	// still queued or running. Runs it right away if the executor isn't running.
+	// tpHotkey is when the hotkey that triggered the action was pressed
+	void PostAction(int id, std::optional<std::chrono::steady_clock::time_point> tpHotkey = {});
+
+	// Body of the actions queued by PostAction. Runs on the executor thread. Returns
+	// false if the action failed, was cancelled or ran past its deadline
+	bool RunAction(int id, bool bDefWndTile, const CTAction::ActionContext& context);
+
+	// Install the WinEvent hooks that keep m_windowRegistry current and seed it with the
+	// windows currently on the desktop. If this fails, actions fall back to EnumWindows
+	void StartWindowRegistry();
+	void StopWindowRegistry();
+
+	// Action (ID_FILE_*) whose hotkey couldn't be registered and the error of RegisterHotKey,
+	// ERROR_HOTKEY_ALREADY_REGISTERED if another program registered the same combination
+	struct HotkeyFailure
+	{
+		int id = 0;
+		DWORD dwError = ERROR_SUCCESS;
+	};
+	using HotkeyFailureVector = std::vector<HotkeyFailure>;
+
+	// Register the global hotkeys configured in the registry for the ID_FILE_* actions.
+	// Returns the hotkeys that couldn't be registered
+	HotkeyFailureVector RegisterHotkeys();
+	void UnregisterHotkeys();
+
+	// Tell the user which hotkeys of vFailed (from RegisterHotkeys) couldn't be
+	// registered and why: in a message box owned by hwndOwner, or in a notification
+	// from the tray icon if hwndOwner is nullptr
+	void ReportHotkeyFailures(const HotkeyFailureVector& vFailed, HWND hwndOwner);
+
+	// "Ctrl+Alt+C" for a hotkey as stored by ClassicTileRegUtil::SetRegHotkey
+	static std::wstring FormatHotkey(DWORD dwHotkey);
+
+	// Fill hwndVector with the windows to tile/cascade, topmost first. Uses the
+	// registry when it is running, otherwise enumerates the desktop
+	bool GetTileableWindows(HwndVector& hwndVector, StageTimes* pTimes = nullptr);
+
+	// Add the stage times of a run of action id to m_actionLatency. Safe on any thread
+	void RecordLatency(int id, const StageTimes& times);
+
+	// Per-stage latency percentiles of every action that ran, one line per stage
+	void FormatLatency(std::wstring& szText) const;
+	void LogLatency() const;
+
+	// Log a window that was left out because it failed the szReason check. Sends no
+	// messages to the window, so it is safe for windows that do not respond
+	static void LogSkippedWindow(HWND hwnd, std::string_view szReason);
 
 	/////////////////////////
 	//Static helper functions
 	/////////////////////////
 	static  const File2DefaultStruct& FindMenuId2MenuItem(MenuId2MenuItemDir menuID2MenuItemDir, UINT uSought);
 
+	// Log the working set and private bytes of the process
+	static void LogFootprint(std::string_view szWhen);
+
+	// Index of ID_FILE_* action id in m_actionLatency, ACTION_COUNT for other ids
+	static std::size_t ActionIndex(int id);
+
+	static long long ElapsedUs(std::chrono::steady_clock::time_point tpStart);
+
+	// ID_FILE_* of an action command, 0 for the other commands
+	static int CommandId(CTInstance::Command command);
+
 	////////////////////
 	//callback functions
 	////////////////////
 	static HRESULT CALLBACK s_TaskDlgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam, LONG_PTR lpRefData);
+	static INT_PTR CALLBACK s_HotkeysDlgProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 	static BOOL CALLBACK s_EnumProc(HWND hwnd, LPARAM lParam);
+	static BOOL CALLBACK s_SeedProc(HWND hwnd, LPARAM lParam);
+	static void CALLBACK s_WinEventProc(HWINEVENTHOOK hWinEventHook, DWORD dwEvent, HWND hwnd, LONG idObject, LONG idChild, DWORD dwEventThread, DWORD dwmsEventTime);
 
 	////////////////////////
 	//Top-level msg handlers
@@ -93,6 +197,11 @@ protected:
 	void OnClose(HWND hwnd) override;
 	void OnDestroy(HWND) override;
 	void OnInitMenuPopup(HWND hwnd, HMENU hMenu, UINT item, BOOL fSystemMenu);
+	void OnWinEvent(DWORD dwEvent, HWND hwnd);
+	void OnActionDone(HWND hwnd);
+	void OnSWMActivate(HWND hwnd, HWND hwndActivate);
+	void OnHotKey(HWND hwnd, int idHotKey, UINT fuModifiers, UINT vk);
+	BOOL OnCopyData(HWND hwnd, HWND hwndFrom, PCOPYDATASTRUCT pcds);
 
 	//////////////////////////
 	//SWM_TRAYMSG msg handlers
@@ -107,7 +216,18 @@ protected:
 	void OnSettingsAutoStart();
 	void OnSettingsLogging(HWND hwnd);
 	void OnSettingsDefWndTile();
+	void OnSettingsMinAnimations();
 	void OnSettingsOpenLogFile(HWND hwnd, std::wstring_view szPath);
+	void OnSettingsDiagnostics(HWND hwnd);
+	void OnSettingsHotkeys(HWND hwnd);
+
+	/////////////////////////////
+	//Hotkeys dialog msg handlers
+	/////////////////////////////
+	void OnHotkeysDlgInit(HWND hwndDlg);
+	// Save the hotkeys and register them again. Returns false, after telling the user,
+	// if one of them couldn't be saved or registered, so that the dialog stays open
+	bool OnHotkeysDlgOK(HWND hwndDlg);
 
 	//////////////////////////
 	//Task Dialog msg handlers
@@ -128,6 +248,9 @@ protected:
 	constexpr static UINT TRAYICONID = 1;
 	constexpr static std::wstring_view APP_NAME = L"Classic Tile Cascade";
 
+	// How long a tile/cascade/minimize action may wait in the queue and run
+	constexpr static UINT ACTION_TIMEOUT_MS = 3000;
+
 
 protected:
 	//////////////////
@@ -144,11 +267,19 @@ protected:
 	// "Settings | Logging"
 	bool m_bLogging = false;
 
+	// Whether the log is written in the binary format (CTGlobals::BIN_LOG_PATH).
+	// Set through the "BinaryLog" registry value, there is no menu item for it
+	bool m_bBinaryLog = false;
+
+	// Whether Show Desktop and Undo Minimize animate the windows. Represents the
+	// "MinimizeAnimations" registry value, toggled by ID_SETTINGS_MINANIMATIONS
+	bool m_bMinimizeAnimations = true;
+
 	// Whether or not to start automatically when user logs in. Represents the 
 	// check state of menu item under "Settings | Start Automatically"
 	bool m_bAutoStart = false;
 
-	// Controls whether the Tile and Cascade actions use 
+	// Controls whether the Tile, Cascade, Show Desktop and Undo Minimize actions use 
 	// Windows default behaviors (buggy) [true] or a custom enumeration of 
 	// the windows that are visible and reflected on the taskbar [false]
 	// Represents the check state of menu item under "Settings | Default Windows Tile/Cascade"
@@ -165,7 +296,44 @@ protected:
 	SPHMENU m_hMenu;
 	HMENU m_hPopupMenu = nullptr;
 
-	CLogViewer m_logViewer;
+	// Only exists while the log viewer is open
+	std::unique_ptr<CLogViewer> m_pLogViewer;
+
+	// Decides which windows are tiled/cascaded. Expensive window attributes are
+	// cached in m_attributeCache and invalidated from the WinEvent hooks
+	Win32AttributeSource m_attributeSource;
+	CTFilter::AttributeCache m_attributeCache;
+	CTFilter::FilterPipeline m_filterPipeline;
+
+	// Top-level windows of the desktop, kept current by the hooks in m_vEventHooks.
+	// m_windowRegistry is updated on the UI thread and read on the executor thread,
+	// always under m_mtxRegistry. The hooks only mark the windows an event touched;
+	// m_registryClassifier runs the filter pipeline on them on a thread of its own,
+	// because the filter sends messages to the window and a hung window would
+	// otherwise stall the UI thread. The hooks also see this process's windows, so
+	// m_mtxRegistry must never be held across a send to another thread
+	WindowRegistry m_windowRegistry;
+	std::vector<SPHWINEVENTHOOK> m_vEventHooks;
+	std::mutex m_mtxRegistry;
+	RegistryClassifier m_registryClassifier{ m_windowRegistry, m_mtxRegistry };
+
+	// Ids (the ID_FILE_* command) of the hotkeys registered by RegisterHotkeys
+	std::vector<int> m_vHotkeys;
+
+	// Show Desktop and Undo Minimize. m_desktopMinimizer remembers what it minimized
+	// and restores it; the shell (through m_shellWorker's cached shell object) is used
+	// for Windows default behavior and to undo a minimize that wasn't ours
+	Win32MinimizeBackend m_minimizeBackend;
+	CTPlacement::DesktopMinimizer m_desktopMinimizer;
+	ShellWorker m_shellWorker;
+
+	// Latency of each ActionStage of each action (by ActionIndex), recorded on the
+	// executor thread and read on the UI thread
+	std::array<std::array<CTMetrics::LatencyHistogram, STAGE_COUNT>, ACTION_COUNT> m_actionLatency;
+
+	// Runs the actions posted from OnCommand off the UI thread. Declared last so that
+	// its thread is stopped before the members it uses are destroyed
+	CTAction::ActionExecutor m_actionExecutor;
 
 	static ClassicTileWnd s_classicTileWnd;
 };
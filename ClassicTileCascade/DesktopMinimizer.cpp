@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include "DesktopMinimizer.h"
+
+CTPlacement::DesktopMinimizer::DesktopMinimizer(IMinimizeBackend& backend)
+    : m_backend(backend)
+{
+}
+
+std::size_t CTPlacement::DesktopMinimizer::MinimizeAll(const std::vector<CTLayout::WindowId>& vWindows)
+{
+    MinimizeRecordVector vNew;
+    vNew.reserve(vWindows.size());
+    for (CTLayout::WindowId id : vWindows) {
+        WindowShowState state;
+        if (m_backend.QueryWindow(id, state) && !state.bMinimized) {
+            vNew.push_back({ id, state.bMaximized, state.rNormal });
+        }
+    }
+
+    if (vNew.empty()) {
+        return 0;
+    }
+
+    const std::size_t nMinimized = m_backend.MinimizeWindows(vNew, m_bAnimate.load(std::memory_order_relaxed));
+
+    //A recorded window that isn't minimized any more was restored by hand since, so its 
+    //old record is replaced. The new windows were on top of the minimized ones
+    std::erase_if(m_vRecords, [&vNew](const MinimizeRecord& record) {
+        return std::ranges::any_of(vNew, [&record](const MinimizeRecord& newRecord) { return newRecord.id == record.id; });
+    });
+    m_vRecords.insert(m_vRecords.begin(), vNew.begin(), vNew.end());
+    return nMinimized;
+}
+
+std::size_t CTPlacement::DesktopMinimizer::RestoreAll(CTLayout::WindowId* pTopmost)
+{
+    if (pTopmost) {
+        *pTopmost = 0;
+    }
+
+    MinimizeRecordVector vRestore;
+    vRestore.reserve(m_vRecords.size());
+    for (const MinimizeRecord& record : m_vRecords) {
+        //Leave the windows that were closed or restored by hand
+        WindowShowState state;
+        if (m_backend.QueryWindow(record.id, state) && state.bMinimized) {
+            vRestore.push_back(record);
+        }
+    }
+    m_vRecords.clear();
+
+    if (vRestore.empty()) {
+        return 0;
+    }
+
+    const std::size_t nRestored = m_backend.RestoreWindows(vRestore, m_bAnimate.load(std::memory_order_relaxed));
+    if (pTopmost && (nRestored > 0)) {
+        *pTopmost = vRestore.front().id;
+    }
+    return nRestored;
+}
+
+void CTPlacement::DesktopMinimizer::Clear()
+{
+    m_vRecords.clear();
+}
@@ -0,0 +1,103 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `DesktopMinimizer.cpp` for details.
+ */
+#pragma once
+
+// Show Desktop / Undo Minimize without IShellDispatch. MinimizeAll records the
+// windows it minimizes, with their z-order and placement, and RestoreAll brings
+// back the ones that are still minimized in one go: the backend restores the whole
+// set to its recorded placement and z-order as a single transaction, optionally
+// with the minimize/restore animation turned off. Activating the topmost window is
+// left to the caller. Windows that were closed or restored by hand in the meantime
+// are left alone.
+// Showing the desktop again before undoing adds the windows shown since to the
+// record, above the ones already in it. The window manager calls live behind
+// IMinimizeBackend so that the record/restore logic has no dependency on Windows headers.
+#include <atomic>
+#include <vector>
+#include "TileLayout.h"
+
+namespace CTPlacement
+{
+	struct WindowShowState
+	{
+		bool bMinimized = false;
+
+		// Maximized, or minimized from maximized
+		bool bMaximized = false;
+
+		// Placement when neither minimized nor maximized, in the backend's coordinates
+		CTLayout::LayoutRect rNormal;
+	};
+
+	struct MinimizeRecord
+	{
+		CTLayout::WindowId id = 0;
+		bool bMaximized = false;
+		CTLayout::LayoutRect rNormal;
+	};
+	using MinimizeRecordVector = std::vector<MinimizeRecord>;
+
+	class IMinimizeBackend
+	{
+	public:
+		virtual ~IMinimizeBackend() = default;
+
+		// Current state of id. Returns false if the window no longer exists
+		virtual bool QueryWindow(CTLayout::WindowId id, WindowShowState& state) = 0;
+
+		// Minimize the windows of vRecords. Returns the number minimized
+		virtual std::size_t MinimizeWindows(const MinimizeRecordVector& vRecords, bool bAnimate) = 0;
+
+		// Restore the windows of vRecords (topmost first) to their recorded placement and
+		// stack them in that order as one transaction, without activating any of them.
+		// Returns the number restored
+		virtual std::size_t RestoreWindows(const MinimizeRecordVector& vRecords, bool bAnimate) = 0;
+	};
+
+	class DesktopMinimizer
+	{
+	public:
+		enum class State
+		{
+			Idle,			// Nothing recorded
+			Minimized		// MinimizeAll recorded windows that RestoreAll hasn't restored yet
+		};
+
+		explicit DesktopMinimizer(IMinimizeBackend& backend);
+		virtual ~DesktopMinimizer() = default;
+		DesktopMinimizer(const DesktopMinimizer&) = delete;
+		DesktopMinimizer(DesktopMinimizer&&) noexcept = delete;
+		DesktopMinimizer& operator=(const DesktopMinimizer&) = delete;
+		DesktopMinimizer& operator=(DesktopMinimizer&&) noexcept = delete;
+
+		// Record and minimize the windows of vWindows (topmost first) that aren't minimized.
+		// Returns the number minimized
+		std::size_t MinimizeAll(const std::vector<CTLayout::WindowId>& vWindows);
+
+		// Restore the recorded windows that are still minimized and forget the record.
+		// Returns the number restored. Does nothing in State::Idle. If pTopmost isn't
+		// nullptr, it receives the topmost window restored (0 if none), to be activated
+		std::size_t RestoreAll(CTLayout::WindowId* pTopmost = nullptr);
+
+		// Forget the record without restoring anything
+		void Clear();
+
+		State GetState() const { return m_vRecords.empty() ? State::Idle : State::Minimized; }
+
+		// Recorded windows, topmost first
+		const MinimizeRecordVector& Records() const { return m_vRecords; }
+
+		// Whether the backend may animate minimizing and restoring. Defaults to true.
+		// May be changed while another thread minimizes or restores
+		void SetAnimate(bool bAnimate) { m_bAnimate.store(bAnimate, std::memory_order_relaxed); }
+
+	protected:
+		IMinimizeBackend& m_backend;
+		MinimizeRecordVector m_vRecords;
+		std::atomic<bool> m_bAnimate{ true };
+	};
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <string_view>
+#include "InstanceProtocol.h"
+
+namespace
+{
+    void PutUInt32(std::vector<std::uint8_t>& vPayload, std::uint32_t n)
+    {
+        for (int i = 0; i < 4; ++i) {
+            vPayload.push_back(static_cast<std::uint8_t>(n >> (8 * i)));
+        }
+    }
+
+    bool GetUInt32(const std::uint8_t*& p, const std::uint8_t* pEnd, std::uint32_t& n)
+    {
+        if (pEnd - p < 4) {
+            return false;
+        }
+        n = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<std::uint32_t>(p[3]) << 24);
+        p += 4;
+        return true;
+    }
+
+    bool EqualsNoCase(std::u16string_view szArg, std::string_view szSwitch)
+    {
+        return std::ranges::equal(szArg, szSwitch, [](char16_t c1, char c2) {
+            return (((c1 >= u'a') && (c1 <= u'z')) ? (c1 - u'a' + u'A') : c1) == static_cast<char16_t>(c2);
+        });
+    }
+}
+
+bool CTInstance::EncodeArgs(const ArgVector& vArgs, std::vector<std::uint8_t>& vPayload)
+{
+    vPayload.clear();
+    if ((vArgs.size() > MAX_ARGS) || std::ranges::any_of(vArgs, [](const std::u16string& szArg) { return szArg.size() > MAX_ARG_CHARS; })) {
+        return false;
+    }
+
+    PutUInt32(vPayload, static_cast<std::uint32_t>(vArgs.size()));
+    for (const std::u16string& szArg : vArgs) {
+        PutUInt32(vPayload, static_cast<std::uint32_t>(szArg.size()));
+        for (char16_t c : szArg) {
+            vPayload.push_back(static_cast<std::uint8_t>(c));
+            vPayload.push_back(static_cast<std::uint8_t>(c >> 8));
+        }
+    }
+    return true;
+}
+
+bool CTInstance::DecodeArgs(const void* pData, std::size_t nSize, ArgVector& vArgs)
+{
+    vArgs.clear();
+    if (!pData) {
+        return false;
+    }
+
+    const std::uint8_t* p = static_cast<const std::uint8_t*>(pData);
+    const std::uint8_t* pEnd = p + nSize;
+    std::uint32_t nArgs = 0;
+    if (!GetUInt32(p, pEnd, nArgs) || (nArgs > MAX_ARGS)) {
+        return false;
+    }
+
+    for (std::uint32_t nArg = 0; nArg < nArgs; ++nArg) {
+        std::uint32_t nChars = 0;
+        if (!GetUInt32(p, pEnd, nChars) || (nChars > MAX_ARG_CHARS) || (static_cast<std::size_t>(pEnd - p) < 2 * static_cast<std::size_t>(nChars))) {
+            vArgs.clear();
+            return false;
+        }
+
+        std::u16string& szArg = vArgs.emplace_back(nChars, u'\0');
+        for (char16_t& c : szArg) {
+            c = static_cast<char16_t>(p[0] | (p[1] << 8));
+            p += 2;
+        }
+    }
+
+    //Trailing bytes mean the payload isn't what it claims to be
+    if (p != pEnd) {
+        vArgs.clear();
+        return false;
+    }
+    return true;
+}
+
+CTInstance::Command CTInstance::ParseCommand(const ArgVector& vArgs)
+{
+    constexpr static std::pair<std::string_view, Command> SWITCHES[] = {
+        {"/CASCADE", Command::Cascade},
+        {"/STACKED", Command::Stacked},
+        {"/SIDEBYSIDE", Command::SideBySide},
+        {"/TILE-HORIZONTAL", Command::Stacked},
+        {"/TILE-VERTICAL", Command::SideBySide},
+        {"/SHOWDESKTOP", Command::ShowDesktop},
+        {"/UNDOMINIMIZE", Command::UndoMinimize},
+        {"/REGISTER", Command::Register},
+        {"/UNREGISTER", Command::Unregister},
+        {"/REGISTERUSER", Command::RegisterUser},
+        {"/UNREGISTERUSER", Command::UnregisterUser}
+    };
+
+    if (vArgs.empty()) {
+        return Command::None;
+    }
+
+    for (const auto& [szSwitch, command] : SWITCHES) {
+        if (EqualsNoCase(vArgs.front(), szSwitch)) {
+            return command;
+        }
+    }
+    return Command::Unknown;
+}
+
+bool CTInstance::IsAction(Command command)
+{
+    switch (command) {
+    case Command::Cascade:
+    case Command::Stacked:
+    case Command::SideBySide:
+    case Command::ShowDesktop:
+    case Command::UndoMinimize:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+CTInstance::Reply CTInstance::ReplyFor(Command command)
+{
+    if ((command == Command::None) || IsAction(command)) {
+        return Reply::Handled;
+    }
+
+    if ((command == Command::RegisterUser) || (command == Command::UnregisterUser)) {
+        return Reply::Yield;
+    }
+    return Reply::Rejected;
+}
@@ -0,0 +1,68 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `InstanceProtocol.cpp` for details.
+ */
+#pragma once
+
+// OS-independent part of the single-instance handoff. A second launch doesn't wait
+// for the running instance to go away; it sends its command line (without the
+// program name) to the running instance and exits. On Windows the payload travels
+// in a WM_COPYDATA message tagged with COMMAND_TAG and the receiver answers with
+// a Reply as the message result. The payload is the number of arguments followed
+// by each argument as a length and UTF-16 code units, all little-endian. Decoding
+// checks every length against the size of the payload, since any process on the
+// desktop can send it.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CTInstance
+{
+	using ArgVector = std::vector<std::u16string>;
+
+	// Identifies a forwarded command line ("CTC1")
+	constexpr static std::uint32_t COMMAND_TAG = 0x31435443;
+
+	// Limits of a payload that DecodeArgs accepts
+	constexpr static std::size_t MAX_ARGS = 32;
+	constexpr static std::size_t MAX_ARG_CHARS = 4096;
+
+	enum class Command
+	{
+		None,				// No arguments: start the notification icon
+		Cascade,			// "/CASCADE"
+		Stacked,			// "/STACKED" or "/TILE-HORIZONTAL"
+		SideBySide,			// "/SIDEBYSIDE" or "/TILE-VERTICAL"
+		ShowDesktop,		// "/SHOWDESKTOP"
+		UndoMinimize,		// "/UNDOMINIMIZE"
+		Register,			// "/REGISTER"
+		Unregister,			// "/UNREGISTER"
+		RegisterUser,		// "/REGISTERUSER"
+		UnregisterUser,		// "/UNREGISTERUSER"
+		Unknown
+	};
+
+	// What the running instance does with a forwarded command
+	enum class Reply
+	{
+		Rejected = 0,		// Not a command it accepts. Also what an unhandled message returns
+		Handled = 1,		// Done (or queued), the sender can exit
+		Yield = 2			// The running instance exits, the sender should wait for it and take over
+	};
+
+	bool EncodeArgs(const ArgVector& vArgs, std::vector<std::uint8_t>& vPayload);
+	bool DecodeArgs(const void* pData, std::size_t nSize, ArgVector& vArgs);
+
+	// The command of vArgs (its first argument, case-insensitive)
+	Command ParseCommand(const ArgVector& vArgs);
+
+	// Whether command is one of the tile/cascade/minimize actions
+	bool IsAction(Command command);
+
+	// How a running instance answers a forwarded command. Installing or uninstalling
+	// while it runs replaces it, everything else is handled by it
+	Reply ReplyFor(Command command);
+}
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include "LatencyHistogram.h"
+
+namespace
+{
+    void StoreMin(std::atomic<std::uint64_t>& nMin, std::uint64_t nValue)
+    {
+        std::uint64_t nCurrent = nMin.load(std::memory_order_relaxed);
+        while ((nValue < nCurrent) && !nMin.compare_exchange_weak(nCurrent, nValue, std::memory_order_relaxed)) {
+        }
+    }
+
+    void StoreMax(std::atomic<std::uint64_t>& nMax, std::uint64_t nValue)
+    {
+        std::uint64_t nCurrent = nMax.load(std::memory_order_relaxed);
+        while ((nValue > nCurrent) && !nMax.compare_exchange_weak(nCurrent, nValue, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+std::size_t CTMetrics::LatencyHistogram::BucketOf(std::uint64_t nMicroseconds)
+{
+    constexpr std::uint64_t SUB_BUCKETS = std::uint64_t{ 1 } << SUB_BUCKET_BITS;
+
+    if (nMicroseconds < SUB_BUCKETS) {
+        return static_cast<std::size_t>(nMicroseconds);
+    }
+    if (nMicroseconds >> MAX_BITS) {
+        return BUCKETS - 1;
+    }
+
+    //The top SUB_BUCKET_BITS + 1 bits of the value pick the bucket
+    const unsigned nMsb = static_cast<unsigned>(std::bit_width(nMicroseconds)) - 1;
+    const unsigned nShift = nMsb - SUB_BUCKET_BITS;
+    return (static_cast<std::size_t>(nShift + 1) << SUB_BUCKET_BITS) | static_cast<std::size_t>((nMicroseconds >> nShift) & (SUB_BUCKETS - 1));
+}
+
+std::uint64_t CTMetrics::LatencyHistogram::BucketHigh(std::size_t nBucket)
+{
+    constexpr std::uint64_t SUB_BUCKETS = std::uint64_t{ 1 } << SUB_BUCKET_BITS;
+
+    const std::size_t nGroup = nBucket >> SUB_BUCKET_BITS;
+    if (nGroup == 0) {
+        return nBucket;
+    }
+
+    const unsigned nShift = static_cast<unsigned>(nGroup - 1);
+    const std::uint64_t nLow = (SUB_BUCKETS | (nBucket & (SUB_BUCKETS - 1))) << nShift;
+    return nLow + (std::uint64_t{ 1 } << nShift) - 1;
+}
+
+void CTMetrics::LatencyHistogram::Record(std::uint64_t nMicroseconds)
+{
+    m_buckets[BucketOf(nMicroseconds)].fetch_add(1, std::memory_order_relaxed);
+    m_nSum.fetch_add(nMicroseconds, std::memory_order_relaxed);
+    StoreMin(m_nMin, nMicroseconds);
+    StoreMax(m_nMax, nMicroseconds);
+    m_nCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t CTMetrics::LatencyHistogram::Percentile(double dQuantile) const
+{
+    std::array<std::uint32_t, BUCKETS> vCounts;
+    std::uint64_t nTotal = 0;
+    for (std::size_t nBucket = 0; nBucket < BUCKETS; ++nBucket) {
+        vCounts[nBucket] = m_buckets[nBucket].load(std::memory_order_relaxed);
+        nTotal += vCounts[nBucket];
+    }
+    return std::min(Percentile(vCounts, nTotal, dQuantile), m_nMax.load(std::memory_order_relaxed));
+}
+
+std::uint64_t CTMetrics::LatencyHistogram::Percentile(const std::array<std::uint32_t, BUCKETS>& vCounts, std::uint64_t nTotal, double dQuantile)
+{
+    if (nTotal == 0) {
+        return 0;
+    }
+
+    //Rank (1-based) of the value sought
+    const double dRank = std::ceil(std::clamp(dQuantile, 0.0, 1.0) * static_cast<double>(nTotal));
+    const std::uint64_t nRank = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(dRank));
+
+    std::uint64_t nSeen = 0;
+    for (std::size_t nBucket = 0; nBucket < BUCKETS; ++nBucket) {
+        nSeen += vCounts[nBucket];
+        if (nSeen >= nRank) {
+            return BucketHigh(nBucket);
+        }
+    }
+    return BucketHigh(BUCKETS - 1);
+}
+
+CTMetrics::LatencySummary CTMetrics::LatencyHistogram::Summarize() const
+{
+    //One copy of the buckets for all percentiles, so that they are consistent with each other
+    std::array<std::uint32_t, BUCKETS> vCounts;
+    std::uint64_t nTotal = 0;
+    for (std::size_t nBucket = 0; nBucket < BUCKETS; ++nBucket) {
+        vCounts[nBucket] = m_buckets[nBucket].load(std::memory_order_relaxed);
+        nTotal += vCounts[nBucket];
+    }
+
+    LatencySummary summary;
+    if (nTotal == 0) {
+        return summary;
+    }
+
+    summary.nCount = nTotal;
+    summary.nMin = m_nMin.load(std::memory_order_relaxed);
+    summary.nMax = m_nMax.load(std::memory_order_relaxed);
+    summary.nMean = m_nSum.load(std::memory_order_relaxed) / nTotal;
+    summary.nP50 = std::min(Percentile(vCounts, nTotal, 0.50), summary.nMax);
+    summary.nP90 = std::min(Percentile(vCounts, nTotal, 0.90), summary.nMax);
+    summary.nP99 = std::min(Percentile(vCounts, nTotal, 0.99), summary.nMax);
+    return summary;
+}
+
+void CTMetrics::LatencyHistogram::Reset()
+{
+    for (std::atomic<std::uint32_t>& nBucket : m_buckets) {
+        nBucket.store(0, std::memory_order_relaxed);
+    }
+    m_nCount.store(0, std::memory_order_relaxed);
+    m_nSum.store(0, std::memory_order_relaxed);
+    m_nMin.store(UINT64_MAX, std::memory_order_relaxed);
+    m_nMax.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `LatencyHistogram.cpp` for details.
+ */
+#pragma once
+
+// OS-independent histogram of latencies in microseconds, in the style of HDR
+// histograms: values below 16 get a bucket each, and every power of two above
+// that is split into 16 linear buckets, so a bucket is at most 1/16 (6.25%) of
+// its value wide. Values from 2^32 us (about 71 minutes) on are counted in the
+// last bucket. Record does a few relaxed atomic increments and no locking, so
+// any thread can record while another reads. A reader sees every count, but the
+// count, sum, minimum and maximum of a value recorded concurrently may not all
+// be visible yet.
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace CTMetrics
+{
+	struct LatencySummary
+	{
+		std::uint64_t nCount = 0;
+		std::uint64_t nMin = 0;
+		std::uint64_t nMax = 0;
+		std::uint64_t nMean = 0;
+		std::uint64_t nP50 = 0;
+		std::uint64_t nP90 = 0;
+		std::uint64_t nP99 = 0;
+	};
+
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram() = default;
+		virtual ~LatencyHistogram() = default;
+		LatencyHistogram(const LatencyHistogram&) = delete;
+		LatencyHistogram(LatencyHistogram&&) noexcept = delete;
+		LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+		LatencyHistogram& operator=(LatencyHistogram&&) noexcept = delete;
+
+		void Record(std::uint64_t nMicroseconds);
+
+		std::uint64_t Count() const { return m_nCount.load(std::memory_order_relaxed); }
+
+		// Smallest value v such that at least fraction dQuantile (0...1) of the recorded
+		// values are <= v, reported as the upper end of v's bucket. 0 if empty
+		std::uint64_t Percentile(double dQuantile) const;
+
+		LatencySummary Summarize() const;
+
+		// Must not run while values are being recorded
+		void Reset();
+
+		// Bucket of nMicroseconds and the largest value that falls into bucket nBucket
+		static std::size_t BucketOf(std::uint64_t nMicroseconds);
+		static std::uint64_t BucketHigh(std::size_t nBucket);
+
+		constexpr static unsigned SUB_BUCKET_BITS = 4;
+		constexpr static unsigned MAX_BITS = 32;
+		constexpr static std::size_t BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+	protected:
+		// Percentiles of counts copied from m_buckets with a total of nTotal
+		static std::uint64_t Percentile(const std::array<std::uint32_t, BUCKETS>& vCounts, std::uint64_t nTotal, double dQuantile);
+
+		std::array<std::atomic<std::uint32_t>, BUCKETS> m_buckets{};
+		std::atomic<std::uint64_t> m_nCount{ 0 };
+		std::atomic<std::uint64_t> m_nSum{ 0 };
+		std::atomic<std::uint64_t> m_nMin{ UINT64_MAX };
+		std::atomic<std::uint64_t> m_nMax{ 0 };
+	};
+}
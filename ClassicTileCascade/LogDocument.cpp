@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <cstring>
+#include "LogDocument.h"
+
+void CTLogView::LogDocument::Attach(IDocumentSource& source)
+{
+    Detach();
+    m_pSource = &source;
+    m_nSize = source.Size();
+
+    if (m_nSize) {
+        m_vCheckpoints.push_back(0);
+        m_nLineStarts = 1;
+    }
+}
+
+void CTLogView::LogDocument::Attach(const char* pData, std::size_t nSize)
+{
+    m_memory.Reset(pData, nSize);
+    Attach(m_memory);
+}
+
+void CTLogView::LogDocument::Extend()
+{
+    if (!m_pSource || (m_pSource->Size() < m_nSize) || !m_nSize) {
+        if (m_pSource) {
+            Attach(*m_pSource);
+        }
+        return;
+    }
+
+    //The scan stopped at the old end without finding a '\n' there, so it can
+    //simply continue from the same offset
+    m_nSize = m_pSource->Size();
+}
+
+void CTLogView::LogDocument::Extend(const char* pData, std::size_t nSize)
+{
+    if (m_pSource != &m_memory) {
+        Attach(pData, nSize);
+        return;
+    }
+
+    m_memory.Reset(pData, nSize);
+    Extend();
+}
+
+void CTLogView::LogDocument::Detach()
+{
+    m_pSource = nullptr;
+    m_nSize = 0;
+    m_vCheckpoints.clear();
+    m_nLineStarts = 0;
+    m_nScanOffset = 0;
+}
+
+std::string_view CTLogView::LogDocument::GetText(std::size_t nOffset, std::size_t nSize)
+{
+    if (nOffset >= m_nSize) {
+        return std::string_view();
+    }
+
+    nSize = std::min(nSize, m_nSize - nOffset);
+    return m_pSource->View(nOffset, nSize).substr(0, nSize);
+}
+
+std::size_t CTLogView::LogDocument::FindNewLine(std::size_t nOffset, std::size_t nEnd)
+{
+    //Whatever the source has mapped around nOffset is scanned in one go
+    nEnd = std::min(nEnd, m_nSize);
+    while (nOffset < nEnd) {
+        std::string_view szView = m_pSource->View(nOffset, 1);
+        szView = szView.substr(0, nEnd - nOffset);
+        const char* pNewLine = static_cast<const char*>(std::memchr(szView.data(), '\n', szView.size()));
+        if (pNewLine) {
+            return nOffset + static_cast<std::size_t>(pNewLine - szView.data());
+        }
+        nOffset += szView.size();
+    }
+    return nEnd;
+}
+
+void CTLogView::LogDocument::IndexTo(std::size_t nLine, std::size_t nOffset)
+{
+    while ((m_nScanOffset < m_nSize) && (m_nLineStarts <= nLine) && (m_nScanOffset <= nOffset)) {
+        std::size_t nNewLine = FindNewLine(m_nScanOffset, m_nSize);
+        if (nNewLine == m_nSize) {
+            m_nScanOffset = m_nSize;
+            break;
+        }
+
+        m_nScanOffset = nNewLine + 1;
+        if ((m_nLineStarts % LINE_STRIDE) == 0) {
+            m_vCheckpoints.push_back(m_nScanOffset);
+        }
+        m_nLineStarts++;
+    }
+}
+
+std::size_t CTLogView::LogDocument::SkipLines(std::size_t nOffset, std::size_t nSkip)
+{
+    for (; nSkip && (nOffset < m_nSize); nSkip--) {
+        std::size_t nNewLine = FindNewLine(nOffset, m_nSize);
+        nOffset = (nNewLine < m_nSize) ? nNewLine + 1 : m_nSize;
+    }
+    return nOffset;
+}
+
+std::size_t CTLogView::LogDocument::LineCount()
+{
+    IndexTo(SIZE_MAX, SIZE_MAX);
+
+    // A trailing '\n' ends the last line rather than starting an empty one
+    bool bTrailingNewLine = m_nSize && (GetText(m_nSize - 1, 1) == "\n");
+    return m_nLineStarts - (bTrailingNewLine ? 1 : 0);
+}
+
+std::size_t CTLogView::LogDocument::LineOffset(std::size_t nLine)
+{
+    IndexTo(nLine, SIZE_MAX);
+    if (nLine >= m_nLineStarts) {
+        return m_nSize;
+    }
+
+    return SkipLines(m_vCheckpoints[nLine / LINE_STRIDE], nLine % LINE_STRIDE);
+}
+
+std::size_t CTLogView::LogDocument::LineFromOffset(std::size_t nOffset)
+{
+    if (!m_nSize) {
+        return 0;
+    }
+    nOffset = std::min(nOffset, m_nSize - 1);
+    IndexTo(SIZE_MAX, nOffset);
+
+    // Last checkpoint at or before nOffset, then count the lines up to nOffset
+    auto it = std::upper_bound(m_vCheckpoints.begin(), m_vCheckpoints.end(), nOffset);
+    std::size_t nCheckpoint = static_cast<std::size_t>(it - m_vCheckpoints.begin()) - 1;
+    std::size_t nLine = nCheckpoint * LINE_STRIDE;
+
+    for (std::size_t nPos = m_vCheckpoints[nCheckpoint]; nPos <= nOffset; nLine++) {
+        std::size_t nNewLine = FindNewLine(nPos, nOffset);
+        if (nNewLine >= nOffset) {
+            break;
+        }
+        nPos = nNewLine + 1;
+    }
+
+    return nLine;
+}
+
+std::string_view CTLogView::LogDocument::GetLines(std::size_t nFirst, std::size_t nCount, std::size_t nMaxBytes)
+{
+    std::size_t nStart = LineOffset(nFirst);
+    std::size_t nEnd = (nCount > SIZE_MAX - nFirst) ? m_nSize : LineOffset(nFirst + nCount);
+
+    if ((nEnd - nStart) > nMaxBytes) {
+        // Keep the whole lines that fit; cut the line if not even one does
+        std::string_view szFit = GetText(nStart, nMaxBytes);
+        std::size_t nLastNewLine = szFit.rfind('\n');
+        nEnd = nStart + ((nLastNewLine == std::string_view::npos) ? nMaxBytes : nLastNewLine + 1);
+    }
+
+    return GetText(nStart, nEnd - nStart);
+}
@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `LogDocument.cpp` for details.
+ */
+#pragma once
+
+// OS-independent data model of the log viewer. LogDocument reads the log file
+// through an IDocumentSource, which serves it in windows (on Windows, views of a
+// file mapping), so a multi-GB log is never mapped as a whole. Lines are found
+// with a sparse index: the offset of every LINE_STRIDE-th line is kept and the
+// file is only scanned as far as the requested line, so opening a multi-GB log
+// costs nothing until it is paged through.
+// A line ends at '\n' (the '\r' of a CRLF line ending stays part of the line text).
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace CTLogView
+{
+	// Read-only bytes of a document, served a window at a time
+	class IDocumentSource
+	{
+	public:
+		virtual ~IDocumentSource() = default;
+
+		virtual std::size_t Size() const = 0;
+
+		// View of the document from nOffset (<= Size()) on, of at least
+		// min(nMinSize, Size() - nOffset) bytes. It may be longer and stays
+		// valid until the next call to View
+		virtual std::string_view View(std::size_t nOffset, std::size_t nMinSize) = 0;
+	};
+
+	// IDocumentSource over a block of memory, which is one window
+	class MemorySource : public IDocumentSource
+	{
+	public:
+		MemorySource() = default;
+		MemorySource(const char* pData, std::size_t nSize) : m_pData(pData), m_nSize(pData ? nSize : 0) {}
+		virtual ~MemorySource() = default;
+		MemorySource(const MemorySource&) = default;
+		MemorySource(MemorySource&&) noexcept = default;
+		MemorySource& operator=(const MemorySource&) = default;
+		MemorySource& operator=(MemorySource&&) noexcept = default;
+
+		void Reset(const char* pData, std::size_t nSize) { *this = MemorySource(pData, nSize); }
+
+		std::size_t Size() const override { return m_nSize; }
+		std::string_view View(std::size_t nOffset, std::size_t) override { return std::string_view(m_pData + nOffset, m_nSize - nOffset); }
+
+	protected:
+		const char* m_pData = nullptr;
+		std::size_t m_nSize = 0;
+	};
+
+	class LogDocument
+	{
+	public:
+		LogDocument() = default;
+		virtual ~LogDocument() = default;
+		LogDocument(const LogDocument&) = delete;
+		LogDocument(LogDocument&&) noexcept = delete;
+		LogDocument& operator=(const LogDocument&) = delete;
+		LogDocument& operator=(LogDocument&&) noexcept = delete;
+
+		// Attach to source and reset the index. The source must stay valid
+		// until the next Attach/Detach
+		void Attach(IDocumentSource& source);
+
+		// Attach to nSize bytes at pData, which must stay valid until the next
+		// Attach/Detach
+		void Attach(const char* pData, std::size_t nSize);
+		void Detach();
+
+		// Take in data appended to the attached source (e.g. a remapped, grown file).
+		// The index built so far is kept. A source that became shorter is attached
+		// from scratch
+		void Extend();
+
+		// Same, for a block of memory that starts with the current one
+		void Extend(const char* pData, std::size_t nSize);
+
+		std::size_t Size() const { return m_nSize; }
+
+		// Text of [nOffset, nOffset + nSize), limited to the document. The view
+		// is valid until the next call that reads the document
+		std::string_view GetText(std::size_t nOffset, std::size_t nSize);
+
+		// Number of lines in the document. Indexes the rest of the document on first use
+		std::size_t LineCount();
+
+		// Offset of the first character of (0-based) nLine. Returns Size() for
+		// nLine >= LineCount()
+		std::size_t LineOffset(std::size_t nLine);
+
+		// (0-based) line that contains the character at nOffset
+		std::size_t LineFromOffset(std::size_t nOffset);
+
+		// Text of lines [nFirst, nFirst + nCount), limited to whole lines that fit
+		// in nMaxBytes (a single line longer than nMaxBytes is cut). The view
+		// points into the attached memory
+		std::string_view GetLines(std::size_t nFirst, std::size_t nCount, std::size_t nMaxBytes = SIZE_MAX);
+
+		// Number of lines indexed so far; LineCount() once the whole document has been scanned
+		std::size_t IndexedLines() const { return m_nLineStarts; }
+
+		constexpr static std::size_t LINE_STRIDE = 256;
+
+	protected:
+		// Scan forward until nLine has been seen, nOffset has been passed, or the end of the document
+		void IndexTo(std::size_t nLine, std::size_t nOffset);
+
+		// Offset of the line nSkip lines after the line starting at nOffset
+		std::size_t SkipLines(std::size_t nOffset, std::size_t nSkip);
+
+		// Offset of the first '\n' in [nOffset, nEnd), or nEnd
+		std::size_t FindNewLine(std::size_t nOffset, std::size_t nEnd);
+
+		IDocumentSource* m_pSource = nullptr;
+		std::size_t m_nSize = 0;
+
+		// Source of Attach(pData, nSize)
+		MemorySource m_memory;
+
+		// m_vCheckpoints[k] is the offset of line k * LINE_STRIDE
+		std::vector<std::size_t> m_vCheckpoints;
+
+		// Number of line starts found before m_nScanOffset. A '\n' always starts a line, 
+		// including the one at the very end of the document, which LineCount() leaves out
+		std::size_t m_nLineStarts = 0;
+		std::size_t m_nScanOffset = 0;
+	};
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <cstring>
+#include "LogIndex.h"
+
+namespace
+{
+    //"YYYY-MM-DD HH:MM:SS " followed by the level padded to 5 characters and a space
+    constexpr std::size_t TIME_LEN = 19;
+    constexpr std::size_t FILE_POS = TIME_LEN + 1 + 5 + 1;
+
+    inline bool IsDigit(char c)
+    {
+        return static_cast<unsigned char>(c - '0') < 10;
+    }
+
+    inline bool Digits(const char* p, std::size_t n, int& nValue)
+    {
+        nValue = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            if (!IsDigit(p[i])) {
+                return false;
+            }
+            nValue = (nValue * 10) + (p[i] - '0');
+        }
+        return true;
+    }
+
+    //Days since 1970-01-01 of a date in the proleptic Gregorian calendar
+    std::int64_t DaysFromCivil(int y, int m, int d)
+    {
+        y -= (m <= 2);
+        const int era = ((y >= 0) ? y : y - 399) / 400;
+        const int yoe = y - (era * 400);
+        const int doy = (((153 * (m + ((m > 2) ? -3 : 9))) + 2) / 5) + d - 1;
+        const int doe = (yoe * 365) + (yoe / 4) - (yoe / 100) + doy;
+        return (static_cast<std::int64_t>(era) * 146097) + doe - 719468;
+    }
+}
+
+bool CTLogView::LineFilter::IsActive() const
+{
+    return (nLevels != ALL_LEVELS) || (nFile != ANY_FILE) ||
+        (nTimeFrom != std::numeric_limits<std::int64_t>::min()) || (nTimeTo != std::numeric_limits<std::int64_t>::max());
+}
+
+void CTLogView::LogIndex::Reset()
+{
+    m_vLines.clear();
+    m_vFiles.clear();
+    m_mapFiles.clear();
+    m_nLastFile = UINT32_MAX;
+    m_nParsed = 0;
+    m_bPartial = false;
+}
+
+void CTLogView::LogIndex::Update(IDocumentSource& text)
+{
+    if (m_bPartial) {
+        //The last line may have grown since
+        m_nParsed = static_cast<std::size_t>(m_vLines.back().nOffset);
+        m_vLines.pop_back();
+        m_bPartial = false;
+    }
+
+    const std::size_t nSize = text.Size();
+    std::size_t nPos = std::min(m_nParsed, nSize);
+    std::size_t nWindow = LINE_BYTES;
+
+    while (nPos < nSize) {
+        std::string_view szWindow = text.View(nPos, nWindow);
+        const char* pWindow = szWindow.data();
+        const char* pEnd = pWindow + szWindow.size();
+        const bool bLast = (nPos + szWindow.size()) >= nSize;
+        const char* p = pWindow;
+
+        while (p < pEnd) {
+            const char* pNewLine = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(pEnd - p)));
+            if (!pNewLine && !bLast) {
+                //The line goes on after the window: the next window starts with it
+                break;
+            }
+            const char* pLineEnd = pNewLine ? pNewLine : pEnd;
+
+            LineInfo info;
+            if (!ParsePrefix(std::string_view(p, static_cast<std::size_t>(pLineEnd - p)), info) && !m_vLines.empty()) {
+                info = m_vLines.back();
+                info.bContinuation = true;
+            }
+            info.nOffset = static_cast<std::uint64_t>(nPos + static_cast<std::size_t>(p - pWindow));
+            m_vLines.push_back(info);
+
+            if (!pNewLine) {
+                m_bPartial = true;
+                p = pEnd;
+            } else {
+                p = pNewLine + 1;
+            }
+        }
+
+        //A line longer than the window needs a larger one
+        nWindow = (p == pWindow) ? nWindow * 2 : LINE_BYTES;
+        nPos += static_cast<std::size_t>(p - pWindow);
+    }
+
+    m_nParsed = nPos;
+}
+
+void CTLogView::LogIndex::Update(std::string_view szText)
+{
+    MemorySource text(szText.data(), szText.size());
+    Update(text);
+}
+
+std::size_t CTLogView::LogIndex::LineSize(std::size_t nLine) const
+{
+    std::size_t nEnd = ((nLine + 1) < m_vLines.size()) ? static_cast<std::size_t>(m_vLines[nLine + 1].nOffset) : m_nParsed;
+    return nEnd - static_cast<std::size_t>(m_vLines[nLine].nOffset);
+}
+
+void CTLogView::LogIndex::Select(const LineFilter& filter, std::size_t nFirst, std::vector<std::size_t>& vLines) const
+{
+    //Lines without level or time (before the first line with a 
+    //prefix) are only hidden by a filter on them
+    const bool bAllLevels = (filter.nLevels == LineFilter::ALL_LEVELS);
+    for (std::size_t nLine = nFirst; nLine < m_vLines.size(); nLine++) {
+        const LineInfo& info = m_vLines[nLine];
+
+        bool bLevel = (info.nLevel < 32) ? ((filter.nLevels >> info.nLevel) & 1) != 0 : bAllLevels;
+        if (
+            bLevel &&
+            ((filter.nFile == LineFilter::ANY_FILE) || (filter.nFile == info.nFile)) &&
+            (info.nTime >= filter.nTimeFrom) && (info.nTime <= filter.nTimeTo)
+        ) {
+            vLines.push_back(nLine);
+        }
+    }
+}
+
+bool CTLogView::LogIndex::ParsePrefix(std::string_view szLine, LineInfo& info)
+{
+    if (szLine.size() < (FILE_POS + 4)) {
+        return false;
+    }
+
+    const char* p = szLine.data();
+    int nYear = 0, nMonth = 0, nDay = 0, nHour = 0, nMinute = 0, nSecond = 0;
+    if (
+        !Digits(p, 4, nYear) || (p[4] != '-') || !Digits(p + 5, 2, nMonth) || (p[7] != '-') || !Digits(p + 8, 2, nDay) ||
+        (p[10] != ' ') || !Digits(p + 11, 2, nHour) || (p[13] != ':') || !Digits(p + 14, 2, nMinute) || (p[16] != ':') ||
+        !Digits(p + 17, 2, nSecond) || (p[TIME_LEN] != ' ') || (p[FILE_POS - 1] != ' ')
+    ) {
+        return false;
+    }
+
+    //Levels are left-aligned and padded with spaces to 5 characters
+    std::string_view szLevel(p + TIME_LEN + 1, 5);
+    szLevel = szLevel.substr(0, szLevel.find(' '));
+    auto itLevel = std::ranges::find(LEVEL_NAMES, szLevel);
+    if (itLevel == std::ranges::end(LEVEL_NAMES)) {
+        return false;
+    }
+
+    //The file name (from __FILE__) may contain ':' itself, as in "C:\...", so
+    //look for the first ':' that is followed by the line number and ": "
+    std::size_t nColon = FILE_POS;
+    for (;;) {
+        nColon = szLine.find(':', nColon + 1);
+        if (nColon == std::string_view::npos) {
+            return false;
+        }
+
+        std::size_t nDigitsEnd = nColon + 1;
+        while ((nDigitsEnd < szLine.size()) && IsDigit(szLine[nDigitsEnd])) {
+            nDigitsEnd++;
+        }
+        if ((nDigitsEnd > (nColon + 1)) && ((nDigitsEnd + 1) < szLine.size()) && (szLine[nDigitsEnd] == ':') && (szLine[nDigitsEnd + 1] == ' ')) {
+            break;
+        }
+    }
+
+    info.nTime = (DaysFromCivil(nYear, nMonth, nDay) * 86400) + (nHour * 3600) + (nMinute * 60) + nSecond;
+    info.nLevel = static_cast<std::uint8_t>(itLevel - std::ranges::begin(LEVEL_NAMES));
+    info.nFile = FileId(szLine.substr(FILE_POS, nColon - FILE_POS));
+    info.bContinuation = false;
+    return true;
+}
+
+std::uint32_t CTLogView::LogIndex::FileId(std::string_view szFile)
+{
+    if ((m_nLastFile != UINT32_MAX) && (m_vFiles[m_nLastFile] == szFile)) {
+        return m_nLastFile;
+    }
+
+    auto it = m_mapFiles.find(szFile);
+    if (it == m_mapFiles.end()) {
+        it = m_mapFiles.emplace(std::string(szFile), static_cast<std::uint32_t>(m_vFiles.size())).first;
+        m_vFiles.emplace_back(szFile);
+    }
+    m_nLastFile = it->second;
+    return m_nLastFile;
+}
@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `LogIndex.cpp` for details.
+ */
+#pragma once
+
+// OS-independent per-line index of a log written by log.c, used by the log
+// viewer's filters. Each line of the text log starts with
+// "YYYY-MM-DD HH:MM:SS LEVEL file:line: ". Update parses that prefix of every line
+// in one pass over the text (line ends are found with memchr, which the CRTs
+// vectorize) and keeps the offset, time, level and an id of the source file.
+// Lines without the prefix (e.g. the rest of a multi-line message) are kept
+// together with the line before them. Line numbers are those of LogDocument.
+// The log is read through an IDocumentSource, a window at a time.
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "LogDocument.h"
+
+namespace CTLogView
+{
+	struct LineInfo
+	{
+		std::uint64_t nOffset = 0;
+
+		// Seconds since 1970-01-01 of the (local) time in the prefix
+		std::int64_t nTime = std::numeric_limits<std::int64_t>::min();
+		std::uint32_t nFile = UINT32_MAX;
+		std::uint8_t nLevel = UINT8_MAX;
+
+		// The line has no prefix of its own, the other members are those of the line before
+		bool bContinuation = false;
+	};
+
+	struct LineFilter
+	{
+		// One bit per level (1 << LOG_TRACE ... 1 << LOG_FATAL)
+		std::uint32_t nLevels = ALL_LEVELS;
+
+		// Id of the source file or ANY_FILE
+		std::uint32_t nFile = ANY_FILE;
+
+		// Lines with a time in [nTimeFrom, nTimeTo]
+		std::int64_t nTimeFrom = std::numeric_limits<std::int64_t>::min();
+		std::int64_t nTimeTo = std::numeric_limits<std::int64_t>::max();
+
+		// Whether the filter hides anything at all
+		bool IsActive() const;
+
+		constexpr static std::uint32_t ALL_LEVELS = 0x3F;
+		constexpr static std::uint32_t ANY_FILE = UINT32_MAX;
+	};
+
+	class LogIndex
+	{
+	public:
+		LogIndex() = default;
+		virtual ~LogIndex() = default;
+		LogIndex(const LogIndex&) = delete;
+		LogIndex(LogIndex&&) noexcept = default;
+		LogIndex& operator=(const LogIndex&) = delete;
+		LogIndex& operator=(LogIndex&&) noexcept = default;
+
+		void Reset();
+
+		// Parse the lines of the text after the ones parsed so far. The text must begin
+		// with the text parsed before (e.g. the same log after it grew). A last line
+		// without '\n' is parsed, and parsed again on the next Update
+		void Update(IDocumentSource& text);
+		void Update(std::string_view szText);
+
+		std::size_t LineCount() const { return m_vLines.size(); }
+
+		// Number of lines that end with '\n', i.e. that won't be parsed again
+		std::size_t CompleteLines() const { return m_vLines.size() - (m_bPartial ? 1 : 0); }
+
+		const LineInfo& Line(std::size_t nLine) const { return m_vLines[nLine]; }
+
+		// Length of (0-based) nLine including its '\n'
+		std::size_t LineSize(std::size_t nLine) const;
+
+		// Name of the source file with id nFile, as written to the log
+		const std::string& FileName(std::uint32_t nFile) const { return m_vFiles[nFile]; }
+		std::size_t FileCount() const { return m_vFiles.size(); }
+
+		// Append the (0-based) lines from nFirst on that pass filter to vLines
+		void Select(const LineFilter& filter, std::size_t nFirst, std::vector<std::size_t>& vLines) const;
+
+		// Level names as written by log.c, indexed by LOG_TRACE ... LOG_FATAL
+		constexpr static std::string_view LEVEL_NAMES[] = { "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL" };
+
+		// Smallest window requested: a line that is longer gets a window twice as large
+		constexpr static std::size_t LINE_BYTES = 64 * 1024;
+
+	protected:
+		// Fill info from the prefix of szLine. Returns false if szLine has no prefix
+		bool ParsePrefix(std::string_view szLine, LineInfo& info);
+
+		std::uint32_t FileId(std::string_view szFile);
+
+		struct StringHash
+		{
+			using is_transparent = void;
+			std::size_t operator()(std::string_view sz) const { return std::hash<std::string_view>{}(sz); }
+		};
+
+		std::vector<LineInfo> m_vLines;
+		std::vector<std::string> m_vFiles;
+		std::unordered_map<std::string, std::uint32_t, StringHash, std::equal_to<>> m_mapFiles;
+
+		// Most lines come from the same few files, in runs
+		std::uint32_t m_nLastFile = UINT32_MAX;
+
+		// Bytes parsed so far and whether the last line parsed had no '\n'
+		std::size_t m_nParsed = 0;
+		bool m_bPartial = false;
+	};
+}
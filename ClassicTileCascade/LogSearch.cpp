@@ -0,0 +1,415 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include "LogSearch.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define CT_LOGSEARCH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr std::size_t FILTER_WORDS = CTLogView::LogSearch::INDEX_BITS / 64;
+    constexpr int FILTER_SHIFT = 32 - std::countr_zero(CTLogView::LogSearch::INDEX_BITS);
+
+    constexpr std::array<unsigned char, 256> FOLD = [] {
+        std::array<unsigned char, 256> fold{};
+        for (std::size_t i = 0; i < fold.size(); i++) {
+            fold[i] = static_cast<unsigned char>(((i >= 'A') && (i <= 'Z')) ? i + ('a' - 'A') : i);
+        }
+        return fold;
+    }();
+
+    constexpr std::array<bool, 256> WORD_BYTE = [] {
+        std::array<bool, 256> word{};
+        for (std::size_t i = 0; i < word.size(); i++) {
+            word[i] = ((i >= 'a') && (i <= 'z')) || ((i >= 'A') && (i <= 'Z')) || ((i >= '0') && (i <= '9')) || (i == '_') || (i >= 0x80);
+        }
+        return word;
+    }();
+
+    inline unsigned char Byte(std::string_view szText, std::size_t nPos)
+    {
+        return static_cast<unsigned char>(szText[nPos]);
+    }
+
+    //Filter bit of the (folded) trigram in the low 24 bits of nTrigram
+    inline std::uint32_t TrigramBit(std::uint32_t nTrigram)
+    {
+        return (nTrigram * 2654435761u) >> FILTER_SHIFT;
+    }
+
+    inline unsigned char Upper(unsigned char c)
+    {
+        return ((c >= 'a') && (c <= 'z')) ? static_cast<unsigned char>(c - ('a' - 'A')) : c;
+    }
+}
+
+void CTLogView::LogSearch::SetPattern(std::string_view szPattern, bool bMatchCase, bool bWholeWord)
+{
+    m_szPattern = szPattern;
+    m_bMatchCase = bMatchCase;
+    m_bWholeWord = bWholeWord;
+
+    m_szFolded = m_szPattern;
+    for (char& c : m_szFolded) {
+        c = static_cast<char>(FOLD[static_cast<unsigned char>(c)]);
+    }
+
+    m_vTrigrams.clear();
+    for (std::size_t i = 0; (i + 2) < m_szFolded.size(); i++) {
+        std::uint32_t nTrigram = (Byte(m_szFolded, i) << 16) | (Byte(m_szFolded, i + 1) << 8) | Byte(m_szFolded, i + 2);
+        m_vTrigrams.push_back(TrigramBit(nTrigram));
+    }
+    std::ranges::sort(m_vTrigrams);
+    m_vTrigrams.erase(std::unique(m_vTrigrams.begin(), m_vTrigrams.end()), m_vTrigrams.end());
+}
+
+std::size_t CTLogView::LogSearch::FindNext(IDocumentSource& text, std::size_t nFrom) const
+{
+    std::size_t nPos = nFrom;
+    std::size_t nIndexed = UseIndex() ? std::min(IndexedBytes(), text.Size()) : 0;
+
+    while (nPos < nIndexed) {
+        std::size_t nBlock = nPos / INDEX_BLOCK;
+        if (!MayContain(nBlock)) {
+            nPos = (nBlock + 1) * INDEX_BLOCK;
+            continue;
+        }
+
+        //Scan a run of candidate blocks in one go
+        std::size_t nEnd = (nBlock + 1) * INDEX_BLOCK;
+        while ((nEnd < nIndexed) && MayContain(nEnd / INDEX_BLOCK)) {
+            nEnd += INDEX_BLOCK;
+        }
+
+        std::size_t nFound = ScanForward(text, nPos, nEnd);
+        if (nFound != npos) {
+            return nFound;
+        }
+        nPos = nEnd;
+    }
+
+    return ScanForward(text, nPos, text.Size());
+}
+
+std::size_t CTLogView::LogSearch::FindNext(std::string_view szText, std::size_t nFrom) const
+{
+    MemorySource text(szText.data(), szText.size());
+    return FindNext(text, nFrom);
+}
+
+std::size_t CTLogView::LogSearch::FindPrev(IDocumentSource& text, std::size_t nBefore) const
+{
+    std::size_t nPos = std::min(nBefore, text.Size());
+    std::size_t nIndexed = UseIndex() ? std::min(IndexedBytes(), text.Size()) : 0;
+
+    while (nPos > 0) {
+        std::size_t nLow = 0;
+        if (nPos > nIndexed) {
+            //The part after the index is always scanned
+            nLow = nIndexed;
+        } else {
+            std::size_t nBlock = (nPos - 1) / INDEX_BLOCK;
+            if (!MayContain(nBlock)) {
+                nPos = nBlock * INDEX_BLOCK;
+                continue;
+            }
+
+            nLow = nBlock * INDEX_BLOCK;
+            while ((nLow > 0) && MayContain((nLow / INDEX_BLOCK) - 1)) {
+                nLow -= INDEX_BLOCK;
+            }
+        }
+
+        std::size_t nFound = ScanBackward(text, nLow, nPos);
+        if (nFound != npos) {
+            return nFound;
+        }
+        nPos = nLow;
+    }
+
+    return npos;
+}
+
+std::size_t CTLogView::LogSearch::FindPrev(std::string_view szText, std::size_t nBefore) const
+{
+    MemorySource text(szText.data(), szText.size());
+    return FindPrev(text, nBefore);
+}
+
+void CTLogView::LogSearch::UpdateIndex(IDocumentSource& text, std::size_t nMaxBytes)
+{
+    //A block is indexed once the trigrams that start in its last bytes are complete
+    std::size_t nBlocks = (text.Size() > 2) ? (text.Size() - 2) / INDEX_BLOCK : 0;
+    nBlocks = std::min(nBlocks, m_nIndexedBlocks + std::max<std::size_t>(nMaxBytes / INDEX_BLOCK, 1));
+    if (nBlocks <= m_nIndexedBlocks) {
+        return;
+    }
+
+    m_vFilters.resize(nBlocks * FILTER_WORDS);
+    for (std::size_t nBlock = m_nIndexedBlocks; nBlock < nBlocks; nBlock++) {
+        std::uint64_t* pFilter = &m_vFilters[nBlock * FILTER_WORDS];
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(text.View(nBlock * INDEX_BLOCK, INDEX_BLOCK + 2).data());
+
+        std::uint32_t nTrigram = (FOLD[p[0]] << 8) | FOLD[p[1]];
+        for (std::size_t i = 0; i < INDEX_BLOCK; i++) {
+            nTrigram = ((nTrigram << 8) | FOLD[p[i + 2]]) & 0xFFFFFF;
+            std::uint32_t nBit = TrigramBit(nTrigram);
+            pFilter[nBit / 64] |= (1ull << (nBit % 64));
+        }
+    }
+    m_nIndexedBlocks = nBlocks;
+}
+
+void CTLogView::LogSearch::UpdateIndex(std::string_view szText, std::size_t nMaxBytes)
+{
+    MemorySource text(szText.data(), szText.size());
+    UpdateIndex(text, nMaxBytes);
+}
+
+void CTLogView::LogSearch::ResetIndex()
+{
+    m_vFilters.clear();
+    m_nIndexedBlocks = 0;
+}
+
+bool CTLogView::LogSearch::UseIndex() const
+{
+    //A pattern of up to INDEX_BLOCK bytes has all its trigrams in the
+    //block the match starts in or the next one
+    return (m_nIndexedBlocks > 0) && !m_vTrigrams.empty() && (m_szPattern.size() <= INDEX_BLOCK);
+}
+
+bool CTLogView::LogSearch::MayContain(std::size_t nBlock) const
+{
+    const std::uint64_t* pFilter = &m_vFilters[nBlock * FILTER_WORDS];
+    const std::uint64_t* pNext = ((nBlock + 1) < m_nIndexedBlocks) ? pFilter + FILTER_WORDS : nullptr;
+
+    for (std::uint32_t nBit : m_vTrigrams) {
+        std::uint64_t nMask = 1ull << (nBit % 64);
+        if (!(pFilter[nBit / 64] & nMask) && pNext && !(pNext[nBit / 64] & nMask)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CTLogView::LogSearch::Verify(std::string_view szText, std::size_t nPos) const
+{
+    std::size_t nLen = m_szPattern.size();
+    if (m_bMatchCase) {
+        if (std::memcmp(szText.data() + nPos, m_szPattern.data(), nLen) != 0) {
+            return false;
+        }
+    } else {
+        for (std::size_t i = 0; i < nLen; i++) {
+            if (FOLD[Byte(szText, nPos + i)] != Byte(m_szFolded, i)) {
+                return false;
+            }
+        }
+    }
+
+    if (m_bWholeWord) {
+        if ((nPos > 0) && WORD_BYTE[Byte(szText, nPos - 1)]) {
+            return false;
+        }
+        if (((nPos + nLen) < szText.size()) && WORD_BYTE[Byte(szText, nPos + nLen)]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t CTLogView::LogSearch::ScanForward(IDocumentSource& text, std::size_t nLow, std::size_t nHigh) const
+{
+    std::size_t nLen = m_szPattern.size();
+    if (!nLen || (nLen > text.Size())) {
+        return npos;
+    }
+
+    //Each window starts a byte early and ends a byte late, for the whole word checks
+    nHigh = std::min(nHigh, text.Size() - nLen + 1);
+    for (std::size_t nPos = nLow; nPos < nHigh; ) {
+        std::size_t nEnd = std::min(nHigh, nPos + SCAN_BYTES);
+        std::size_t nStart = nPos ? nPos - 1 : 0;
+        std::string_view szWindow = text.View(nStart, nEnd + nLen - nStart);
+        szWindow = szWindow.substr(0, nEnd + nLen - nStart);
+
+        std::size_t nFound = ScanForward(szWindow, nPos - nStart, nEnd - nStart);
+        if (nFound != npos) {
+            return nStart + nFound;
+        }
+        nPos = nEnd;
+    }
+
+    return npos;
+}
+
+std::size_t CTLogView::LogSearch::ScanBackward(IDocumentSource& text, std::size_t nLow, std::size_t nHigh) const
+{
+    std::size_t nLen = m_szPattern.size();
+    if (!nLen || (nLen > text.Size())) {
+        return npos;
+    }
+
+    nHigh = std::min(nHigh, text.Size() - nLen + 1);
+    for (std::size_t nPos = nHigh; nPos > nLow; ) {
+        std::size_t nBegin = ((nPos - nLow) > SCAN_BYTES) ? nPos - SCAN_BYTES : nLow;
+        std::size_t nStart = nBegin ? nBegin - 1 : 0;
+        std::string_view szWindow = text.View(nStart, nPos + nLen - nStart);
+        szWindow = szWindow.substr(0, nPos + nLen - nStart);
+
+        std::size_t nFound = ScanBackward(szWindow, nBegin - nStart, nPos - nStart);
+        if (nFound != npos) {
+            return nStart + nFound;
+        }
+        nPos = nBegin;
+    }
+
+    return npos;
+}
+
+std::size_t CTLogView::LogSearch::ScanForward(std::string_view szText, std::size_t nLow, std::size_t nHigh) const
+{
+    std::size_t nLen = m_szPattern.size();
+    if (!nLen || (nLen > szText.size())) {
+        return npos;
+    }
+
+    nHigh = std::min(nHigh, szText.size() - nLen + 1);
+    if (nLow >= nHigh) {
+        return npos;
+    }
+
+    //Candidates have the first and the last byte of the pattern in place.
+    //Without case matching, a letter may be in either case
+    unsigned char cFirst = Byte(m_szFolded, 0), cLast = Byte(m_szFolded, nLen - 1);
+    unsigned char cFirstAlt = m_bMatchCase ? Byte(m_szPattern, 0) : Upper(cFirst);
+    unsigned char cLastAlt = m_bMatchCase ? Byte(m_szPattern, nLen - 1) : Upper(cLast);
+    if (m_bMatchCase) {
+        cFirst = cFirstAlt;
+        cLast = cLastAlt;
+    }
+
+    std::size_t i = nLow;
+#ifdef CT_LOGSEARCH_SSE2
+    const __m128i vFirst = _mm_set1_epi8(static_cast<char>(cFirst)), vFirstAlt = _mm_set1_epi8(static_cast<char>(cFirstAlt));
+    const __m128i vLast = _mm_set1_epi8(static_cast<char>(cLast)), vLastAlt = _mm_set1_epi8(static_cast<char>(cLastAlt));
+
+    //Reading 16 bytes at i + nLen - 1 stays within szText as long as i + 16 <= nHigh
+    for (; (i + 16) <= nHigh; i += 16) {
+        __m128i vBlockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(szText.data() + i));
+        __m128i vBlockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(szText.data() + i + nLen - 1));
+
+        __m128i vEqFirst = _mm_or_si128(_mm_cmpeq_epi8(vBlockFirst, vFirst), _mm_cmpeq_epi8(vBlockFirst, vFirstAlt));
+        __m128i vEqLast = _mm_or_si128(_mm_cmpeq_epi8(vBlockLast, vLast), _mm_cmpeq_epi8(vBlockLast, vLastAlt));
+
+        unsigned int nMask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(vEqFirst, vEqLast)));
+        while (nMask) {
+            std::size_t nPos = i + static_cast<std::size_t>(std::countr_zero(nMask));
+            if (Verify(szText, nPos)) {
+                return nPos;
+            }
+            nMask &= nMask - 1;
+        }
+    }
+#endif
+
+    for (; i < nHigh; i++) {
+        unsigned char c = Byte(szText, i);
+        if ((c == cFirst) || (c == cFirstAlt)) {
+            unsigned char d = Byte(szText, i + nLen - 1);
+            if (((d == cLast) || (d == cLastAlt)) && Verify(szText, i)) {
+                return i;
+            }
+        }
+    }
+
+    return npos;
+}
+
+std::size_t CTLogView::LogSearch::ScanBackward(std::string_view szText, std::size_t nLow, std::size_t nHigh) const
+{
+    std::size_t nLen = m_szPattern.size();
+    if (!nLen || (nLen > szText.size())) {
+        return npos;
+    }
+
+    nHigh = std::min(nHigh, szText.size() - nLen + 1);
+    if (nLow >= nHigh) {
+        return npos;
+    }
+
+    unsigned char cFirst = Byte(m_szFolded, 0), cLast = Byte(m_szFolded, nLen - 1);
+    unsigned char cFirstAlt = m_bMatchCase ? Byte(m_szPattern, 0) : Upper(cFirst);
+    unsigned char cLastAlt = m_bMatchCase ? Byte(m_szPattern, nLen - 1) : Upper(cLast);
+    if (m_bMatchCase) {
+        cFirst = cFirstAlt;
+        cLast = cLastAlt;
+    }
+
+    std::size_t i = nHigh;
+#ifdef CT_LOGSEARCH_SSE2
+    const __m128i vFirst = _mm_set1_epi8(static_cast<char>(cFirst)), vFirstAlt = _mm_set1_epi8(static_cast<char>(cFirstAlt));
+    const __m128i vLast = _mm_set1_epi8(static_cast<char>(cLast)), vLastAlt = _mm_set1_epi8(static_cast<char>(cLastAlt));
+
+    //Same as ScanForward, walking down 16 positions at a time from nHigh
+    for (; (i - nLow) >= 16; i -= 16) {
+        std::size_t nBase = i - 16;
+        __m128i vBlockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(szText.data() + nBase));
+        __m128i vBlockLast = _mm_loadu_si128(reinterpret_cast<const __m128i*>(szText.data() + nBase + nLen - 1));
+
+        __m128i vEqFirst = _mm_or_si128(_mm_cmpeq_epi8(vBlockFirst, vFirst), _mm_cmpeq_epi8(vBlockFirst, vFirstAlt));
+        __m128i vEqLast = _mm_or_si128(_mm_cmpeq_epi8(vBlockLast, vLast), _mm_cmpeq_epi8(vBlockLast, vLastAlt));
+
+        unsigned int nMask = static_cast<unsigned int>(_mm_movemask_epi8(_mm_and_si128(vEqFirst, vEqLast)));
+        while (nMask) {
+            int nBit = std::bit_width(nMask) - 1;
+            if (Verify(szText, nBase + nBit)) {
+                return nBase + nBit;
+            }
+            nMask &= ~(1u << nBit);
+        }
+    }
+#endif
+
+    while (i > nLow) {
+        i--;
+        unsigned char c = Byte(szText, i);
+        if ((c == cFirst) || (c == cFirstAlt)) {
+            unsigned char d = Byte(szText, i + nLen - 1);
+            if (((d == cLast) || (d == cLastAlt)) && Verify(szText, i)) {
+                return i;
+            }
+        }
+    }
+
+    return npos;
+}
@@ -0,0 +1,98 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `LogSearch.cpp` for details.
+ */
+#pragma once
+
+// OS-independent substring search over the raw bytes of the log, used by the
+// log viewer's Find dialog instead of searching the RichEdit document.
+// Candidates are found by comparing the first and the last byte of the pattern
+// 16 positions at a time (SSE2, with a scalar fallback) and then verified.
+// Case-insensitive matching folds ASCII letters only, whole-word matching treats
+// letters, digits, '_' and any byte >= 0x80 as word characters.
+// For repeated searches over a large log, UpdateIndex builds a per-block trigram
+// filter so that blocks which cannot contain the pattern are skipped.
+// The log is read through an IDocumentSource, a window of at most about
+// SCAN_BYTES at a time; the std::string_view overloads search a block of memory.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "LogDocument.h"
+
+namespace CTLogView
+{
+	class LogSearch
+	{
+	public:
+		LogSearch() = default;
+		virtual ~LogSearch() = default;
+		LogSearch(const LogSearch&) = delete;
+		LogSearch(LogSearch&&) noexcept = default;
+		LogSearch& operator=(const LogSearch&) = delete;
+		LogSearch& operator=(LogSearch&&) noexcept = default;
+
+		void SetPattern(std::string_view szPattern, bool bMatchCase, bool bWholeWord);
+		const std::string& Pattern() const { return m_szPattern; }
+
+		// Offset of the first match in the text that starts at or after nFrom, or npos
+		std::size_t FindNext(IDocumentSource& text, std::size_t nFrom) const;
+		std::size_t FindNext(std::string_view szText, std::size_t nFrom) const;
+
+		// Offset of the last match in the text that starts before nBefore, or npos
+		std::size_t FindPrev(IDocumentSource& text, std::size_t nBefore) const;
+		std::size_t FindPrev(std::string_view szText, std::size_t nBefore) const;
+
+		// Index up to nMaxBytes of the whole blocks of the text that have not been indexed
+		// yet. The text must begin with the text indexed so far (e.g. the same log after
+		// it grew). Indexing costs about as much as ten unindexed searches
+		void UpdateIndex(IDocumentSource& text, std::size_t nMaxBytes = SIZE_MAX);
+		void UpdateIndex(std::string_view szText, std::size_t nMaxBytes = SIZE_MAX);
+		void ResetIndex();
+
+		// Length of the text prefix covered by the index
+		std::size_t IndexedBytes() const { return m_nIndexedBlocks * INDEX_BLOCK; }
+
+		constexpr static std::size_t npos = SIZE_MAX;
+
+		// Each INDEX_BLOCK bytes of text get an INDEX_BITS bit trigram filter
+		constexpr static std::size_t INDEX_BLOCK = 16 * 1024;
+		constexpr static std::size_t INDEX_BITS = 4096;
+
+		// Candidates scanned per window of the text
+		constexpr static std::size_t SCAN_BYTES = 4 * 1024 * 1024;
+
+	protected:
+		// First/last match that starts in [nLow, nHigh) of the text, a window at a time
+		std::size_t ScanForward(IDocumentSource& text, std::size_t nLow, std::size_t nHigh) const;
+		std::size_t ScanBackward(IDocumentSource& text, std::size_t nLow, std::size_t nHigh) const;
+
+		// Same, within one window szText (offsets relative to it)
+		std::size_t ScanForward(std::string_view szText, std::size_t nLow, std::size_t nHigh) const;
+		std::size_t ScanBackward(std::string_view szText, std::size_t nLow, std::size_t nHigh) const;
+
+		// Compare the whole pattern at nPos and check the word boundaries
+		bool Verify(std::string_view szText, std::size_t nPos) const;
+
+		// Whether the index can rule out matches starting in nBlock
+		bool MayContain(std::size_t nBlock) const;
+		bool UseIndex() const;
+
+		std::string m_szPattern;
+
+		// m_szPattern with ASCII letters folded to lower case
+		std::string m_szFolded;
+		bool m_bMatchCase = true;
+		bool m_bWholeWord = false;
+
+		// Filter bits of the trigrams of m_szFolded
+		std::vector<std::uint32_t> m_vTrigrams;
+
+		// INDEX_BITS / 64 words per indexed block
+		std::vector<std::uint64_t> m_vFilters;
+		std::size_t m_nIndexedBlocks = 0;
+	};
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include "LogTail.h"
+
+CTLogView::TailReader::TailReader(ITailSource& source)
+    : m_source(source) {}
+
+void CTLogView::TailReader::Reset(std::uint64_t nOffset)
+{
+    m_nOffset = nOffset;
+    m_szPending.clear();
+
+    FileStat stat;
+    m_bHaveIdentity = m_source.Stat(stat) && stat.bExists;
+    m_nIdentity = stat.nIdentity;
+}
+
+CTLogView::TailEvent CTLogView::TailReader::Poll(std::size_t nMaxBytes, std::string& szAppended)
+{
+    szAppended.clear();
+
+    FileStat stat;
+    if (!m_source.Stat(stat) || !stat.bExists) {
+        return TailEvent::Missing;
+    }
+
+    if (!m_bHaveIdentity) {
+        m_bHaveIdentity = true;
+        m_nIdentity = stat.nIdentity;
+    } else if (stat.nIdentity != m_nIdentity) {
+        m_nIdentity = stat.nIdentity;
+        m_nOffset = 0;
+        m_szPending.clear();
+        return TailEvent::Rotated;
+    }
+
+    if (stat.nSize < m_nOffset) {
+        m_nOffset = 0;
+        m_szPending.clear();
+        return TailEvent::Truncated;
+    }
+
+    if ((stat.nSize == m_nOffset) || (nMaxBytes == 0)) {
+        return TailEvent::None;
+    }
+
+    std::size_t nWant = static_cast<std::size_t>(std::min<std::uint64_t>(stat.nSize - m_nOffset, nMaxBytes));
+    std::size_t nPending = m_szPending.size();
+    m_szPending.resize(nPending + nWant);
+    std::size_t nRead = m_source.Read(m_nOffset, m_szPending.data() + nPending, nWant);
+    m_szPending.resize(nPending + nRead);
+    m_nOffset += nRead;
+
+    // Hand back whole lines; a line that outgrew nMaxBytes goes as it is
+    std::size_t nLastNewLine = m_szPending.rfind('\n');
+    std::size_t nTake = (nLastNewLine != std::string::npos) ? nLastNewLine + 1
+                        : ((m_szPending.size() >= nMaxBytes) ? m_szPending.size() : 0);
+    if (nTake == 0) {
+        return TailEvent::None;
+    }
+
+    szAppended.assign(m_szPending, 0, nTake);
+    m_szPending.erase(0, nTake);
+    return TailEvent::Appended;
+}
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `LogTail.cpp` for details.
+ */
+#pragma once
+
+// OS-independent incremental reader behind the log viewer's "Follow Tail" mode.
+// Each Poll reads at most a given number of newly appended bytes and hands back
+// whole lines only; the rest of a line that is still being written waits for
+// the next Poll. A file that shrank (truncation) or whose identity changed
+// (rotation: the path now names a different file) is reported so that the
+// caller can reload it from the start. File access goes through ITailSource,
+// which the Win32 side implements.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace CTLogView
+{
+	struct FileStat
+	{
+		bool bExists = false;
+
+		// Identifies the file behind the path (on Windows, the file index)
+		std::uint64_t nIdentity = 0;
+		std::uint64_t nSize = 0;
+	};
+
+	class ITailSource
+	{
+	public:
+		virtual ~ITailSource() = default;
+
+		// Look up the file currently at the followed path
+		virtual bool Stat(FileStat& stat) = 0;
+
+		// Read up to nBytes at nOffset of the file last seen by Stat. Returns the number of bytes read
+		virtual std::size_t Read(std::uint64_t nOffset, char* pBuf, std::size_t nBytes) = 0;
+	};
+
+	enum class TailEvent
+	{
+		None,			// Nothing new (or only part of a line)
+		Appended,		// Lines were appended
+		Truncated,		// The file is shorter than what was already read
+		Rotated,		// The path names a different file
+		Missing			// The file can't be found (e.g. in the middle of a rotation)
+	};
+
+	class TailReader
+	{
+	public:
+		explicit TailReader(ITailSource& source);
+		virtual ~TailReader() = default;
+		TailReader(const TailReader&) = delete;
+		TailReader(TailReader&&) noexcept = delete;
+		TailReader& operator=(const TailReader&) = delete;
+		TailReader& operator=(TailReader&&) noexcept = delete;
+
+		// Follow the file from nOffset on (the part before nOffset is already displayed)
+		void Reset(std::uint64_t nOffset);
+
+		// Read at most nMaxBytes of new data. On TailEvent::Appended szAppended receives
+		// the new whole lines. A line longer than nMaxBytes is handed back in pieces
+		TailEvent Poll(std::size_t nMaxBytes, std::string& szAppended);
+
+		// Offset up to which data has been handed back by Poll
+		std::uint64_t Consumed() const { return m_nOffset - m_szPending.size(); }
+
+	protected:
+		ITailSource& m_source;
+
+		bool m_bHaveIdentity = false;
+		std::uint64_t m_nIdentity = 0;
+
+		// Offset up to which the file has been read, including m_szPending
+		std::uint64_t m_nOffset = 0;
+
+		// Start of a line that hasn't been completed yet
+		std::string m_szPending;
+	};
+}
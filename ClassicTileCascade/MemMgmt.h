@@ -45,6 +45,8 @@ using SPHICON = std::unique_ptr<HICON, MM_Deleter<HICON, ::DestroyIcon>>;
 using SPFILE = std::unique_ptr<FILE, FILE_deleter>;
 using SPHANDLE_EX = std::unique_ptr<HANDLE, MM_Deleter<HANDLE, ::CloseHandle>>;
 using SPHMODULE = std::unique_ptr<HMODULE, MM_Deleter<HMODULE, ::FreeLibrary>>;
+using SPHWINEVENTHOOK = std::unique_ptr<HWINEVENTHOOK, MM_Deleter<HWINEVENTHOOK, ::UnhookWinEvent>>;
+using SPMAPVIEW = std::unique_ptr<LPCVOID, MM_Deleter<LPCVOID, ::UnmapViewOfFile>>;
 
 // Utility class (CCoInitialize) for automatically calling CoInitialize and 
 // CoUnitialize at entry/exit of scope
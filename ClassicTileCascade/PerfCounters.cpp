@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include "PerfCounters.h"
+
+//Other processes read the block, so it must be plain memory with a fixed layout
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t));
+static_assert(std::is_standard_layout_v<CTCounters::CounterBlock>);
+static_assert(std::size(CTCounters::COUNTER_NAMES) == CTCounters::COUNTER_COUNT);
+
+std::mutex CTCounters::LocalSharedMemory::s_mutex;
+std::map<std::string, std::weak_ptr<CTCounters::LocalSharedMemory::Region>, std::less<>> CTCounters::LocalSharedMemory::s_mapRegions;
+
+void* CTCounters::LocalSharedMemory::Create(std::string_view szName, std::size_t nSize, bool& bExisted)
+{
+    std::lock_guard lock(s_mutex);
+    std::shared_ptr<Region> spRegion;
+    if (auto it = s_mapRegions.find(szName); it != s_mapRegions.end()) {
+        spRegion = it->second.lock();
+    }
+
+    //Like a file mapping, an existing region keeps the size it was created with
+    bExisted = static_cast<bool>(spRegion);
+    if (!spRegion) {
+        spRegion = std::make_shared<Region>((nSize + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t));
+        s_mapRegions[std::string(szName)] = spRegion;
+    } else if (spRegion->size() * sizeof(std::uint64_t) < nSize) {
+        return nullptr;
+    }
+
+    m_vRegions.push_back(spRegion);
+    return spRegion->data();
+}
+
+const void* CTCounters::LocalSharedMemory::Open(std::string_view szName, std::size_t nSize)
+{
+    std::lock_guard lock(s_mutex);
+    auto it = s_mapRegions.find(szName);
+    std::shared_ptr<Region> spRegion = (it != s_mapRegions.end()) ? it->second.lock() : nullptr;
+    if (!spRegion || (spRegion->size() * sizeof(std::uint64_t) < nSize)) {
+        return nullptr;
+    }
+
+    m_vRegions.push_back(spRegion);
+    return spRegion->data();
+}
+
+CTCounters::PerfCounters::PerfCounters()
+    : m_pBlock(&m_localBlock) {}
+
+CTCounters::PerfCounters::~PerfCounters()
+{
+    //Counting that still happens while the process exits goes to the private block
+    m_pBlock.store(&m_localBlock, std::memory_order_release);
+}
+
+CTCounters::PerfCounters& CTCounters::PerfCounters::Global()
+{
+    static PerfCounters s_counters;
+    return s_counters;
+}
+
+void CTCounters::PerfCounters::Add(Counter counter, std::uint64_t n)
+{
+    if (counter >= Counter::Count) {
+        return;
+    }
+
+    const std::size_t nCounter = static_cast<std::size_t>(counter);
+    CounterBlock* pBlock = m_pBlock.load(std::memory_order_acquire);
+    if (pBlock != &m_localBlock) {
+        pBlock->nValues[nCounter].fetch_add(n, std::memory_order_relaxed);
+        return;
+    }
+
+    //Publish may have switched blocks and carried the private counts over between the
+    //load above and this increment. Either its exchange sees the increment, or (all
+    //four operations being sequentially consistent) the load below sees the switch,
+    //and the late count is carried over here
+    m_localBlock.nValues[nCounter].fetch_add(n);
+    if (CounterBlock* pPublished = m_pBlock.load(); pPublished != &m_localBlock) {
+        pPublished->nValues[nCounter].fetch_add(m_localBlock.nValues[nCounter].exchange(0), std::memory_order_relaxed);
+    }
+}
+
+std::uint64_t CTCounters::PerfCounters::Get(Counter counter) const
+{
+    if (counter >= Counter::Count) {
+        return 0;
+    }
+    return m_pBlock.load(std::memory_order_acquire)->nValues[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+}
+
+bool CTCounters::PerfCounters::Publish(std::unique_ptr<ISharedMemory> spMemory, std::string_view szName, std::uint32_t nProcessId, std::uint64_t nNow, const ProcessPredicate& fnIsRunning)
+{
+    if (!spMemory || IsPublished()) {
+        return false;
+    }
+
+    bool bExisted = false;
+    void* pData = spMemory->Create(szName, sizeof(CounterBlock), bExisted);
+    if (!pData) {
+        return false;
+    }
+
+    //Another instance (e.g. a command-line run) must not reset the counters of a running one
+    const CounterBlock* pExisting = static_cast<const CounterBlock*>(pData);
+    if (bExisted && (pExisting->nMagic == BLOCK_MAGIC) && (pExisting->nProcessId != nProcessId) && fnIsRunning && fnIsRunning(pExisting->nProcessId)) {
+        return false;
+    }
+
+    //The region may be left over from an earlier process that a reader kept open, start over
+    CounterBlock* pBlock = new (pData) CounterBlock;
+    pBlock->nProcessId = nProcessId;
+    pBlock->nPublished = nNow;
+
+    //Counts added between reading the private block and the switch would be lost, so 
+    //switch first and then carry the private counts over. An Add that still increments
+    //the private block after this carries its count over itself (see Add)
+    m_spMemory = std::move(spMemory);
+    m_pBlock.store(pBlock);
+    for (std::size_t nCounter = 0; nCounter < COUNTER_COUNT; ++nCounter) {
+        pBlock->nValues[nCounter].fetch_add(m_localBlock.nValues[nCounter].exchange(0), std::memory_order_relaxed);
+    }
+    return true;
+}
+
+bool CTCounters::ReadCounters(const void* pData, std::size_t nSize, CounterSnapshot& snapshot)
+{
+    snapshot = CounterSnapshot();
+    if (!pData || (nSize < offsetof(CounterBlock, nValues))) {
+        return false;
+    }
+
+    const CounterBlock* pBlock = static_cast<const CounterBlock*>(pData);
+    if ((pBlock->nMagic != BLOCK_MAGIC) || (pBlock->nVersion < 1)) {
+        return false;
+    }
+
+    //Blocks of newer versions have more counters, older ones fewer
+    const std::size_t nCounters = std::min<std::size_t>(pBlock->nCounters, COUNTER_COUNT);
+    if (nSize < offsetof(CounterBlock, nValues) + nCounters * sizeof(std::uint64_t)) {
+        return false;
+    }
+
+    snapshot.nProcessId = pBlock->nProcessId;
+    snapshot.nPublished = pBlock->nPublished;
+    for (std::size_t nCounter = 0; nCounter < nCounters; ++nCounter) {
+        snapshot.vValues[nCounter] = pBlock->nValues[nCounter].load(std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void CTCounters::FormatCounters(const CounterSnapshot& snapshot, std::string& szText)
+{
+    szText = "process " + std::to_string(snapshot.nProcessId) + "\n";
+    szText += "published " + std::to_string(snapshot.nPublished) + "\n";
+    for (std::size_t nCounter = 0; nCounter < COUNTER_COUNT; ++nCounter) {
+        szText += COUNTER_NAMES[nCounter];
+        szText += ' ';
+        szText += std::to_string(snapshot.vValues[nCounter]);
+        szText += '\n';
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `PerfCounters.cpp` for details.
+ */
+#pragma once
+
+// OS-independent health counters (actions run, windows moved, log bytes written,
+// ...) kept in a block of shared memory so that monitoring tools can read them
+// without parsing the log. Counters are 64-bit atomics updated with relaxed
+// increments; a reader sees each counter as a whole, but not a consistent set.
+// Counting starts in a block private to the process. Publish moves it into a named
+// shared-memory region created through an ISharedMemory, which on Windows is a
+// page-file backed file mapping. LocalSharedMemory is a process-local stand-in
+// used where there is no such mapping (e.g. when exercising the layout on Linux).
+// The layout only ever grows at the end: readers check the magic and version,
+// and read the counters the block says it has.
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace CTCounters
+{
+	enum class Counter : std::uint32_t
+	{
+		CascadeActions,			// Runs of each ID_FILE_* action that weren't cancelled
+		StackedActions,
+		SideBySideActions,
+		ShowDesktopActions,
+		UndoMinimizeActions,
+		WindowsMoved,			// Windows moved, minimized or restored by the actions
+		Enumerations,			// Enumerations of the desktop's windows and their total time
+		EnumerationUs,
+		LogBytes,				// Bytes written to the text or binary log
+		Exceptions,				// LoggingExceptions thrown (e.g. by the eval_* macros)
+		ViewerOpens,			// Times the log viewer was opened and their total time
+		ViewerOpenUs,
+		Count
+	};
+	constexpr static std::size_t COUNTER_COUNT = static_cast<std::size_t>(Counter::Count);
+
+	// Names reported by FormatCounters, by Counter
+	constexpr static std::string_view COUNTER_NAMES[COUNTER_COUNT] = {
+		"actions.cascade",
+		"actions.stacked",
+		"actions.sidebyside",
+		"actions.showdesktop",
+		"actions.undominimize",
+		"windows.moved",
+		"enumerations",
+		"enumerations.us",
+		"log.bytes",
+		"exceptions",
+		"viewer.opens",
+		"viewer.open.us"
+	};
+
+	// Name of the region on Windows, in the session's namespace
+	constexpr static std::string_view SHARED_NAME = "Local\\ClassicTileCascadeCounters";
+
+	constexpr static std::uint32_t BLOCK_MAGIC = 0x52544E43;		// "CNTR"
+	constexpr static std::uint32_t BLOCK_VERSION = 1;
+
+	struct CounterBlock
+	{
+		std::uint32_t nMagic = BLOCK_MAGIC;
+		std::uint32_t nVersion = BLOCK_VERSION;
+		std::uint32_t nCounters = static_cast<std::uint32_t>(COUNTER_COUNT);
+		std::uint32_t nProcessId = 0;
+
+		// Seconds since 1970-01-01 (UTC) when the counters were published
+		std::uint64_t nPublished = 0;
+
+		std::atomic<std::uint64_t> nValues[COUNTER_COUNT] = {};
+	};
+
+	// Named region of memory that other processes can open
+	class ISharedMemory
+	{
+	public:
+		virtual ~ISharedMemory() = default;
+
+		// Create the region (zero-filled) or, if it exists, open it for writing and set
+		// bExisted. Returns nullptr on failure
+		virtual void* Create(std::string_view szName, std::size_t nSize, bool& bExisted) = 0;
+
+		// Open an existing region for reading. Returns nullptr if there is none
+		virtual const void* Open(std::string_view szName, std::size_t nSize) = 0;
+	};
+
+	// ISharedMemory whose regions are shared by the instances in this process only
+	class LocalSharedMemory : public ISharedMemory
+	{
+	public:
+		LocalSharedMemory() = default;
+		virtual ~LocalSharedMemory() = default;
+		LocalSharedMemory(const LocalSharedMemory&) = delete;
+		LocalSharedMemory(LocalSharedMemory&&) noexcept = delete;
+		LocalSharedMemory& operator=(const LocalSharedMemory&) = delete;
+		LocalSharedMemory& operator=(LocalSharedMemory&&) noexcept = delete;
+
+		void* Create(std::string_view szName, std::size_t nSize, bool& bExisted) override;
+		const void* Open(std::string_view szName, std::size_t nSize) override;
+
+	protected:
+		// 8-byte aligned, like a mapped view
+		using Region = std::vector<std::uint64_t>;
+
+		// Keeps the regions this instance created or opened alive
+		std::vector<std::shared_ptr<Region>> m_vRegions;
+
+		static std::mutex s_mutex;
+		static std::map<std::string, std::weak_ptr<Region>, std::less<>> s_mapRegions;
+	};
+
+	class PerfCounters
+	{
+	public:
+		PerfCounters();
+		virtual ~PerfCounters();
+		PerfCounters(const PerfCounters&) = delete;
+		PerfCounters(PerfCounters&&) noexcept = delete;
+		PerfCounters& operator=(const PerfCounters&) = delete;
+		PerfCounters& operator=(PerfCounters&&) noexcept = delete;
+
+		static PerfCounters& Global();
+
+		void Add(Counter counter, std::uint64_t n = 1);
+		std::uint64_t Get(Counter counter) const;
+
+		// Whether the process with the given id is still running
+		using ProcessPredicate = std::function<bool(std::uint32_t)>;
+
+		// Move the counters into the region szName of spMemory, which is kept until the
+		// counters are destroyed. What was counted so far is carried over. Returns false
+		// (and keeps counting privately) if the region can't be created, or if it holds
+		// the counters of another process that fnIsRunning says is still running
+		bool Publish(std::unique_ptr<ISharedMemory> spMemory, std::string_view szName, std::uint32_t nProcessId, std::uint64_t nNow, const ProcessPredicate& fnIsRunning);
+
+		bool IsPublished() const { return m_pBlock.load(std::memory_order_acquire) != &m_localBlock; }
+
+	protected:
+		CounterBlock m_localBlock;
+		std::atomic<CounterBlock*> m_pBlock;
+		std::unique_ptr<ISharedMemory> m_spMemory;
+	};
+
+	struct CounterSnapshot
+	{
+		std::uint32_t nProcessId = 0;
+		std::uint64_t nPublished = 0;
+
+		// Counters this build knows about, 0 for those the block doesn't have
+		std::array<std::uint64_t, COUNTER_COUNT> vValues{};
+	};
+
+	// Read the block at pData (nSize bytes, e.g. from ISharedMemory::Open). Returns
+	// false if it isn't a counter block
+	bool ReadCounters(const void* pData, std::size_t nSize, CounterSnapshot& snapshot);
+
+	// One "name value" line per counter
+	void FormatCounters(const CounterSnapshot& snapshot, std::string& szText);
+}
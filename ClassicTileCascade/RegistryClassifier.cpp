@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <utility>
+#include "RegistryClassifier.h"
+
+RegistryClassifier::RegistryClassifier(WindowRegistry& registry, std::mutex& mtxRegistry)
+    : m_registry(registry), m_mtxRegistry(mtxRegistry) {}
+
+RegistryClassifier::~RegistryClassifier()
+{
+    Stop();
+}
+
+void RegistryClassifier::Start(Classifier classifier)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_thread.joinable()) {
+        return;
+    }
+
+    m_classifier = std::move(classifier);
+    m_bNotified = true;
+    m_thread = std::jthread([this](std::stop_token stopToken) { Run(stopToken); });
+}
+
+void RegistryClassifier::Stop()
+{
+    std::jthread thread;
+    {
+        std::lock_guard lock(m_mutex);
+        thread = std::move(m_thread);
+    }
+
+    if (thread.joinable()) {
+        thread.request_stop();
+        thread.join();
+    }
+}
+
+bool RegistryClassifier::IsRunning() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_thread.joinable();
+}
+
+void RegistryClassifier::Notify()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_bNotified = true;
+    }
+    m_cv.notify_all();
+}
+
+void RegistryClassifier::Flush()
+{
+    //Copied because Start may replace the classifier while the thread isn't running
+    Classifier classifier;
+    {
+        std::lock_guard lock(m_mutex);
+        classifier = m_classifier;
+    }
+    if (!classifier) {
+        return;
+    }
+
+    ClassifyPending(classifier);
+
+    //Only wait for the run in progress: with a steady stream of events the thread
+    //may never be idle
+    std::unique_lock lock(m_mutex);
+    if (m_bBusy) {
+        const std::size_t nRun = m_nRuns;
+        m_cv.wait(lock, [this, nRun] { return m_nRuns != nRun; });
+    }
+}
+
+std::size_t RegistryClassifier::Classified() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_nClassified;
+}
+
+void RegistryClassifier::Run(std::stop_token stopToken)
+{
+    for (;;) {
+        {
+            std::unique_lock lock(m_mutex);
+            if (!m_cv.wait(lock, stopToken, [this] { return m_bNotified; })) {
+                return;
+            }
+            m_bNotified = false;
+            m_bBusy = true;
+        }
+
+        ClassifyPending(m_classifier);
+
+        {
+            std::lock_guard lock(m_mutex);
+            m_bBusy = false;
+            m_nRuns++;
+        }
+        m_cv.notify_all();
+    }
+}
+
+void RegistryClassifier::ClassifyPending(const Classifier& classifier)
+{
+    WindowRegistry::PendingVector vPending;
+    {
+        std::lock_guard lock(m_mtxRegistry);
+        m_registry.TakePending(vPending);
+    }
+
+    //Each result is set as soon as it is known, so that one slow window doesn't hold
+    //back the others
+    for (const WindowRegistry::PendingWindow& pending : vPending) {
+        const bool bAltTab = classifier(pending.id);
+        {
+            std::lock_guard lock(m_mtxRegistry);
+            m_registry.SetClassification(pending, bAltTab);
+        }
+
+        std::lock_guard lock(m_mutex);
+        m_nClassified++;
+    }
+}
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `RegistryClassifier.cpp` for details.
+ */
+#pragma once
+
+// Classifies the windows that a WindowRegistry marked as pending on a thread of its
+// own, so that the thread that delivers the window events (on Windows, the UI thread
+// running the WinEvent hooks) only marks windows and never waits for one to answer.
+// The registry is shared with that thread and only used under the caller's mutex,
+// which is not held while the classifier runs: a result that went stale in the
+// meantime is dropped by the registry, and the window is classified again.
+// The classifier has no dependency on Windows headers.
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include "WindowRegistry.h"
+
+class RegistryClassifier
+{
+public:
+	using Classifier = WindowRegistry::Classifier;
+
+	RegistryClassifier(WindowRegistry& registry, std::mutex& mtxRegistry);
+	virtual ~RegistryClassifier();
+	RegistryClassifier(const RegistryClassifier&) = delete;
+	RegistryClassifier(RegistryClassifier&&) noexcept = delete;
+	RegistryClassifier& operator=(const RegistryClassifier&) = delete;
+	RegistryClassifier& operator=(RegistryClassifier&&) noexcept = delete;
+
+	// Start the thread, which classifies what is pending right away. classifier is also
+	// run by Flush, on the thread that calls it, so it must be safe to call from both.
+	// Does nothing if the thread is already running
+	void Start(Classifier classifier);
+
+	// Wait for the window being classified and stop the thread. Windows still pending
+	// stay pending. Must not be called with mtxRegistry held
+	void Stop();
+
+	bool IsRunning() const;
+
+	// Wake the thread after windows were marked as pending. May be called with
+	// mtxRegistry held
+	void Notify();
+
+	// Classify the pending windows on the calling thread and wait for those the thread
+	// is classifying, e.g. before the tileable windows are read. Must not be called with
+	// mtxRegistry held
+	void Flush();
+
+	// Windows classified so far, stale results included
+	std::size_t Classified() const;
+
+protected:
+	void Run(std::stop_token stopToken);
+
+	// Classify the windows pending now, one at a time
+	void ClassifyPending(const Classifier& classifier);
+
+	WindowRegistry& m_registry;
+	std::mutex& m_mtxRegistry;
+	Classifier m_classifier;
+
+	// Guards the members below. Never held while m_mtxRegistry is taken
+	mutable std::mutex m_mutex;
+	std::condition_variable_any m_cv;
+	bool m_bNotified = false;
+	bool m_bBusy = false;
+	std::size_t m_nRuns = 0;
+	std::size_t m_nClassified = 0;
+	std::jthread m_thread;
+};
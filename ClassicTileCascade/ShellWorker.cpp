@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "pch.h"
+#include "MemMgmt.h"
+#include "win_log.h"
+#include "ShellWorker.h"
+
+ShellWorker::~ShellWorker()
+{
+    Stop();
+}
+
+bool ShellWorker::Start()
+{
+    if (IsRunning()) {
+        return true;
+    }
+
+    try {
+        std::promise<DWORD> threadId;
+        std::future<DWORD> futureThreadId = threadId.get_future();
+        m_thread = std::thread([this, threadId = std::move(threadId)]() mutable { Run(threadId); });
+        m_dwThreadId = futureThreadId.get();
+        if (!m_dwThreadId) {
+            m_thread.join();
+        }
+    } catch (...) {
+        log_error("Unable to start the shell worker thread");
+        m_dwThreadId = 0;
+    }
+    return IsRunning();
+}
+
+void ShellWorker::Stop()
+{
+    const DWORD dwThreadId = m_dwThreadId.exchange(0);
+    if (dwThreadId) {
+        ::PostThreadMessageW(dwThreadId, WM_QUIT, 0, 0);
+    }
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+HRESULT ShellWorker::Call(CTWinUtils::LPSHELLFUNC lpShellFunc, DWORD dwTimeoutMs)
+{
+    if (!IsRunning() || !lpShellFunc) {
+        return E_UNEXPECTED;
+    }
+
+    //The request is shared with the worker so that it outlives a call that timed out
+    SPRequest spRequest = std::make_shared<Request>();
+    spRequest->lpShellFunc = lpShellFunc;
+    std::future<HRESULT> futureResult = spRequest->result.get_future();
+
+    const auto tpStart = std::chrono::steady_clock::now();
+    std::unique_ptr<SPRequest> pPosted = std::make_unique<SPRequest>(spRequest);
+    if (!::PostThreadMessageW(m_dwThreadId, SWM_CALL, 0, reinterpret_cast<LPARAM>(pPosted.get()))) {
+        return HRESULT_FROM_WIN32(::GetLastError());
+    }
+    pPosted.release();
+
+    if (futureResult.wait_for(std::chrono::milliseconds(dwTimeoutMs)) != std::future_status::ready) {
+        log_warn("Shell call did not return within <%lu> ms", dwTimeoutMs);
+        return HRESULT_FROM_WIN32(ERROR_TIMEOUT);
+    }
+
+    const HRESULT hr = futureResult.get();
+    const auto usElapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tpStart).count();
+    log_debug("Shell call returned <0X%08X> after <%lld> us.", hr, static_cast<long long>(usElapsed));
+    return hr;
+}
+
+void ShellWorker::Reset()
+{
+    if (IsRunning()) {
+        ::PostThreadMessageW(m_dwThreadId, SWM_RESET, 0, 0);
+    }
+}
+
+void ShellWorker::Prewarm()
+{
+    if (IsRunning()) {
+        ::PostThreadMessageW(m_dwThreadId, SWM_PREWARM, 0, 0);
+    }
+}
+
+void ShellWorker::Run(std::promise<DWORD>& threadId)
+{
+    HRESULT hrInit = ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
+    if (FAILED(hrInit)) {
+        log_error("Shell worker unable to initialize COM <0X%08X>", hrInit);
+        threadId.set_value(0);
+        return;
+    }
+
+    //Make sure the thread has a message queue before anyone posts to it
+    MSG msg = { 0 };
+    ::PeekMessageW(&msg, nullptr, WM_USER, WM_USER, PM_NOREMOVE);
+    threadId.set_value(::GetCurrentThreadId());
+
+    while (::GetMessageW(&msg, nullptr, 0, 0) > 0) {
+        if ((msg.hwnd == nullptr) && (msg.message == SWM_CALL)) {
+            std::unique_ptr<SPRequest> pRequest(reinterpret_cast<SPRequest*>(msg.lParam));
+            (*pRequest)->result.set_value(Invoke((*pRequest)->lpShellFunc));
+        } else if ((msg.hwnd == nullptr) && (msg.message == SWM_RESET)) {
+            log_debug("Shell worker releasing the shell object.");
+            m_shell.Release();
+        } else if ((msg.hwnd == nullptr) && (msg.message == SWM_PREWARM)) {
+            try {
+                CreateShell();
+            } catch (const LoggingException& le) {
+                le.Log();
+            } catch (...) {
+                log_error("Unhandled exception");
+            }
+        } else {
+            ::TranslateMessage(&msg);
+            ::DispatchMessageW(&msg);
+        }
+    }
+
+    //Fail the calls that were posted after WM_QUIT
+    while (::PeekMessageW(&msg, nullptr, SWM_CALL, SWM_CALL, PM_REMOVE)) {
+        if (msg.hwnd == nullptr) {
+            std::unique_ptr<SPRequest> pRequest(reinterpret_cast<SPRequest*>(msg.lParam));
+            (*pRequest)->result.set_value(E_ABORT);
+        }
+    }
+
+    m_shell.Release();
+    ::CoUninitialize();
+}
+
+HRESULT ShellWorker::Invoke(CTWinUtils::LPSHELLFUNC lpShellFunc)
+{
+    HRESULT hr = E_FAIL;
+    try {
+        //A call that fails on the cached instance (e.g. Explorer restarted before
+        //TaskbarCreated arrived) is retried once on a new one
+        const bool bCached = (m_shell != nullptr);
+        CreateShell();
+        hr = (m_shell.GetInterfacePtr()->*lpShellFunc)();
+        if (FAILED(hr) && bCached) {
+            log_debug("Shell call failed <0X%08X> on the cached shell object, retrying.", hr);
+            m_shell.Release();
+            CreateShell();
+            hr = (m_shell.GetInterfacePtr()->*lpShellFunc)();
+        }
+        eval_error_hr(hr);
+    } catch (const LoggingException& le) {
+        le.Log();
+    } catch (...) {
+        log_error("Unhandled exception");
+    }
+    return hr;
+}
+
+void ShellWorker::CreateShell()
+{
+    if (!m_shell) {
+        //The cold-start cost that the cached instance saves on every later call
+        const auto tpStart = std::chrono::steady_clock::now();
+        eval_error_hr(m_shell.CreateInstance(CLSID_Shell, nullptr, CLSCTX_INPROC_SERVER));
+        const auto usElapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tpStart).count();
+        log_debug("Shell worker created the shell object in <%lld> us.", static_cast<long long>(usElapsed));
+    }
+}
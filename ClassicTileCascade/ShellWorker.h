@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `ShellWorker.cpp` for details.
+ */
+#pragma once
+
+// Long-lived single-threaded apartment that owns the IShellDispatch instance used by
+// Show Desktop and Undo Minimize. CTWinUtils::ShellHelper initializes COM and creates
+// the shell object on every call; the worker does both once, when its thread starts
+// and on first use, and then services calls from its message queue (an STA has to
+// pump messages anyway). The caller blocks until the call returns or times out.
+// When Explorer restarts (TaskbarCreated), Reset drops the cached instance, and a
+// call that fails on the cached instance is retried once on a new one.
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+#include "WinUtils.h"
+
+class ShellWorker
+{
+public:
+	ShellWorker() = default;
+	virtual ~ShellWorker();
+	ShellWorker(const ShellWorker&) = delete;
+	ShellWorker(ShellWorker&&) noexcept = delete;
+	ShellWorker& operator=(const ShellWorker&) = delete;
+	ShellWorker& operator=(ShellWorker&&) noexcept = delete;
+
+	// Start the worker thread and wait until its message queue exists
+	bool Start();
+	void Stop();
+	bool IsRunning() const { return m_dwThreadId != 0; }
+
+	// Call lpShellFunc on the cached instance on the worker thread. Returns
+	// HRESULT_FROM_WIN32(ERROR_TIMEOUT) if it doesn't return within dwTimeoutMs
+	HRESULT Call(CTWinUtils::LPSHELLFUNC lpShellFunc, DWORD dwTimeoutMs);
+
+	// Release the cached instance, the next call creates a new one
+	void Reset();
+
+	// Create the instance now rather than on the first call
+	void Prewarm();
+
+protected:
+	struct Request
+	{
+		CTWinUtils::LPSHELLFUNC lpShellFunc = nullptr;
+		std::promise<HRESULT> result;
+	};
+	using SPRequest = std::shared_ptr<Request>;
+
+	void Run(std::promise<DWORD>& threadId);
+
+	// Run on the worker thread
+	HRESULT Invoke(CTWinUtils::LPSHELLFUNC lpShellFunc);
+	void CreateShell();
+
+	// Thread messages of the worker. lParam of SWM_CALL is a heap-allocated SPRequest
+	constexpr static UINT SWM_CALL = WM_APP;
+	constexpr static UINT SWM_RESET = WM_APP + 1;
+	constexpr static UINT SWM_PREWARM = WM_APP + 2;
+
+	std::thread m_thread;
+
+	// Read by the threads that call Call
+	std::atomic<DWORD> m_dwThreadId = 0;
+
+	// Only used on the worker thread
+	_COM_SMARTPTR_TYPEDEF(IShellDispatch, IID_IShellDispatch);
+	IShellDispatchPtr m_shell;
+};
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include "SpanRecorder.h"
+
+namespace
+{
+    //Threads are numbered in the order they first record a span
+    std::atomic<std::uint32_t> s_nNextThread{ 1 };
+    thread_local std::uint32_t s_nThread = 0;
+
+    //Spans currently open on this thread
+    thread_local std::uint32_t s_nOpenSpans = 0;
+
+    std::uint32_t ThreadNumber()
+    {
+        if (s_nThread == 0) {
+            s_nThread = s_nNextThread.fetch_add(1, std::memory_order_relaxed);
+        }
+        return s_nThread;
+    }
+
+    void AppendJsonString(std::string& szJson, const char* sz)
+    {
+        szJson += '"';
+        for (const char* p = sz ? sz : ""; *p; ++p) {
+            const unsigned char c = static_cast<unsigned char>(*p);
+            if ((c == '"') || (c == '\\')) {
+                szJson += '\\';
+                szJson += static_cast<char>(c);
+            } else if (c < 0x20) {
+                char szEscape[8];
+                std::snprintf(szEscape, sizeof(szEscape), "\\u%04x", c);
+                szJson += szEscape;
+            } else {
+                szJson += static_cast<char>(c);
+            }
+        }
+        szJson += '"';
+    }
+}
+
+CTTrace::SpanRecorder::SpanRecorder()
+    : m_tpEpoch(Clock::now()) {}
+
+CTTrace::SpanRecorder& CTTrace::SpanRecorder::Global()
+{
+    static SpanRecorder s_recorder;
+    return s_recorder;
+}
+
+std::uint64_t CTTrace::SpanRecorder::Now() const
+{
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - m_tpEpoch).count());
+}
+
+void CTTrace::SpanRecorder::Record(const char* szName, std::uint64_t nStartNs, std::uint64_t nEndNs, std::uint32_t nDepth)
+{
+    //Cheap check first, so that a full recorder doesn't keep growing m_nNext
+    if (m_nNext.load(std::memory_order_relaxed) >= CAPACITY) {
+        m_nDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const std::size_t nSlot = m_nNext.fetch_add(1, std::memory_order_relaxed);
+    if (nSlot >= CAPACITY) {
+        m_nDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Slot& slot = m_slots[nSlot];
+    slot.record.szName = szName;
+    slot.record.nStartNs = nStartNs;
+    slot.record.nDurationNs = (nEndNs > nStartNs) ? (nEndNs - nStartNs) : 0;
+    slot.record.nThread = ThreadNumber();
+    slot.record.nDepth = nDepth;
+    slot.bReady.store(true, std::memory_order_release);
+}
+
+void CTTrace::SpanRecorder::Snapshot(std::vector<SpanRecord>& vRecords) const
+{
+    //A slot that was claimed but not published yet is skipped
+    const std::size_t nSlots = std::min(m_nNext.load(std::memory_order_acquire), CAPACITY);
+    for (std::size_t nSlot = 0; nSlot < nSlots; ++nSlot) {
+        if (m_slots[nSlot].bReady.load(std::memory_order_acquire)) {
+            vRecords.push_back(m_slots[nSlot].record);
+        }
+    }
+}
+
+void CTTrace::SpanRecorder::Clear()
+{
+    for (Slot& slot : m_slots) {
+        slot.bReady.store(false, std::memory_order_relaxed);
+    }
+    m_nDropped.store(0, std::memory_order_relaxed);
+    m_nNext.store(0, std::memory_order_release);
+}
+
+void CTTrace::SpanRecorder::ExportChromeTrace(std::string& szJson, std::uint32_t nProcessId) const
+{
+    std::vector<SpanRecord> vRecords;
+    Snapshot(vRecords);
+
+    //Spans are recorded as they close, i.e. children before their parents
+    std::ranges::stable_sort(vRecords, {}, &SpanRecord::nStartNs);
+
+    szJson = "{\"traceEvents\":[";
+    char szNumbers[160];
+    bool bFirst = true;
+    for (const SpanRecord& record : vRecords) {
+        if (!bFirst) {
+            szJson += ',';
+        }
+        bFirst = false;
+
+        szJson += "\n{\"name\":";
+        AppendJsonString(szJson, record.szName);
+        std::snprintf(szNumbers, sizeof(szNumbers), ",\"cat\":\"ct\",\"ph\":\"X\",\"ts\":%" PRIu64 ".%03u,\"dur\":%" PRIu64 ".%03u,\"pid\":%" PRIu32 ",\"tid\":%" PRIu32 ",\"args\":{\"depth\":%" PRIu32 "}}",
+            record.nStartNs / 1000, static_cast<unsigned>(record.nStartNs % 1000),
+            record.nDurationNs / 1000, static_cast<unsigned>(record.nDurationNs % 1000),
+            nProcessId, record.nThread, record.nDepth);
+        szJson += szNumbers;
+    }
+
+    std::snprintf(szNumbers, sizeof(szNumbers), "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedSpans\":%zu}}\n", Dropped());
+    szJson += szNumbers;
+}
+
+CTTrace::ScopedSpan::ScopedSpan(const char* szName, SpanRecorder& recorder)
+{
+    if (recorder.IsEnabled()) {
+        m_pRecorder = &recorder;
+        m_szName = szName;
+        m_nDepth = s_nOpenSpans++;
+        m_nStartNs = recorder.Now();
+    }
+}
+
+CTTrace::ScopedSpan::~ScopedSpan()
+{
+    if (m_pRecorder) {
+        const std::uint64_t nEndNs = m_pRecorder->Now();
+        --s_nOpenSpans;
+        m_pRecorder->Record(m_szName, m_nStartNs, nEndNs, m_nDepth);
+    }
+}
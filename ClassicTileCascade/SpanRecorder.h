@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `SpanRecorder.cpp` for details.
+ */
+#pragma once
+
+// OS-independent recorder of timed, nested spans (e.g. the steps of start-up),
+// exported as Chrome trace-event JSON that Perfetto and about:tracing can open.
+// A span is opened with CT_SPAN("name") and closed at the end of the scope. The
+// recorder has a fixed number of slots and records a span when it closes: a slot
+// is claimed with one atomic increment and the record is published with a release
+// store, so recording neither allocates nor locks and is safe from any thread.
+// Spans that close after the slots ran out are only counted. Names must outlive
+// the recorder (string literals). The recorder has no dependency on Windows headers.
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace CTTrace
+{
+	using Clock = std::chrono::steady_clock;
+
+	struct SpanRecord
+	{
+		const char* szName = nullptr;
+
+		// Nanoseconds since the recorder was created
+		std::uint64_t nStartNs = 0;
+		std::uint64_t nDurationNs = 0;
+
+		// Small per-thread number, in the order threads first recorded a span
+		std::uint32_t nThread = 0;
+
+		// Number of spans open on the thread when this one was opened
+		std::uint32_t nDepth = 0;
+	};
+
+	class SpanRecorder
+	{
+	public:
+		SpanRecorder();
+		virtual ~SpanRecorder() = default;
+		SpanRecorder(const SpanRecorder&) = delete;
+		SpanRecorder(SpanRecorder&&) noexcept = delete;
+		SpanRecorder& operator=(const SpanRecorder&) = delete;
+		SpanRecorder& operator=(SpanRecorder&&) noexcept = delete;
+
+		// The recorder CT_SPAN records to
+		static SpanRecorder& Global();
+
+		// Disabled recorders don't record anything. Enabled by default
+		void SetEnabled(bool bEnabled) { m_bEnabled.store(bEnabled, std::memory_order_relaxed); }
+		bool IsEnabled() const { return m_bEnabled.load(std::memory_order_relaxed); }
+
+		// Nanoseconds since the recorder was created
+		std::uint64_t Now() const;
+
+		// Record a closed span
+		void Record(const char* szName, std::uint64_t nStartNs, std::uint64_t nEndNs, std::uint32_t nDepth);
+
+		// Append the records published so far to vRecords, in the order they closed
+		void Snapshot(std::vector<SpanRecord>& vRecords) const;
+
+		// Spans that closed after the slots ran out
+		std::size_t Dropped() const { return m_nDropped.load(std::memory_order_relaxed); }
+
+		// Forget all records. Must not run while spans are being recorded
+		void Clear();
+
+		// Chrome trace-event JSON ("X" events with microsecond times) of the records so far
+		void ExportChromeTrace(std::string& szJson, std::uint32_t nProcessId = 0) const;
+
+		constexpr static std::size_t CAPACITY = 1024;
+
+	protected:
+		struct Slot
+		{
+			SpanRecord record;
+			std::atomic<bool> bReady{ false };
+		};
+
+		Clock::time_point m_tpEpoch;
+		std::atomic<bool> m_bEnabled{ true };
+		std::atomic<std::size_t> m_nNext{ 0 };
+		std::atomic<std::size_t> m_nDropped{ 0 };
+		std::array<Slot, CAPACITY> m_slots;
+	};
+
+	// Records the span from its construction to its destruction
+	class ScopedSpan
+	{
+	public:
+		explicit ScopedSpan(const char* szName, SpanRecorder& recorder = SpanRecorder::Global());
+		virtual ~ScopedSpan();
+		ScopedSpan(const ScopedSpan&) = delete;
+		ScopedSpan(ScopedSpan&&) noexcept = delete;
+		ScopedSpan& operator=(const ScopedSpan&) = delete;
+		ScopedSpan& operator=(ScopedSpan&&) noexcept = delete;
+
+	protected:
+		// nullptr if the recorder was disabled when the span opened
+		SpanRecorder* m_pRecorder = nullptr;
+		const char* m_szName = nullptr;
+		std::uint64_t m_nStartNs = 0;
+		std::uint32_t m_nDepth = 0;
+	};
+}
+
+#define CT_SPAN_CONCAT_(a, b) a##b
+#define CT_SPAN_CONCAT(a, b) CT_SPAN_CONCAT_(a, b)
+
+// Record the rest of the enclosing scope as a span named szName
+#define CT_SPAN(szName) const CTTrace::ScopedSpan CT_SPAN_CONCAT(ctSpan_, __LINE__)(szName)
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "TileLayout.h"
+
+// Split the range [nStart, nEnd) into nParts contiguous pieces and return the start of piece nIndex.
+// Using the integer ratio (rather than a fixed piece size) spreads the rounding remainder across
+// the pieces so that the last piece always ends exactly at nEnd - i.e. no blank space
+static long SplitEdge(long nStart, long nEnd, std::size_t nParts, std::size_t nIndex)
+{
+    return nStart + static_cast<long>((static_cast<long long>(nEnd - nStart) * static_cast<long long>(nIndex)) / static_cast<long long>(nParts));
+}
+
+void CTLayout::CalcTileSlots(const LayoutRect& rWorkArea, std::size_t nCount, Arrangement arrangement, std::vector<LayoutRect>& vSlots)
+{
+    vSlots.clear();
+    if (nCount == 0) {
+        return;
+    }
+    vSlots.reserve(nCount);
+
+    //Number of "major" lanes: columns for stacked tiles, rows for side-by-side tiles.
+    //This is the same grid TileWindows uses: the square root of the window count, rounded down
+    std::size_t nLanes = static_cast<std::size_t>(std::sqrt(static_cast<double>(nCount)));
+    nLanes = std::clamp<std::size_t>(nLanes, 1, nCount);
+
+    const std::size_t nPerLane = nCount / nLanes;
+    const std::size_t nExtra = nCount % nLanes;
+
+    const bool bStacked = (arrangement == Arrangement::Stacked);
+
+    for (std::size_t nLane = 0; nLane < nLanes; nLane++) {
+        //The last nExtra lanes receive one more window so that the grid is filled completely
+        const std::size_t nInLane = nPerLane + ((nLane >= (nLanes - nExtra)) ? 1 : 0);
+
+        for (std::size_t nPos = 0; nPos < nInLane; nPos++) {
+            LayoutRect r;
+            if (bStacked) {
+                r.left = SplitEdge(rWorkArea.left, rWorkArea.right, nLanes, nLane);
+                r.right = SplitEdge(rWorkArea.left, rWorkArea.right, nLanes, nLane + 1);
+                r.top = SplitEdge(rWorkArea.top, rWorkArea.bottom, nInLane, nPos);
+                r.bottom = SplitEdge(rWorkArea.top, rWorkArea.bottom, nInLane, nPos + 1);
+            } else {
+                r.top = SplitEdge(rWorkArea.top, rWorkArea.bottom, nLanes, nLane);
+                r.bottom = SplitEdge(rWorkArea.top, rWorkArea.bottom, nLanes, nLane + 1);
+                r.left = SplitEdge(rWorkArea.left, rWorkArea.right, nInLane, nPos);
+                r.right = SplitEdge(rWorkArea.left, rWorkArea.right, nInLane, nPos + 1);
+            }
+            vSlots.push_back(r);
+        }
+    }
+}
+
+void CTLayout::CalcCascadeSlots(const LayoutRect& rWorkArea, std::size_t nCount, const LayoutOptions& options, std::vector<LayoutRect>& vSlots)
+{
+    vSlots.clear();
+    if (nCount == 0) {
+        return;
+    }
+    vSlots.reserve(nCount);
+
+    const long nStepX = std::max(options.nCascadeStepX, 1L);
+    const long nStepY = std::max(options.nCascadeStepY, 1L);
+    const long nMinPercent = std::clamp(options.nCascadeMinPercent, 1L, 100L);
+
+    const long nMinWidth = (rWorkArea.Width() * nMinPercent) / 100;
+    const long nMinHeight = (rWorkArea.Height() * nMinPercent) / 100;
+
+    //Number of windows that fit in one run of the cascade before the windows
+    //would have to shrink below the minimum size
+    const long nFitX = std::max((rWorkArea.Width() - nMinWidth) / nStepX, 0L) + 1;
+    const long nFitY = std::max((rWorkArea.Height() - nMinHeight) / nStepY, 0L) + 1;
+    const std::size_t nRun = std::min<std::size_t>(nCount, static_cast<std::size_t>(std::min(nFitX, nFitY)));
+
+    //Every window of the cascade has the same size: large enough that the front
+    //window of a full run touches the bottom-right corner of the work area
+    const long nWidth = rWorkArea.Width() - (static_cast<long>(nRun) - 1) * nStepX;
+    const long nHeight = rWorkArea.Height() - (static_cast<long>(nRun) - 1) * nStepY;
+
+    for (std::size_t i = 0; i < nCount; i++) {
+        const long nOffset = static_cast<long>(i % nRun);
+
+        LayoutRect r;
+        r.left = rWorkArea.left + nOffset * nStepX;
+        r.top = rWorkArea.top + nOffset * nStepY;
+        r.right = r.left + nWidth;
+        r.bottom = r.top + nHeight;
+        vSlots.push_back(r);
+    }
+}
+
+void CTLayout::CalcLayout(const LayoutRect& rWorkArea, const WindowDescVector& vWindows, const LayoutOptions& options, PlacementVector& vPlacements)
+{
+    vPlacements.clear();
+    if (vWindows.empty() || rWorkArea.IsEmpty()) {
+        return;
+    }
+
+    std::vector<LayoutRect> vSlots;
+    const std::size_t nCount = vWindows.size();
+    vPlacements.resize(nCount);
+
+    switch (options.arrangement) {
+    case Arrangement::Cascade:
+        //vWindows is in z-order with the topmost window first. The topmost window
+        //goes to the front of the cascade (the last slot), just like MDITILE_ZORDER
+        CalcCascadeSlots(rWorkArea, nCount, options, vSlots);
+        for (std::size_t i = 0; i < nCount; i++) {
+            vPlacements[i] = { vWindows[i].id, vSlots[nCount - 1 - i] };
+        }
+        break;
+
+    case Arrangement::Stacked:
+    case Arrangement::SideBySide:
+        CalcTileSlots(rWorkArea, nCount, options.arrangement, vSlots);
+        if (options.bMinimizeMovement && (nCount > 1)) {
+            //The cost of a slot for a window is how far its edges have to move
+            std::vector<long long> vCost(nCount * nCount);
+            for (std::size_t i = 0; i < nCount; i++) {
+                const LayoutRect& r = vWindows[i].rect;
+                for (std::size_t j = 0; j < nCount; j++) {
+                    const LayoutRect& s = vSlots[j];
+                    vCost[(i * nCount) + j] = std::abs(static_cast<long long>(r.left) - s.left) + std::abs(static_cast<long long>(r.top) - s.top) +
+                        std::abs(static_cast<long long>(r.right) - s.right) + std::abs(static_cast<long long>(r.bottom) - s.bottom);
+                }
+            }
+
+            std::vector<std::size_t> vAssignment;
+            SolveAssignment(vCost, nCount, vAssignment);
+            for (std::size_t i = 0; i < nCount; i++) {
+                vPlacements[i] = { vWindows[i].id, vSlots[vAssignment[i]] };
+            }
+        } else {
+            for (std::size_t i = 0; i < nCount; i++) {
+                vPlacements[i] = { vWindows[i].id, vSlots[i] };
+            }
+        }
+        break;
+    }
+}
+
+std::size_t CTLayout::MonitorFromRect(const MonitorDescVector& vMonitors, const LayoutRect& rWindow)
+{
+    std::size_t nBest = 0;
+    long long nBestOverlap = 0;
+    long long nBestDistance = -1;
+
+    for (std::size_t i = 0; i < vMonitors.size(); i++) {
+        const LayoutRect& rMonitor = vMonitors[i].rMonitor;
+
+        long nOverlapX = std::min(rWindow.right, rMonitor.right) - std::max(rWindow.left, rMonitor.left);
+        long nOverlapY = std::min(rWindow.bottom, rMonitor.bottom) - std::max(rWindow.top, rMonitor.top);
+        if ((nOverlapX > 0) && (nOverlapY > 0)) {
+            long long nOverlap = static_cast<long long>(nOverlapX) * nOverlapY;
+            if (nOverlap > nBestOverlap) {
+                nBest = i;
+                nBestOverlap = nOverlap;
+            }
+        } else if (!nBestOverlap) {
+            //No overlap (yet): keep the monitor with the smallest gap to the window
+            long long nGapX = std::max(0L, -nOverlapX);
+            long long nGapY = std::max(0L, -nOverlapY);
+            long long nDistance = (nGapX * nGapX) + (nGapY * nGapY);
+            if ((nBestDistance < 0) || (nDistance < nBestDistance)) {
+                nBest = i;
+                nBestDistance = nDistance;
+            }
+        }
+    }
+
+    return nBest;
+}
+
+void CTLayout::PartitionByMonitor(const MonitorDescVector& vMonitors, const WindowDescVector& vWindows, std::vector<WindowDescVector>& vPerMonitor)
+{
+    vPerMonitor.assign(vMonitors.size(), {});
+    if (vMonitors.empty()) {
+        return;
+    }
+
+    for (const WindowDesc& window : vWindows) {
+        vPerMonitor[MonitorFromRect(vMonitors, window.rect)].push_back(window);
+    }
+}
+
+void CTLayout::CalcLayoutPerMonitor(const MonitorDescVector& vMonitors, const WindowDescVector& vWindows, const LayoutOptions& options, std::vector<PlacementVector>& vPerMonitor)
+{
+    std::vector<WindowDescVector> vWindowsPerMonitor;
+    PartitionByMonitor(vMonitors, vWindows, vWindowsPerMonitor);
+
+    vPerMonitor.assign(vMonitors.size(), {});
+    for (std::size_t i = 0; i < vMonitors.size(); i++) {
+        CalcLayout(vMonitors[i].rWorkArea, vWindowsPerMonitor[i], options, vPerMonitor[i]);
+    }
+}
+
+void CTLayout::SolveAssignment(const std::vector<long long>& vCost, std::size_t nCount, std::vector<std::size_t>& vAssignment)
+{
+    vAssignment.assign(nCount, 0);
+    if (nCount == 0) {
+        return;
+    }
+
+    //Hungarian algorithm with row/column potentials (shortest augmenting paths).
+    //Rows and columns are 1-based below, row/column 0 is a sentinel
+    const long long INF = std::numeric_limits<long long>::max() / 4;
+    std::vector<long long> vRowPot(nCount + 1, 0), vColPot(nCount + 1, 0);
+    std::vector<std::size_t> vColRow(nCount + 1, 0), vWay(nCount + 1, 0);
+    std::vector<long long> vMinSlack(nCount + 1);
+    std::vector<char> vUsed(nCount + 1);
+
+    for (std::size_t nRow = 1; nRow <= nCount; nRow++) {
+        //Find an augmenting path for nRow
+        vColRow[0] = nRow;
+        std::size_t nCol = 0;
+        std::fill(vMinSlack.begin(), vMinSlack.end(), INF);
+        std::fill(vUsed.begin(), vUsed.end(), 0);
+
+        do {
+            vUsed[nCol] = 1;
+            std::size_t nCurRow = vColRow[nCol], nNextCol = 0;
+            long long nDelta = INF;
+            const long long* pCostRow = &vCost[(nCurRow - 1) * nCount];
+            for (std::size_t j = 1; j <= nCount; j++) {
+                if (!vUsed[j]) {
+                    long long nSlack = pCostRow[j - 1] - vRowPot[nCurRow] - vColPot[j];
+                    if (nSlack < vMinSlack[j]) {
+                        vMinSlack[j] = nSlack;
+                        vWay[j] = nCol;
+                    }
+                    if (vMinSlack[j] < nDelta) {
+                        nDelta = vMinSlack[j];
+                        nNextCol = j;
+                    }
+                }
+            }
+
+            for (std::size_t j = 0; j <= nCount; j++) {
+                if (vUsed[j]) {
+                    vRowPot[vColRow[j]] += nDelta;
+                    vColPot[j] -= nDelta;
+                } else {
+                    vMinSlack[j] -= nDelta;
+                }
+            }
+            nCol = nNextCol;
+        } while (vColRow[nCol] != 0);
+
+        //Flip the path
+        do {
+            std::size_t nPrevCol = vWay[nCol];
+            vColRow[nCol] = vColRow[nPrevCol];
+            nCol = nPrevCol;
+        } while (nCol != 0);
+    }
+
+    for (std::size_t j = 1; j <= nCount; j++) {
+        vAssignment[vColRow[j] - 1] = j - 1;
+    }
+}
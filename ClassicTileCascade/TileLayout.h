@@ -0,0 +1,120 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `TileLayout.cpp` for details.
+ */
+#pragma once
+
+// OS-independent layout engine for the tile and cascade actions. Given the work area
+// and a list of window descriptors (in z-order, topmost first, the way EnumWindows
+// returns them), calculates the target rectangle of every window. The engine has no
+// dependency on Windows headers so that it can be built, measured and tested on any
+// platform. The Win32 side converts HWNDs/RECTs to and from these types.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace CTLayout
+{
+	// Mirror of the Win32 RECT structure (right/bottom are exclusive)
+	struct LayoutRect
+	{
+		long left = 0;
+		long top = 0;
+		long right = 0;
+		long bottom = 0;
+
+		long Width() const { return right - left; }
+		long Height() const { return bottom - top; }
+		bool IsEmpty() const { return (right <= left) || (bottom <= top); }
+
+		bool operator==(const LayoutRect&) const = default;
+	};
+
+	// Opaque window identifier (HWND on Windows) plus the current rectangle of the window
+	using WindowId = std::uintptr_t;
+
+	struct WindowDesc
+	{
+		WindowId id = 0;
+		LayoutRect rect;
+
+		// A maximized window has to be placed (restored) even if rect is its target already
+		bool bMaximized = false;
+	};
+	using WindowDescVector = std::vector<WindowDesc>;
+
+	enum class Arrangement
+	{
+		Cascade,		// Equivalent of CascadeWindows(..., MDITILE_ZORDER, ...)
+		Stacked,		// Equivalent of TileWindows(..., MDITILE_HORIZONTAL, ...)
+		SideBySide		// Equivalent of TileWindows(..., MDITILE_VERTICAL, ...)
+	};
+
+	struct LayoutOptions
+	{
+		Arrangement arrangement = Arrangement::Cascade;
+
+		// Offset between two consecutive cascaded windows. On Windows this is the height of
+		// the caption plus the sizing frame, so that every title bar stays visible
+		long nCascadeStepX = 32;
+		long nCascadeStepY = 32;
+
+		// Smallest fraction (in percent) of the work area that a cascaded window may shrink to.
+		// Once the cascade would go below this size it wraps back to the top-left corner
+		long nCascadeMinPercent = 50;
+
+		// Stacked/side-by-side tiles normally fill the slots in z-order. With this set, every window
+		// goes to the slot that, over all windows, moves and resizes the windows the least, so
+		// that tiling an already tiled (or nearly tiled) desktop leaves most windows in place
+		bool bMinimizeMovement = false;
+	};
+
+	struct Placement
+	{
+		WindowId id = 0;
+		LayoutRect rect;
+	};
+	using PlacementVector = std::vector<Placement>;
+
+	// A display: the whole monitor and its work area (the monitor without the taskbar and
+	// other app bars). On Windows, from GetMonitorInfo
+	struct MonitorDesc
+	{
+		LayoutRect rMonitor;
+		LayoutRect rWorkArea;
+	};
+	using MonitorDescVector = std::vector<MonitorDesc>;
+
+	// Calculate the target rectangles for vWindows within rWorkArea. vPlacements receives one
+	// entry per window, in the same order as vWindows
+	void CalcLayout(const LayoutRect& rWorkArea, const WindowDescVector& vWindows, const LayoutOptions& options, PlacementVector& vPlacements);
+
+	// Index in vMonitors (which must not be empty) of the monitor that a window at rWindow is on:
+	// the one it overlaps most or, if it overlaps none, the closest one. On a tie the
+	// monitor that comes first wins. Same rules as MonitorFromRect(..., MONITOR_DEFAULTTONEAREST)
+	std::size_t MonitorFromRect(const MonitorDescVector& vMonitors, const LayoutRect& rWindow);
+
+	// Split vWindows by monitor. vPerMonitor receives one vector per entry in vMonitors; the
+	// windows of each keep their order in vWindows (i.e. the z-order)
+	void PartitionByMonitor(const MonitorDescVector& vMonitors, const WindowDescVector& vWindows, std::vector<WindowDescVector>& vPerMonitor);
+
+	// Lay out the windows of every monitor within the work area of that monitor. vPerMonitor
+	// receives one vector of placements per entry in vMonitors (empty for a monitor without windows)
+	void CalcLayoutPerMonitor(const MonitorDescVector& vMonitors, const WindowDescVector& vWindows, const LayoutOptions& options, std::vector<PlacementVector>& vPerMonitor);
+
+	// Solve the assignment problem for the nCount x nCount matrix vCost (row-major; rows are
+	// windows, columns are slots) with the Hungarian algorithm, in O(nCount^3). vAssignment[row]
+	// receives the column assigned to row, so that the sum of the costs is minimal
+	void SolveAssignment(const std::vector<long long>& vCost, std::size_t nCount, std::vector<std::size_t>& vAssignment);
+
+	// Calculate the slots of an nCount-window tile with no blank space left in the work area.
+	// Stacked tiles fill columns top to bottom, side-by-side tiles fill rows left to right.
+	// When nCount does not fill the grid evenly, the trailing columns (rows) get one extra window
+	void CalcTileSlots(const LayoutRect& rWorkArea, std::size_t nCount, Arrangement arrangement, std::vector<LayoutRect>& vSlots);
+
+	// Calculate the slots of an nCount-window cascade. Slot 0 is the back of the cascade (top-left),
+	// slot nCount - 1 is the front
+	void CalcCascadeSlots(const LayoutRect& rWorkArea, std::size_t nCount, const LayoutOptions& options, std::vector<LayoutRect>& vSlots);
+}
@@ -0,0 +1,562 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "pch.h"
+#include "MemMgmt.h"
+#include "win_log.h"
+#include "WinUtils.h"
+#include "ClassicTileRegUtil.h"
+#include "WinPlatform.h"
+
+Win32PlacementBackend::~Win32PlacementBackend()
+{
+    AbortBatch();
+}
+
+RECT Win32PlacementBackend::WindowRect(HWND hwnd, const CTLayout::LayoutRect& rLayout)
+{
+    RECT r = CTWinUtils::LayoutRect2Rect(rLayout);
+    CTWinUtils::VisibleRect2WindowRect(hwnd, r);
+    return r;
+}
+
+void Win32PlacementBackend::RestoreIfMaximized(HWND hwnd)
+{
+    if (::IsZoomed(hwnd)) {
+        ::ShowWindow(hwnd, SW_SHOWNOACTIVATE);
+    }
+}
+
+bool Win32PlacementBackend::BeginBatch(std::size_t nCount)
+{
+    AbortBatch();
+    m_hdwp = ::BeginDeferWindowPos(static_cast<int>(nCount));
+    if (!m_hdwp) {
+        log_warn("BeginDeferWindowPos failed: error <%u>", ::GetLastError());
+    }
+    return (m_hdwp != nullptr);
+}
+
+bool Win32PlacementBackend::AddToBatch(const CTLayout::Placement& placement)
+{
+    if (!m_hdwp) {
+        return false;
+    }
+
+    HWND hwnd = reinterpret_cast<HWND>(placement.id);
+    RECT r = WindowRect(hwnd, placement.rect);
+
+    //On failure DeferWindowPos frees the structure and returns null,
+    //so there is nothing left to abort
+    m_hdwp = ::DeferWindowPos(m_hdwp, hwnd, nullptr, r.left, r.top, r.right - r.left, r.bottom - r.top, SWP_FLAGS);
+    if (!m_hdwp) {
+        log_warn("DeferWindowPos failed for window <0X%p>: error <%u>", hwnd, ::GetLastError());
+        m_vMaximized.clear();
+        return false;
+    }
+
+    if (::IsZoomed(hwnd)) {
+        m_vMaximized.push_back(hwnd);
+    }
+    return true;
+}
+
+bool Win32PlacementBackend::EndBatch()
+{
+    if (!m_hdwp) {
+        return false;
+    }
+
+    HDWP hdwp = m_hdwp;
+    m_hdwp = nullptr;
+
+    //A deferred move can't change the show state, so the maximized windows are
+    //restored right before the moves are committed
+    for (HWND hwnd : m_vMaximized) {
+        RestoreIfMaximized(hwnd);
+    }
+    m_vMaximized.clear();
+
+    bool bRetVal = (::EndDeferWindowPos(hdwp) == TRUE);
+    if (!bRetVal) {
+        log_warn("EndDeferWindowPos failed: error <%u>", ::GetLastError());
+    }
+    return bRetVal;
+}
+
+void Win32PlacementBackend::AbortBatch()
+{
+    //There is no API that frees a deferred window position structure without
+    //applying it, and dropping it would leak a USER handle of the process on every
+    //failure. Commit the moves added so far instead: the fallback moves the same
+    //windows to the same rects right after. The maximized windows are left as they
+    //are, MoveOne restores them
+    m_vMaximized.clear();
+    if (m_hdwp) {
+        HDWP hdwp = m_hdwp;
+        m_hdwp = nullptr;
+        log_debug("Ending unfinished window transaction <0X%p>", hdwp);
+        if (!::EndDeferWindowPos(hdwp)) {
+            log_warn("EndDeferWindowPos failed: error <%u>", ::GetLastError());
+        }
+    }
+}
+
+bool Win32PlacementBackend::MoveOne(const CTLayout::Placement& placement)
+{
+    HWND hwnd = reinterpret_cast<HWND>(placement.id);
+    RestoreIfMaximized(hwnd);
+    RECT r = WindowRect(hwnd, placement.rect);
+
+    bool bRetVal = (::SetWindowPos(hwnd, nullptr, r.left, r.top, r.right - r.left, r.bottom - r.top, SWP_FLAGS) == TRUE);
+    if (!bRetVal) {
+        log_warn("SetWindowPos failed for window <0X%p>: error <%u>", hwnd, ::GetLastError());
+    }
+    return bRetVal;
+}
+
+Win32MinimizeBackend::AnimationSuppressor::AnimationSuppressor(bool bAnimate)
+{
+    if (!bAnimate && ::SystemParametersInfoW(SPI_GETANIMATION, sizeof(m_ai), &m_ai, 0) && m_ai.iMinAnimate) {
+        //Recorded first, so that the next start puts the animation back if this process
+        //ends before the destructor runs
+        if (ClassicTileRegUtil::SetRegMinAnimateToRestore(static_cast<DWORD>(m_ai.iMinAnimate)) != ERROR_SUCCESS) {
+            log_warn("Unable to record the minimize animation setting, leaving the animation on");
+            return;
+        }
+
+        ANIMATIONINFO aiOff = m_ai;
+        aiOff.iMinAnimate = 0;
+        m_bRestore = (::SystemParametersInfoW(SPI_SETANIMATION, sizeof(aiOff), &aiOff, 0) == TRUE);
+        if (!m_bRestore) {
+            ClassicTileRegUtil::DeleteRegMinAnimateToRestore();
+        }
+    }
+}
+
+Win32MinimizeBackend::AnimationSuppressor::~AnimationSuppressor()
+{
+    if (m_bRestore && ::SystemParametersInfoW(SPI_SETANIMATION, sizeof(m_ai), &m_ai, 0)) {
+        ClassicTileRegUtil::DeleteRegMinAnimateToRestore();
+    }
+}
+
+void Win32MinimizeBackend::RestoreAnimation()
+{
+    DWORD dwMinAnimate = 0;
+    if (ClassicTileRegUtil::GetRegMinAnimateToRestore(dwMinAnimate) != ERROR_SUCCESS) {
+        return;
+    }
+
+    ANIMATIONINFO ai = { sizeof(ANIMATIONINFO) };
+    if (::SystemParametersInfoW(SPI_GETANIMATION, sizeof(ai), &ai, 0)) {
+        ai.iMinAnimate = static_cast<int>(dwMinAnimate);
+        if (::SystemParametersInfoW(SPI_SETANIMATION, sizeof(ai), &ai, 0)) {
+            ClassicTileRegUtil::DeleteRegMinAnimateToRestore();
+            log_info("Minimize animation turned back on after an earlier run ended while it was off.");
+            return;
+        }
+    }
+    log_warn("Unable to turn the minimize animation back on: error <%u>", ::GetLastError());
+}
+
+bool Win32MinimizeBackend::QueryWindow(CTLayout::WindowId id, CTPlacement::WindowShowState& state)
+{
+    //GetWindowPlacement doesn't send messages, so this is safe for windows that don't respond
+    HWND hwnd = reinterpret_cast<HWND>(id);
+    WINDOWPLACEMENT wp = { sizeof(WINDOWPLACEMENT) };
+    if (!::IsWindow(hwnd) || !::GetWindowPlacement(hwnd, &wp)) {
+        return false;
+    }
+
+    state.bMinimized = (::IsIconic(hwnd) == TRUE);
+    state.bMaximized = state.bMinimized ? ((wp.flags & WPF_RESTORETOMAXIMIZED) == WPF_RESTORETOMAXIMIZED) : (::IsZoomed(hwnd) == TRUE);
+    state.rNormal = CTWinUtils::Rect2LayoutRect(wp.rcNormalPosition);
+    return true;
+}
+
+std::size_t Win32MinimizeBackend::MinimizeWindows(const CTPlacement::MinimizeRecordVector& vRecords, bool bAnimate)
+{
+    AnimationSuppressor suppressor(bAnimate);
+
+    std::size_t nMinimized = 0;
+    for (const CTPlacement::MinimizeRecord& record : vRecords) {
+        HWND hwnd = reinterpret_cast<HWND>(record.id);
+        if (::IsHungAppWindow(hwnd)) {
+            nMinimized += ::ShowWindowAsync(hwnd, SW_SHOWMINNOACTIVE) ? 1 : 0;
+        } else {
+            ::ShowWindow(hwnd, SW_SHOWMINNOACTIVE);
+            nMinimized += ::IsIconic(hwnd) ? 1 : 0;
+        }
+    }
+    return nMinimized;
+}
+
+std::size_t Win32MinimizeBackend::RestoreWindows(const CTPlacement::MinimizeRecordVector& vRecords, bool bAnimate)
+{
+    AnimationSuppressor suppressor(bAnimate);
+
+    //Windows that don't respond are restored asynchronously, outside the transaction
+    std::size_t nRestored = 0;
+    CTPlacement::MinimizeRecordVector vBatch;
+    vBatch.reserve(vRecords.size());
+    for (const CTPlacement::MinimizeRecord& record : vRecords) {
+        HWND hwnd = reinterpret_cast<HWND>(record.id);
+        if (!::IsWindow(hwnd)) {
+            continue;
+        }
+
+        if (!::IsHungAppWindow(hwnd)) {
+            vBatch.push_back(record);
+            continue;
+        }
+
+        WINDOWPLACEMENT wp = { sizeof(WINDOWPLACEMENT) };
+        if (::GetWindowPlacement(hwnd, &wp)) {
+            wp.rcNormalPosition = CTWinUtils::LayoutRect2Rect(record.rNormal);
+            wp.showCmd = record.bMaximized ? SW_SHOWMAXIMIZED : SW_SHOWNOACTIVATE;
+            wp.flags = WPF_ASYNCWINDOWPLACEMENT;
+            nRestored += ::SetWindowPlacement(hwnd, &wp) ? 1 : 0;
+        }
+    }
+
+    if (vBatch.empty()) {
+        return nRestored;
+    }
+
+    //Set up the whole transaction before any window changes: the recorded placement of
+    //the windows that aren't maximized and the recorded z-order (topmost first) of all
+    HDWP hdwp = ::BeginDeferWindowPos(static_cast<int>(vBatch.size()));
+    HWND hwndInsertAfter = HWND_TOP;
+    for (const CTPlacement::MinimizeRecord& record : vBatch) {
+        if (!hdwp) {
+            break;
+        }
+
+        HWND hwnd = reinterpret_cast<HWND>(record.id);
+        if (record.bMaximized) {
+            hdwp = ::DeferWindowPos(hdwp, hwnd, hwndInsertAfter, 0, 0, 0, 0, SWP_RESTORE_FLAGS | SWP_NOMOVE | SWP_NOSIZE);
+        } else {
+            RECT r = NormalRect2ScreenRect(CTWinUtils::LayoutRect2Rect(record.rNormal));
+            hdwp = ::DeferWindowPos(hdwp, hwnd, hwndInsertAfter, r.left, r.top, r.right - r.left, r.bottom - r.top, SWP_RESTORE_FLAGS);
+        }
+        hwndInsertAfter = hwnd;
+    }
+
+    //On failure DeferWindowPos frees the structure, so there is nothing to abort
+    if (!hdwp) {
+        log_warn("Unable to set up the restore of <%zu> windows: error <%u>, restoring them one at a time", vBatch.size(), ::GetLastError());
+        return nRestored + RestoreEach(vBatch);
+    }
+
+    //A deferred move can't change the show state, so the windows are shown right before
+    //the transaction is committed, bottom first. There is no way to maximize a window
+    //without activating it, which raises it; the commit puts it back in its place
+    for (const CTPlacement::MinimizeRecord& record : vBatch | std::views::reverse) {
+        HWND hwnd = reinterpret_cast<HWND>(record.id);
+        ::ShowWindow(hwnd, record.bMaximized ? SW_SHOWMAXIMIZED : SW_SHOWNOACTIVATE);
+        nRestored += ::IsIconic(hwnd) ? 0 : 1;
+    }
+
+    if (!::EndDeferWindowPos(hdwp)) {
+        log_warn("Placing and stacking <%zu> restored windows failed: error <%u>", vBatch.size(), ::GetLastError());
+    }
+    return nRestored;
+}
+
+std::size_t Win32MinimizeBackend::RestoreEach(const CTPlacement::MinimizeRecordVector& vRecords)
+{
+    std::size_t nRestored = 0;
+
+    //Bottom first, so that the windows end up roughly in order
+    for (const CTPlacement::MinimizeRecord& record : vRecords | std::views::reverse) {
+        HWND hwnd = reinterpret_cast<HWND>(record.id);
+        WINDOWPLACEMENT wp = { sizeof(WINDOWPLACEMENT) };
+        if (!::GetWindowPlacement(hwnd, &wp)) {
+            continue;
+        }
+
+        wp.rcNormalPosition = CTWinUtils::LayoutRect2Rect(record.rNormal);
+        wp.showCmd = record.bMaximized ? SW_SHOWMAXIMIZED : SW_SHOWNOACTIVATE;
+        wp.flags = 0;
+        if (::SetWindowPlacement(hwnd, &wp)) {
+            ++nRestored;
+        } else {
+            log_warn("SetWindowPlacement failed for window <0X%p>: error <%u>", hwnd, ::GetLastError());
+        }
+    }
+    return nRestored;
+}
+
+RECT Win32MinimizeBackend::NormalRect2ScreenRect(const RECT& rNormal)
+{
+    //Workspace coordinates are relative to the work area of the window's monitor rather
+    //than to the monitor, they differ when the taskbar is at the top or on the left
+    RECT r = rNormal;
+    MONITORINFO mi = { sizeof(MONITORINFO) };
+    if (::GetMonitorInfoW(::MonitorFromRect(&rNormal, MONITOR_DEFAULTTONEAREST), &mi)) {
+        ::OffsetRect(&r, mi.rcWork.left - mi.rcMonitor.left, mi.rcWork.top - mi.rcMonitor.top);
+    }
+    return r;
+}
+
+CTFilter::WindowState Win32AttributeSource::GetState(CTFilter::WindowId id)
+{
+    HWND hwnd = reinterpret_cast<HWND>(id);
+
+    CTFilter::WindowState state;
+    state.bVisible = (::IsWindowVisible(hwnd) == TRUE);
+    state.bIconic = (::IsIconic(hwnd) == TRUE);
+    state.bHung = (::IsHungAppWindow(hwnd) == TRUE);
+    return state;
+}
+
+CTFilter::WindowAttributes Win32AttributeSource::GetAttributes(CTFilter::WindowId id)
+{
+    HWND hwnd = reinterpret_cast<HWND>(id);
+    CTFilter::WindowAttributes attributes;
+
+    //See: https://devblogs.microsoft.com/oldnewthing/20071008-00/?p=24863
+    //Which windows appear in the Alt+Tab list?
+    //Old New Thing blog from October 8th, 2007
+    HWND  hwndWalk = nullptr;
+    HWND hwndTry = ::GetAncestor(hwnd, GA_ROOTOWNER);
+    while (hwndTry != hwndWalk)
+    {
+        hwndWalk = hwndTry;
+        hwndTry = ::GetLastActivePopup(hwndWalk);
+        if (::IsWindowVisible(hwndTry))
+            break;
+    }
+    attributes.bOwnerWalkIsSelf = (hwndWalk == hwnd);
+
+    TITLEBARINFO ti = { 0 };
+    ti.cbSize = sizeof(ti);
+    ::GetTitleBarInfo(hwnd, &ti);
+    attributes.bTitleBarInvisible = ((ti.rgstate[0] & STATE_SYSTEM_INVISIBLE) == STATE_SYSTEM_INVISIBLE);
+
+    attributes.bShellWindow = (::GetShellWindow() == hwnd);
+    attributes.bDisabled = ((::GetWindowLong(hwnd, GWL_STYLE) & WS_DISABLED) == WS_DISABLED);
+    attributes.bToolWindow = ((::GetWindowLong(hwnd, GWL_EXSTYLE) & WS_EX_TOOLWINDOW) == WS_EX_TOOLWINDOW);
+    attributes.bShellCloaked = IsShellCloaked(hwnd);
+
+    //GetWindowTextLengthW sends WM_GETTEXTLENGTH without a timeout and 
+    //would block for as long as the window doesn't respond
+    DWORD_PTR dwTextLength = 0;
+    if (::SendMessageTimeoutW(hwnd, WM_GETTEXTLENGTH, 0, 0, SMTO_ABORTIFHUNG | SMTO_ERRORONEXIT, SEND_TIMEOUT_MS, &dwTextLength)) {
+        attributes.bHasTitle = (dwTextLength > 0);
+    } else {
+        //A window destroyed in the meantime has no title, anything else did not respond
+        attributes.bNotResponding = (::IsWindow(hwnd) == TRUE);
+    }
+
+    return attributes;
+}
+
+bool Win32AttributeSource::IsShellCloaked(HWND hwnd)
+{
+    DWORD cloaked = 0;
+    HRESULT hrTemp = ::DwmGetWindowAttribute(hwnd, DWMWA_CLOAKED, &cloaked, sizeof(cloaked));
+    return SUCCEEDED(hrTemp) && (cloaked == DWM_CLOAKED_SHELL);
+}
+
+void Win32MappedFile::Open(std::wstring_view szPath)
+{
+    Close();
+
+    //The log file is held open for writing by the logger, so the share mode
+    //has to allow writers
+    HANDLE hFile = ::CreateFileW(szPath.data(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                 nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    eval_error_nz(hFile != INVALID_HANDLE_VALUE);
+    m_hFile.reset(hFile);
+
+    LARGE_INTEGER liSize = { 0 };
+    eval_error_nz(::GetFileSizeEx(m_hFile.get(), &liSize));
+    if (liSize.QuadPart == 0) {
+        return;
+    }
+
+    //Offsets are size_t, so a 32 bit build can only view files of up to 4 GB
+    if (static_cast<ULONGLONG>(liSize.QuadPart) > static_cast<ULONGLONG>(SIZE_MAX)) {
+        eval_error_es(ERROR_FILE_TOO_LARGE);
+    }
+
+    m_hMapping.reset(eval_error_nz(::CreateFileMappingW(m_hFile.get(), nullptr, PAGE_READONLY, liSize.HighPart, liSize.LowPart, nullptr)));
+    m_nSize = static_cast<std::size_t>(liSize.QuadPart);
+}
+
+bool Win32MappedFile::Refresh()
+{
+    if (!m_hFile) {
+        return false;
+    }
+
+    LARGE_INTEGER liSize = { 0 };
+    eval_error_nz(::GetFileSizeEx(m_hFile.get(), &liSize));
+    if (static_cast<ULONGLONG>(liSize.QuadPart) < static_cast<ULONGLONG>(m_nSize)) {
+        return false;
+    }
+    if (static_cast<ULONGLONG>(liSize.QuadPart) == static_cast<ULONGLONG>(m_nSize)) {
+        return true;
+    }
+    if (static_cast<ULONGLONG>(liSize.QuadPart) > static_cast<ULONGLONG>(SIZE_MAX)) {
+        eval_error_es(ERROR_FILE_TOO_LARGE);
+    }
+
+    //A mapping can't grow, so a larger one replaces it. The current view holds
+    //a reference to the old mapping and its bytes haven't changed, so it is kept
+    m_hMapping.reset(eval_error_nz(::CreateFileMappingW(m_hFile.get(), nullptr, PAGE_READONLY, liSize.HighPart, liSize.LowPart, nullptr)));
+    m_nSize = static_cast<std::size_t>(liSize.QuadPart);
+    return true;
+}
+
+void Win32MappedFile::Close()
+{
+    m_pView.reset();
+    m_nViewOffset = 0;
+    m_nViewSize = 0;
+    m_hMapping.reset();
+    m_hFile.reset();
+    m_nSize = 0;
+}
+
+std::string_view Win32MappedFile::View(std::size_t nOffset, std::size_t nMinSize)
+{
+    if (nOffset >= m_nSize) {
+        return std::string_view();
+    }
+
+    nMinSize = std::min(nMinSize, m_nSize - nOffset);
+    if (!m_pView || (nOffset < m_nViewOffset) || ((nOffset + nMinSize) > (m_nViewOffset + m_nViewSize))) {
+        static const DWORD GRANULARITY = [] {
+            SYSTEM_INFO si = { 0 };
+            ::GetSystemInfo(&si);
+            return si.dwAllocationGranularity;
+        }();
+
+        //Views have to start at a multiple of the allocation granularity
+        std::size_t nStart = nOffset - (nOffset % GRANULARITY);
+        std::size_t nEnd = std::min(m_nSize, std::max(nStart + WINDOW_BYTES, nOffset + nMinSize));
+        ULARGE_INTEGER uliStart = { 0 };
+        uliStart.QuadPart = nStart;
+
+        m_pView.reset();
+        m_nViewSize = 0;
+        m_pView.reset(eval_error_nz(::MapViewOfFile(m_hMapping.get(), FILE_MAP_READ, uliStart.HighPart, uliStart.LowPart, nEnd - nStart)));
+        m_nViewOffset = nStart;
+        m_nViewSize = nEnd - nStart;
+    }
+
+    const char* pView = static_cast<const char*>(m_pView.get());
+    return std::string_view(pView + (nOffset - m_nViewOffset), m_nViewSize - (nOffset - m_nViewOffset));
+}
+
+void Win32TailSource::SetPath(std::wstring_view szPath)
+{
+    Close();
+    m_szPath = szPath;
+}
+
+void Win32TailSource::Close()
+{
+    m_hFile.reset();
+}
+
+bool Win32TailSource::Stat(CTLogView::FileStat& stat)
+{
+    stat = CTLogView::FileStat();
+    m_hFile.reset();
+
+    HANDLE hFile = ::CreateFileW(m_szPath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                 nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        //Not finding the file is a state to report, not a failure
+        DWORD dwError = ::GetLastError();
+        return (dwError == ERROR_FILE_NOT_FOUND) || (dwError == ERROR_PATH_NOT_FOUND);
+    }
+    m_hFile.reset(hFile);
+
+    BY_HANDLE_FILE_INFORMATION bhfi = { 0 };
+    if (!::GetFileInformationByHandle(m_hFile.get(), &bhfi)) {
+        return false;
+    }
+
+    stat.bExists = true;
+    stat.nIdentity = (static_cast<std::uint64_t>(bhfi.nFileIndexHigh) << 32) | bhfi.nFileIndexLow;
+    stat.nSize = (static_cast<std::uint64_t>(bhfi.nFileSizeHigh) << 32) | bhfi.nFileSizeLow;
+    return true;
+}
+
+std::size_t Win32TailSource::Read(std::uint64_t nOffset, char* pBuf, std::size_t nBytes)
+{
+    if (!m_hFile) {
+        return 0;
+    }
+
+    OVERLAPPED ov = { 0 };
+    ov.Offset = static_cast<DWORD>(nOffset);
+    ov.OffsetHigh = static_cast<DWORD>(nOffset >> 32);
+
+    DWORD dwRead = 0;
+    if (!::ReadFile(m_hFile.get(), pBuf, static_cast<DWORD>(std::min<std::size_t>(nBytes, MAXDWORD)), &dwRead, &ov)) {
+        return 0;
+    }
+    return dwRead;
+}
+
+void* Win32SharedMemory::Create(std::string_view szName, std::size_t nSize, bool& bExisted)
+{
+    std::wstring szWName;
+    CTWinUtils::String2wstring(szWName, std::string(szName));
+
+    m_pView.reset();
+    m_hMapping.reset(::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(nSize), szWName.c_str()));
+    bExisted = m_hMapping && (::GetLastError() == ERROR_ALREADY_EXISTS);
+    if (m_hMapping) {
+        m_pView.reset(::MapViewOfFile(m_hMapping.get(), FILE_MAP_WRITE, 0, 0, nSize));
+    }
+    return const_cast<void*>(m_pView.get());
+}
+
+const void* Win32SharedMemory::Open(std::string_view szName, std::size_t nSize)
+{
+    std::wstring szWName;
+    CTWinUtils::String2wstring(szWName, std::string(szName));
+
+    m_pView.reset();
+    m_hMapping.reset(::OpenFileMappingW(FILE_MAP_READ, FALSE, szWName.c_str()));
+    if (m_hMapping) {
+        m_pView.reset(::MapViewOfFile(m_hMapping.get(), FILE_MAP_READ, 0, 0, nSize));
+    }
+    return m_pView.get();
+}
+
+bool Win32SharedMemory::IsProcessRunning(std::uint32_t nProcessId)
+{
+    SPHANDLE_EX hProcess(::OpenProcess(SYNCHRONIZE, FALSE, nProcessId));
+    if (!hProcess) {
+        //A process that exists but can't be opened is running
+        return ::GetLastError() == ERROR_ACCESS_DENIED;
+    }
+    return ::WaitForSingleObject(hProcess.get(), 0) == WAIT_TIMEOUT;
+}
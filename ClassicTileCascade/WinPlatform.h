@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `WinPlatform.cpp` for details.
+ */
+#pragma once
+
+// Win32 implementations of the platform abstractions used by the OS-independent
+// parts of the tile/cascade pipeline and the log viewer
+#include "MemMgmt.h"
+#include "WindowPlacement.h"
+#include "WindowFilter.h"
+#include "DesktopMinimizer.h"
+#include "LogDocument.h"
+#include "LogTail.h"
+#include "PerfCounters.h"
+
+// Placement backend that uses BeginDeferWindowPos/DeferWindowPos/EndDeferWindowPos
+// for the transaction and SetWindowPos for the fallback path
+class Win32PlacementBackend : public CTPlacement::IPlacementBackend
+{
+public:
+	Win32PlacementBackend() = default;
+	virtual ~Win32PlacementBackend();
+	Win32PlacementBackend(const Win32PlacementBackend&) = delete;
+	Win32PlacementBackend(Win32PlacementBackend&&) noexcept = delete;
+	Win32PlacementBackend& operator=(const Win32PlacementBackend&) = delete;
+	Win32PlacementBackend& operator=(Win32PlacementBackend&&) noexcept = delete;
+
+	bool BeginBatch(std::size_t nCount) override;
+	bool AddToBatch(const CTLayout::Placement& placement) override;
+	bool EndBatch() override;
+	void AbortBatch() override;
+	bool MoveOne(const CTLayout::Placement& placement) override;
+
+protected:
+	// Convert the layout rect (visible frame) to the rect expected by SetWindowPos/DeferWindowPos
+	static RECT WindowRect(HWND hwnd, const CTLayout::LayoutRect& rLayout);
+
+	// TileWindows/CascadeWindows restore maximized windows before moving them
+	static void RestoreIfMaximized(HWND hwnd);
+
+	constexpr static UINT SWP_FLAGS = SWP_NOZORDER | SWP_NOOWNERZORDER | SWP_NOACTIVATE;
+
+	HDWP m_hdwp = nullptr;
+
+	// Maximized windows in the transaction. They are only restored when EndBatch
+	// commits it, so that an aborted transaction leaves every window as it was
+	std::vector<HWND> m_vMaximized;
+};
+
+// Minimize backend for CTPlacement::DesktopMinimizer. Restoring shows the windows
+// and then places and stacks them all in one DeferWindowPos transaction. Windows
+// that don't respond are minimized and restored asynchronously, so that they can't
+// block the caller, and are left out of the transaction. Nothing is activated: the
+// caller activates the topmost window on the thread that has the foreground rights
+class Win32MinimizeBackend : public CTPlacement::IMinimizeBackend
+{
+public:
+	bool QueryWindow(CTLayout::WindowId id, CTPlacement::WindowShowState& state) override;
+	std::size_t MinimizeWindows(const CTPlacement::MinimizeRecordVector& vRecords, bool bAnimate) override;
+	std::size_t RestoreWindows(const CTPlacement::MinimizeRecordVector& vRecords, bool bAnimate) override;
+
+	// Put the minimize/restore animation back if an earlier run ended while an
+	// AnimationSuppressor had it turned off. Called at start-up
+	static void RestoreAnimation();
+
+protected:
+	// Turns the minimize/restore animation off for the current session while it
+	// exists, unless bAnimate. The setting is not written to the user's profile, but
+	// it is session-wide, so the value to put back is kept in the registry until it
+	// has been put back (see RestoreAnimation)
+	class AnimationSuppressor
+	{
+	public:
+		explicit AnimationSuppressor(bool bAnimate);
+		virtual ~AnimationSuppressor();
+		AnimationSuppressor(const AnimationSuppressor&) = delete;
+		AnimationSuppressor(AnimationSuppressor&&) noexcept = delete;
+		AnimationSuppressor& operator=(const AnimationSuppressor&) = delete;
+		AnimationSuppressor& operator=(AnimationSuppressor&&) noexcept = delete;
+
+	protected:
+		ANIMATIONINFO m_ai = { sizeof(ANIMATIONINFO) };
+		bool m_bRestore = false;
+	};
+
+	// Screen rect of rcNormalPosition, which is in workspace coordinates
+	static RECT NormalRect2ScreenRect(const RECT& rNormal);
+
+	// Restore vRecords one window at a time, when the transaction can't be set up
+	static std::size_t RestoreEach(const CTPlacement::MinimizeRecordVector& vRecords);
+
+	constexpr static UINT SWP_RESTORE_FLAGS = SWP_NOACTIVATE | SWP_NOOWNERZORDER;
+};
+
+// Attribute source for the window filter pipeline. GetAttributes holds the
+// queries that used to run inline in ClassicTileWnd::s_EnumProc
+class Win32AttributeSource : public CTFilter::IAttributeSource
+{
+public:
+	CTFilter::WindowState GetState(CTFilter::WindowId id) override;
+	CTFilter::WindowAttributes GetAttributes(CTFilter::WindowId id) override;
+
+	static bool IsShellCloaked(HWND hwnd);
+
+	// Messages sent to other windows while filtering give up after this long,
+	// so that a window that stops responding can't block the caller
+	constexpr static UINT SEND_TIMEOUT_MS = 200;
+};
+
+// Read-only mapping of a file that another handle may still be writing to (the log
+// file), covering the size of the file at the time Open was called. Only one window
+// of the file is mapped at a time: View maps WINDOW_BYTES (or as much as asked for)
+// from the allocation granularity boundary at or before the requested offset
+class Win32MappedFile : public CTLogView::IDocumentSource
+{
+public:
+	Win32MappedFile() = default;
+	virtual ~Win32MappedFile() = default;
+	Win32MappedFile(const Win32MappedFile&) = delete;
+	Win32MappedFile(Win32MappedFile&&) noexcept = default;
+	Win32MappedFile& operator=(const Win32MappedFile&) = delete;
+	Win32MappedFile& operator=(Win32MappedFile&&) noexcept = default;
+
+	// (Re)open szPath. Throws a LoggingException on failure. An empty file is
+	// not an error, it results in Size() == 0
+	void Open(std::wstring_view szPath);
+	void Close();
+
+	// Pick up data appended to the open file without reopening it. The mapped
+	// window stays valid, so only what is read past it gets mapped. Returns false
+	// if the file shrank, in which case it has to be opened again
+	bool Refresh();
+
+	std::size_t Size() const override { return m_nSize; }
+
+	// Throws a LoggingException if the window can't be mapped
+	std::string_view View(std::size_t nOffset, std::size_t nMinSize) override;
+
+	constexpr static std::size_t WINDOW_BYTES = 64 * 1024 * 1024;
+
+protected:
+	SPHANDLE_EX m_hFile;
+	SPHANDLE_EX m_hMapping;
+	std::size_t m_nSize = 0;
+
+	// The mapped window [m_nViewOffset, m_nViewOffset + m_nViewSize)
+	SPMAPVIEW m_pView;
+	std::size_t m_nViewOffset = 0;
+	std::size_t m_nViewSize = 0;
+};
+
+// Named shared memory for CTCounters::PerfCounters, backed by the page file. The
+// region lives until the last process that opened it closes it
+class Win32SharedMemory : public CTCounters::ISharedMemory
+{
+public:
+	Win32SharedMemory() = default;
+	virtual ~Win32SharedMemory() = default;
+	Win32SharedMemory(const Win32SharedMemory&) = delete;
+	Win32SharedMemory(Win32SharedMemory&&) noexcept = delete;
+	Win32SharedMemory& operator=(const Win32SharedMemory&) = delete;
+	Win32SharedMemory& operator=(Win32SharedMemory&&) noexcept = delete;
+
+	// Don't throw: they can run while a LoggingException is being counted
+	void* Create(std::string_view szName, std::size_t nSize, bool& bExisted) override;
+	const void* Open(std::string_view szName, std::size_t nSize) override;
+
+	// CTCounters::PerfCounters::ProcessPredicate for Publish
+	static bool IsProcessRunning(std::uint32_t nProcessId);
+
+protected:
+	SPHANDLE_EX m_hMapping;
+	SPMAPVIEW m_pView;
+};
+
+// Tail source for the log viewer. Every Stat reopens the path, so that a rotated
+// file is seen as a different file (by its file index)
+class Win32TailSource : public CTLogView::ITailSource
+{
+public:
+	Win32TailSource() = default;
+	virtual ~Win32TailSource() = default;
+	Win32TailSource(const Win32TailSource&) = delete;
+	Win32TailSource(Win32TailSource&&) noexcept = delete;
+	Win32TailSource& operator=(const Win32TailSource&) = delete;
+	Win32TailSource& operator=(Win32TailSource&&) noexcept = delete;
+
+	void SetPath(std::wstring_view szPath);
+	void Close();
+
+	bool Stat(CTLogView::FileStat& stat) override;
+	std::size_t Read(std::uint64_t nOffset, char* pBuf, std::size_t nBytes) override;
+
+protected:
+	std::wstring m_szPath;
+	SPHANDLE_EX m_hFile;
+};
@@ -26,21 +26,27 @@
 #include "win_log.h"
 #include "WinUtils.h"
 
-void CTWinUtils::ShellHelper(LPSHELLFUNC lpShellFunc)
+bool CTWinUtils::ShellHelper(LPSHELLFUNC lpShellFunc)
 {
     _COM_SMARTPTR_TYPEDEF(IShellDispatch, IID_IShellDispatch);
+    bool fRetVal = false;
     try {
         if (lpShellFunc) {
+            const auto tpStart = std::chrono::steady_clock::now();
             CCoInitialize coInit;
             IShellDispatchPtr shell;
             eval_error_hr(shell.CreateInstance(CLSID_Shell, nullptr, CLSCTX_INPROC_SERVER));
             eval_error_hr((shell.GetInterfacePtr()->*lpShellFunc)());
+            const auto usElapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - tpStart).count();
+            log_debug("Shell call (with COM initialization and a new shell object) took <%lld> us.", static_cast<long long>(usElapsed));
+            fRetVal = true;
         }
     }catch (const LoggingException& le) {
         le.Log();
     }catch (...) {
         log_error("Unhandled exception");
     }
+    return fRetVal;
 }
 
 bool CTWinUtils::CheckMenuItem(HMENU hMenu, UINT uID, bool bChecked)
@@ -139,6 +145,41 @@ void CTWinUtils::Wstring2string(std::string& szString, const std::wstring& szWSt
     ::wcstombs_s(nullptr, szStringBuf, szStringBuf.size(), szWString.c_str(), szStringBuf.size() - 1);
 }
 
+void CTWinUtils::Ansi2wstring(std::wstring& szWString, std::string_view szAnsi)
+{
+    szWString.clear();
+    if (!szAnsi.empty()) {
+        int cchWString = eval_error_nz(::MultiByteToWideChar(CP_ACP, 0, szAnsi.data(), static_cast<int>(szAnsi.size()), nullptr, 0));
+        eval_error_nz(::MultiByteToWideChar(CP_ACP, 0, szAnsi.data(), static_cast<int>(szAnsi.size()), sz_wbuf(szWString, cchWString, false), cchWString));
+    }
+}
+
+bool CTWinUtils::Wstring2ansi(std::string& szAnsi, std::wstring_view szWString)
+{
+    szAnsi.clear();
+    BOOL bUsedDefaultChar = FALSE;
+    if (!szWString.empty()) {
+        int cbAnsi = eval_error_nz(::WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, szWString.data(), static_cast<int>(szWString.size()), nullptr, 0, nullptr, nullptr));
+        eval_error_nz(::WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, szWString.data(), static_cast<int>(szWString.size()), sz_buf(szAnsi, cbAnsi, false), cbAnsi, nullptr, &bUsedDefaultChar));
+    }
+    return !bUsedDefaultChar;
+}
+
+std::wstring CTWinUtils::FormatErrorMessage(DWORD dwError)
+{
+    wchar_t szMessage[512] = {};
+    DWORD cchMessage = ::FormatMessageW(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS, nullptr, dwError, 0, szMessage, _countof(szMessage), nullptr);
+
+    //The system messages end with a line break
+    while ((cchMessage > 0) && ((szMessage[cchMessage - 1] == L'\r') || (szMessage[cchMessage - 1] == L'\n') || (szMessage[cchMessage - 1] == L' '))) {
+        cchMessage--;
+    }
+    if (cchMessage == 0) {
+        return std::format(L"Error {}", dwError);
+    }
+    return std::wstring(szMessage, cchMessage);
+}
+
 void CTWinUtils::String2wstring(std::wstring& szWString, const std::string& szString)
 {
     szWString.clear();
@@ -313,3 +354,86 @@ void CTWinUtils::OpenTextFile(HWND hwnd, std::wstring_view szPath, std::wstring_
         log_error("Unhandled exception");
     }
 }
+
+CTLayout::LayoutRect CTWinUtils::Rect2LayoutRect(const RECT& r)
+{
+    return { r.left, r.top, r.right, r.bottom };
+}
+
+RECT CTWinUtils::LayoutRect2Rect(const CTLayout::LayoutRect& r)
+{
+    return { r.left, r.top, r.right, r.bottom };
+}
+
+void CTWinUtils::GetMonitors(CTLayout::MonitorDescVector& vMonitors)
+{
+    vMonitors.clear();
+
+    auto EnumMonitorProc = [](HMONITOR hMonitor, HDC, LPRECT, LPARAM lParam) -> BOOL {
+        CTLayout::MonitorDescVector& vMonitors = *reinterpret_cast<CTLayout::MonitorDescVector*>(lParam);
+
+        MONITORINFO mi = { 0 };
+        mi.cbSize = sizeof(mi);
+        if (::GetMonitorInfoW(hMonitor, &mi)) {
+            CTLayout::MonitorDesc monitor = { Rect2LayoutRect(mi.rcMonitor), Rect2LayoutRect(mi.rcWork) };
+
+            //The primary monitor goes first, so that it wins a tie in CTLayout::MonitorFromRect
+            if (mi.dwFlags & MONITORINFOF_PRIMARY) {
+                vMonitors.insert(vMonitors.begin(), monitor);
+            } else {
+                vMonitors.push_back(monitor);
+            }
+        }
+        return TRUE;
+    };
+
+    eval_error_nz(::EnumDisplayMonitors(nullptr, nullptr, EnumMonitorProc, reinterpret_cast<LPARAM>(&vMonitors)));
+}
+
+bool CTWinUtils::GetVisibleRect(HWND hwnd, RECT& r)
+{
+    return SUCCEEDED(::DwmGetWindowAttribute(hwnd, DWMWA_EXTENDED_FRAME_BOUNDS, &r, sizeof(r))) || ::GetWindowRect(hwnd, &r);
+}
+
+void CTWinUtils::VisibleRect2WindowRect(HWND hwnd, RECT& r)
+{
+    RECT rWindow = { 0 };
+    RECT rFrame = { 0 };
+
+    if (
+            ::GetWindowRect(hwnd, &rWindow)
+            &&
+            SUCCEEDED(::DwmGetWindowAttribute(hwnd, DWMWA_EXTENDED_FRAME_BOUNDS, &rFrame, sizeof(rFrame)))
+        )
+    {
+        r.left -= (rFrame.left - rWindow.left);
+        r.top -= (rFrame.top - rWindow.top);
+        r.right += (rWindow.right - rFrame.right);
+        r.bottom += (rWindow.bottom - rFrame.bottom);
+    }
+}
+
+long long CTWinUtils::GetProcessAgeUs()
+{
+    auto FileTimeUs = [](const FILETIME& ft) { return static_cast<long long>(((static_cast<ULONGLONG>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime) / 10); };
+
+    FILETIME ftCreation = { 0 }, ftExit = { 0 }, ftKernel = { 0 }, ftUser = { 0 }, ftNow = { 0 };
+    ::GetSystemTimePreciseAsFileTime(&ftNow);
+    if (!::GetProcessTimes(::GetCurrentProcess(), &ftCreation, &ftExit, &ftKernel, &ftUser)) {
+        return -1;
+    }
+    return FileTimeUs(ftNow) - FileTimeUs(ftCreation);
+}
+
+bool CTWinUtils::GetProcessFootprint(SIZE_T& nWorkingSet, SIZE_T& nPrivateBytes)
+{
+    PROCESS_MEMORY_COUNTERS_EX pmc = { 0 };
+    pmc.cb = sizeof(pmc);
+    if (!::GetProcessMemoryInfo(::GetCurrentProcess(), reinterpret_cast<PPROCESS_MEMORY_COUNTERS>(&pmc), sizeof(pmc))) {
+        nWorkingSet = nPrivateBytes = 0;
+        return false;
+    }
+    nWorkingSet = pmc.WorkingSetSize;
+    nPrivateBytes = pmc.PrivateUsage;
+    return true;
+}
@@ -5,14 +5,16 @@
  * This library is free software; you can redistribute it and/or modify it
  * under the terms of the MIT license. See `WinUtils.cpp` for details.
  */
+#include "TileLayout.h"
 
 // Library of helper utilities for calling various Windows functions
 namespace CTWinUtils
 {
 	// Create IShellDispatch instance and call any passed-in IShellDispatch member function 
-	// with no parameters
+	// with no parameters. ShellWorker does the same with a cached instance. Returns
+	// false if the call failed
 	using LPSHELLFUNC = HRESULT(STDMETHODCALLTYPE IShellDispatch::*)();
-	void ShellHelper(LPSHELLFUNC lpShellFunc);
+	bool ShellHelper(LPSHELLFUNC lpShellFunc);
 
 	//Windows menu object helpers
 	bool CheckMenuItem(HMENU hMenu, UINT uID, bool bChecked);
@@ -34,6 +36,13 @@ namespace CTWinUtils
 	// String conversion routines
 	void Wstring2string(std::string& szString, const std::wstring& szWString);
 	void String2wstring(std::wstring& szWString, const std::string& szString);
+	// Converts text in the ANSI code page (e.g. what the CRT writes to the log file)
+	void Ansi2wstring(std::wstring& szWString, std::string_view szAnsi);
+	// Returns false if some characters have no representation in the ANSI code page
+	bool Wstring2ansi(std::string& szAnsi, std::wstring_view szWString);
+
+	// System message for a Win32 error code, or the code itself if there is none
+	std::wstring FormatErrorMessage(DWORD dwError);
 	
 	// Wrapper for CreateProcess
 	bool CreateProcessHelper(std::wstring_view szCommand, std::wstring_view szArguments = L"", LPDWORD lpdwProcId = nullptr, const std::optional<int>& nShowWindow = {});
@@ -44,7 +53,29 @@ namespace CTWinUtils
 	// checks that file exists and is not a directory
 	bool FileExists(std::wstring_view szPath);
 
+	// Conversions between Win32 RECTs and the OS-independent CTLayout::LayoutRect
+	CTLayout::LayoutRect Rect2LayoutRect(const RECT& r);
+	RECT LayoutRect2Rect(const CTLayout::LayoutRect& r);
+
+	// Monitor and work area rectangles of all display monitors, primary monitor first
+	void GetMonitors(CTLayout::MonitorDescVector& vMonitors);
+
+	// Convert a rect describing the visible frame of hwnd into the rect to pass to SetWindowPos.
+	// Windows 10+ windows have invisible resize borders, which would otherwise leave gaps
+	// between tiled windows
+	void VisibleRect2WindowRect(HWND hwnd, RECT& r);
+
+	// The visible frame of hwnd (without the invisible resize borders), i.e. what 
+	// VisibleRect2WindowRect converts from. Falls back to the window rect
+	bool GetVisibleRect(HWND hwnd, RECT& r);
+
 	// Opens a text file using the default app based on app extension. If file type does not 
 	// have a default, fallback to use notepad.exe
 	void OpenTextFile(HWND hwnd, std::wstring_view szPath, std::wstring_view szAppName);
+
+	// Microseconds since the current process was created, or -1
+	long long GetProcessAgeUs();
+
+	// Working set and private (commit) bytes of the current process
+	bool GetProcessFootprint(SIZE_T& nWorkingSet, SIZE_T& nPrivateBytes);
 }
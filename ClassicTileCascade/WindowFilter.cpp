@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <thread>
+#include "WindowFilter.h"
+
+CTFilter::AttributeCache::AttributeCache(Clock::duration maxAge)
+    : m_maxAge(maxAge) {}
+
+CTFilter::WindowAttributes CTFilter::AttributeCache::Get(IAttributeSource& source, WindowId id)
+{
+    const Clock::time_point tpNow = Clock::now();
+    std::uint64_t nEpoch = 0;
+    {
+        std::scoped_lock lock(m_mutex);
+        auto it = m_entries.find(id);
+        if ((it != m_entries.end()) && ((tpNow - it->second.tpFetched) < m_maxAge)) {
+            m_nHits++;
+            return it->second.attributes;
+        }
+        nEpoch = m_nEpoch;
+    }
+
+    //Fetch outside of the lock: the queries can take a while and other
+    //threads should be able to use the cache in the meantime
+    m_nMisses++;
+    WindowAttributes attributes = source.GetAttributes(id);
+    if (attributes.bNotResponding) {
+        //Query the window again next time, it may have recovered by then
+        return attributes;
+    }
+
+    //The caller still gets what was fetched, the window it invalidated is classified again
+    std::scoped_lock lock(m_mutex);
+    if (nEpoch == m_nEpoch) {
+        m_entries[id] = { attributes, tpNow };
+    }
+    return attributes;
+}
+
+void CTFilter::AttributeCache::Invalidate(WindowId id)
+{
+    std::scoped_lock lock(m_mutex);
+    m_nEpoch++;
+    m_entries.erase(id);
+}
+
+void CTFilter::AttributeCache::Clear()
+{
+    std::scoped_lock lock(m_mutex);
+    m_nEpoch++;
+    m_entries.clear();
+}
+
+CTFilter::FilterPipeline::FilterPipeline(IAttributeSource& source, AttributeCache* pCache)
+    : m_source(source), m_pCache(pCache) {}
+
+void CTFilter::FilterPipeline::AddStateStage(std::string_view szName, StatePredicate predicate, bool bReport)
+{
+    m_vStateStages.push_back({ std::string(szName), std::move(predicate), bReport });
+}
+
+void CTFilter::FilterPipeline::AddAttributeStage(std::string_view szName, AttributePredicate predicate, bool bReport)
+{
+    m_vAttributeStages.push_back({ std::string(szName), std::move(predicate), bReport });
+}
+
+void CTFilter::FilterPipeline::AddTileableStages()
+{
+    AddStateStage("visible", [](const WindowState& state) { return state.bVisible; });
+    AddStateStage("not minimized", [](const WindowState& state) { return !state.bIconic; });
+
+    //A hung window would block the queries below and the move itself
+    AddStateStage("not hung", [](const WindowState& state) { return !state.bHung; }, true);
+    AddAttributeStage("responding", [](const WindowAttributes& attr) { return !attr.bNotResponding; }, true);
+
+    //See: https://devblogs.microsoft.com/oldnewthing/20071008-00/?p=24863
+    //Which windows appear in the Alt+Tab list?
+    AddAttributeStage("alt-tab owner", [](const WindowAttributes& attr) { return attr.bOwnerWalkIsSelf; });
+    AddAttributeStage("not desktop", [](const WindowAttributes& attr) { return !attr.bShellWindow; });
+    AddAttributeStage("enabled", [](const WindowAttributes& attr) { return !attr.bDisabled; });
+    AddAttributeStage("not tool window", [](const WindowAttributes& attr) { return !attr.bToolWindow; });
+    AddAttributeStage("not shell cloaked", [](const WindowAttributes& attr) { return !attr.bShellCloaked; });
+    AddAttributeStage("has title", [](const WindowAttributes& attr) { return attr.bHasTitle; });
+    AddAttributeStage("title bar visible", [](const WindowAttributes& attr) { return !attr.bTitleBarInvisible; });
+}
+
+bool CTFilter::FilterPipeline::Evaluate(WindowId id, bool bState, std::string_view* pszReported)
+{
+    //Stop at the first stage that rejects the window
+    auto Run = [pszReported](const auto& vStages, const auto& value) {
+        for (const auto& stage : vStages) {
+            if (!stage.predicate(value)) {
+                if (pszReported && stage.bReport) {
+                    *pszReported = stage.szName;
+                }
+                return false;
+            }
+        }
+        return true;
+    };
+
+    if (bState && !m_vStateStages.empty()) {
+        if (!Run(m_vStateStages, m_source.GetState(id))) {
+            return false;
+        }
+    }
+
+    if (m_vAttributeStages.empty()) {
+        return true;
+    }
+
+    return Run(m_vAttributeStages, m_pCache ? m_pCache->Get(m_source, id) : m_source.GetAttributes(id));
+}
+
+bool CTFilter::FilterPipeline::IsTileable(WindowId id)
+{
+    return Evaluate(id, true, nullptr);
+}
+
+bool CTFilter::FilterPipeline::IsEligible(WindowId id)
+{
+    return Evaluate(id, false, nullptr);
+}
+
+void CTFilter::FilterPipeline::Filter(const WindowIdVector& vIn, WindowIdVector& vOut, std::size_t nParallelThreshold, RejectionVector* pvReported)
+{
+    vOut.clear();
+
+    //One flag (and reported stage) per input window so that the workers never 
+    //share an output slot and the original (z-)order is preserved
+    std::vector<char> vPass(vIn.size(), 0);
+    std::vector<std::string_view> vReported(pvReported ? vIn.size() : 0);
+
+    const std::size_t nHardware = std::max<std::size_t>(std::thread::hardware_concurrency(), 1);
+    const std::size_t nWorkers = (vIn.size() >= nParallelThreshold) ? std::min(nHardware, vIn.size()) : 1;
+
+    auto EvaluateRange = [this, &vIn, &vPass, &vReported, pvReported](std::size_t nBegin, std::size_t nEnd) {
+        for (std::size_t i = nBegin; i < nEnd; i++) {
+            vPass[i] = Evaluate(vIn[i], true, pvReported ? &vReported[i] : nullptr) ? 1 : 0;
+        }
+    };
+
+    if (nWorkers <= 1) {
+        EvaluateRange(0, vIn.size());
+    } else {
+        std::vector<std::jthread> vThreads;
+        vThreads.reserve(nWorkers - 1);
+
+        const std::size_t nChunk = (vIn.size() + nWorkers - 1) / nWorkers;
+        for (std::size_t nBegin = nChunk; nBegin < vIn.size(); nBegin += nChunk) {
+            vThreads.emplace_back(EvaluateRange, nBegin, std::min(nBegin + nChunk, vIn.size()));
+        }
+
+        //The calling thread takes the first chunk
+        EvaluateRange(0, std::min(nChunk, vIn.size()));
+    }
+
+    vOut.reserve(vIn.size());
+    for (std::size_t i = 0; i < vIn.size(); i++) {
+        if (vPass[i]) {
+            vOut.push_back(vIn[i]);
+        } else if (pvReported && !vReported[i].empty()) {
+            pvReported->push_back({ vIn[i], vReported[i] });
+        }
+    }
+}
@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `WindowFilter.cpp` for details.
+ */
+#pragma once
+
+// Filter pipeline that decides which windows take part in a tile/cascade action.
+// The test is split into stages. Stages that only need the cheap, constantly changing
+// state of a window (visible, minimized) run first. Stages that need attributes which
+// are expensive to query (cloak state, owner-chain walk, title bar, styles, title) run
+// only when those pass, and the attributes are fetched once per window and kept in an
+// AttributeCache until they are invalidated or expire. Large window lists can be
+// evaluated across a pool of worker threads.
+//
+// The pipeline is OS-independent: the window queries live behind IAttributeSource.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace CTFilter
+{
+	using WindowId = std::uintptr_t;
+	using WindowIdVector = std::vector<WindowId>;
+
+	// State that changes constantly and is cheap to query. Never cached
+	struct WindowState
+	{
+		bool bVisible = false;
+		bool bIconic = false;
+		bool bHung = false;				// the window's thread hasn't been processing messages for a while
+	};
+
+	// Attributes that need one or more cross-process or DWM queries. Cached
+	struct WindowAttributes
+	{
+		bool bShellCloaked = false;		// cloaked by the shell, e.g. on another virtual desktop
+		bool bOwnerWalkIsSelf = false;	// the Alt-Tab owner/popup walk ends at this window
+		bool bShellWindow = false;		// the desktop window
+		bool bDisabled = false;
+		bool bToolWindow = false;
+		bool bHasTitle = false;
+		bool bTitleBarInvisible = false;
+
+		// A query sent to the window timed out, so the other attributes are incomplete. 
+		// Such attributes are not cached
+		bool bNotResponding = false;
+	};
+
+	// Source of window state/attributes. Must be safe to call from several threads
+	class IAttributeSource
+	{
+	public:
+		virtual ~IAttributeSource() = default;
+		virtual WindowState GetState(WindowId id) = 0;
+		virtual WindowAttributes GetAttributes(WindowId id) = 0;
+	};
+
+	// Thread-safe cache of WindowAttributes. Entries are dropped by Invalidate (called when
+	// a window event says the attributes may have changed) or once they are older than the
+	// maximum age, so that callers without an event source never see stale data for long
+	class AttributeCache
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		explicit AttributeCache(Clock::duration maxAge = std::chrono::seconds(2));
+		virtual ~AttributeCache() = default;
+		AttributeCache(const AttributeCache&) = delete;
+		AttributeCache(AttributeCache&&) noexcept = delete;
+		AttributeCache& operator=(const AttributeCache&) = delete;
+		AttributeCache& operator=(AttributeCache&&) noexcept = delete;
+
+		WindowAttributes Get(IAttributeSource& source, WindowId id);
+		void Invalidate(WindowId id);
+		void Clear();
+
+		std::size_t GetHits() const { return m_nHits; }
+		std::size_t GetMisses() const { return m_nMisses; }
+
+	protected:
+		struct Entry
+		{
+			WindowAttributes attributes;
+			Clock::time_point tpFetched;
+		};
+
+		std::mutex m_mutex;
+		std::unordered_map<WindowId, Entry> m_entries;
+		Clock::duration m_maxAge;
+
+		// Bumped by Invalidate and Clear. A fetch that was overtaken by one isn't stored,
+		// since it may have read the window before the change that invalidated it
+		std::uint64_t m_nEpoch = 0;
+
+		std::atomic<std::size_t> m_nHits = 0;
+		std::atomic<std::size_t> m_nMisses = 0;
+	};
+
+	class FilterPipeline
+	{
+	public:
+		using StatePredicate = std::function<bool(const WindowState&)>;
+		using AttributePredicate = std::function<bool(const WindowAttributes&)>;
+
+		// A window rejected by a stage added with bReport set, see Filter
+		struct Rejection
+		{
+			WindowId id = 0;
+			std::string_view szStage;
+		};
+		using RejectionVector = std::vector<Rejection>;
+
+		// pCache may be null, in which case attributes are fetched on every evaluation
+		FilterPipeline(IAttributeSource& source, AttributeCache* pCache = nullptr);
+		virtual ~FilterPipeline() = default;
+		FilterPipeline(const FilterPipeline&) = delete;
+		FilterPipeline(FilterPipeline&&) noexcept = delete;
+		FilterPipeline& operator=(const FilterPipeline&) = delete;
+		FilterPipeline& operator=(FilterPipeline&&) noexcept = delete;
+
+		// Windows rejected by a stage added with bReport set are reported by Filter
+		void AddStateStage(std::string_view szName, StatePredicate predicate, bool bReport = false);
+		void AddAttributeStage(std::string_view szName, AttributePredicate predicate, bool bReport = false);
+
+		// Add the stages that select the windows shown in Alt-Tab and in the Task Manager
+		// "Apps" list that are visible and not minimized
+		void AddTileableStages();
+
+		// Run every stage against one window
+		bool IsTileable(WindowId id);
+
+		// Run only the attribute stages, i.e. the part of the test that does not depend
+		// on whether the window is currently shown
+		bool IsEligible(WindowId id);
+
+		// Filter vIn into vOut, preserving the order. When vIn holds at least
+		// nParallelThreshold windows the work is split across worker threads.
+		// If pvReported isn't null, it receives the windows rejected by a reported stage
+		void Filter(const WindowIdVector& vIn, WindowIdVector& vOut, std::size_t nParallelThreshold = std::numeric_limits<std::size_t>::max(), RejectionVector* pvReported = nullptr);
+
+		// Default value for nParallelThreshold
+		constexpr static std::size_t PARALLEL_THRESHOLD = 64;
+
+	protected:
+		template<class Predicate>
+		struct Stage
+		{
+			std::string szName;
+			Predicate predicate;
+			bool bReport = false;
+		};
+
+		// Run the (state and) attribute stages. If a reported stage rejects 
+		// the window and pszReported isn't null, it receives the stage name
+		bool Evaluate(WindowId id, bool bState, std::string_view* pszReported);
+
+		IAttributeSource& m_source;
+		AttributeCache* m_pCache;
+
+		std::vector<Stage<StatePredicate>> m_vStateStages;
+		std::vector<Stage<AttributePredicate>> m_vAttributeStages;
+	};
+}
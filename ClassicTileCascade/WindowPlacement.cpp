@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <exception>
+#include <future>
+#include <unordered_map>
+#include "WindowPlacement.h"
+
+CTPlacement::PlacementResult CTPlacement::ApplyPlacements(IPlacementBackend& backend, const CTLayout::PlacementVector& vPlacements)
+{
+    PlacementResult result;
+    if (vPlacements.empty()) {
+        return result;
+    }
+
+    bool bBatchOK = backend.BeginBatch(vPlacements.size());
+    if (bBatchOK) {
+        for (const CTLayout::Placement& placement : vPlacements) {
+            if (!backend.AddToBatch(placement)) {
+                bBatchOK = false;
+                break;
+            }
+        }
+
+        if (bBatchOK) {
+            bBatchOK = backend.EndBatch();
+        } else {
+            backend.AbortBatch();
+        }
+    }
+
+    if (bBatchOK) {
+        result.bBatched = true;
+    } else {
+        //Either the transaction could not be built or it could not be committed. A failed
+        //commit may have moved some of the windows already, but moving a window to the
+        //rect it already has is harmless, so move every window individually
+        for (const CTLayout::Placement& placement : vPlacements) {
+            result.nMovedIndividually++;
+            if (!backend.MoveOne(placement)) {
+                result.nFailed++;
+            }
+        }
+    }
+
+    return result;
+}
+
+std::size_t CTPlacement::SkipUnchanged(const CTLayout::WindowDescVector& vWindows, CTLayout::PlacementVector& vPlacements)
+{
+    std::unordered_map<CTLayout::WindowId, const CTLayout::WindowDesc*> mapWindows;
+    mapWindows.reserve(vWindows.size());
+    for (const CTLayout::WindowDesc& window : vWindows) {
+        mapWindows.emplace(window.id, &window);
+    }
+
+    std::size_t nBefore = vPlacements.size();
+    std::erase_if(vPlacements, [&mapWindows](const CTLayout::Placement& placement) {
+        auto it = mapWindows.find(placement.id);
+        return (it != mapWindows.end()) && !it->second->bMaximized && (it->second->rect == placement.rect);
+    });
+    return nBefore - vPlacements.size();
+}
+
+CTPlacement::PlacementResult CTPlacement::ApplyPlacementsParallel(const BackendFactory& createBackend, const std::vector<CTLayout::PlacementVector>& vBatches)
+{
+    std::vector<const CTLayout::PlacementVector*> vWork;
+    for (const CTLayout::PlacementVector& vPlacements : vBatches) {
+        if (!vPlacements.empty()) {
+            vWork.push_back(&vPlacements);
+        }
+    }
+
+    //One result per batch so that the threads never share one
+    std::vector<PlacementResult> vResults(vWork.size());
+    auto Apply = [&createBackend, &vWork, &vResults](std::size_t i) {
+        std::unique_ptr<IPlacementBackend> spBackend = createBackend();
+        vResults[i] = ApplyPlacements(*spBackend, *vWork[i]);
+    };
+
+    //The other batches run through std::async, so that an exception on their
+    //thread reaches the caller instead of terminating the process. A single
+    //batch (one monitor) needs no thread at all
+    std::vector<std::future<void>> vFutures;
+    std::exception_ptr spError;
+    try {
+        vFutures.reserve(vWork.size());
+        for (std::size_t i = 1; i < vWork.size(); i++) {
+            vFutures.push_back(std::async(std::launch::async, Apply, i));
+        }
+
+        if (!vWork.empty()) {
+            Apply(0);
+        }
+    } catch (...) {
+        spError = std::current_exception();
+    }
+
+    //Wait for every batch before reporting the first error: the others still use vResults
+    for (std::future<void>& future : vFutures) {
+        try {
+            future.get();
+        } catch (...) {
+            if (!spError) {
+                spError = std::current_exception();
+            }
+        }
+    }
+    if (spError) {
+        std::rethrow_exception(spError);
+    }
+
+    PlacementResult result;
+    result.bBatched = !vWork.empty();
+    for (const PlacementResult& batchResult : vResults) {
+        result.bBatched = result.bBatched && batchResult.bBatched;
+        result.nMovedIndividually += batchResult.nMovedIndividually;
+        result.nFailed += batchResult.nFailed;
+    }
+    return result;
+}
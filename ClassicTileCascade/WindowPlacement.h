@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `WindowPlacement.cpp` for details.
+ */
+#pragma once
+
+// Placement stage that runs after the CTLayout engine. Commits all of the calculated
+// moves as a single transaction (the BeginDeferWindowPos/DeferWindowPos/EndDeferWindowPos
+// pattern) so that the desktop repaints once per action instead of once per window.
+// If the transaction cannot be built or committed, falls back to moving the windows
+// one at a time. The actual window manager calls live behind IPlacementBackend so that
+// the batching and fallback logic has no dependency on Windows headers.
+// Independent sets of moves (one per monitor) can be committed concurrently, each as
+// its own transaction on its own thread.
+#include <functional>
+#include <memory>
+#include "TileLayout.h"
+
+namespace CTPlacement
+{
+	class IPlacementBackend
+	{
+	public:
+		virtual ~IPlacementBackend() = default;
+
+		// Start a transaction that will hold nCount moves
+		virtual bool BeginBatch(std::size_t nCount) = 0;
+
+		// Add one move to the transaction started by BeginBatch
+		virtual bool AddToBatch(const CTLayout::Placement& placement) = 0;
+
+		// Commit all moves added since BeginBatch in one operation
+		virtual bool EndBatch() = 0;
+
+		// End the transaction after AddToBatch failed, without changing any window's show
+		// state (e.g. restoring a maximized window). Every window is moved one by one
+		// afterwards, so a backend that can't discard a transaction may commit the moves
+		// added so far instead
+		virtual void AbortBatch() = 0;
+
+		// Move a single window immediately. Used by the fallback path
+		virtual bool MoveOne(const CTLayout::Placement& placement) = 0;
+	};
+
+	struct PlacementResult
+	{
+		// True if the moves were committed as one transaction
+		bool bBatched = false;
+
+		// Number of windows moved by the fallback path, and number of those moves that failed
+		std::size_t nMovedIndividually = 0;
+		std::size_t nFailed = 0;
+	};
+
+	// Apply vPlacements through backend. Tries a single transaction first; on any failure
+	// in building or committing the transaction, moves the windows one by one
+	PlacementResult ApplyPlacements(IPlacementBackend& backend, const CTLayout::PlacementVector& vPlacements);
+
+	// Remove the placements whose target is where the window (looked up in vWindows by id)
+	// already is, so that re-applying a layout doesn't move and repaint those windows again.
+	// Returns the number of placements removed
+	std::size_t SkipUnchanged(const CTLayout::WindowDescVector& vWindows, CTLayout::PlacementVector& vPlacements);
+
+	// Creates the backend for one thread of ApplyPlacementsParallel
+	using BackendFactory = std::function<std::unique_ptr<IPlacementBackend>()>;
+
+	// Apply every non-empty entry of vBatches with ApplyPlacements, each with a backend of its own
+	// (created on the thread that uses it) and on a thread of its own. The calling thread applies
+	// the first batch. bBatched in the result is true if every batch was committed as one transaction.
+	// An exception thrown for any batch is rethrown once all batches are done
+	PlacementResult ApplyPlacementsParallel(const BackendFactory& createBackend, const std::vector<CTLayout::PlacementVector>& vBatches);
+}
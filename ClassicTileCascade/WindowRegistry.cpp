@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// This file does not use the precompiled header so that it stays free of
+// Windows dependencies
+#include <algorithm>
+#include <utility>
+#include "WindowRegistry.h"
+
+WindowRegistry::WindowRegistry(Classifier classifier)
+    : m_classifier(std::move(classifier)) {}
+
+void WindowRegistry::SetClassifier(Classifier classifier)
+{
+    m_classifier = std::move(classifier);
+}
+
+void WindowRegistry::Clear()
+{
+    m_windows.clear();
+    m_vPending.clear();
+    m_vTileable.clear();
+    m_bDirty = true;
+    m_bSeeded = false;
+    m_nNextSeedZ = Z_ORDER_BASE;
+    m_nNextTopZ = Z_ORDER_BASE + 1;
+}
+
+bool WindowRegistry::Classify(WindowId id) const
+{
+    return m_classifier ? m_classifier(id) : true;
+}
+
+void WindowRegistry::MarkPending(WindowId id, Entry& entry)
+{
+    entry.nGeneration = m_nNextGeneration++;
+    if (!entry.bPending) {
+        entry.bPending = true;
+        m_vPending.push_back(id);
+    }
+}
+
+void WindowRegistry::Seed(WindowId id, const WindowFlags& flags)
+{
+    Entry entry;
+    entry.bVisible = flags.bVisible;
+    entry.bIconic = flags.bIconic;
+    entry.bCloaked = flags.bCloaked;
+    entry.nZOrder = m_nNextSeedZ--;
+    MarkPending(id, m_windows.insert_or_assign(id, entry).first->second);
+
+    m_bSeeded = true;
+    m_bDirty = true;
+}
+
+void WindowRegistry::SetFlag(WindowId id, bool Entry::* pFlag, bool bValue)
+{
+    auto it = m_windows.find(id);
+    if (it != m_windows.end()) {
+        bool bWasTileable = it->second.IsTileable();
+        it->second.*pFlag = bValue;
+        if (bWasTileable != it->second.IsTileable()) {
+            m_bDirty = true;
+        }
+    }
+}
+
+void WindowRegistry::Reclassify(WindowId id)
+{
+    auto it = m_windows.find(id);
+    if (it != m_windows.end()) {
+        MarkPending(id, it->second);
+    }
+}
+
+void WindowRegistry::TakePending(PendingVector& vPending)
+{
+    for (WindowId id : m_vPending) {
+        auto it = m_windows.find(id);
+        if ((it != m_windows.end()) && it->second.bPending) {
+            it->second.bPending = false;
+            vPending.push_back({ id, it->second.nGeneration });
+        }
+    }
+    m_vPending.clear();
+}
+
+bool WindowRegistry::SetClassification(const PendingWindow& pending, bool bAltTab)
+{
+    auto it = m_windows.find(pending.id);
+    if ((it == m_windows.end()) || (it->second.nGeneration != pending.nGeneration)) {
+        return false;
+    }
+
+    SetFlag(pending.id, &Entry::bAltTab, bAltTab);
+    return true;
+}
+
+void WindowRegistry::ClassifyPending()
+{
+    //The classifier may send messages to the window and so run other events (e.g. the
+    //window's Destroy) first, which SetClassification copes with
+    PendingVector vPending;
+    TakePending(vPending);
+    for (const PendingWindow& pending : vPending) {
+        SetClassification(pending, Classify(pending.id));
+    }
+}
+
+void WindowRegistry::OnEvent(Event event, WindowId id)
+{
+    switch (event) {
+    case Event::Create:
+        {
+            //New windows are created hidden; a Show event follows if they become visible.
+            //They go on top of the z-order
+            Entry entry;
+            entry.nZOrder = m_nNextTopZ++;
+            MarkPending(id, m_windows.insert_or_assign(id, entry).first->second);
+            m_bDirty = true;
+        }
+        break;
+
+    case Event::Destroy:
+        {
+            auto it = m_windows.find(id);
+            if (it != m_windows.end()) {
+                if (it->second.IsTileable()) {
+                    m_bDirty = true;
+                }
+                m_windows.erase(it);
+            }
+        }
+        break;
+
+    case Event::Show:
+        //Windows created before the registry was seeded, or whose create event
+        //was missed, are picked up when they are shown
+        if (m_windows.find(id) == m_windows.end()) {
+            OnEvent(Event::Create, id);
+        } else {
+            Reclassify(id);
+        }
+        SetFlag(id, &Entry::bVisible, true);
+        break;
+
+    case Event::Hide:
+        SetFlag(id, &Entry::bVisible, false);
+        break;
+
+    case Event::MinimizeStart:
+        SetFlag(id, &Entry::bIconic, true);
+        break;
+
+    case Event::MinimizeEnd:
+        SetFlag(id, &Entry::bIconic, false);
+        break;
+
+    case Event::Cloak:
+        SetFlag(id, &Entry::bCloaked, true);
+        Reclassify(id);
+        break;
+
+    case Event::Uncloak:
+        SetFlag(id, &Entry::bCloaked, false);
+        Reclassify(id);
+        break;
+
+    case Event::Foreground:
+        {
+            auto it = m_windows.find(id);
+            if (it != m_windows.end()) {
+                it->second.nZOrder = m_nNextTopZ++;
+                if (it->second.IsTileable()) {
+                    m_bDirty = true;
+                }
+
+                //A window that was not eligible (e.g. it did not respond when it was 
+                //classified) gets another chance when it is brought to the foreground
+                if (!it->second.bAltTab) {
+                    MarkPending(id, it->second);
+                }
+            }
+        }
+        break;
+
+    case Event::NameChange:
+        //Windows without a title are not tileable, so a rename may change eligibility
+        Reclassify(id);
+        break;
+    }
+}
+
+const WindowRegistry::WindowIdVector& WindowRegistry::GetTileable()
+{
+    if (m_bDirty) {
+        std::vector<std::pair<std::uint64_t, WindowId>> vSorted;
+        vSorted.reserve(m_windows.size());
+        for (const auto& [id, entry] : m_windows) {
+            if (entry.IsTileable()) {
+                vSorted.emplace_back(entry.nZOrder, id);
+            }
+        }
+
+        std::ranges::sort(vSorted, std::greater<>());
+
+        m_vTileable.clear();
+        m_vTileable.reserve(vSorted.size());
+        for (const auto& [nZOrder, id] : vSorted) {
+            m_vTileable.push_back(id);
+        }
+        m_bDirty = false;
+    }
+    return m_vTileable;
+}
@@ -0,0 +1,151 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `WindowRegistry.cpp` for details.
+ */
+#pragma once
+
+// Long-lived registry of the top-level windows on the desktop. Rather than enumerating
+// and querying every window on each tile/cascade action, the registry is seeded once and
+// then kept current from window events (create/destroy/show/hide/minimize/cloak/foreground).
+// At action time the list of tileable windows is returned from a cache.
+//
+// The registry is OS-independent. Whether a window can ever be tiled (i.e. whether it is an
+// Alt-Tab window) is decided by a caller-supplied classifier. Classifying a window can take
+// long (on Windows it sends the window messages), so events and seeding never run it: a window
+// that is created, shown, renamed or (un)cloaked is only marked as pending. The pending windows
+// are classified later, inline by ClassifyPending or, without holding the registry's lock while
+// the classifier runs, with TakePending and SetClassification (see RegistryClassifier). A window
+// keeps its last classification until the new one is set; new windows are not tileable until
+// they are classified. The dynamic state (visible, minimized, cloaked) and the z-order are
+// derived from the events themselves.
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class WindowRegistry
+{
+public:
+	using WindowId = std::uintptr_t;
+	using WindowIdVector = std::vector<WindowId>;
+	using Classifier = std::function<bool(WindowId)>;
+
+	enum class Event
+	{
+		Create,
+		Destroy,
+		Show,
+		Hide,
+		MinimizeStart,
+		MinimizeEnd,
+		Cloak,
+		Uncloak,
+		Foreground,
+		NameChange
+	};
+
+	// A window to classify, and the generation its classification has to match
+	struct PendingWindow
+	{
+		WindowId id = 0;
+		std::uint64_t nGeneration = 0;
+	};
+	using PendingVector = std::vector<PendingWindow>;
+
+	// State of a window when the registry is seeded
+	struct WindowFlags
+	{
+		bool bVisible = false;
+		bool bIconic = false;
+		bool bCloaked = false;
+	};
+
+	explicit WindowRegistry(Classifier classifier = {});
+	virtual ~WindowRegistry() = default;
+	WindowRegistry(const WindowRegistry&) = delete;
+	WindowRegistry(WindowRegistry&&) noexcept = default;
+	WindowRegistry& operator=(const WindowRegistry&) = delete;
+	WindowRegistry& operator=(WindowRegistry&&) noexcept = default;
+
+	void SetClassifier(Classifier classifier);
+
+	// Drop all windows. Seed must be called again before the registry is used
+	void Clear();
+
+	// Add a window found while enumerating the desktop. Windows must be seeded
+	// in z-order, topmost first (the order EnumWindows returns them)
+	void Seed(WindowId id, const WindowFlags& flags);
+
+	// Apply one window event to the registry
+	void OnEvent(Event event, WindowId id);
+
+	// Mark a window already in the registry for classification (e.g. the owner of a window
+	// whose owned popup was just shown or hidden). Does nothing for unknown windows
+	void Reclassify(WindowId id);
+
+	bool HasPending() const { return !m_vPending.empty(); }
+
+	// Move the windows marked for classification to the end of vPending and unmark them
+	void TakePending(PendingVector& vPending);
+
+	// Set the classification of a window taken with TakePending. Ignored (returns false) if
+	// the window was destroyed or marked again since, i.e. if the result may be stale
+	bool SetClassification(const PendingWindow& pending, bool bAltTab);
+
+	// Run the classifier for every pending window, on the calling thread
+	void ClassifyPending();
+
+	// Tileable windows in z-order, topmost first. The vector is cached and
+	// only rebuilt after an event that changed the result
+	const WindowIdVector& GetTileable();
+
+	bool IsSeeded() const { return m_bSeeded; }
+	std::size_t Size() const { return m_windows.size(); }
+
+protected:
+	struct Entry
+	{
+		bool bAltTab = false;
+		bool bVisible = false;
+		bool bIconic = false;
+		bool bCloaked = false;
+
+		// Higher values are closer to the top of the z-order
+		std::uint64_t nZOrder = 0;
+
+		// Changes every time the window is marked for classification
+		std::uint64_t nGeneration = 0;
+		bool bPending = false;
+
+		bool IsTileable() const { return bAltTab && bVisible && !bIconic && !bCloaked; }
+	};
+
+	bool Classify(WindowId id) const;
+
+	// Mark the window with entry for classification
+	void MarkPending(WindowId id, Entry& entry);
+
+	// Set one of the flags of an existing window and mark the cache dirty if the window's
+	// tileable state changed. Does nothing for unknown windows
+	void SetFlag(WindowId id, bool Entry::* pFlag, bool bValue);
+
+	std::unordered_map<WindowId, Entry> m_windows;
+	Classifier m_classifier;
+
+	// Windows marked for classification, in the order they were marked. May contain
+	// windows destroyed since
+	WindowIdVector m_vPending;
+	std::uint64_t m_nNextGeneration = 1;
+
+	WindowIdVector m_vTileable;
+	bool m_bDirty = true;
+	bool m_bSeeded = false;
+
+	// Seeded windows count down from the top of this range, windows brought to the
+	// foreground count up from it, so every foreground window ends up on top
+	constexpr static std::uint64_t Z_ORDER_BASE = 1ull << 32;
+	std::uint64_t m_nNextSeedZ = Z_ORDER_BASE;
+	std::uint64_t m_nNextTopZ = Z_ORDER_BASE + 1;
+};
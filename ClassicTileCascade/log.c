@@ -20,7 +20,17 @@
  * IN THE SOFTWARE.
  */
 
+#if !defined(_WIN32) && !defined(_GNU_SOURCE)
+// For the writer-preferring read/write lock initializer of glibc
+#define _GNU_SOURCE
+#endif
+
 #include "log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <wchar.h>
 
 #define MAX_CALLBACKS 32
 
@@ -39,6 +49,14 @@ static struct {
 } L;
 
 
+//Added by thf
+static log_BytesFn bytes_fn;
+
+static void count_bytes(long long bytes) {
+  if (bytes_fn && bytes > 0) { bytes_fn((size_t)bytes); }
+}
+
+
 static const char *level_strings[] = {
   "TRACE", "DEBUG", "INFO", "WARN", "ERROR", "FATAL"
 };
@@ -72,12 +90,13 @@ static void stdout_callback(log_Event *ev) {
 static void file_callback(log_Event *ev) {
   char buf[64];
   buf[strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", ev->time)] = '\0';
-  fprintf(
+  long long bytes = fprintf(
     ev->udata, "%s %-5s %s:%d: ",
     buf, level_strings[ev->level], ev->file, ev->line);
-  vfprintf(ev->udata, ev->fmt, ev->ap);
-  fprintf(ev->udata, "\n");
+  bytes += vfprintf(ev->udata, ev->fmt, ev->ap);
+  bytes += fprintf(ev->udata, "\n");
   fflush(ev->udata);
+  count_bytes(bytes);
 }
 
 
@@ -91,6 +110,896 @@ static void unlock(void) {
 }
 
 
+//Added by thf
+// Asynchronous mode. Callers format their message into a slot of a bounded
+// multi-producer/single-consumer ring (a sequence number per slot, after
+// D. Vyukov's bounded queue) and return without touching the file. A writer
+// thread drains the ring to the file callbacks, converts the time stamp only
+// when the second changes and flushes once per batch instead of per message.
+// Custom callbacks and the stderr output still run on the caller's thread.
+#ifdef _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <process.h>
+
+typedef volatile LONG64 log_atomic;
+
+#define async_load(p)           ReadAcquire64(p)
+#define async_store(p, v)       WriteRelease64((p), (v))
+#define async_cas(p, oldv, newv) (InterlockedCompareExchange64((p), (newv), (oldv)) == (oldv))
+#define async_xchg(p, v)        InterlockedExchange64((p), (v))
+#define async_inc(p)            InterlockedIncrement64(p)
+#define async_yield()           SwitchToThread()
+#define async_sleep_ms(ms)      Sleep(ms)
+
+static SRWLOCK cb_mutex = SRWLOCK_INIT;
+static SRWLOCK bin_mutex = SRWLOCK_INIT;
+static HANDLE async_thread;
+static HANDLE async_event;
+
+static void cb_lock(void)   { AcquireSRWLockExclusive(&cb_mutex); }
+static void cb_unlock(void) { ReleaseSRWLockExclusive(&cb_mutex); }
+static void cb_lock_shared(void)   { AcquireSRWLockShared(&cb_mutex); }
+static void cb_unlock_shared(void) { ReleaseSRWLockShared(&cb_mutex); }
+static void bin_lock(void)   { AcquireSRWLockExclusive(&bin_mutex); }
+static void bin_unlock(void) { ReleaseSRWLockExclusive(&bin_mutex); }
+static void async_wake(void) { SetEvent(async_event); }
+static void async_wait(unsigned ms) { WaitForSingleObject(async_event, ms); }
+
+#else
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+typedef _Atomic long long log_atomic;
+
+static bool async_cas_ll(log_atomic *p, long long oldv, long long newv) {
+  return atomic_compare_exchange_strong(p, &oldv, newv);
+}
+
+#define async_load(p)           atomic_load_explicit((p), memory_order_acquire)
+#define async_store(p, v)       atomic_store_explicit((p), (v), memory_order_release)
+#define async_cas(p, oldv, newv) async_cas_ll((p), (oldv), (newv))
+#define async_xchg(p, v)        atomic_exchange((p), (v))
+#define async_inc(p)            atomic_fetch_add((p), 1)
+#define async_yield()           sched_yield()
+#define async_sleep_ms(ms)      nanosleep(&(struct timespec) { 0, (ms) * 1000000L }, NULL)
+
+// Writer-preferring where available, so that log_remove_fp can't be starved
+#ifdef PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP
+static pthread_rwlock_t cb_mutex = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP;
+#else
+static pthread_rwlock_t cb_mutex = PTHREAD_RWLOCK_INITIALIZER;
+#endif
+static pthread_mutex_t bin_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t async_wake_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t async_cond = PTHREAD_COND_INITIALIZER;
+static bool async_signaled;
+static pthread_t async_thread;
+
+static void cb_lock(void)   { pthread_rwlock_wrlock(&cb_mutex); }
+static void cb_unlock(void) { pthread_rwlock_unlock(&cb_mutex); }
+static void cb_lock_shared(void)   { pthread_rwlock_rdlock(&cb_mutex); }
+static void cb_unlock_shared(void) { pthread_rwlock_unlock(&cb_mutex); }
+static void bin_lock(void)   { pthread_mutex_lock(&bin_mutex); }
+static void bin_unlock(void) { pthread_mutex_unlock(&bin_mutex); }
+
+static void async_wake(void) {
+  pthread_mutex_lock(&async_wake_mutex);
+  async_signaled = true;
+  pthread_cond_signal(&async_cond);
+  pthread_mutex_unlock(&async_wake_mutex);
+}
+
+static void async_wait(unsigned ms) {
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += ms / 1000;
+  ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+  if (ts.tv_nsec >= 1000000000L) { ts.tv_sec++; ts.tv_nsec -= 1000000000L; }
+  pthread_mutex_lock(&async_wake_mutex);
+  while (!async_signaled) {
+    if (pthread_cond_timedwait(&async_cond, &async_wake_mutex, &ts) != 0) { break; }
+  }
+  async_signaled = false;
+  pthread_mutex_unlock(&async_wake_mutex);
+}
+
+#endif
+
+// Messages that don't fit into a slot are formatted into a heap buffer of up
+// to LOG_ASYNC_MAX_MSG bytes. Longer ones are cut and end in LOG_TRUNCATED
+#define LOG_ASYNC_MSG_SIZE 512
+#define LOG_ASYNC_MAX_MSG  (64 * 1024)
+#define LOG_ASYNC_IDLE_MS  100
+#define LOG_TRUNCATED      "... [truncated]"
+
+typedef struct {
+  time_t time;
+  const char *file;
+  int line;
+  int level;
+  char *long_msg;
+  char msg[LOG_ASYNC_MSG_SIZE];
+} AsyncRecord;
+
+typedef struct {
+  log_atomic seq;
+  AsyncRecord rec;
+} AsyncSlot;
+
+// Producer and consumer positions live on separate cache lines
+static struct {
+  AsyncSlot *slots;
+  long long mask;
+  int overflow;
+  log_atomic running;
+  log_atomic stop;
+  char pad0[64];
+  log_atomic enqueue_pos;
+  char pad1[64];
+  long long dequeue_pos;
+  log_atomic written_pos;
+  log_atomic sleeping;
+  log_atomic dropped;
+  long long dropped_reported;
+  time_t last_time;
+  char time_buf[64];
+} A;
+
+
+static bool async_pending(void) {
+  AsyncSlot *slot = &A.slots[A.dequeue_pos & A.mask];
+  return async_load(&slot->seq) == A.dequeue_pos + 1;
+}
+
+
+static void async_push(int level, const char *file, int line, const char *fmt, va_list ap) {
+  AsyncSlot *slot;
+  long long pos = async_load(&A.enqueue_pos);
+
+  for (;;) {
+    slot = &A.slots[pos & A.mask];
+    long long diff = async_load(&slot->seq) - pos;
+    if (diff == 0) {
+      if (async_cas(&A.enqueue_pos, pos, pos + 1)) { break; }
+    } else if (diff < 0) {
+      // Queue is full: the writer is at least one lap behind
+      if (A.overflow == LOG_OVERFLOW_DROP) {
+        async_inc(&A.dropped);
+        return;
+      }
+      async_wake();
+      async_yield();
+    }
+    pos = async_load(&A.enqueue_pos);
+  }
+
+  slot->rec.time = time(NULL);
+  slot->rec.file = file;
+  slot->rec.line = line;
+  slot->rec.level = level;
+  slot->rec.long_msg = NULL;
+
+  va_list ap_long;
+  va_copy(ap_long, ap);
+  int len = vsnprintf(slot->rec.msg, sizeof(slot->rec.msg), fmt, ap);
+  if (len >= (int)sizeof(slot->rec.msg)) {
+    size_t size = (len < LOG_ASYNC_MAX_MSG) ? (size_t)len + 1 : LOG_ASYNC_MAX_MSG;
+    char *buf = malloc(size);
+    if (buf) {
+      vsnprintf(buf, size, fmt, ap_long);
+      slot->rec.long_msg = buf;
+    } else {
+      size = sizeof(slot->rec.msg);
+      buf = slot->rec.msg;
+    }
+    if ((size_t)len >= size) {
+      memcpy(buf + size - sizeof(LOG_TRUNCATED), LOG_TRUNCATED, sizeof(LOG_TRUNCATED));
+    }
+  }
+  va_end(ap_long);
+  async_store(&slot->seq, pos + 1);
+
+  if (async_xchg(&A.sleeping, 0)) { async_wake(); }
+}
+
+
+static void async_write(time_t t, int level, const char *file, int line, const char *msg) {
+  if (t != A.last_time) {
+    struct tm tm_buf;
+#ifdef _WIN32
+    localtime_s(&tm_buf, &t);
+#else
+    localtime_r(&t, &tm_buf);
+#endif
+    A.time_buf[strftime(A.time_buf, sizeof(A.time_buf), "%Y-%m-%d %H:%M:%S", &tm_buf)] = '\0';
+    A.last_time = t;
+  }
+
+  for (int i = 0; i < MAX_CALLBACKS && L.callbacks[i].fn; i++) {
+    Callback *cb = &L.callbacks[i];
+    if (cb->fn == file_callback && level >= cb->level) {
+      count_bytes(fprintf(cb->udata, "%s %-5s %s:%d: %s\n",
+        A.time_buf, level_strings[level], file, line, msg));
+    }
+  }
+}
+
+
+// Write out everything published so far (at most one lap of the ring) and
+// flush the files once. Called on the writer thread only
+static long long async_drain(void) {
+  long long n = 0;
+
+  cb_lock_shared();
+  while (n <= A.mask && async_pending()) {
+    AsyncSlot *slot = &A.slots[A.dequeue_pos & A.mask];
+    async_write(slot->rec.time, slot->rec.level, slot->rec.file, slot->rec.line,
+      slot->rec.long_msg ? slot->rec.long_msg : slot->rec.msg);
+    free(slot->rec.long_msg);
+    slot->rec.long_msg = NULL;
+    async_store(&slot->seq, A.dequeue_pos + A.mask + 1);
+    A.dequeue_pos++;
+    n++;
+  }
+
+  long long dropped = async_load(&A.dropped);
+  if (dropped != A.dropped_reported) {
+    char msg[64];
+    snprintf(msg, sizeof(msg), "%lld log message(s) dropped, queue full",
+      dropped - A.dropped_reported);
+    async_write(time(NULL), LOG_WARN, __FILE__, __LINE__, msg);
+    A.dropped_reported = dropped;
+    n++;
+  }
+
+  if (n) {
+    for (int i = 0; i < MAX_CALLBACKS && L.callbacks[i].fn; i++) {
+      if (L.callbacks[i].fn == file_callback) { fflush(L.callbacks[i].udata); }
+    }
+  }
+  cb_unlock_shared();
+
+  async_store(&A.written_pos, A.dequeue_pos);
+  return n;
+}
+
+
+static void async_run(void) {
+  for (;;) {
+    if (async_drain()) { continue; }
+    if (async_load(&A.stop)) {
+      if (async_drain()) { continue; }
+      break;
+    }
+    // Announce the wait before re-checking the ring, so that a producer
+    // either sees the flag and wakes us up or its message is seen here
+    async_xchg(&A.sleeping, 1);
+    if (!async_pending()) { async_wait(LOG_ASYNC_IDLE_MS); }
+    async_xchg(&A.sleeping, 0);
+  }
+}
+
+
+#ifdef _WIN32
+static unsigned __stdcall async_thread_proc(void *arg) {
+  (void)arg;
+  async_run();
+  return 0;
+}
+#else
+static void *async_thread_proc(void *arg) {
+  (void)arg;
+  async_run();
+  return NULL;
+}
+#endif
+
+
+//Added by thf
+// Binary log sink. Instead of rendering the message, a record stores the time,
+// level, line, the ids of the file and format strings and the raw arguments of
+// the format. File and format strings are written once, as definitions, the
+// first time they are seen. log_decode_bin renders a binary log back into the
+// layout of file_callback. Values are stored in host byte order; the header
+// records the sizes of long and pointers so the decoder can reproduce
+// the writer's conversions on another platform.
+//
+//   header      "CTBL" u8 version, u8 sizeof(long), u8 sizeof(void*), u8 0
+//   definition  'S' u32 id, u32 length, bytes
+//   record      'R' i64 time, u8 level, u32 file id, i32 line, u32 format id,
+//               u16 payload length, payload
+//
+// Integer, character and pointer arguments take 8 bytes (i64), floating point
+// arguments 8 bytes (double) and strings u32 length plus bytes (wide strings
+// as UTF-8, NULL as length LOG_BIN_NULL). A session defines at most
+// LOG_BIN_MAX_STRINGS strings of at most LOG_BIN_MAX_STRING bytes each; the
+// decoder rejects definitions beyond either limit
+#define LOG_BIN_VERSION    1
+#define LOG_BIN_MAX_RECORD 4096
+#define LOG_BIN_MAX_STRINGS (1u << 20)
+#define LOG_BIN_MAX_STRING (64u * 1024u)
+#define LOG_BIN_MAX_ARGS   32
+#define LOG_BIN_NULL       0xFFFFFFFFu
+#define LOG_BIN_REC_HEADER 23
+
+typedef struct {
+  char flags[8];
+  int width;        // -1 none, -2 '*'
+  int precision;    // -1 none, -2 '*'
+  char length[4];
+  char conv;
+} FmtSpec;
+
+typedef struct {
+  uint32_t hash;
+  uint32_t id;
+  char *str;
+  char kinds[LOG_BIN_MAX_ARGS + 1];
+} BinString;
+
+static struct {
+  FILE *fp;
+  BinString *table;
+  uint32_t table_size;
+  uint32_t count;
+} B;
+
+
+// Parse the conversion specification following a '%'
+static const char *parse_spec(const char *p, FmtSpec *spec) {
+  size_t n = 0;
+  memset(spec, 0, sizeof(*spec));
+  spec->width = -1;
+  spec->precision = -1;
+
+  while (*p && strchr("-+ #0", *p)) {
+    if (n < sizeof(spec->flags) - 1) { spec->flags[n++] = *p; }
+    p++;
+  }
+  if (*p == '*') {
+    spec->width = -2;
+    p++;
+  } else if (*p >= '0' && *p <= '9') {
+    spec->width = 0;
+    while (*p >= '0' && *p <= '9') { spec->width = spec->width * 10 + (*p++ - '0'); }
+  }
+  if (*p == '.') {
+    p++;
+    spec->precision = 0;
+    if (*p == '*') {
+      spec->precision = -2;
+      p++;
+    } else {
+      while (*p >= '0' && *p <= '9') { spec->precision = spec->precision * 10 + (*p++ - '0'); }
+    }
+  }
+
+  if ((p[0] == 'h' && p[1] == 'h') || (p[0] == 'l' && p[1] == 'l')) {
+    memcpy(spec->length, p, 2);
+    p += 2;
+  } else if (p[0] == 'I' && ((p[1] == '6' && p[2] == '4') || (p[1] == '3' && p[2] == '2'))) {
+    memcpy(spec->length, p, 3);
+    p += 3;
+  } else if (*p && strchr("hljztLwI", *p)) {
+    spec->length[0] = *p++;
+  }
+
+  spec->conv = *p;
+  return *p ? p + 1 : p;
+}
+
+
+// Type of the argument that printf reads for spec; 0 if it is not understood
+static char spec_kind(const FmtSpec *spec) {
+  const char *len = spec->length;
+
+  switch (spec->conv) {
+  case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+    if (!strcmp(len, "l")) { return 'l'; }
+    if (!strcmp(len, "ll") || !strcmp(len, "I64")) { return 'q'; }
+    if (!strcmp(len, "j")) { return 'j'; }
+    if (!strcmp(len, "z") || !strcmp(len, "I")) { return 'z'; }
+    if (!strcmp(len, "t")) { return 't'; }
+    return 'i';
+  case 'c':
+    return (!strcmp(len, "l") || !strcmp(len, "w")) ? 'c' : 'i';
+  case 'C':
+    return 'c';
+  case 's':
+    return (!strcmp(len, "l") || !strcmp(len, "w")) ? 'w' : 's';
+  case 'S':
+    return 'w';
+  case 'e': case 'E': case 'f': case 'F': case 'g': case 'G': case 'a': case 'A':
+    return !strcmp(len, "L") ? 'D' : 'd';
+  case 'p':
+    return 'p';
+  case 'n':
+    return 'n';
+  default:
+    return 0;
+  }
+}
+
+
+// Argument kinds of fmt in order, '*' widths and precisions included
+static void parse_kinds(const char *fmt, char *kinds) {
+  size_t n = 0;
+  for (const char *p = fmt; *p && n < LOG_BIN_MAX_ARGS; ) {
+    if (*p++ != '%') { continue; }
+    if (*p == '%') { p++; continue; }
+
+    FmtSpec spec;
+    p = parse_spec(p, &spec);
+    char kind = spec_kind(&spec);
+    if (!kind) { break; }
+    if (spec.width == -2 && n < LOG_BIN_MAX_ARGS) { kinds[n++] = 'i'; }
+    if (spec.precision == -2 && n < LOG_BIN_MAX_ARGS) { kinds[n++] = 'i'; }
+    if (n < LOG_BIN_MAX_ARGS) { kinds[n++] = kind; }
+  }
+  kinds[n] = '\0';
+}
+
+
+static uint32_t bin_hash(const char *str) {
+  uint32_t hash = 2166136261u;
+  while (*str) { hash = (hash ^ (unsigned char)*str++) * 16777619u; }
+  return hash;
+}
+
+
+static void bin_put(char *buf, size_t *pos, const void *data, size_t size) {
+  memcpy(buf + *pos, data, size);
+  *pos += size;
+}
+
+
+static bool bin_grow(void) {
+  uint32_t size = B.table_size ? B.table_size * 2 : 256;
+  BinString *table = calloc(size, sizeof(BinString));
+  if (!table) { return false; }
+
+  for (uint32_t i = 0; i < B.table_size; i++) {
+    if (!B.table[i].str) { continue; }
+    uint32_t j = B.table[i].hash & (size - 1);
+    while (table[j].str) { j = (j + 1) & (size - 1); }
+    table[j] = B.table[i];
+  }
+  free(B.table);
+  B.table = table;
+  B.table_size = size;
+  return true;
+}
+
+
+// Look up str, writing its definition the first time it is seen. Returns NULL
+// when str is too long or the string table is full or cannot grow
+static BinString *bin_intern(const char *str) {
+  uint32_t hash = bin_hash(str);
+
+  if (B.table_size) {
+    for (uint32_t i = hash & (B.table_size - 1); B.table[i].str; i = (i + 1) & (B.table_size - 1)) {
+      if (B.table[i].hash == hash && !strcmp(B.table[i].str, str)) { return &B.table[i]; }
+    }
+  }
+
+  size_t len = strlen(str);
+  if (len > LOG_BIN_MAX_STRING || B.count >= LOG_BIN_MAX_STRINGS) { return NULL; }
+  if ((B.count + 1) * 2 > B.table_size && !bin_grow()) { return NULL; }
+
+  char *copy = malloc(len + 1);
+  if (!copy) { return NULL; }
+  memcpy(copy, str, len + 1);
+
+  uint32_t i = hash & (B.table_size - 1);
+  while (B.table[i].str) { i = (i + 1) & (B.table_size - 1); }
+  BinString *entry = &B.table[i];
+  entry->hash = hash;
+  entry->id = B.count++;
+  entry->str = copy;
+  parse_kinds(str, entry->kinds);
+
+  uint32_t len32 = (uint32_t)len;
+  fputc('S', B.fp);
+  fwrite(&entry->id, sizeof(entry->id), 1, B.fp);
+  fwrite(&len32, sizeof(len32), 1, B.fp);
+  fwrite(str, 1, len, B.fp);
+  count_bytes((long long)(1 + sizeof(entry->id) + sizeof(len32) + len));
+  return entry;
+}
+
+
+static void bin_put_string(char *buf, size_t *pos, const char *str, size_t avail) {
+  uint32_t len = LOG_BIN_NULL;
+  if (str) {
+    size_t n = strlen(str);
+    len = (uint32_t)(n < avail ? n : avail);
+  }
+  bin_put(buf, pos, &len, sizeof(len));
+  if (len != LOG_BIN_NULL) { bin_put(buf, pos, str, len); }
+}
+
+
+static void bin_put_wstring(char *buf, size_t *pos, const wchar_t *str, size_t avail) {
+  uint32_t len = LOG_BIN_NULL;
+  size_t start = *pos;
+  *pos += sizeof(len);
+
+  if (str) {
+    len = 0;
+    for (; *str; str++) {
+      uint32_t c = (uint32_t)*str;
+      unsigned char utf8[4];
+      size_t n;
+      if (sizeof(wchar_t) == 2 && c >= 0xD800 && c < 0xDC00 && str[1] >= 0xDC00 && str[1] < 0xE000) {
+        c = 0x10000 + ((c - 0xD800) << 10) + ((uint32_t)str[1] - 0xDC00);
+        str++;
+      }
+      if (c < 0x80) {
+        utf8[0] = (unsigned char)c; n = 1;
+      } else if (c < 0x800) {
+        utf8[0] = (unsigned char)(0xC0 | (c >> 6)); utf8[1] = (unsigned char)(0x80 | (c & 0x3F)); n = 2;
+      } else if (c < 0x10000) {
+        utf8[0] = (unsigned char)(0xE0 | (c >> 12)); utf8[1] = (unsigned char)(0x80 | ((c >> 6) & 0x3F));
+        utf8[2] = (unsigned char)(0x80 | (c & 0x3F)); n = 3;
+      } else {
+        utf8[0] = (unsigned char)(0xF0 | (c >> 18)); utf8[1] = (unsigned char)(0x80 | ((c >> 12) & 0x3F));
+        utf8[2] = (unsigned char)(0x80 | ((c >> 6) & 0x3F)); utf8[3] = (unsigned char)(0x80 | (c & 0x3F)); n = 4;
+      }
+      if (len + n > avail) { break; }
+      bin_put(buf, pos, utf8, n);
+      len += (uint32_t)n;
+    }
+  }
+  memcpy(buf + start, &len, sizeof(len));
+}
+
+
+static void bin_callback(log_Event *ev) {
+  char buf[LOG_BIN_MAX_RECORD];
+  size_t pos = 0;
+  int64_t t = (int64_t)time(NULL);
+
+  bin_lock();
+  if (B.fp != ev->udata) {
+    bin_unlock();
+    return;
+  }
+
+  BinString *file = bin_intern(ev->file);
+  BinString *fmt = bin_intern(ev->fmt);
+  if (!file || !fmt) {
+    bin_unlock();
+    return;
+  }
+
+  uint8_t level = (uint8_t)ev->level;
+  int32_t line = ev->line;
+  uint16_t payload = 0;
+
+  buf[pos++] = 'R';
+  bin_put(buf, &pos, &t, sizeof(t));
+  bin_put(buf, &pos, &level, sizeof(level));
+  bin_put(buf, &pos, &file->id, sizeof(file->id));
+  bin_put(buf, &pos, &line, sizeof(line));
+  bin_put(buf, &pos, &fmt->id, sizeof(fmt->id));
+  size_t payload_pos = pos;
+  pos += sizeof(payload);
+
+  size_t nArgs = strlen(fmt->kinds);
+  for (size_t i = 0; i < nArgs; i++) {
+    // Keep 8 bytes for each remaining argument, strings get whatever is left
+    size_t reserve = (nArgs - i) * sizeof(int64_t);
+    size_t avail = sizeof(buf) - pos > reserve ? sizeof(buf) - pos - reserve : 0;
+    int64_t v = 0;
+    double d = 0;
+
+    switch (fmt->kinds[i]) {
+    case 'i': v = va_arg(ev->ap, int); break;
+    case 'l': v = va_arg(ev->ap, long); break;
+    case 'q': v = va_arg(ev->ap, long long); break;
+    case 'j': v = (int64_t)va_arg(ev->ap, intmax_t); break;
+    case 'z': v = (int64_t)va_arg(ev->ap, size_t); break;
+    case 't': v = (int64_t)va_arg(ev->ap, ptrdiff_t); break;
+    case 'c': v = (int64_t)va_arg(ev->ap, wint_t); break;
+    case 'p': v = (int64_t)(uintptr_t)va_arg(ev->ap, void *); break;
+    case 'd': d = va_arg(ev->ap, double); break;
+    case 'D': d = (double)va_arg(ev->ap, long double); break;
+    case 's': bin_put_string(buf, &pos, va_arg(ev->ap, const char *), avail); continue;
+    case 'w': bin_put_wstring(buf, &pos, va_arg(ev->ap, const wchar_t *), avail); continue;
+    case 'n': (void)va_arg(ev->ap, int *); continue;
+    }
+
+    if (fmt->kinds[i] == 'd' || fmt->kinds[i] == 'D') {
+      bin_put(buf, &pos, &d, sizeof(d));
+    } else {
+      bin_put(buf, &pos, &v, sizeof(v));
+    }
+  }
+
+  payload = (uint16_t)(pos - payload_pos - sizeof(payload));
+  memcpy(buf + payload_pos, &payload, sizeof(payload));
+  count_bytes((long long)fwrite(buf, 1, pos, B.fp));
+  if (ev->level >= LOG_WARN) { fflush(B.fp); }
+  bin_unlock();
+}
+
+
+static void bin_reset(void) {
+  for (uint32_t i = 0; i < B.table_size; i++) { free(B.table[i].str); }
+  free(B.table);
+  B.fp = NULL;
+  B.table = NULL;
+  B.table_size = 0;
+  B.count = 0;
+}
+
+
+// Decoder state: definitions by id and the writer's type sizes
+typedef struct {
+  char **strings;
+  uint32_t count;
+  int long_size;
+  int ptr_size;
+} BinDecoder;
+
+
+static bool read_exact(FILE *in, void *data, size_t size) {
+  return fread(data, 1, size, in) == size;
+}
+
+
+static bool decode_define(FILE *in, BinDecoder *dec) {
+  uint32_t id, len;
+  if (!read_exact(in, &id, sizeof(id)) || !read_exact(in, &len, sizeof(len)) ||
+      id >= LOG_BIN_MAX_STRINGS || len > LOG_BIN_MAX_STRING) {
+    return false;
+  }
+
+  char *str = malloc((size_t)len + 1);
+  if (!str || !read_exact(in, str, len)) {
+    free(str);
+    return false;
+  }
+  str[len] = '\0';
+
+  if (id >= dec->count) {
+    // count stays a power of two and id is below LOG_BIN_MAX_STRINGS, so this
+    // stops at LOG_BIN_MAX_STRINGS at the latest
+    uint32_t count = dec->count ? dec->count : 256;
+    while (count <= id) { count *= 2; }
+    char **strings = realloc(dec->strings, (size_t)count * sizeof(char *));
+    if (!strings) {
+      free(str);
+      return false;
+    }
+    memset(strings + dec->count, 0, (size_t)(count - dec->count) * sizeof(char *));
+    dec->strings = strings;
+    dec->count = count;
+  }
+  free(dec->strings[id]);
+  dec->strings[id] = str;
+  return true;
+}
+
+
+static bool payload_get(const char **p, const char *end, void *data, size_t size) {
+  if ((size_t)(end - *p) < size) { return false; }
+  memcpy(data, *p, size);
+  *p += size;
+  return true;
+}
+
+
+// Decode the UTF-8 written by bin_put_wstring back into a wide string, with
+// surrogate pairs where wchar_t has 16 bits. Returns NULL if out of memory
+static wchar_t *utf8_to_wide(const char *str, size_t len) {
+  // A sequence of n bytes never takes more than n wide characters
+  wchar_t *wstr = malloc((len + 1) * sizeof(wchar_t));
+  if (!wstr) { return NULL; }
+
+  const unsigned char *p = (const unsigned char *)str;
+  const unsigned char *end = p + len;
+  size_t n = 0;
+  while (p < end) {
+    uint32_t c = *p++;
+    int extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+    if (c >= 0x80 && c < 0xC0) {
+      c = 0xFFFD;
+    } else if (extra) {
+      c &= 0x3Fu >> extra;
+      for (; extra && p < end && (*p & 0xC0) == 0x80; extra--) { c = (c << 6) | (*p++ & 0x3Fu); }
+      if (extra) { c = 0xFFFD; }
+    }
+
+    if (sizeof(wchar_t) == 2 && c >= 0x10000) {
+      wstr[n++] = (wchar_t)(0xD800 + ((c - 0x10000) >> 10));
+      wstr[n++] = (wchar_t)(0xDC00 + ((c - 0x10000) & 0x3FF));
+    } else {
+      wstr[n++] = (wchar_t)c;
+    }
+  }
+  wstr[n] = L'\0';
+  return wstr;
+}
+
+
+// Render one conversion the way the writer's printf would have. Wide strings and
+// characters go through printf's own conversion (%ls, %lc), so they come out in
+// the same (locale's) encoding as in a text log
+static void decode_arg(FILE *out, const FmtSpec *spec, char kind, const char **p, const char *end,
+  int width, int precision, const BinDecoder *dec) {
+  char sfmt[48];
+  int n = snprintf(sfmt, sizeof(sfmt), "%%%s", spec->flags);
+  if (width != -1) { n += snprintf(sfmt + n, sizeof(sfmt) - n, "%d", width); }
+  if (precision != -1) { n += snprintf(sfmt + n, sizeof(sfmt) - n, ".%d", precision); }
+
+  if (kind == 's' || kind == 'w') {
+    uint32_t len;
+    if (!payload_get(p, end, &len, sizeof(len))) { return; }
+    if (len == LOG_BIN_NULL) {
+      snprintf(sfmt + n, sizeof(sfmt) - n, "s");
+      fprintf(out, sfmt, "(null)");
+      return;
+    }
+    if ((size_t)(end - *p) < len) { return; }
+    if (kind == 'w') {
+      wchar_t *wstr = utf8_to_wide(*p, len);
+      *p += len;
+      if (!wstr) { return; }
+      snprintf(sfmt + n, sizeof(sfmt) - n, "ls");
+      fprintf(out, sfmt, wstr);
+      free(wstr);
+      return;
+    }
+    char *str = malloc((size_t)len + 1);
+    if (!str) { return; }
+    memcpy(str, *p, len);
+    str[len] = '\0';
+    *p += len;
+    snprintf(sfmt + n, sizeof(sfmt) - n, "s");
+    fprintf(out, sfmt, str);
+    free(str);
+    return;
+  }
+
+  if (kind == 'd' || kind == 'D') {
+    double d;
+    if (!payload_get(p, end, &d, sizeof(d))) { return; }
+    snprintf(sfmt + n, sizeof(sfmt) - n, "%c", spec->conv);
+    fprintf(out, sfmt, d);
+    return;
+  }
+
+  int64_t v;
+  if (!payload_get(p, end, &v, sizeof(v))) { return; }
+
+  if (kind == 'p') {
+    fprintf(out, "%0*llX", dec->ptr_size * 2, (unsigned long long)v);
+  } else if (kind == 'c') {
+    snprintf(sfmt + n, sizeof(sfmt) - n, "lc");
+    fprintf(out, sfmt, (wint_t)v);
+  } else if (spec->conv == 'c') {
+    snprintf(sfmt + n, sizeof(sfmt) - n, "c");
+    fprintf(out, sfmt, (int)v);
+  } else {
+    // Narrow the value back to the width printf converted it to
+    int bits = 64;
+    if (!strcmp(spec->length, "hh")) { bits = 8; }
+    else if (!strcmp(spec->length, "h")) { bits = 16; }
+    else if (kind == 'i') { bits = 32; }
+    else if (kind == 'l') { bits = dec->long_size * 8; }
+    else if ((kind == 'z' || kind == 't') && dec->ptr_size) { bits = dec->ptr_size * 8; }
+
+    uint64_t u = (uint64_t)v;
+    if (bits < 64) {
+      uint64_t mask = (1ull << bits) - 1;
+      u &= mask;
+      if ((spec->conv == 'd' || spec->conv == 'i') && (u >> (bits - 1))) { u |= ~mask; }
+    }
+
+    snprintf(sfmt + n, sizeof(sfmt) - n, "ll%c", spec->conv);
+    if (spec->conv == 'd' || spec->conv == 'i') {
+      fprintf(out, sfmt, (long long)u);
+    } else {
+      fprintf(out, sfmt, (unsigned long long)u);
+    }
+  }
+}
+
+
+static void decode_message(FILE *out, const char *fmt, const char *p, const char *end, const BinDecoder *dec) {
+  while (*fmt) {
+    if (*fmt != '%') {
+      fputc(*fmt++, out);
+      continue;
+    }
+    const char *start = fmt++;
+    if (*fmt == '%') {
+      fputc('%', out);
+      fmt++;
+      continue;
+    }
+
+    FmtSpec spec;
+    fmt = parse_spec(fmt, &spec);
+    char kind = spec_kind(&spec);
+    if (!kind) {
+      // Not understood by the writer either: no arguments were stored for it
+      fwrite(start, 1, (size_t)(fmt - start), out);
+      fputs(fmt, out);
+      return;
+    }
+
+    int width = spec.width;
+    int precision = spec.precision;
+    int64_t v;
+    if (width == -2) { width = payload_get(&p, end, &v, sizeof(v)) ? (int)v : -1; }
+    if (precision == -2) { precision = payload_get(&p, end, &v, sizeof(v)) ? (int)v : -1; }
+    if (kind != 'n') { decode_arg(out, &spec, kind, &p, end, width, precision, dec); }
+  }
+}
+
+
+static bool decode_record(FILE *in, FILE *out, BinDecoder *dec) {
+  char hdr[LOG_BIN_REC_HEADER];
+  char payload[LOG_BIN_MAX_RECORD];
+  int64_t t;
+  uint8_t level;
+  uint32_t file_id, fmt_id;
+  int32_t line;
+  uint16_t len;
+
+  if (!read_exact(in, hdr, sizeof(hdr))) { return false; }
+  const char *p = hdr;
+  memcpy(&t, p, sizeof(t)); p += sizeof(t);
+  memcpy(&level, p, sizeof(level)); p += sizeof(level);
+  memcpy(&file_id, p, sizeof(file_id)); p += sizeof(file_id);
+  memcpy(&line, p, sizeof(line)); p += sizeof(line);
+  memcpy(&fmt_id, p, sizeof(fmt_id)); p += sizeof(fmt_id);
+  memcpy(&len, p, sizeof(len));
+
+  if (level > LOG_FATAL || len > sizeof(payload) || !read_exact(in, payload, len)) { return false; }
+
+  const char *file = file_id < dec->count && dec->strings[file_id] ? dec->strings[file_id] : "?";
+  const char *fmt = fmt_id < dec->count && dec->strings[fmt_id] ? dec->strings[fmt_id] : NULL;
+
+  char buf[64];
+  time_t tt = (time_t)t;
+  struct tm *tm_time = localtime(&tt);
+  buf[tm_time ? strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", tm_time) : 0] = '\0';
+
+  fprintf(out, "%s %-5s %s:%d: ", buf, level_strings[level], file, line);
+  if (fmt) {
+    decode_message(out, fmt, payload, payload + len, dec);
+  } else {
+    fprintf(out, "<undefined format %u>", fmt_id);
+  }
+  fputc('\n', out);
+  return true;
+}
+
+
+static bool decode_header(FILE *in, BinDecoder *dec) {
+  unsigned char hdr[7];
+  if (!read_exact(in, hdr, sizeof(hdr)) || memcmp(hdr, "TBL", 3) || hdr[3] != LOG_BIN_VERSION) {
+    return false;
+  }
+
+  // Every session appended to the file starts its own string ids
+  for (uint32_t i = 0; i < dec->count; i++) {
+    free(dec->strings[i]);
+    dec->strings[i] = NULL;
+  }
+  dec->long_size = hdr[4];
+  dec->ptr_size = hdr[5];
+  return true;
+}
+
+
 const char* log_level_string(int level) {
   return level_strings[level];
 }
@@ -112,14 +1021,23 @@ void log_set_quiet(bool enable) {
 }
 
 
+void log_set_bytes_fn(log_BytesFn fn) {
+  bytes_fn = fn;
+}
+
+
 int log_add_callback(log_LogFn fn, void *udata, int level) {
+  int ret = -1;
+  cb_lock();
   for (int i = 0; i < MAX_CALLBACKS; i++) {
     if (!L.callbacks[i].fn) {
       L.callbacks[i] = (Callback) { fn, udata, level };
-      return 0;
+      ret = 0;
+      break;
     }
   }
-  return -1;
+  cb_unlock();
+  return ret;
 }
 
 
@@ -128,10 +1046,17 @@ int log_add_fp(FILE *fp, int level) {
 }
 
 
-static void init_event(log_Event *ev, void *udata) {
+// tm_buf receives the time: callers log concurrently, and localtime's
+// static buffer is only per thread on some platforms
+static void init_event(log_Event *ev, void *udata, struct tm *tm_buf) {
   if (!ev->time) {
     time_t t = time(NULL);
-    ev->time = localtime(&t);
+#ifdef _WIN32
+    localtime_s(tm_buf, &t);
+#else
+    localtime_r(&t, tm_buf);
+#endif
+    ev->time = tm_buf;
   }
   ev->udata = udata;
 }
@@ -144,27 +1069,51 @@ void log_log(int level, const char *file, int line, const char *fmt, ...) {
     .line  = line,
     .level = level,
   };
+  struct tm tm_buf;
 
   lock();
 
   if (!L.quiet && level >= L.level) {
-    init_event(&ev, stderr);
+    init_event(&ev, stderr, &tm_buf);
     va_start(ev.ap, fmt);
     stdout_callback(&ev);
     va_end(ev.ap);
   }
 
+  bool async = async_load(&A.running) != 0;
+  bool queue = false;
+
+  // Callbacks are added and removed (and their files closed) while other
+  // threads log, so the table is only read under the callback lock. Shared,
+  // so that callers don't wait for each other or for the async writer
+  cb_lock_shared();
   for (int i = 0; i < MAX_CALLBACKS && L.callbacks[i].fn; i++) {
     Callback *cb = &L.callbacks[i];
     if (level >= cb->level) {
-      init_event(&ev, cb->udata);
+      if (async && cb->fn == file_callback) {
+        queue = true;
+        continue;
+      }
+      if (cb->fn == bin_callback) {
+        // The binary sink stores the raw time, it needs no localtime
+        ev.udata = cb->udata;
+      } else {
+        init_event(&ev, cb->udata, &tm_buf);
+      }
       va_start(ev.ap, fmt);
       cb->fn(&ev);
       va_end(ev.ap);
     }
   }
+  cb_unlock_shared();
 
   unlock();
+
+  if (queue) {
+    va_start(ev.ap, fmt);
+    async_push(level, file, line, fmt, ev.ap);
+    va_end(ev.ap);
+  }
 }
 
 //Added by thf
@@ -178,7 +1127,7 @@ static int log_find_fp_ex(FILE* fp, int level, int* pLocation)
     if (fp) {
         for (int i = 0; !bFound && (i < MAX_CALLBACKS) && L.callbacks[i].fn; i++) {
             Callback* pCB = &L.callbacks[i];
-            bFound = ((pCB->fn == &file_callback) && (pCB->udata == fp) && (pCB->level == level));
+            bFound = ((pCB->fn == &file_callback || pCB->fn == &bin_callback) && (pCB->udata == fp) && (pCB->level == level));
             if (bFound && pLocation) {
                 *pLocation = i;
             }
@@ -198,6 +1147,10 @@ int log_remove_fp(FILE* fp, int level)
     _Bool bFound = 0;
     _Bool bFoundOne = 0;
 
+    // Messages already queued for fp must reach it before it goes away
+    log_flush();
+    cb_lock();
+
     do {
         int position = 0;
         bFound = (log_find_fp_ex(fp, level, &position) == 0);
@@ -222,5 +1175,184 @@ int log_remove_fp(FILE* fp, int level)
         }
     } while (bFound);
 
+    bin_lock();
+    if (bFoundOne && B.fp == fp) {
+        fflush(fp);
+        bin_reset();
+    }
+    bin_unlock();
+
+    cb_unlock();
     return bFoundOne ? 0 : -1;
-}
\ No newline at end of file
+}
+
+int log_start_async(size_t capacity, int overflow)
+{
+    if (async_load(&A.running)) {
+        return -1;
+    }
+
+    size_t nSlots = 2;
+    while (nSlots < capacity) {
+        nSlots <<= 1;
+    }
+
+    A.slots = calloc(nSlots, sizeof(AsyncSlot));
+    if (!A.slots) {
+        return -1;
+    }
+    for (size_t i = 0; i < nSlots; i++) {
+        async_store(&A.slots[i].seq, (long long)i);
+    }
+    A.mask = (long long)nSlots - 1;
+    A.overflow = overflow;
+    A.enqueue_pos = 0;
+    A.dequeue_pos = 0;
+    A.written_pos = 0;
+    A.sleeping = 0;
+    A.dropped = 0;
+    A.dropped_reported = 0;
+    A.last_time = 0;
+    A.stop = 0;
+
+#ifdef _WIN32
+    async_event = CreateEventW(NULL, FALSE, FALSE, NULL);
+    async_thread = async_event ? (HANDLE)_beginthreadex(NULL, 0, async_thread_proc, NULL, 0, NULL) : NULL;
+    if (!async_thread) {
+        if (async_event) {
+            CloseHandle(async_event);
+            async_event = NULL;
+        }
+        free(A.slots);
+        A.slots = NULL;
+        return -1;
+    }
+#else
+    if (pthread_create(&async_thread, NULL, async_thread_proc, NULL) != 0) {
+        free(A.slots);
+        A.slots = NULL;
+        return -1;
+    }
+#endif
+
+    async_store(&A.running, 1);
+    return 0;
+}
+
+// Drains the queue and joins the writer. No other thread may be logging
+// while this runs, as the ring is released afterwards
+void log_stop_async(void)
+{
+    if (!async_load(&A.running)) {
+        return;
+    }
+
+    async_store(&A.running, 0);
+    async_store(&A.stop, 1);
+    async_wake();
+
+#ifdef _WIN32
+    WaitForSingleObject(async_thread, INFINITE);
+    CloseHandle(async_thread);
+    CloseHandle(async_event);
+    async_thread = NULL;
+    async_event = NULL;
+#else
+    pthread_join(async_thread, NULL);
+#endif
+
+    free(A.slots);
+    A.slots = NULL;
+}
+
+// Blocks until every message queued before the call has been written and flushed
+void log_flush(void)
+{
+    if (async_load(&A.running)) {
+        long long target = async_load(&A.enqueue_pos);
+        while (async_load(&A.written_pos) < target) {
+            async_wake();
+            async_sleep_ms(1);
+        }
+    }
+
+    bin_lock();
+    if (B.fp) {
+        fflush(B.fp);
+    }
+    bin_unlock();
+}
+
+unsigned long long log_dropped_count(void)
+{
+    return (unsigned long long)async_load(&A.dropped);
+}
+
+// Only one binary log can be open at a time. Every call starts a new session
+// in the file, with its own header and string definitions
+int log_add_bin_fp(FILE* fp, int level)
+{
+    const unsigned char hdr[8] = { 'C', 'T', 'B', 'L', LOG_BIN_VERSION, (unsigned char)sizeof(long), (unsigned char)sizeof(void*), 0 };
+
+    if (!fp) {
+        return -1;
+    }
+
+    bin_lock();
+    if (B.fp && B.fp != fp) {
+        bin_unlock();
+        return -1;
+    }
+    if (!B.fp) {
+        B.fp = fp;
+        fwrite(hdr, 1, sizeof(hdr), fp);
+    }
+    bin_unlock();
+
+    return log_add_callback(bin_callback, fp, level);
+}
+
+int log_decode_bin(FILE* in, FILE* out)
+{
+    BinDecoder dec = { NULL, 0, (int)sizeof(long), (int)sizeof(void*) };
+    _Bool bOK = 1;
+    int type = 0;
+
+    while (bOK && (type = fgetc(in)) != EOF) {
+        switch (type) {
+        case 'C':
+            bOK = decode_header(in, &dec);
+            break;
+        case 'S':
+            bOK = decode_define(in, &dec);
+            break;
+        case 'R':
+            bOK = decode_record(in, out, &dec);
+            break;
+        default:
+            bOK = 0;
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < dec.count; i++) {
+        free(dec.strings[i]);
+    }
+    free(dec.strings);
+
+    return bOK ? 0 : -1;
+}
+
+// Lets callers skip expensive preparation of arguments (error message
+// lookups and the like) for a message that nothing would record
+bool log_is_enabled(int level)
+{
+    bool enabled = !L.quiet && level >= L.level;
+
+    cb_lock_shared();
+    for (int i = 0; !enabled && i < MAX_CALLBACKS && L.callbacks[i].fn; i++) {
+        enabled = (level >= L.callbacks[i].level);
+    }
+    cb_unlock_shared();
+    return enabled;
+}
@@ -49,4 +49,26 @@ void log_log(int level, const char *file, int line, const char *fmt, ...);
 //Added by thf
 int log_find_fp(FILE* fp, int level);
 int log_remove_fp(FILE* fp, int level);
+
+// Asynchronous mode: file callbacks are written by a background thread.
+// capacity is the number of queued messages (rounded up to a power of two),
+// overflow decides what happens to a message when the queue is full
+enum { LOG_OVERFLOW_DROP, LOG_OVERFLOW_BLOCK };
+
+int log_start_async(size_t capacity, int overflow);
+void log_stop_async(void);
+void log_flush(void);
+unsigned long long log_dropped_count(void);
+
+// Binary log: records hold the raw arguments and ids of the file and format
+// strings instead of the rendered text. log_decode_bin renders a binary log
+// in the text layout of log_add_fp. The binary files must be opened in binary mode
+int log_add_bin_fp(FILE* fp, int level);
+int log_decode_bin(FILE* in, FILE* out);
+bool log_is_enabled(int level);
+
+// fn is called with the number of bytes after each write to a text or binary log
+// file, on the thread that wrote them. Set it before logging starts
+typedef void (*log_BytesFn)(size_t bytes);
+void log_set_bytes_fn(log_BytesFn fn);
 #endif
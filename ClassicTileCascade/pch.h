@@ -42,6 +42,7 @@
 #include <algorithm>
 #include <io.h>
 #include <ranges>
+#include <chrono>
 
 #include <tom.h>
 #include <richedit.h>
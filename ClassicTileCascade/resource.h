@@ -5,6 +5,7 @@
 #define IDM_EXIT                        105
 #define IDI_CLASSICTILECASCADE          131
 #define IDR_MENUPOPUP                   132
+#define IDD_HOTKEYS                     133
 #define ID_SETTINGS_LOGGING             32796
 #define ID_FILE_CASCADEWINDOWS          32802
 #define ID_FILE_SHOWWINDOWSSTACKED      32803
@@ -20,6 +21,9 @@
 #define ID_DEFAULT_SHOWTHEDESKTOP       32813
 #define ID_DEFAULT_UNDOMINIMIZE         32814
 #define ID_SETTINGS_OPENLOGFILE         32815
+#define ID_SETTINGS_DIAGNOSTICS         32828
+#define ID_SETTINGS_MINANIMATIONS       32829
+#define ID_SETTINGS_HOTKEYS             32830
 #define ID_SETTINGS				        40000
 #define ID_DEFAULT				        40001
 #define IDC_STATIC                      -1
@@ -28,6 +32,11 @@
 #define IDC_LOGVIEWER                   109
 #define IDC_EDITLINE                    1000
 #define IDC_BUTTONGOTO                  1001
+#define IDC_HOTKEY_CASCADE              1004
+#define IDC_HOTKEY_STACKED              1005
+#define IDC_HOTKEY_SIDEBYSIDE           1006
+#define IDC_HOTKEY_SHOWDESKTOP          1007
+#define IDC_HOTKEY_UNDOMINIMIZE         1008
 #define ID_FILE_RELOAD                  32771
 #define ID_EDIT_COPY                    32772
 #define ID_EDIT_FIND                    32773
@@ -40,11 +49,24 @@
 #define ID_ZOOM_ZOOMOUT                 32783
 #define ID_VIEW_LINENUMBERS             32786
 #define ID_VIEW_STATUSBAR				32788
+#define ID_VIEW_PREVIOUSPAGE            32816
+#define ID_VIEW_NEXTPAGE                32817
+#define ID_VIEW_FOLLOWTAIL              32818
+#define ID_FILTER_TRACE                 32819
+#define ID_FILTER_DEBUG                 32820
+#define ID_FILTER_INFO                  32821
+#define ID_FILTER_WARN                  32822
+#define ID_FILTER_ERROR                 32823
+#define ID_FILTER_FATAL                 32824
+#define ID_FILTER_SOURCE                32825
+#define ID_FILTER_TIME                  32826
+#define ID_FILTER_CLEAR                 32827
 #define IDC_LOGEDIT                     50000
 #define ID_FILE                         50001
 #define ID_EDIT                         50002
 #define ID_VIEW                         50003
 #define ID_ZOOM                         50004
+#define ID_FILTER                       50005
 #define IDC_LOGSTATUS					50006	
 
 
@@ -53,9 +75,9 @@
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
 #define _APS_NO_MFC                     1
-#define _APS_NEXT_RESOURCE_VALUE        133
-#define _APS_NEXT_COMMAND_VALUE         32816
-#define _APS_NEXT_CONTROL_VALUE         1004
+#define _APS_NEXT_RESOURCE_VALUE        134
+#define _APS_NEXT_COMMAND_VALUE         32831
+#define _APS_NEXT_CONTROL_VALUE         1009
 #define _APS_NEXT_SYMED_VALUE           110
 #endif
 #endif
@@ -23,6 +23,7 @@
 #include "MemMgmt.h"
 #include "win_log.h"
 #include "WinUtils.h"
+#include "PerfCounters.h"
 
 const DWORD PROC_ID = ::GetCurrentProcessId();
 
@@ -52,7 +53,10 @@ LoggingException::LoggingException(int level, const std::string& file, int line,
     m_file(file),
     m_line(line),
     m_function(function),
-    m_functionCalled(functionCalled){}
+    m_functionCalled(functionCalled)
+{
+    CTCounters::PerfCounters::Global().Add(CTCounters::Counter::Exceptions);
+}
 
 bool LoggingException::FormatMsg(DWORD dwErrVal, std::string& szErrMsg)
 {
@@ -84,6 +88,11 @@ void HRLoggingException::Log() const
 {
     static constexpr std::string_view FMT_FUNCTION = "%s: Calling function <%s>: Received error : <0X%08X> %s";
 
+    // Don't look up the error description if nothing would record it
+    if (!log_is_enabled(m_level)) {
+        return;
+    }
+
     IErrorInfoPtr spErrInfo;
 
     std::string szErrMsg;
@@ -111,6 +120,10 @@ void DWLoggingException::Log() const
 {
     static constexpr std::string_view FMT_FUNCTION = "%s: Calling function <%s>: Received error : <0X%08X> %s";
 
+    if (!log_is_enabled(m_level)) {
+        return;
+    }
+
     std::string szErrVal;
     if (!FormatMsg(m_errVal, szErrVal)) {
         szErrVal = "Unknown Windows error";
@@ -130,18 +143,20 @@ void MSGLoggingException::Log() const
 }
 
 
-bool enable_logging(const std::string& szLogPath, SPFILE& spFile )
+bool enable_logging(const std::string& szLogPath, SPFILE& spFile, bool bBinary)
 {
     bool bRetVal = false;
 
 
     if (!spFile) {
-        spFile.reset( _fsopen(szLogPath.c_str(), "a+", _SH_DENYWR) );
+        spFile.reset( _fsopen(szLogPath.c_str(), bBinary ? "ab" : "a+", _SH_DENYWR) );
     }
 
     if (spFile) {
         if (log_find_fp(spFile.get(), LOG_TRACE) == 0) {
             bRetVal = true;
+        } else if (bBinary) {
+            bRetVal = (log_add_bin_fp(spFile.get(), LOG_TRACE) == 0);
         } else {
             bRetVal = (log_add_fp(spFile.get(), LOG_TRACE) == 0);
         }
@@ -150,9 +165,9 @@ bool enable_logging(const std::string& szLogPath, SPFILE& spFile )
     return bRetVal;
 }
 
-bool enable_logging(const std::wstring& szLogPath, SPFILE& spFile)
+bool enable_logging(const std::wstring& szLogPath, SPFILE& spFile, bool bBinary)
 {
     std::string szLogPathNarrow;
     CTWinUtils::Wstring2string(szLogPathNarrow, szLogPath);
-    return enable_logging(szLogPathNarrow, spFile);
+    return enable_logging(szLogPathNarrow, spFile, bBinary);
 }
\ No newline at end of file
@@ -93,8 +93,8 @@ public:
 	void Log() const override;
 };
 
-bool enable_logging(const std::string& szLogPath, SPFILE& spFIle);
-bool enable_logging(const std::wstring& szLogPath, SPFILE& spFIle);
+bool enable_logging(const std::string& szLogPath, SPFILE& spFIle, bool bBinary = false);
+bool enable_logging(const std::wstring& szLogPath, SPFILE& spFIle, bool bBinary = false);
 
 // Evaluate dwError for == ERROR_SUCCESS (i.e. == 0). if dwError !=ERROR_SUCCESS, throw a DWLoggingException. 
 // DWLoggingException::Log() will call FormatMessage to provide the error description in the log ifle
@@ -0,0 +1,232 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Coalescing of the executor's actions, e.g. the tile/cascade actions of a burst
+// of clicks on the tray icon
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+#include "CTTest.h"
+#include "ActionExecutor.h"
+
+using namespace CTAction;
+using namespace std::chrono_literals;
+
+namespace
+{
+    // Take results from executor until there are nCount, for up to 5 seconds
+    std::vector<ActionResult> WaitForResults(ActionExecutor& executor, std::size_t nCount)
+    {
+        std::vector<ActionResult> vResults;
+        const Clock::time_point tpEnd = Clock::now() + 5s;
+        while ((vResults.size() < nCount) && (Clock::now() < tpEnd)) {
+            executor.TakeResults(vResults);
+            std::this_thread::sleep_for(1ms);
+        }
+        return vResults;
+    }
+
+    // A layout that takes about 20 ms and stops at its next window once cancelled
+    Action MakeLayout(int nId, std::atomic<int>& nRuns, std::atomic<int>& nCancelled)
+    {
+        Action action;
+        action.nId = nId;
+        action.bCoalesce = true;
+        action.fnRun = [&nRuns, &nCancelled](const ActionContext& context) {
+            nRuns++;
+            for (int i = 0; (i < 20) && !context.IsCancelled(); i++) {
+                std::this_thread::sleep_for(1ms);
+            }
+            if (context.IsCancelled()) {
+                nCancelled++;
+            }
+        };
+        return action;
+    }
+
+    const ActionResult* FindResult(const std::vector<ActionResult>& vResults, int nId)
+    {
+        for (const ActionResult& result : vResults) {
+            if (result.nId == nId) {
+                return &result;
+            }
+        }
+        return nullptr;
+    }
+}
+
+CT_TEST(ClickBurstRunsAtMostTwice)
+{
+    constexpr int CLICKS = 10;
+    constexpr int OTHER_ID = 100;
+
+    //Clicks from back to back up to 5 ms apart, all well within the coalesce delay
+    for (std::chrono::microseconds usGap : { 0us, 100us, 1000us, 5000us }) {
+        std::atomic<int> nRuns = 0;
+        std::atomic<int> nCancelled = 0;
+        ActionExecutor executor;
+        executor.SetCoalesceDelay(200ms);
+        executor.Start({});
+
+        for (int i = 0; i < CLICKS; i++) {
+            CT_REQUIRE(executor.Post(MakeLayout(i, nRuns, nCancelled)));
+            std::this_thread::sleep_for(usGap);
+        }
+
+        //An action that isn't coalesced is never superseded by the burst
+        Action other;
+        other.nId = OTHER_ID;
+        other.fnRun = [](const ActionContext&) {};
+        CT_REQUIRE(executor.Post(std::move(other)));
+
+        const std::vector<ActionResult> vResults = WaitForResults(executor, CLICKS + 1);
+        CT_REQUIRE_EQ(vResults.size(), static_cast<std::size_t>(CLICKS + 1));
+        CT_CHECK(nRuns.load() <= 2);
+
+        int nSuperseded = 0;
+        int nCancelledResults = 0;
+        int nCompleted = 0;
+        for (const ActionResult& result : vResults) {
+            switch (result.status) {
+            case ActionStatus::Superseded:  nSuperseded++;          break;
+            case ActionStatus::Cancelled:   nCancelledResults++;    break;
+            case ActionStatus::Completed:   nCompleted++;           break;
+            default:                        CT_CHECK(false);        break;
+            }
+        }
+        CT_CHECK_EQ(nSuperseded + nCancelledResults + nCompleted, CLICKS + 1);
+        CT_CHECK(nCancelledResults <= 1);
+        CT_CHECK_EQ(nCancelledResults, nCancelled.load());
+
+        //The last click's intent survives
+        const ActionResult* pLast = FindResult(vResults, CLICKS - 1);
+        CT_REQUIRE(pLast);
+        CT_CHECK(pLast->status == ActionStatus::Completed);
+        const ActionResult* pOther = FindResult(vResults, OTHER_ID);
+        CT_REQUIRE(pOther);
+        CT_CHECK(pOther->status == ActionStatus::Completed);
+    }
+}
+
+CT_TEST(NewerIntentCancelsTheRunningAction)
+{
+    ActionExecutor executor;
+    executor.Start({});
+
+    std::promise<void> started;
+    Action first;
+    first.nId = 1;
+    first.bCoalesce = true;
+    first.fnRun = [&](const ActionContext& context) {
+        started.set_value();
+        while (!context.IsCancelled()) {
+            std::this_thread::sleep_for(1ms);
+        }
+    };
+    CT_REQUIRE(executor.Post(std::move(first)));
+    started.get_future().wait();
+
+    Action second;
+    second.nId = 2;
+    second.bCoalesce = true;
+    second.fnRun = [](const ActionContext&) {};
+    CT_REQUIRE(executor.Post(std::move(second)));
+
+    const std::vector<ActionResult> vResults = WaitForResults(executor, 2);
+    CT_REQUIRE_EQ(vResults.size(), 2u);
+    CT_CHECK_EQ(vResults[0].nId, 1);
+    CT_CHECK(vResults[0].status == ActionStatus::Cancelled);
+    CT_CHECK_EQ(vResults[1].nId, 2);
+    CT_CHECK(vResults[1].status == ActionStatus::Completed);
+}
+
+CT_TEST(CoalescedPostDoesntCancelOtherActions)
+{
+    ActionExecutor executor;
+    executor.Start({});
+
+    std::promise<void> started;
+    std::promise<void> posted;
+    bool bCancelled = true;
+    Action first;
+    first.nId = 1;
+    first.fnRun = [&](const ActionContext& context) {
+        started.set_value();
+        posted.get_future().wait();
+        bCancelled = context.IsCancelled();
+    };
+    CT_REQUIRE(executor.Post(std::move(first)));
+    started.get_future().wait();
+
+    Action second;
+    second.nId = 2;
+    second.bCoalesce = true;
+    CT_REQUIRE(executor.Post(std::move(second)));
+    posted.set_value();
+
+    const std::vector<ActionResult> vResults = WaitForResults(executor, 2);
+    CT_REQUIRE_EQ(vResults.size(), 2u);
+    CT_CHECK(vResults[0].status == ActionStatus::Completed);
+    CT_CHECK(vResults[1].status == ActionStatus::Completed);
+    CT_CHECK(!bCancelled);
+}
+
+CT_TEST(BurstIsHeldUntilTheDelayPassed)
+{
+    std::atomic<int> nRuns = 0;
+    std::atomic<int> nCancelled = 0;
+    ActionExecutor executor;
+    executor.SetCoalesceDelay(100ms);
+    executor.Start({});
+
+    CT_REQUIRE(executor.Post(MakeLayout(1, nRuns, nCancelled)));
+    CT_REQUIRE(executor.Post(MakeLayout(2, nRuns, nCancelled)));
+
+    const std::vector<ActionResult> vResults = WaitForResults(executor, 2);
+    CT_REQUIRE_EQ(vResults.size(), 2u);
+    const ActionResult* pSecond = FindResult(vResults, 2);
+    CT_REQUIRE(pSecond);
+    CT_CHECK(pSecond->status == ActionStatus::Completed);
+    CT_CHECK(pSecond->usQueued >= 100ms);
+}
+
+CT_TEST(ClicksFurtherApartThanTheDelayRunRightAway)
+{
+    std::atomic<int> nRuns = 0;
+    std::atomic<int> nCancelled = 0;
+    ActionExecutor executor;
+    executor.SetCoalesceDelay(50ms);
+    executor.Start({});
+
+    for (int i = 0; i < 3; i++) {
+        CT_REQUIRE(executor.Post(MakeLayout(i, nRuns, nCancelled)));
+        const std::vector<ActionResult> vResults = WaitForResults(executor, 1);
+        CT_REQUIRE_EQ(vResults.size(), 1u);
+        CT_CHECK(vResults[0].status == ActionStatus::Completed);
+        CT_CHECK(vResults[0].usQueued < 50ms);
+        std::this_thread::sleep_for(80ms);
+    }
+    CT_CHECK_EQ(nRuns.load(), 3);
+    CT_CHECK_EQ(nCancelled.load(), 0);
+}
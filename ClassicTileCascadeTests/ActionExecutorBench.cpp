@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Cost of handing an action to the executor: the round trip from Post to the
+// result notification for a single action (what a menu click waits for before
+// the action starts), and the throughput of a queue of empty actions. Then bursts of
+// coalesced clicks: how many layouts a burst runs and how long until the last one is
+// done, with the double-click time as the coalesce delay (100 ms, 500 ms with --full)
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "CTBench.h"
+#include "ActionExecutor.h"
+
+using namespace CTAction;
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    const std::size_t nActions = bFull ? 100000 : 10000;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::size_t nNotified = 0;
+
+    ActionExecutor executor;
+    executor.Start([&] {
+        {
+            std::lock_guard lock(mutex);
+            nNotified++;
+        }
+        cv.notify_one();
+    });
+
+    auto WaitForNotified = [&](std::size_t nCount) {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [&] { return nNotified >= nCount; });
+    };
+
+    //Actions posted so far, which is what nNotified reaches once they all ran
+    std::size_t nPosted = 0;
+    std::vector<ActionResult> vResults;
+    auto MakeAction = [] {
+        Action action;
+        action.fnRun = [](const ActionContext&) {};
+        return action;
+    };
+
+    const std::size_t nRoundTrips = nActions / 10;
+    const double dRoundTripNs = CTBench::NsPerOp(nRoundTrips, [&] {
+        for (std::size_t i = 0; i < nRoundTrips; i++) {
+            executor.Post(MakeAction());
+            WaitForNotified(++nPosted);
+        }
+        vResults.clear();
+        executor.TakeResults(vResults);
+    });
+    CTBench::Report("executor.roundtrip", dRoundTripNs / 1000.0, "us/action");
+
+    const double dQueuedNs = CTBench::NsPerOp(nActions, [&] {
+        for (std::size_t i = 0; i < nActions; i++) {
+            executor.Post(MakeAction());
+        }
+        nPosted += nActions;
+        WaitForNotified(nPosted);
+        vResults.clear();
+        executor.TakeResults(vResults);
+    });
+    CTBench::Report("executor.queued", dQueuedNs / 1000.0, "us/action");
+    executor.Stop();
+
+    const std::chrono::milliseconds coalesceDelay(bFull ? 500 : 100);
+    for (int nClicks : { 1, 2, 3, 10, 100 }) {
+        ActionExecutor burstExecutor;
+        burstExecutor.SetCoalesceDelay(coalesceDelay);
+        burstExecutor.Start({});
+
+        //A layout of about 20 ms that stops at its next window once cancelled
+        std::atomic<int> nRuns = 0;
+        const Clock::time_point tpStart = Clock::now();
+        for (int i = 0; i < nClicks; i++) {
+            Action action;
+            action.bCoalesce = true;
+            action.fnRun = [&nRuns](const ActionContext& context) {
+                nRuns++;
+                for (int j = 0; (j < 20) && !context.IsCancelled(); j++) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+            };
+            burstExecutor.Post(std::move(action));
+        }
+
+        std::vector<ActionResult> vBurst;
+        while (vBurst.size() < static_cast<std::size_t>(nClicks)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            burstExecutor.TakeResults(vBurst);
+        }
+        const std::chrono::duration<double, std::milli> msSettled = Clock::now() - tpStart;
+
+        const std::string szName = "executor.burst." + std::to_string(nClicks);
+        const std::string szRuns = std::to_string(nRuns.load()) + " runs";
+        CTBench::Report(szName.c_str(), msSettled.count(), "ms", szRuns.c_str());
+    }
+    return 0;
+}
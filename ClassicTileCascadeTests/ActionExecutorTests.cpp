@@ -0,0 +1,238 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "CTTest.h"
+#include "ActionExecutor.h"
+
+using namespace CTAction;
+using namespace std::chrono_literals;
+
+namespace
+{
+    // Take results from executor until there are nCount, for up to 5 seconds
+    std::vector<ActionResult> WaitForResults(ActionExecutor& executor, std::size_t nCount)
+    {
+        std::vector<ActionResult> vResults;
+        const Clock::time_point tpEnd = Clock::now() + 5s;
+        while ((vResults.size() < nCount) && (Clock::now() < tpEnd)) {
+            executor.TakeResults(vResults);
+            std::this_thread::sleep_for(1ms);
+        }
+        return vResults;
+    }
+
+    // Holds an action until Open is called, and tells when the action got there
+    class Gate
+    {
+    public:
+        void Pass()
+        {
+            m_entered.set_value();
+            m_open.get_future().wait();
+        }
+
+        void WaitUntilEntered() { m_entered.get_future().wait(); }
+        void Open() { m_open.set_value(); }
+
+    protected:
+        std::promise<void> m_entered;
+        std::promise<void> m_open;
+    };
+
+    Action MakeAction(int nId, std::function<void(const ActionContext&)> fnRun, std::chrono::milliseconds timeout = 5000ms)
+    {
+        Action action;
+        action.nId = nId;
+        action.fnRun = std::move(fnRun);
+        action.timeout = timeout;
+        return action;
+    }
+}
+
+CT_TEST(PostFailsUnlessTheExecutorRuns)
+{
+    ActionExecutor executor;
+    CT_CHECK(!executor.IsRunning());
+    CT_CHECK(!executor.Post(MakeAction(1, {})));
+
+    executor.Start({});
+    CT_CHECK(executor.IsRunning());
+    CT_CHECK(executor.Post(MakeAction(1, {})));
+
+    executor.Stop();
+    CT_CHECK(!executor.IsRunning());
+    CT_CHECK(!executor.Post(MakeAction(2, {})));
+}
+
+CT_TEST(ActionsRunInPostedOrderOffThePostingThread)
+{
+    const std::thread::id idTest = std::this_thread::get_id();
+    std::atomic<int> nNotified = 0;
+    std::atomic<bool> bNotifiedOnTestThread = false;
+
+    ActionExecutor executor;
+    executor.Start([&] {
+        if (std::this_thread::get_id() == idTest) {
+            bNotifiedOnTestThread = true;
+        }
+        nNotified++;
+    });
+
+    std::vector<int> vOrder;
+    std::atomic<bool> bRanOnTestThread = false;
+    for (int i = 0; i < 20; i++) {
+        CT_REQUIRE(executor.Post(MakeAction(i, [&, i](const ActionContext&) {
+            if (std::this_thread::get_id() == idTest) {
+                bRanOnTestThread = true;
+            }
+            vOrder.push_back(i);
+        })));
+    }
+
+    const std::vector<ActionResult> vResults = WaitForResults(executor, 20);
+    CT_REQUIRE_EQ(vResults.size(), 20u);
+    for (int i = 0; i < 20; i++) {
+        CT_CHECK_EQ(vResults[i].nId, i);
+        CT_CHECK(vResults[i].status == ActionStatus::Completed);
+        CT_CHECK_EQ(vOrder[i], i);
+    }
+    CT_CHECK_EQ(nNotified.load(), 20);
+    CT_CHECK(!bRanOnTestThread);
+    CT_CHECK(!bNotifiedOnTestThread);
+}
+
+CT_TEST(ActionsQueuedPastTheirTimeoutDontRun)
+{
+    ActionExecutor executor;
+    executor.Start({});
+
+    Gate gate;
+    std::atomic<bool> bRan = false;
+    CT_REQUIRE(executor.Post(MakeAction(1, [&](const ActionContext&) { gate.Pass(); })));
+    gate.WaitUntilEntered();
+    CT_REQUIRE(executor.Post(MakeAction(2, [&](const ActionContext&) { bRan = true; }, 10ms)));
+    CT_CHECK_EQ(executor.Pending(), 1u);
+
+    std::this_thread::sleep_for(30ms);
+    gate.Open();
+
+    const std::vector<ActionResult> vResults = WaitForResults(executor, 2);
+    CT_REQUIRE_EQ(vResults.size(), 2u);
+    CT_CHECK(vResults[0].status == ActionStatus::Completed);
+    CT_CHECK(vResults[1].status == ActionStatus::Expired);
+    CT_CHECK(vResults[1].usQueued >= 30ms);
+    CT_CHECK(vResults[1].usRun == 0us);
+    CT_CHECK(!bRan);
+}
+
+CT_TEST(ActionsRunningPastTheirTimeoutTimeOut)
+{
+    ActionExecutor executor;
+    executor.Start({});
+
+    bool bWasPastDeadline = true;
+    CT_REQUIRE(executor.Post(MakeAction(1, [&](const ActionContext& context) {
+        bWasPastDeadline = context.IsPastDeadline();
+        while (!context.IsPastDeadline()) {
+            std::this_thread::sleep_for(1ms);
+        }
+        std::this_thread::sleep_for(1ms);
+    }, 20ms)));
+
+    const std::vector<ActionResult> vResults = WaitForResults(executor, 1);
+    CT_REQUIRE_EQ(vResults.size(), 1u);
+    CT_CHECK(vResults[0].status == ActionStatus::TimedOut);
+    CT_CHECK(vResults[0].usQueued + vResults[0].usRun >= 20ms);
+    CT_CHECK(!bWasPastDeadline);
+}
+
+CT_TEST(AFailingActionDoesntStopTheExecutor)
+{
+    ActionExecutor executor;
+    executor.Start({});
+
+    CT_REQUIRE(executor.Post(MakeAction(1, [](const ActionContext&) { throw std::runtime_error("failed"); })));
+    CT_REQUIRE(executor.Post(MakeAction(2, [](const ActionContext&) {})));
+
+    const std::vector<ActionResult> vResults = WaitForResults(executor, 2);
+    CT_REQUIRE_EQ(vResults.size(), 2u);
+    CT_CHECK(vResults[0].status == ActionStatus::Failed);
+    CT_CHECK(vResults[1].status == ActionStatus::Completed);
+}
+
+CT_TEST(StopCancelsTheRunningActionAndDropsTheQueue)
+{
+    ActionExecutor executor;
+    executor.Start({});
+
+    std::promise<void> started;
+    CT_REQUIRE(executor.Post(MakeAction(1, [&](const ActionContext& context) {
+        started.set_value();
+        while (!context.IsCancelled()) {
+            std::this_thread::sleep_for(1ms);
+        }
+    })));
+    std::atomic<bool> bRan = false;
+    CT_REQUIRE(executor.Post(MakeAction(2, [&](const ActionContext&) { bRan = true; })));
+    started.get_future().wait();
+
+    executor.Stop();
+
+    //Results of a stopped executor stay available
+    std::vector<ActionResult> vResults;
+    executor.TakeResults(vResults);
+    CT_REQUIRE_EQ(vResults.size(), 2u);
+    CT_CHECK(vResults[0].status == ActionStatus::Cancelled);
+    CT_CHECK(vResults[1].status == ActionStatus::Dropped);
+    CT_CHECK(!bRan);
+
+    //And it can be started again
+    executor.Start({});
+    CT_REQUIRE(executor.Post(MakeAction(3, {})));
+    vResults = WaitForResults(executor, 1);
+    CT_REQUIRE_EQ(vResults.size(), 1u);
+    CT_CHECK(vResults[0].status == ActionStatus::Completed);
+}
+
+CT_TEST(QueuedTimeIsMeasuredFromThePost)
+{
+    ActionExecutor executor;
+    executor.Start({});
+
+    Gate gate;
+    CT_REQUIRE(executor.Post(MakeAction(1, [&](const ActionContext&) { gate.Pass(); })));
+    CT_REQUIRE(executor.Post(MakeAction(2, {})));
+    gate.WaitUntilEntered();
+    std::this_thread::sleep_for(20ms);
+    gate.Open();
+
+    const std::vector<ActionResult> vResults = WaitForResults(executor, 2);
+    CT_REQUIRE_EQ(vResults.size(), 2u);
+    CT_CHECK(vResults[0].usRun >= 20ms);
+    CT_CHECK(vResults[1].usQueued >= 20ms);
+}
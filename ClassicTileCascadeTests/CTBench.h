@@ -0,0 +1,72 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `CTTest.cpp` for details.
+ */
+#pragma once
+
+// Helpers for the benchmarks. A benchmark runs with small sizes by default so that
+// ctest stays fast, and with the sizes it was written for when given --full.
+// Results are printed one per line as "name: value unit (details)".
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+namespace CTBench
+{
+	using Clock = std::chrono::steady_clock;
+
+	inline bool IsFull(int argc, char* argv[])
+	{
+		for (int i = 1; i < argc; i++) {
+			if (std::strcmp(argv[i], "--full") == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Keep the compiler from optimizing value (and the work that produced it) away
+	template <typename T>
+	inline void DoNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* s_pSink;
+		s_pSink = &value;
+#endif
+	}
+
+	// Best of nRepeats runs of fn, which performs nOps operations per run, in nanoseconds per operation
+	template <typename Fn>
+	double NsPerOp(std::size_t nOps, Fn&& fn, int nRepeats = 3)
+	{
+		double dBest = std::numeric_limits<double>::max();
+		for (int i = 0; i < nRepeats; i++) {
+			const Clock::time_point tpStart = Clock::now();
+			fn();
+			const std::chrono::duration<double, std::nano> dur = Clock::now() - tpStart;
+			dBest = std::min(dBest, dur.count() / static_cast<double>(std::max<std::size_t>(nOps, 1)));
+		}
+		return dBest;
+	}
+
+	inline void Report(const char* szName, double dValue, const char* szUnit, const char* szDetails = "")
+	{
+		std::printf("%s: %.1f %s%s%s%s\n", szName, dValue, szUnit, *szDetails ? " (" : "", szDetails, *szDetails ? ")" : "");
+		std::fflush(stdout);
+	}
+
+	// Same, with the cost per item (e.g. per window) as the details
+	inline void Report(const char* szName, double dValue, const char* szUnit, double dPerItem, const char* szPerItemUnit)
+	{
+		char szDetails[64];
+		std::snprintf(szDetails, sizeof(szDetails), "%.2f %s", dPerItem, szPerItemUnit);
+		Report(szName, dValue, szUnit, szDetails);
+	}
+}
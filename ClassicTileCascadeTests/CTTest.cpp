@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <vector>
+#include "CTTest.h"
+
+namespace
+{
+    struct TestCase
+    {
+        const char* szName;
+        CTTest::TestFn fn;
+    };
+
+    std::vector<TestCase>& Tests()
+    {
+        static std::vector<TestCase> vTests;
+        return vTests;
+    }
+
+    std::size_t s_nFailures = 0;
+}
+
+CTTest::Registrar::Registrar(const char* szName, TestFn fn)
+{
+    Tests().push_back({ szName, fn });
+}
+
+void CTTest::Fail(const char* szFile, int nLine, const std::string& szWhat)
+{
+    s_nFailures++;
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", szFile, nLine, szWhat.c_str());
+}
+
+std::string CTTest::TempPath(const std::string& szName)
+{
+    return "ct_" + szName;
+}
+
+int CTTest::RunAll(int argc, char* argv[])
+{
+    std::size_t nRun = 0, nFailed = 0;
+    for (const TestCase& test : Tests()) {
+        bool bSelected = (argc < 2);
+        for (int i = 1; i < argc && !bSelected; i++) {
+            bSelected = (std::strcmp(argv[i], test.szName) == 0);
+        }
+        if (!bSelected) {
+            continue;
+        }
+
+        const std::size_t nFailuresBefore = s_nFailures;
+        try {
+            test.fn();
+        } catch (const RequireFailed&) {
+        } catch (const std::exception& e) {
+            Fail(test.szName, 0, std::string("unexpected exception: ") + e.what());
+        }
+
+        nRun++;
+        const bool bPassed = (s_nFailures == nFailuresBefore);
+        if (!bPassed) {
+            nFailed++;
+        }
+        std::printf("[%s] %s\n", bPassed ? "  OK  " : " FAIL ", test.szName);
+    }
+
+    std::printf("%zu test(s), %zu failed\n", nRun, nFailed);
+    return ((nFailed > 0) || (nRun == 0)) ? 1 : 0;
+}
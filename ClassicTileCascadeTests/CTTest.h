@@ -0,0 +1,83 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `CTTest.cpp` for details.
+ */
+#pragma once
+
+// Minimal test harness for the OS-independent components. A test is a function
+// declared with CT_TEST(Name); CTTestMain.cpp runs all tests of the executable (or
+// the ones named on the command line) and returns non-zero if any check failed.
+// CT_CHECK* record a failure and let the test go on, CT_REQUIRE* end the test.
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <type_traits>
+
+namespace CTTest
+{
+	using TestFn = void(*)();
+
+	// Adds a test to the list run by RunAll. Used by CT_TEST
+	class Registrar
+	{
+	public:
+		Registrar(const char* szName, TestFn fn);
+	};
+
+	// Thrown by CT_REQUIRE* to end the current test
+	struct RequireFailed {};
+
+	void Fail(const char* szFile, int nLine, const std::string& szWhat);
+
+	// Run the tests named in argv[1...] or, without arguments, all tests.
+	// Returns the exit code of the test executable
+	int RunAll(int argc, char* argv[]);
+
+	// Directory for files written by tests (the working directory ctest runs in)
+	std::string TempPath(const std::string& szName);
+
+	template <typename T>
+	std::string Describe(const T& value)
+	{
+		std::ostringstream os;
+		if constexpr (std::is_enum_v<T>) {
+			os << static_cast<std::int64_t>(value);
+		} else if constexpr (std::is_same_v<T, bool>) {
+			os << (value ? "true" : "false");
+		} else if constexpr (requires { os << value; }) {
+			os << value;
+		} else {
+			os << "?";
+		}
+		return os.str();
+	}
+
+	template <typename A, typename B>
+	bool CheckEqual(const A& a, const B& b, const char* szA, const char* szB, const char* szFile, int nLine)
+	{
+		if (a == b) {
+			return true;
+		}
+		Fail(szFile, nLine, std::string(szA) + " == " + szB + " (" + Describe(a) + " vs " + Describe(b) + ")");
+		return false;
+	}
+}
+
+#define CT_TEST(name) \
+	static void name(); \
+	static const CTTest::Registrar ctTestRegistrar_##name(#name, name); \
+	static void name()
+
+#define CT_CHECK(expr) \
+	do { if (!(expr)) CTTest::Fail(__FILE__, __LINE__, #expr); } while (0)
+
+#define CT_CHECK_EQ(a, b) \
+	do { CTTest::CheckEqual((a), (b), #a, #b, __FILE__, __LINE__); } while (0)
+
+#define CT_REQUIRE(expr) \
+	do { if (!(expr)) { CTTest::Fail(__FILE__, __LINE__, #expr); throw CTTest::RequireFailed(); } } while (0)
+
+#define CT_REQUIRE_EQ(a, b) \
+	do { if (!CTTest::CheckEqual((a), (b), #a, #b, __FILE__, __LINE__)) throw CTTest::RequireFailed(); } while (0)
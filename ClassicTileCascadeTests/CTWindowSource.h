@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2023 thf
+ *
+ * This library is free software; you can redistribute it and/or modify it
+ * under the terms of the MIT license. See `CTTest.cpp` for details.
+ */
+#pragma once
+
+// IDocumentSource that serves a string in small windows, each in a fresh
+// allocation, so that code reading through windows is exercised across window
+// boundaries and a view kept past the next call to View is caught by ASan
+#include <algorithm>
+#include <memory>
+#include <string>
+#include "LogDocument.h"
+
+namespace CTTest
+{
+	class WindowSource : public CTLogView::IDocumentSource
+	{
+	public:
+		WindowSource(std::string szText, std::size_t nWindow) : m_szText(std::move(szText)), m_nWindow(nWindow) {}
+		virtual ~WindowSource() = default;
+		WindowSource(const WindowSource&) = delete;
+		WindowSource(WindowSource&&) noexcept = delete;
+		WindowSource& operator=(const WindowSource&) = delete;
+		WindowSource& operator=(WindowSource&&) noexcept = delete;
+
+		std::size_t Size() const override { return m_szText.size(); }
+
+		std::string_view View(std::size_t nOffset, std::size_t nMinSize) override
+		{
+			const std::size_t nSize = std::min(std::max(nMinSize, m_nWindow), m_szText.size() - nOffset);
+			m_spWindow = std::make_unique<char[]>(nSize + 1);
+			std::copy_n(m_szText.data() + nOffset, nSize, m_spWindow.get());
+			m_nViews++;
+			m_nLargestView = std::max(m_nLargestView, nSize);
+			return std::string_view(m_spWindow.get(), nSize);
+		}
+
+		const std::string& Text() const { return m_szText; }
+		std::size_t Views() const { return m_nViews; }
+		std::size_t LargestView() const { return m_nLargestView; }
+
+	protected:
+		std::string m_szText;
+		std::size_t m_nWindow = 0;
+		std::unique_ptr<char[]> m_spWindow;
+		std::size_t m_nViews = 0;
+		std::size_t m_nLargestView = 0;
+	};
+}
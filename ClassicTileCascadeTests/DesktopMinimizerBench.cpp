@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Bookkeeping cost of Show Desktop and Undo Minimize per window, against a backend
+// that only answers queries: what DesktopMinimizer adds to the window manager calls
+#include <string>
+#include <vector>
+#include "CTBench.h"
+#include "DesktopMinimizer.h"
+
+using namespace CTLayout;
+using namespace CTPlacement;
+
+namespace
+{
+    class NullBackend : public IMinimizeBackend
+    {
+    public:
+        bool QueryWindow(WindowId id, WindowShowState& state) override
+        {
+            state.bMinimized = bMinimized;
+            state.bMaximized = (id % 5 == 0);
+            return true;
+        }
+
+        std::size_t MinimizeWindows(const MinimizeRecordVector& vRecords, bool) override
+        {
+            return vRecords.size();
+        }
+
+        std::size_t RestoreWindows(const MinimizeRecordVector& vRecords, bool) override
+        {
+            return vRecords.size();
+        }
+
+        bool bMinimized = false;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    const std::size_t nRepeats = bFull ? 1000 : 100;
+
+    for (std::size_t nCount : { 10, 100, 1000 }) {
+        std::vector<WindowId> vWindows(nCount);
+        for (std::size_t i = 0; i < nCount; i++) {
+            vWindows[i] = i + 1;
+        }
+
+        NullBackend backend;
+        DesktopMinimizer minimizer(backend);
+        std::size_t nRestored = 0;
+        const double dNs = CTBench::NsPerOp(nCount * nRepeats, [&] {
+            for (std::size_t i = 0; i < nRepeats; i++) {
+                backend.bMinimized = false;
+                minimizer.MinimizeAll(vWindows);
+                backend.bMinimized = true;
+                nRestored += minimizer.RestoreAll();
+            }
+        });
+        CTBench::DoNotOptimize(nRestored);
+
+        const std::string szName = "minimizer.roundtrip." + std::to_string(nCount);
+        CTBench::Report(szName.c_str(), dNs, "ns/window");
+    }
+
+    //A second Show Desktop merges the new windows into the record
+    for (std::size_t nCount : { 10, 100, 1000 }) {
+        std::vector<WindowId> vWindows(nCount);
+        for (std::size_t i = 0; i < nCount; i++) {
+            vWindows[i] = i + 1;
+        }
+
+        NullBackend backend;
+        DesktopMinimizer minimizer(backend);
+        const double dNs = CTBench::NsPerOp(nCount * nRepeats, [&] {
+            for (std::size_t i = 0; i < nRepeats; i++) {
+                minimizer.Clear();
+                minimizer.MinimizeAll(vWindows);
+                minimizer.MinimizeAll(vWindows);
+            }
+        });
+
+        const std::string szName = "minimizer.merge." + std::to_string(nCount);
+        CTBench::Report(szName.c_str(), dNs, "ns/window");
+    }
+    return 0;
+}
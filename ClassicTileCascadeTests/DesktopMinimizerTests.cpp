@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <map>
+#include <vector>
+#include "CTTest.h"
+#include "DesktopMinimizer.h"
+
+using namespace CTLayout;
+using namespace CTPlacement;
+
+namespace
+{
+    // Fake window manager with a z-order (topmost first). Restoring stacks the restored
+    // windows on top in the order given, as the Win32 backend does
+    class FakeBackend : public IMinimizeBackend
+    {
+    public:
+        struct Window
+        {
+            bool bMinimized = false;
+            bool bMaximized = false;
+            LayoutRect rNormal;
+        };
+
+        void AddWindow(WindowId id, bool bMaximized = false)
+        {
+            const long n = static_cast<long>(id);
+            mapWindows[id] = { false, bMaximized, { n * 10, n * 10, n * 10 + 400, n * 10 + 300 } };
+            vZOrder.push_back(id);
+        }
+
+        bool QueryWindow(WindowId id, WindowShowState& state) override
+        {
+            auto it = mapWindows.find(id);
+            if (it == mapWindows.end()) {
+                return false;
+            }
+            state.bMinimized = it->second.bMinimized;
+            state.bMaximized = it->second.bMaximized;
+            state.rNormal = it->second.rNormal;
+            return true;
+        }
+
+        std::size_t MinimizeWindows(const MinimizeRecordVector& vRecords, bool bAnimate) override
+        {
+            nMinimizeCalls++;
+            bLastAnimate = bAnimate;
+            for (const MinimizeRecord& record : vRecords) {
+                mapWindows[record.id].bMinimized = true;
+            }
+            return vRecords.size();
+        }
+
+        std::size_t RestoreWindows(const MinimizeRecordVector& vRecords, bool bAnimate) override
+        {
+            nRestoreCalls++;
+            bLastAnimate = bAnimate;
+
+            std::vector<WindowId> vNewZOrder;
+            for (const MinimizeRecord& record : vRecords) {
+                Window& window = mapWindows[record.id];
+                window.bMinimized = false;
+                window.bMaximized = record.bMaximized;
+                window.rNormal = record.rNormal;
+                vNewZOrder.push_back(record.id);
+            }
+            for (WindowId id : vZOrder) {
+                if (std::ranges::find(vNewZOrder, id) == vNewZOrder.end()) {
+                    vNewZOrder.push_back(id);
+                }
+            }
+            vZOrder = std::move(vNewZOrder);
+            return vRecords.size();
+        }
+
+        std::map<WindowId, Window> mapWindows;
+        std::vector<WindowId> vZOrder;
+        int nMinimizeCalls = 0;
+        int nRestoreCalls = 0;
+        bool bLastAnimate = true;
+    };
+
+    std::vector<WindowId> RecordIds(const DesktopMinimizer& minimizer)
+    {
+        std::vector<WindowId> vIds;
+        for (const MinimizeRecord& record : minimizer.Records()) {
+            vIds.push_back(record.id);
+        }
+        return vIds;
+    }
+}
+
+CT_TEST(RestoreAllIsOneBatchInTheRecordedOrder)
+{
+    FakeBackend backend;
+    for (WindowId id : { 3, 1, 2, 4 }) {
+        backend.AddWindow(id, id == 2);
+    }
+    const std::map<WindowId, FakeBackend::Window> mapBefore = backend.mapWindows;
+
+    DesktopMinimizer minimizer(backend);
+    CT_CHECK_EQ(minimizer.MinimizeAll({ 3, 1, 2, 4 }), 4u);
+    CT_CHECK(minimizer.GetState() == DesktopMinimizer::State::Minimized);
+
+    //Something else is activated while the desktop is shown
+    backend.vZOrder = { 4, 2, 1, 3 };
+
+    CT_CHECK_EQ(minimizer.RestoreAll(), 4u);
+    CT_CHECK_EQ(backend.nRestoreCalls, 1);
+    CT_CHECK(backend.vZOrder == std::vector<WindowId>({ 3, 1, 2, 4 }));
+    for (const auto& [id, window] : backend.mapWindows) {
+        CT_CHECK(!window.bMinimized);
+        CT_CHECK_EQ(window.bMaximized, mapBefore.at(id).bMaximized);
+        CT_CHECK(window.rNormal == mapBefore.at(id).rNormal);
+    }
+    CT_CHECK(minimizer.GetState() == DesktopMinimizer::State::Idle);
+}
+
+CT_TEST(MinimizedWindowsArentRecorded)
+{
+    FakeBackend backend;
+    for (WindowId id : { 1, 2, 3 }) {
+        backend.AddWindow(id);
+    }
+    backend.mapWindows[2].bMinimized = true;
+
+    DesktopMinimizer minimizer(backend);
+    CT_CHECK_EQ(minimizer.MinimizeAll({ 1, 2, 3 }), 2u);
+    CT_CHECK(RecordIds(minimizer) == std::vector<WindowId>({ 1, 3 }));
+
+    //Undo leaves the window that was minimized before alone
+    CT_CHECK_EQ(minimizer.RestoreAll(), 2u);
+    CT_CHECK(backend.mapWindows[2].bMinimized);
+}
+
+CT_TEST(WindowsClosedOrRestoredByHandAreLeftAlone)
+{
+    FakeBackend backend;
+    for (WindowId id : { 1, 2, 3, 4 }) {
+        backend.AddWindow(id);
+    }
+
+    DesktopMinimizer minimizer(backend);
+    minimizer.MinimizeAll({ 1, 2, 3, 4 });
+
+    //2 is closed, 3 is restored and moved by hand
+    backend.mapWindows.erase(2);
+    backend.mapWindows[3].bMinimized = false;
+    backend.mapWindows[3].rNormal = { 0, 0, 100, 100 };
+
+    CT_CHECK_EQ(minimizer.RestoreAll(), 2u);
+    CT_CHECK(backend.mapWindows[3].rNormal == LayoutRect({ 0, 0, 100, 100 }));
+    CT_CHECK(!backend.mapWindows.contains(2));
+    CT_CHECK_EQ(backend.vZOrder[0], 1u);
+    CT_CHECK_EQ(backend.vZOrder[1], 4u);
+}
+
+CT_TEST(ShowingTheDesktopAgainAddsTheNewWindowsOnTop)
+{
+    FakeBackend backend;
+    for (WindowId id : { 1, 2, 3 }) {
+        backend.AddWindow(id);
+    }
+
+    DesktopMinimizer minimizer(backend);
+    minimizer.MinimizeAll({ 1, 2, 3 });
+
+    //4 is opened and 2 restored by hand before the desktop is shown again
+    backend.AddWindow(4);
+    backend.mapWindows[2].bMinimized = false;
+    CT_CHECK_EQ(minimizer.MinimizeAll({ 4, 2, 1, 3 }), 2u);
+    CT_CHECK(RecordIds(minimizer) == std::vector<WindowId>({ 4, 2, 1, 3 }));
+    CT_CHECK_EQ(backend.nMinimizeCalls, 2);
+
+    CT_CHECK_EQ(minimizer.RestoreAll(), 4u);
+    CT_CHECK_EQ(backend.nRestoreCalls, 1);
+    CT_CHECK(std::ranges::equal(std::vector<WindowId>(backend.vZOrder.begin(), backend.vZOrder.begin() + 4), std::vector<WindowId>({ 4, 2, 1, 3 })));
+}
+
+CT_TEST(NothingToDoDoesntCallTheBackend)
+{
+    FakeBackend backend;
+    backend.AddWindow(1);
+    backend.mapWindows[1].bMinimized = true;
+
+    DesktopMinimizer minimizer(backend);
+    CT_CHECK_EQ(minimizer.RestoreAll(), 0u);
+    CT_CHECK_EQ(minimizer.MinimizeAll({}), 0u);
+    CT_CHECK_EQ(minimizer.MinimizeAll({ 1 }), 0u);
+    CT_CHECK(minimizer.GetState() == DesktopMinimizer::State::Idle);
+    CT_CHECK_EQ(backend.nMinimizeCalls, 0);
+    CT_CHECK_EQ(backend.nRestoreCalls, 0);
+
+    //Every recorded window was restored by hand
+    backend.AddWindow(2);
+    minimizer.MinimizeAll({ 2 });
+    backend.mapWindows[2].bMinimized = false;
+    CT_CHECK_EQ(minimizer.RestoreAll(), 0u);
+    CT_CHECK_EQ(backend.nRestoreCalls, 0);
+    CT_CHECK(minimizer.GetState() == DesktopMinimizer::State::Idle);
+}
+
+CT_TEST(ClearForgetsTheRecord)
+{
+    FakeBackend backend;
+    backend.AddWindow(1);
+
+    DesktopMinimizer minimizer(backend);
+    minimizer.MinimizeAll({ 1 });
+    minimizer.Clear();
+    CT_CHECK(minimizer.GetState() == DesktopMinimizer::State::Idle);
+    CT_CHECK_EQ(minimizer.RestoreAll(), 0u);
+    CT_CHECK(backend.mapWindows[1].bMinimized);
+}
+
+CT_TEST(AnimateIsPassedToTheBackend)
+{
+    FakeBackend backend;
+    backend.AddWindow(1);
+
+    DesktopMinimizer minimizer(backend);
+    minimizer.MinimizeAll({ 1 });
+    CT_CHECK(backend.bLastAnimate);
+
+    minimizer.SetAnimate(false);
+    minimizer.RestoreAll();
+    CT_CHECK(!backend.bLastAnimate);
+}
+
+CT_TEST(TopmostRestoredWindowIsReportedForActivation)
+{
+    FakeBackend backend;
+    for (WindowId id : { 1, 2, 3 }) {
+        backend.AddWindow(id);
+    }
+
+    DesktopMinimizer minimizer(backend);
+    WindowId idTopmost = 99;
+    CT_CHECK_EQ(minimizer.RestoreAll(&idTopmost), 0u);
+    CT_CHECK_EQ(idTopmost, 0u);
+
+    //The topmost recorded window is closed, so the next one is activated
+    minimizer.MinimizeAll({ 1, 2, 3 });
+    backend.mapWindows.erase(1);
+    CT_CHECK_EQ(minimizer.RestoreAll(&idTopmost), 2u);
+    CT_CHECK_EQ(idTopmost, 2u);
+}
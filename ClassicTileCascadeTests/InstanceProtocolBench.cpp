@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Cost of handing a command line to the running instance, without the message
+// itself: encoding on the sender, and decoding and parsing on the receiver
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CTBench.h"
+#include "InstanceProtocol.h"
+
+using namespace CTInstance;
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    const std::size_t nRuns = bFull ? 1000000 : 100000;
+
+    const ArgVector vCommand = { u"/SHOWDESKTOP" };
+    std::vector<std::uint8_t> vPayload;
+    const double dEncodeNs = CTBench::NsPerOp(nRuns, [&] {
+        for (std::size_t i = 0; i < nRuns; i++) {
+            EncodeArgs(vCommand, vPayload);
+            CTBench::DoNotOptimize(vPayload);
+        }
+    });
+    CTBench::Report("instance.encode", dEncodeNs, "ns/message");
+
+    ArgVector vArgs;
+    std::size_t nHandled = 0;
+    const double dReceiveNs = CTBench::NsPerOp(nRuns, [&] {
+        for (std::size_t i = 0; i < nRuns; i++) {
+            if (DecodeArgs(vPayload.data(), vPayload.size(), vArgs) && (ReplyFor(ParseCommand(vArgs)) == Reply::Handled)) {
+                nHandled++;
+            }
+        }
+    });
+    CTBench::DoNotOptimize(nHandled);
+    CTBench::Report("instance.receive", dReceiveNs, "ns/message");
+
+    //The largest payload the receiver accepts, which bounds what a hostile sender can cost it
+    const ArgVector vLargest(MAX_ARGS, std::u16string(MAX_ARG_CHARS, u'a'));
+    EncodeArgs(vLargest, vPayload);
+    const std::size_t nLargeRuns = nRuns / 1000;
+    const double dLargestNs = CTBench::NsPerOp(nLargeRuns, [&] {
+        for (std::size_t i = 0; i < nLargeRuns; i++) {
+            DecodeArgs(vPayload.data(), vPayload.size(), vArgs);
+            CTBench::DoNotOptimize(vArgs);
+        }
+    });
+    const std::string szDetails = std::to_string(vPayload.size()) + " bytes";
+    CTBench::Report("instance.receive.largest", dLargestNs, "ns/message", szDetails.c_str());
+    return 0;
+}
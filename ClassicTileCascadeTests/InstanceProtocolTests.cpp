@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "CTTest.h"
+#include "InstanceProtocol.h"
+
+using namespace CTInstance;
+
+namespace
+{
+    // What ClassicTileWnd::OnCopyData answers to a message tagged nTag
+    Reply Receive(std::uint32_t nTag, const std::vector<std::uint8_t>& vPayload, Command& command)
+    {
+        ArgVector vArgs;
+        if ((nTag != COMMAND_TAG) || !DecodeArgs(vPayload.data(), vPayload.size(), vArgs)) {
+            return Reply::Rejected;
+        }
+        command = ParseCommand(vArgs);
+        return ReplyFor(command);
+    }
+}
+
+CT_TEST(ArgumentsSurviveTheRoundTrip)
+{
+    const ArgVector vIn = { u"/UndoMinimize", u"C:\\p\u00e4th \u4e2d", u"" };
+    std::vector<std::uint8_t> vPayload;
+    CT_REQUIRE(EncodeArgs(vIn, vPayload));
+
+    ArgVector vOut;
+    CT_REQUIRE(DecodeArgs(vPayload.data(), vPayload.size(), vOut));
+    CT_CHECK(vOut == vIn);
+}
+
+CT_TEST(NoArgumentsIsJustTheCount)
+{
+    std::vector<std::uint8_t> vPayload;
+    CT_REQUIRE(EncodeArgs({}, vPayload));
+    CT_CHECK_EQ(vPayload.size(), 4u);
+
+    Command command = Command::Unknown;
+    CT_CHECK(Receive(COMMAND_TAG, vPayload, command) == Reply::Handled);
+    CT_CHECK(command == Command::None);
+}
+
+CT_TEST(ActionsAreHandledByTheRunningInstance)
+{
+    std::vector<std::uint8_t> vPayload;
+    Command command = Command::None;
+    CT_REQUIRE(EncodeArgs({ u"/cascade" }, vPayload));
+    CT_CHECK(Receive(COMMAND_TAG, vPayload, command) == Reply::Handled);
+    CT_CHECK(command == Command::Cascade);
+
+    CT_REQUIRE(EncodeArgs({ u"/showdesktop" }, vPayload));
+    CT_CHECK(Receive(COMMAND_TAG, vPayload, command) == Reply::Handled);
+    CT_CHECK(command == Command::ShowDesktop);
+}
+
+CT_TEST(UserInstallMakesTheRunningInstanceYield)
+{
+    std::vector<std::uint8_t> vPayload;
+    Command command = Command::None;
+    CT_REQUIRE(EncodeArgs({ u"/RegisterUser" }, vPayload));
+    CT_CHECK(Receive(COMMAND_TAG, vPayload, command) == Reply::Yield);
+
+    CT_REQUIRE(EncodeArgs({ u"/UNREGISTERUSER", u"x" }, vPayload));
+    CT_CHECK(Receive(COMMAND_TAG, vPayload, command) == Reply::Yield);
+}
+
+CT_TEST(UnknownCommandsAndForeignMessagesAreRejected)
+{
+    std::vector<std::uint8_t> vPayload;
+    Command command = Command::None;
+    CT_REQUIRE(EncodeArgs({ u"/REGISTER" }, vPayload));
+    CT_CHECK(Receive(COMMAND_TAG, vPayload, command) == Reply::Rejected);
+
+    CT_REQUIRE(EncodeArgs({ u"/bogus" }, vPayload));
+    CT_CHECK(Receive(COMMAND_TAG, vPayload, command) == Reply::Rejected);
+    CT_CHECK(command == Command::Unknown);
+
+    CT_REQUIRE(EncodeArgs({ u"/showdesktop" }, vPayload));
+    CT_CHECK(Receive(0x1234, vPayload, command) == Reply::Rejected);
+}
+
+CT_TEST(CommandsAreCaseInsensitiveAndWhole)
+{
+    CT_CHECK(ParseCommand({ u"/SIDEBYSIDE" }) == Command::SideBySide);
+    CT_CHECK(ParseCommand({ u"/Stacked" }) == Command::Stacked);
+    CT_CHECK(ParseCommand({ u"/tile-vertical" }) == Command::SideBySide);
+    CT_CHECK(ParseCommand({ u"/cascadex" }) == Command::Unknown);
+    CT_CHECK(IsAction(Command::UndoMinimize));
+    CT_CHECK(!IsAction(Command::RegisterUser));
+}
+
+CT_TEST(TruncatedOrPaddedPayloadsAreRejected)
+{
+    std::vector<std::uint8_t> vPayload;
+    CT_REQUIRE(EncodeArgs({ u"/cascade", u"abc" }, vPayload));
+
+    ArgVector vArgs;
+    for (std::size_t nSize = 0; nSize < vPayload.size(); nSize++) {
+        CT_CHECK(!DecodeArgs(vPayload.data(), nSize, vArgs));
+        CT_CHECK(vArgs.empty());
+    }
+
+    std::vector<std::uint8_t> vPadded = vPayload;
+    vPadded.push_back(0);
+    CT_CHECK(!DecodeArgs(vPadded.data(), vPadded.size(), vArgs));
+    CT_CHECK(!DecodeArgs(nullptr, 0, vArgs));
+}
+
+CT_TEST(OversizedCountsAndLengthsAreRejected)
+{
+    std::vector<std::uint8_t> vPayload;
+    CT_REQUIRE(EncodeArgs({ u"/cascade" }, vPayload));
+
+    //A length near 2^31 must not be trusted (or overflow the size check)
+    std::vector<std::uint8_t> vForged = vPayload;
+    vForged[4] = 0xFF;
+    vForged[5] = 0xFF;
+    vForged[6] = 0xFF;
+    vForged[7] = 0x7F;
+    ArgVector vArgs;
+    CT_CHECK(!DecodeArgs(vForged.data(), vForged.size(), vArgs));
+
+    vForged = vPayload;
+    vForged[0] = static_cast<std::uint8_t>(MAX_ARGS + 1);
+    CT_CHECK(!DecodeArgs(vForged.data(), vForged.size(), vArgs));
+
+    CT_CHECK(!EncodeArgs(ArgVector(MAX_ARGS + 1, u"a"), vPayload));
+    CT_CHECK(!EncodeArgs({ std::u16string(MAX_ARG_CHARS + 1, u'a') }, vPayload));
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Cost of recording a latency, from one thread and from several at once (which
+// contend for the count, sum and bucket cache lines), and of summarizing
+#include <algorithm>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CTBench.h"
+#include "LatencyHistogram.h"
+
+using namespace CTMetrics;
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    const std::size_t nRuns = bFull ? 10000000 : 1000000;
+
+    LatencyHistogram histogram;
+    const double dRecordNs = CTBench::NsPerOp(nRuns, [&] {
+        for (std::size_t i = 0; i < nRuns; i++) {
+            histogram.Record(i & 0xFFFFF);
+        }
+    });
+    CTBench::Report("histogram.record", dRecordNs, "ns/value");
+
+    const unsigned nThreads = std::max(2u, std::thread::hardware_concurrency());
+    const std::size_t nPerThread = nRuns / nThreads;
+    const double dContendedNs = CTBench::NsPerOp(nPerThread * nThreads, [&] {
+        std::vector<std::thread> vThreads;
+        for (unsigned t = 0; t < nThreads; t++) {
+            vThreads.emplace_back([&histogram, nPerThread] {
+                for (std::size_t i = 0; i < nPerThread; i++) {
+                    histogram.Record(i & 0xFFFFF);
+                }
+            });
+        }
+        for (std::thread& thread : vThreads) {
+            thread.join();
+        }
+    });
+    const std::string szDetails = std::to_string(nThreads) + " threads";
+    CTBench::Report("histogram.record.contended", dContendedNs, "ns/value", szDetails.c_str());
+
+    const std::size_t nSummaries = nRuns / 1000;
+    LatencySummary summary;
+    const double dSummarizeNs = CTBench::NsPerOp(nSummaries, [&] {
+        for (std::size_t i = 0; i < nSummaries; i++) {
+            summary = histogram.Summarize();
+            CTBench::DoNotOptimize(summary);
+        }
+    });
+    CTBench::Report("histogram.summarize", dSummarizeNs, "ns/summary");
+    return 0;
+}
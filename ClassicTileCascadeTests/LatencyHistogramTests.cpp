@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+#include "CTTest.h"
+#include "LatencyHistogram.h"
+
+using namespace CTMetrics;
+
+namespace
+{
+    // Whether nReported is nExact rounded up by at most a bucket (1/16 of the value)
+    bool IsWithinBucket(std::uint64_t nReported, std::uint64_t nExact)
+    {
+        return (nReported >= nExact) && ((nReported - nExact) * 16 <= std::max<std::uint64_t>(nExact, 16));
+    }
+}
+
+CT_TEST(BucketsAreContiguous)
+{
+    std::uint64_t nPrevHigh = 0;
+    for (std::size_t nBucket = 0; nBucket < LatencyHistogram::BUCKETS; nBucket++) {
+        const std::uint64_t nHigh = LatencyHistogram::BucketHigh(nBucket);
+        CT_REQUIRE_EQ(LatencyHistogram::BucketOf(nHigh), nBucket);
+        if (nBucket > 0) {
+            CT_REQUIRE(nHigh > nPrevHigh);
+            CT_REQUIRE_EQ(LatencyHistogram::BucketOf(nPrevHigh + 1), nBucket);
+        }
+        nPrevHigh = nHigh;
+    }
+    CT_CHECK_EQ(nPrevHigh, std::uint64_t{ UINT32_MAX });
+    CT_CHECK_EQ(LatencyHistogram::BucketOf(std::uint64_t{ 1 } << 40), LatencyHistogram::BUCKETS - 1);
+    CT_CHECK_EQ(LatencyHistogram::BucketOf(UINT64_MAX), LatencyHistogram::BUCKETS - 1);
+}
+
+CT_TEST(BucketsAreAtMostASixteenthWide)
+{
+    std::mt19937_64 rng(1);
+    for (int i = 0; i < 100000; i++) {
+        const std::uint64_t nValue = rng() >> (rng() % 64);
+        if (nValue > UINT32_MAX) {
+            continue;
+        }
+        CT_REQUIRE(IsWithinBucket(LatencyHistogram::BucketHigh(LatencyHistogram::BucketOf(nValue)), nValue));
+    }
+}
+
+CT_TEST(PercentilesMatchTheSortedValues)
+{
+    std::mt19937_64 rng(1);
+    std::lognormal_distribution<double> distribution(8.0, 1.5);
+    LatencyHistogram histogram;
+    std::vector<std::uint64_t> vValues;
+    for (int i = 0; i < 100000; i++) {
+        const std::uint64_t nValue = static_cast<std::uint64_t>(distribution(rng));
+        vValues.push_back(nValue);
+        histogram.Record(nValue);
+    }
+    std::ranges::sort(vValues);
+
+    const auto Exact = [&vValues](double dQuantile) {
+        return vValues[static_cast<std::size_t>(std::ceil(dQuantile * static_cast<double>(vValues.size()))) - 1];
+    };
+
+    const LatencySummary summary = histogram.Summarize();
+    CT_CHECK_EQ(summary.nCount, vValues.size());
+    CT_CHECK_EQ(summary.nMin, vValues.front());
+    CT_CHECK_EQ(summary.nMax, vValues.back());
+    CT_CHECK(IsWithinBucket(summary.nP50, Exact(0.50)));
+    CT_CHECK(IsWithinBucket(summary.nP90, Exact(0.90)));
+    CT_CHECK(IsWithinBucket(summary.nP99, Exact(0.99)));
+    CT_CHECK(IsWithinBucket(histogram.Percentile(0.999), Exact(0.999)));
+    CT_CHECK_EQ(histogram.Percentile(1.0), vValues.back());
+}
+
+CT_TEST(PercentilesDontExceedTheMaximum)
+{
+    LatencyHistogram histogram;
+    CT_CHECK_EQ(histogram.Percentile(0.5), 0u);
+    CT_CHECK_EQ(histogram.Summarize().nCount, 0u);
+
+    //1000 is in a bucket that reaches 1023
+    histogram.Record(1000);
+    CT_CHECK_EQ(histogram.Percentile(0.99), 1000u);
+    CT_CHECK_EQ(histogram.Summarize().nP50, 1000u);
+    CT_CHECK_EQ(histogram.Summarize().nMean, 1000u);
+
+    histogram.Reset();
+    CT_CHECK_EQ(histogram.Count(), 0u);
+    CT_CHECK_EQ(histogram.Summarize().nMax, 0u);
+    histogram.Record(5);
+    CT_CHECK_EQ(histogram.Summarize().nMin, 5u);
+}
+
+CT_TEST(ConcurrentRecordsAreAllCounted)
+{
+    constexpr int THREADS = 8;
+    constexpr int RECORDS = 50000;
+    LatencyHistogram histogram;
+    std::atomic<bool> bStop{ false };
+    bool bOrdered = true;
+    std::thread reader([&] {
+        while (!bStop.load()) {
+            const LatencySummary summary = histogram.Summarize();
+            bOrdered = bOrdered && (summary.nP50 <= summary.nP99);
+        }
+    });
+
+    std::vector<std::thread> vWriters;
+    for (int t = 0; t < THREADS; t++) {
+        vWriters.emplace_back([&histogram, t] {
+            for (int i = 0; i < RECORDS; i++) {
+                histogram.Record(static_cast<std::uint64_t>(i % 5000 + t));
+            }
+        });
+    }
+    for (std::thread& writer : vWriters) {
+        writer.join();
+    }
+    bStop.store(true);
+    reader.join();
+    CT_CHECK(bOrdered);
+
+    const LatencySummary summary = histogram.Summarize();
+    CT_CHECK_EQ(summary.nCount, std::uint64_t{ THREADS } * RECORDS);
+    CT_CHECK_EQ(summary.nMin, 0u);
+    CT_CHECK_EQ(summary.nMax, 4999u + THREADS - 1);
+}
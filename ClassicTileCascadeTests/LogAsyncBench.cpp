@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Per-call latency and throughput of log_log to a file, synchronous vs. asynchronous
+// (the caller only formats into the ring), with one and with several logging threads
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CTBench.h"
+
+extern "C"
+{
+#include "log.h"
+}
+
+namespace
+{
+    struct Result
+    {
+        double dNsPerCall = 0.0;	// mean time a caller spent in log_log
+        double dP99Ns = 0.0;		// 99th percentile of that time
+        double dMsgPerSec = 0.0;	// messages written to the file per second, including draining the queue
+    };
+
+    Result Run(bool bAsync, int nThreads, int nMessages)
+    {
+        const std::string szPath = "ct_bench.log";
+        FILE* fp = std::fopen(szPath.c_str(), "w");
+        log_set_quiet(true);
+        log_add_fp(fp, LOG_TRACE);
+        if (bAsync) {
+            log_start_async(8192, LOG_OVERFLOW_BLOCK);
+        }
+
+        std::vector<std::vector<double>> vSamples(nThreads);
+        const CTBench::Clock::time_point tpStart = CTBench::Clock::now();
+        {
+            std::vector<std::jthread> vThreads;
+            for (int t = 0; t < nThreads; t++) {
+                vThreads.emplace_back([t, nMessages, &vSamples] {
+                    std::vector<double>& vMine = vSamples[t];
+                    vMine.reserve(nMessages);
+                    for (int i = 0; i < nMessages; i++) {
+                        const CTBench::Clock::time_point tpCall = CTBench::Clock::now();
+                        log_info("Moved window <0X%p> to (%ld, %ld, %ld, %ld) in <%lld> us", &vMine, 10L * i, 20L, 800L, 600L, 123LL);
+                        vMine.push_back(std::chrono::duration<double, std::nano>(CTBench::Clock::now() - tpCall).count());
+                    }
+                });
+            }
+        }
+        log_flush();
+        const std::chrono::duration<double> dur = CTBench::Clock::now() - tpStart;
+
+        log_remove_fp(fp, LOG_TRACE);
+        if (bAsync) {
+            log_stop_async();
+        }
+        std::fclose(fp);
+        std::remove(szPath.c_str());
+
+        std::vector<double> vAll;
+        for (const std::vector<double>& vMine : vSamples) {
+            vAll.insert(vAll.end(), vMine.begin(), vMine.end());
+        }
+        std::sort(vAll.begin(), vAll.end());
+
+        Result result;
+        double dSum = 0.0;
+        for (double d : vAll) {
+            dSum += d;
+        }
+        result.dNsPerCall = dSum / static_cast<double>(vAll.size());
+        result.dP99Ns = vAll[(vAll.size() * 99) / 100];
+        result.dMsgPerSec = static_cast<double>(vAll.size()) / dur.count();
+        return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int nMessages = CTBench::IsFull(argc, argv) ? 200000 : 5000;
+
+    for (int nThreads : { 1, 4 }) {
+        for (bool bAsync : { false, true }) {
+            const Result result = Run(bAsync, nThreads, nMessages);
+            const std::string szName = std::string("log.") + (bAsync ? "async" : "sync") + "." + std::to_string(nThreads) + "thread";
+            char szDetails[96];
+            std::snprintf(szDetails, sizeof(szDetails), "p99 %.0f ns, %.0f msg/s", result.dP99Ns, result.dMsgPerSec);
+            CTBench::Report(szName.c_str(), result.dNsPerCall, "ns/call", szDetails);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CTTest.h"
+
+extern "C"
+{
+#include "log.h"
+}
+
+namespace
+{
+    // The message part of the lines in szPath, i.e. without the time stamp
+    std::vector<std::string> ReadMessages(const std::string& szPath)
+    {
+        std::vector<std::string> vLines;
+        std::ifstream in(szPath);
+        std::string szLine;
+        while (std::getline(in, szLine)) {
+            vLines.push_back(szLine.size() > 20 ? szLine.substr(20) : szLine);
+        }
+        return vLines;
+    }
+
+    // A log file registered with log_add_fp for the lifetime of the object
+    class LogFile
+    {
+    public:
+        explicit LogFile(const std::string& szName)
+            : m_szPath(CTTest::TempPath(szName))
+        {
+            log_set_quiet(true);
+            m_fp = std::fopen(m_szPath.c_str(), "w");
+            log_add_fp(m_fp, LOG_TRACE);
+        }
+
+        ~LogFile()
+        {
+            Close();
+            std::remove(m_szPath.c_str());
+        }
+
+        void Close()
+        {
+            if (m_fp) {
+                log_remove_fp(m_fp, LOG_TRACE);
+                std::fclose(m_fp);
+                m_fp = nullptr;
+            }
+        }
+
+        const std::string& Path() const { return m_szPath; }
+
+    protected:
+        std::string m_szPath;
+        FILE* m_fp = nullptr;
+    };
+}
+
+CT_TEST(AsyncOutputMatchesSyncOutput)
+{
+    auto Write = [] {
+        for (int i = 0; i < 100; i++) {
+            log_info("message %d of %s", i, "test");
+        }
+        log_warn("%5.2f|%-4s|%c|%x", 3.14159, "ab", 'z', 255u);
+    };
+
+    std::vector<std::string> vSync, vAsync;
+    {
+        LogFile file("sync.log");
+        Write();
+        file.Close();
+        vSync = ReadMessages(file.Path());
+    }
+    {
+        LogFile file("async.log");
+        CT_REQUIRE_EQ(log_start_async(64, LOG_OVERFLOW_BLOCK), 0);
+        Write();
+        file.Close();
+        log_stop_async();
+        vAsync = ReadMessages(file.Path());
+    }
+
+    CT_REQUIRE_EQ(vSync.size(), 101u);
+    CT_CHECK(vSync == vAsync);
+    CT_CHECK(vAsync.back().find(" 3.14|ab  |z|ff") != std::string::npos);
+}
+
+CT_TEST(BlockingQueueKeepsEveryMessageInOrder)
+{
+    constexpr int THREADS = 4;
+    constexpr int MESSAGES = 20000;
+
+    LogFile file("block.log");
+    CT_REQUIRE_EQ(log_start_async(16, LOG_OVERFLOW_BLOCK), 0);
+    {
+        std::vector<std::jthread> vThreads;
+        for (int t = 0; t < THREADS; t++) {
+            vThreads.emplace_back([t] {
+                for (int i = 0; i < MESSAGES; i++) {
+                    log_debug("thread %d message %d", t, i);
+                }
+            });
+        }
+    }
+    file.Close();
+    log_stop_async();
+    CT_CHECK_EQ(log_dropped_count(), 0u);
+
+    //Messages of one thread keep their order
+    std::vector<int> vNext(THREADS, 0);
+    std::size_t nLines = 0;
+    for (const std::string& szLine : ReadMessages(file.Path())) {
+        int t = 0, i = 0;
+        const std::size_t nPos = szLine.find("thread ");
+        CT_REQUIRE(nPos != std::string::npos);
+        CT_REQUIRE_EQ(std::sscanf(szLine.c_str() + nPos, "thread %d message %d", &t, &i), 2);
+        CT_REQUIRE((t >= 0) && (t < THREADS));
+        CT_CHECK_EQ(i, vNext[t]);
+        vNext[t] = i + 1;
+        nLines++;
+    }
+    CT_CHECK_EQ(nLines, static_cast<std::size_t>(THREADS * MESSAGES));
+}
+
+CT_TEST(DroppingQueueCountsAndReportsDrops)
+{
+    constexpr int THREADS = 4;
+    constexpr int MESSAGES = 20000;
+
+    LogFile file("drop.log");
+    CT_REQUIRE_EQ(log_start_async(2, LOG_OVERFLOW_DROP), 0);
+    {
+        std::vector<std::jthread> vThreads;
+        for (int t = 0; t < THREADS; t++) {
+            vThreads.emplace_back([t] {
+                for (int i = 0; i < MESSAGES; i++) {
+                    log_debug("thread %d message %d", t, i);
+                }
+            });
+        }
+    }
+    file.Close();
+    log_stop_async();
+
+    std::size_t nWritten = 0, nReports = 0;
+    unsigned long long nReported = 0;
+    for (const std::string& szLine : ReadMessages(file.Path())) {
+        const std::size_t nPos = szLine.find(" log message(s) dropped");
+        if (nPos == std::string::npos) {
+            nWritten++;
+        } else {
+            nReports++;
+            nReported += std::stoull(szLine.substr(szLine.rfind(' ', nPos - 1) + 1));
+        }
+    }
+
+    //Every message is either written or counted, and every drop is reported in the log
+    CT_CHECK_EQ(nWritten + log_dropped_count(), static_cast<unsigned long long>(THREADS * MESSAGES));
+    CT_CHECK_EQ(nReported, log_dropped_count());
+    CT_CHECK((log_dropped_count() == 0) || (nReports > 0));
+}
+
+CT_TEST(FlushWritesEverythingQueuedBeforeIt)
+{
+    LogFile file("flush.log");
+    CT_REQUIRE_EQ(log_start_async(1024, LOG_OVERFLOW_BLOCK), 0);
+    for (int i = 0; i < 500; i++) {
+        log_info("message %d", i);
+    }
+    log_flush();
+    CT_CHECK_EQ(ReadMessages(file.Path()).size(), 500u);
+    file.Close();
+    log_stop_async();
+}
+
+CT_TEST(LongMessagesAreNotCut)
+{
+    //E.g. the latency table logged on exit
+    const std::string szLong(3000, 'x');
+    const std::string szHuge(100 * 1024, 'y');
+
+    LogFile file("long.log");
+    CT_REQUIRE_EQ(log_start_async(8, LOG_OVERFLOW_BLOCK), 0);
+    log_info("<%s>", szLong.c_str());
+    log_info("<%s>", szHuge.c_str());
+    log_info("short");
+    file.Close();
+    log_stop_async();
+
+    const std::vector<std::string> vMessages = ReadMessages(file.Path());
+    CT_REQUIRE_EQ(vMessages.size(), 3u);
+    CT_CHECK(vMessages[0].find("<" + szLong + ">") != std::string::npos);
+
+    //Messages beyond the limit end in a visible marker
+    CT_CHECK(vMessages[1].size() > 60 * 1024);
+    CT_CHECK(vMessages[1].size() < szHuge.size());
+    CT_CHECK(vMessages[1].ends_with("... [truncated]"));
+    CT_CHECK(vMessages[2].ends_with("short"));
+}
+
+CT_TEST(RemovingAFileWhileOthersLogIsSafe)
+{
+    //Turning logging off during an action: the file is removed and closed while
+    //other threads are in log_log. Under -DCT_SANITIZE=ON a write to the closed
+    //FILE* shows up as a use after free
+    log_set_quiet(true);
+    const std::string szPath = CTTest::TempPath("remove.log");
+    std::atomic<bool> bStop{ false };
+
+    for (bool bAsync : { false, true }) {
+        if (bAsync) {
+            CT_REQUIRE_EQ(log_start_async(64, LOG_OVERFLOW_DROP), 0);
+        }
+        {
+            std::vector<std::jthread> vThreads;
+            for (int t = 0; t < 3; t++) {
+                vThreads.emplace_back([&bStop] {
+                    for (int i = 0; !bStop.load(); i++) {
+                        log_debug("message %d", i);
+                    }
+                });
+            }
+
+            for (int i = 0; i < 300; i++) {
+                FILE* fp = std::fopen(szPath.c_str(), "w");
+                CT_REQUIRE(fp != nullptr);
+                log_add_fp(fp, LOG_TRACE);
+                std::this_thread::yield();
+                CT_CHECK_EQ(log_remove_fp(fp, LOG_TRACE), 0);
+                std::fclose(fp);
+            }
+            bStop = true;
+        }
+        bStop = false;
+        if (bAsync) {
+            log_stop_async();
+        }
+    }
+    std::remove(szPath.c_str());
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Cost of a log_log call and bytes written per message for the text and the binary
+// log, and the rate at which log_decode_bin renders a binary log back to text
+#include <cstdio>
+#include <string>
+#include "CTBench.h"
+
+extern "C"
+{
+#include "log.h"
+}
+
+namespace
+{
+    struct Result
+    {
+        double dNsPerCall = 0.0;
+        double dBytesPerMsg = 0.0;
+    };
+
+    void Emit(int i)
+    {
+        log_info("Moved window <0X%p> to (%ld, %ld, %ld, %ld) in <%lld> us", &i, 10L * i, 20L, 800L, 600L, 123LL);
+        log_debug("Skipped window of class <%s> (process <%lu>): failed the <%s> check", "Shell_TrayWnd", 4242UL, "visible");
+    }
+
+    Result Run(bool bBinary, const std::string& szPath, int nMessages)
+    {
+        Result result;
+        result.dNsPerCall = CTBench::NsPerOp(static_cast<std::size_t>(nMessages) * 2, [&] {
+            FILE* fp = std::fopen(szPath.c_str(), bBinary ? "wb" : "w");
+            if (bBinary) {
+                log_add_bin_fp(fp, LOG_TRACE);
+            } else {
+                log_add_fp(fp, LOG_TRACE);
+            }
+            for (int i = 0; i < nMessages; i++) {
+                Emit(i);
+            }
+            log_remove_fp(fp, LOG_TRACE);
+            result.dBytesPerMsg = static_cast<double>(std::ftell(fp)) / (nMessages * 2.0);
+            std::fclose(fp);
+        });
+        return result;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const int nMessages = CTBench::IsFull(argc, argv) ? 500000 : 20000;
+    const std::string szText = "ct_bench.log";
+    const std::string szBinary = "ct_bench.blog";
+    const std::string szDecoded = "ct_bench.blog.log";
+    log_set_quiet(true);
+
+    const Result text = Run(false, szText, nMessages);
+    const Result binary = Run(true, szBinary, nMessages);
+    CTBench::Report("log.text", text.dNsPerCall, "ns/call", text.dBytesPerMsg, "bytes/msg");
+    CTBench::Report("log.binary", binary.dNsPerCall, "ns/call", binary.dBytesPerMsg, "bytes/msg");
+
+    const double dNsPerMsg = CTBench::NsPerOp(static_cast<std::size_t>(nMessages) * 2, [&] {
+        FILE* in = std::fopen(szBinary.c_str(), "rb");
+        FILE* out = std::fopen(szDecoded.c_str(), "w");
+        CTBench::DoNotOptimize(log_decode_bin(in, out));
+        std::fclose(out);
+        std::fclose(in);
+    }, 1);
+    CTBench::Report("log.decode", dNsPerMsg, "ns/msg");
+
+    std::remove(szText.c_str());
+    std::remove(szBinary.c_str());
+    std::remove(szDecoded.c_str());
+    return 0;
+}
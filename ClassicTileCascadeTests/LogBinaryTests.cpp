@@ -0,0 +1,274 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Round trips of the binary log: log_decode_bin must render a binary log in the
+// layout log_add_fp writes, and fail cleanly on files it can't decode
+#include <algorithm>
+#include <cstdint>
+#include <clocale>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "CTTest.h"
+
+extern "C"
+{
+#include "log.h"
+}
+
+namespace
+{
+    // The message part of the lines in szPath, i.e. without the time stamp
+    std::vector<std::string> ReadMessages(const std::string& szPath)
+    {
+        std::vector<std::string> vLines;
+        std::ifstream in(szPath);
+        std::string szLine;
+        while (std::getline(in, szLine)) {
+            vLines.push_back(szLine.size() > 20 ? szLine.substr(20) : szLine);
+        }
+        return vLines;
+    }
+
+    // Decode szIn into szOut. Returns log_decode_bin's result
+    int Decode(const std::string& szIn, const std::string& szOut)
+    {
+        FILE* in = std::fopen(szIn.c_str(), "rb");
+        FILE* out = std::fopen(szOut.c_str(), "w");
+        const int nResult = (in && out) ? log_decode_bin(in, out) : -2;
+        if (in) {
+            std::fclose(in);
+        }
+        if (out) {
+            std::fclose(out);
+        }
+        return nResult;
+    }
+
+    // A text and a binary log registered for the lifetime of the object, with the
+    // decoded binary log next to them
+    class LogPair
+    {
+    public:
+        explicit LogPair(const std::string& szName)
+            : m_szText(CTTest::TempPath(szName + ".log")),
+              m_szBinary(CTTest::TempPath(szName + ".blog")),
+              m_szDecoded(CTTest::TempPath(szName + ".blog.log"))
+        {
+            log_set_quiet(true);
+            m_fpText = std::fopen(m_szText.c_str(), "w");
+            m_fpBinary = std::fopen(m_szBinary.c_str(), "wb");
+            log_add_fp(m_fpText, LOG_TRACE);
+            log_add_bin_fp(m_fpBinary, LOG_TRACE);
+        }
+
+        ~LogPair()
+        {
+            Close();
+            std::remove(m_szText.c_str());
+            std::remove(m_szBinary.c_str());
+            std::remove(m_szDecoded.c_str());
+        }
+
+        void Close()
+        {
+            if (m_fpText) {
+                log_remove_fp(m_fpText, LOG_TRACE);
+                log_remove_fp(m_fpBinary, LOG_TRACE);
+                std::fclose(m_fpText);
+                std::fclose(m_fpBinary);
+                m_fpText = m_fpBinary = nullptr;
+            }
+        }
+
+        // Start a new binary session, as a restart of the app would
+        void Reopen()
+        {
+            log_remove_fp(m_fpBinary, LOG_TRACE);
+            log_add_bin_fp(m_fpBinary, LOG_TRACE);
+        }
+
+        const std::string& Text() const { return m_szText; }
+        const std::string& Binary() const { return m_szBinary; }
+        const std::string& Decoded() const { return m_szDecoded; }
+
+    protected:
+        std::string m_szText;
+        std::string m_szBinary;
+        std::string m_szDecoded;
+        FILE* m_fpText = nullptr;
+        FILE* m_fpBinary = nullptr;
+    };
+
+    void Emit()
+    {
+        log_info("plain message");
+        log_warn("ints %d %u %x %5.3d %-4d| %hd %hhu %ld %lld %zu %llx", -5, -1, 255, 7, 3, (short)-2, (unsigned char)250, -9L, -123456789012LL, (size_t)42, 0xdeadbeefcafeULL);
+        log_debug("str <%s> <%10s> <%-6.2s> %S <%5ls> null=%s", "abc", "right", "trunc", L"wide", L"w2", static_cast<const char*>(nullptr));
+        log_error("dbl %f %.2e %g %*d %.*s %c %%", 3.5, 12345.678, 0.1, 6, 42, 3, "abcdef", 'Z');
+        log_trace("pct only 100%%");
+    }
+}
+
+CT_TEST(DecodedLogMatchesTextLog)
+{
+    LogPair logs("bin_match");
+    Emit();
+    Emit();
+    logs.Close();
+
+    CT_REQUIRE_EQ(Decode(logs.Binary(), logs.Decoded()), 0);
+    const std::vector<std::string> vText = ReadMessages(logs.Text());
+    const std::vector<std::string> vDecoded = ReadMessages(logs.Decoded());
+    CT_REQUIRE_EQ(vText.size(), 10u);
+    CT_REQUIRE_EQ(vDecoded.size(), vText.size());
+    for (std::size_t i = 0; i < vText.size(); i++) {
+        CT_CHECK_EQ(vDecoded[i], vText[i]);
+    }
+}
+
+CT_TEST(WideTextIsConvertedLikeTheTextLog)
+{
+    // Both logs convert wide text with the locale: test with one that has all of it
+    const std::string szLocale = std::setlocale(LC_ALL, nullptr);
+    if (!std::setlocale(LC_ALL, "C.UTF-8") && !std::setlocale(LC_ALL, "C.utf8")) {
+        return;
+    }
+
+    LogPair logs("bin_wide");
+    log_info("<%S> <%ls> <%-8ls|%.3ls> <%lc%c>", L"caf\u00E9 \u20AC", L"\U0001F600", L"\u00A9x", L"abcdef", static_cast<wint_t>(L'\u00FC'), 'q');
+    logs.Close();
+    const int nResult = Decode(logs.Binary(), logs.Decoded());
+    std::setlocale(LC_ALL, szLocale.c_str());
+
+    CT_REQUIRE_EQ(nResult, 0);
+    const std::vector<std::string> vText = ReadMessages(logs.Text());
+    const std::vector<std::string> vDecoded = ReadMessages(logs.Decoded());
+    CT_REQUIRE_EQ(vText.size(), 1u);
+    CT_CHECK(vText[0].find("<caf\xC3\xA9 \xE2\x82\xAC>") != std::string::npos);
+    CT_CHECK_EQ(vDecoded, vText);
+}
+
+CT_TEST(EverySessionDefinesItsOwnStrings)
+{
+    LogPair logs("bin_sessions");
+    Emit();
+    logs.Reopen();
+    log_info("only in the second session %d", 2);
+    Emit();
+    logs.Close();
+
+    CT_REQUIRE_EQ(Decode(logs.Binary(), logs.Decoded()), 0);
+    CT_CHECK(ReadMessages(logs.Decoded()) == ReadMessages(logs.Text()));
+}
+
+CT_TEST(PointersUseTheWritersWidth)
+{
+    LogPair logs("bin_pointer");
+    log_info("window <%p>", reinterpret_cast<void*>(static_cast<std::uintptr_t>(0xABCDEF)));
+    logs.Close();
+
+    CT_REQUIRE_EQ(Decode(logs.Binary(), logs.Decoded()), 0);
+    const std::vector<std::string> vDecoded = ReadMessages(logs.Decoded());
+    CT_REQUIRE_EQ(vDecoded.size(), 1u);
+    const std::string szHex = std::string(sizeof(void*) * 2 - 6, '0') + "ABCDEF";
+    CT_CHECK(vDecoded[0].find("window <" + szHex + ">") != std::string::npos);
+}
+
+CT_TEST(LongArgumentsAreCutToTheRecord)
+{
+    const std::string szLong(10000, 'x');
+    LogPair logs("bin_long");
+    log_info("<%s> %d", szLong.c_str(), 42);
+    log_info("after");
+    logs.Close();
+
+    CT_REQUIRE_EQ(Decode(logs.Binary(), logs.Decoded()), 0);
+    const std::vector<std::string> vDecoded = ReadMessages(logs.Decoded());
+    CT_REQUIRE_EQ(vDecoded.size(), 2u);
+    const std::size_t nKept = static_cast<std::size_t>(std::count(vDecoded[0].begin(), vDecoded[0].end(), 'x'));
+    CT_CHECK(nKept > 3000 && nKept < 4096);
+    CT_CHECK(vDecoded[0].ends_with("> 42"));
+    CT_CHECK(vDecoded[1].ends_with("after"));
+}
+
+CT_TEST(TruncatedLogDecodesUpToTheCut)
+{
+    LogPair logs("bin_cut");
+    log_info("first");
+    log_info("second %d", 2);
+    logs.Close();
+
+    std::string szData;
+    {
+        std::ifstream in(logs.Binary(), std::ios::binary);
+        szData.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    {
+        std::ofstream out(logs.Binary(), std::ios::binary | std::ios::trunc);
+        out.write(szData.data(), static_cast<std::streamsize>(szData.size() - 3));
+    }
+
+    CT_CHECK_EQ(Decode(logs.Binary(), logs.Decoded()), -1);
+    const std::vector<std::string> vDecoded = ReadMessages(logs.Decoded());
+    CT_REQUIRE_EQ(vDecoded.size(), 1u);
+    CT_CHECK(vDecoded[0].ends_with("first"));
+}
+
+CT_TEST(MalformedDefinitionsAreRejected)
+{
+    // A session header as log_add_bin_fp writes it, followed by one definition
+    auto Write = [](const std::string& szPath, std::uint32_t nId, std::uint32_t nLen, const std::string& szBytes) {
+        FILE* fp = std::fopen(szPath.c_str(), "wb");
+        const unsigned char hdr[8] = { 'C', 'T', 'B', 'L', 1, static_cast<unsigned char>(sizeof(long)), static_cast<unsigned char>(sizeof(void*)), 0 };
+        std::fwrite(hdr, 1, sizeof(hdr), fp);
+        std::fputc('S', fp);
+        std::fwrite(&nId, sizeof(nId), 1, fp);
+        std::fwrite(&nLen, sizeof(nLen), 1, fp);
+        std::fwrite(szBytes.data(), 1, szBytes.size(), fp);
+        std::fclose(fp);
+    };
+
+    const std::string szIn = CTTest::TempPath("bin_bad.blog");
+    const std::string szOut = CTTest::TempPath("bin_bad.blog.log");
+
+    Write(szIn, 1000, 4, "abcd");
+    CT_CHECK_EQ(Decode(szIn, szOut), 0);
+
+    Write(szIn, 0xFFFFFFFFu, 4, "abcd");
+    CT_CHECK_EQ(Decode(szIn, szOut), -1);
+
+    Write(szIn, 0xFFFFFFFEu, 4, "abcd");
+    CT_CHECK_EQ(Decode(szIn, szOut), -1);
+
+    Write(szIn, 0, 0x7FFFFFFFu, "abcd");
+    CT_CHECK_EQ(Decode(szIn, szOut), -1);
+
+    Write(szIn, 0, 8, "abcd");
+    CT_CHECK_EQ(Decode(szIn, szOut), -1);
+
+    std::remove(szIn.c_str());
+    std::remove(szOut.c_str());
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Cost of opening a synthetic log with LogDocument and paging through it: the
+// last page (what the viewer shows first), jumps to random lines once the whole
+// file is indexed, and the full scan. The log is a file of 64 MB, or 4 GB with
+// --full, mapped a window at a time as the viewer does
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include "CTBench.h"
+#include "LogDocument.h"
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace CTLogView;
+
+namespace
+{
+    constexpr std::size_t PAGE_LINES = 10000;
+    constexpr std::size_t PAGE_BYTES = 4 * 1024 * 1024;
+
+    // Write nBytes of lines in the layout of the text log to szPath
+    void WriteLog(const std::string& szPath, std::uint64_t nBytes)
+    {
+        FILE* fp = std::fopen(szPath.c_str(), "wb");
+        std::string szChunk;
+        std::uint64_t nWritten = 0;
+        for (std::size_t i = 0; nWritten < nBytes; i++) {
+            char szLine[256];
+            const int nLen = std::snprintf(szLine, sizeof(szLine), "2023-05-01 12:%02zu:%02zu INFO  ClassicTileWnd.cpp:%zu: Moved window <0X%016zX> to (%zu, 20, 800, 600)\n",
+                (i / 60) % 60, i % 60, 100 + (i % 900), i * 4096, i % 1900);
+            szChunk.append(szLine, static_cast<std::size_t>(nLen));
+            if (szChunk.size() >= (1 << 20)) {
+                nWritten += std::fwrite(szChunk.data(), 1, szChunk.size(), fp);
+                szChunk.clear();
+            }
+        }
+        std::fclose(fp);
+    }
+
+    // Read-only windows of a file, mapped like Win32MappedFile maps the log: one
+    // window of WINDOW_BYTES at a time, from a page boundary
+    class MappedFile : public IDocumentSource
+    {
+    public:
+        explicit MappedFile(const std::string& szPath)
+        {
+#ifdef _WIN32
+            std::ifstream in(szPath, std::ios::binary);
+            m_szData.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+            m_nSize = m_szData.size();
+#else
+            m_fd = ::open(szPath.c_str(), O_RDONLY);
+            struct stat st = {};
+            ::fstat(m_fd, &st);
+            m_nSize = static_cast<std::size_t>(st.st_size);
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifndef _WIN32
+            Unmap();
+            ::close(m_fd);
+#endif
+        }
+
+        std::size_t Size() const override { return m_nSize; }
+
+        std::string_view View(std::size_t nOffset, std::size_t nMinSize) override
+        {
+#ifdef _WIN32
+            (void)nMinSize;
+            return std::string_view(m_szData).substr(nOffset);
+#else
+            nMinSize = std::min(nMinSize, m_nSize - nOffset);
+            if (!m_pView || (nOffset < m_nViewOffset) || ((nOffset + nMinSize) > (m_nViewOffset + m_nViewSize))) {
+                static const std::size_t PAGE = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+                const std::size_t nStart = nOffset - (nOffset % PAGE);
+                const std::size_t nEnd = std::min(m_nSize, std::max(nStart + WINDOW_BYTES, nOffset + nMinSize));
+                Unmap();
+                m_pView = static_cast<const char*>(::mmap(nullptr, nEnd - nStart, PROT_READ, MAP_PRIVATE, m_fd, static_cast<off_t>(nStart)));
+                m_nViewOffset = nStart;
+                m_nViewSize = nEnd - nStart;
+                m_nMaps++;
+            }
+            return std::string_view(m_pView + (nOffset - m_nViewOffset), m_nViewSize - (nOffset - m_nViewOffset));
+#endif
+        }
+
+        std::size_t Maps() const { return m_nMaps; }
+
+        constexpr static std::size_t WINDOW_BYTES = 64 * 1024 * 1024;
+
+    protected:
+#ifdef _WIN32
+        std::string m_szData;
+#else
+        void Unmap()
+        {
+            if (m_pView) {
+                ::munmap(const_cast<char*>(m_pView), m_nViewSize);
+                m_pView = nullptr;
+            }
+        }
+
+        int m_fd = -1;
+        const char* m_pView = nullptr;
+        std::size_t m_nViewOffset = 0;
+        std::size_t m_nViewSize = 0;
+#endif
+        std::size_t m_nSize = 0;
+        std::size_t m_nMaps = 0;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    const std::uint64_t nBytes = bFull ? (4ull << 30) : (64ull << 20);
+    const std::string szPath = "ct_bench_document.log";
+    WriteLog(szPath, nBytes);
+
+    {
+        MappedFile file(szPath);
+        const double dGB = static_cast<double>(file.Size()) / (1 << 30);
+
+        // Open and show the last page, as CLogViewer::OpenFile does. This indexes
+        // the whole file once
+        std::size_t nLines = 0;
+        const double dOpenNs = CTBench::NsPerOp(1, [&] {
+            LogDocument doc;
+            doc.Attach(file);
+            nLines = doc.LineCount();
+            CTBench::DoNotOptimize(doc.GetLines(nLines - PAGE_LINES, PAGE_LINES, PAGE_BYTES));
+        });
+        CTBench::Report("document.open.lastpage", dOpenNs / 1e6, "ms", dGB / (dOpenNs / 1e9), "GB/s");
+
+        // The first page only needs the first lines
+        const double dFirstNs = CTBench::NsPerOp(1, [&] {
+            LogDocument doc;
+            doc.Attach(file);
+            CTBench::DoNotOptimize(doc.GetLines(0, PAGE_LINES, PAGE_BYTES));
+        });
+        CTBench::Report("document.open.firstpage", dFirstNs / 1e6, "ms");
+
+        // Go To line and paging once the file is indexed
+        LogDocument doc;
+        doc.Attach(file);
+        doc.LineCount();
+        std::mt19937_64 rng(42);
+        constexpr std::size_t JUMPS = 10000;
+        const double dJumpNs = CTBench::NsPerOp(JUMPS, [&] {
+            for (std::size_t i = 0; i < JUMPS; i++) {
+                CTBench::DoNotOptimize(doc.GetLines(rng() % nLines, PAGE_LINES, PAGE_BYTES).size());
+            }
+        });
+        CTBench::Report("document.page.random", dJumpNs / 1000.0, "us/page");
+
+        const double dFromNs = CTBench::NsPerOp(JUMPS, [&] {
+            for (std::size_t i = 0; i < JUMPS; i++) {
+                CTBench::DoNotOptimize(doc.LineFromOffset(rng() % file.Size()));
+            }
+        });
+        char szDetails[96];
+        std::snprintf(szDetails, sizeof(szDetails), "%zu lines, %.2f GB, %zu windows mapped", nLines, dGB, file.Maps());
+        CTBench::Report("document.linefromoffset", dFromNs / 1000.0, "us/lookup", szDetails);
+    }
+
+    std::remove(szPath.c_str());
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <string>
+#include <vector>
+#include "CTTest.h"
+#include "CTWindowSource.h"
+#include "LogDocument.h"
+
+using namespace CTLogView;
+
+namespace
+{
+    // nLines lines of varying length, every fifth ending in CRLF, and the offset of each
+    std::string MakeLog(std::size_t nLines, std::vector<std::size_t>& vStarts)
+    {
+        std::string szLog;
+        vStarts.clear();
+        for (std::size_t i = 0; i < nLines; i++) {
+            vStarts.push_back(szLog.size());
+            szLog += "line " + std::to_string(i) + std::string(i % 37, 'x') + ((i % 5) ? "\n" : "\r\n");
+        }
+        return szLog;
+    }
+}
+
+CT_TEST(LineOffsetsMatchAFullScan)
+{
+    std::vector<std::size_t> vStarts;
+    const std::string szLog = MakeLog(3 * LogDocument::LINE_STRIDE + 17, vStarts);
+
+    for (bool bTrailingNewLine : { true, false }) {
+        const std::string szText = bTrailingNewLine ? szLog : szLog + "last line without newline";
+        const std::size_t nLines = vStarts.size() + (bTrailingNewLine ? 0 : 1);
+
+        LogDocument doc;
+        doc.Attach(szText.data(), szText.size());
+        for (std::size_t i = 0; i < vStarts.size(); i++) {
+            CT_REQUIRE_EQ(doc.LineOffset(i), vStarts[i]);
+        }
+        CT_CHECK_EQ(doc.LineCount(), nLines);
+        CT_CHECK_EQ(doc.LineOffset(nLines), szText.size());
+        CT_CHECK_EQ(doc.LineOffset(nLines + 100), szText.size());
+    }
+}
+
+CT_TEST(LineFromOffsetFindsTheContainingLine)
+{
+    std::vector<std::size_t> vStarts;
+    const std::string szLog = MakeLog(1000, vStarts);
+    LogDocument doc;
+    doc.Attach(szLog.data(), szLog.size());
+
+    // Backwards, so that the lines are found before and after they are indexed
+    for (std::size_t i = vStarts.size(); i-- > 0; ) {
+        CT_REQUIRE_EQ(doc.LineFromOffset(vStarts[i]), i);
+        CT_REQUIRE_EQ(doc.LineFromOffset(vStarts[i] + 4), i);
+    }
+    CT_CHECK_EQ(doc.LineFromOffset(szLog.size() - 1), vStarts.size() - 1);
+    CT_CHECK_EQ(doc.LineFromOffset(SIZE_MAX), vStarts.size() - 1);
+}
+
+CT_TEST(IndexingStopsAtTheRequestedLine)
+{
+    std::vector<std::size_t> vStarts;
+    const std::string szLog = MakeLog(100 * LogDocument::LINE_STRIDE, vStarts);
+    LogDocument doc;
+    doc.Attach(szLog.data(), szLog.size());
+
+    CT_CHECK_EQ(doc.LineOffset(10), vStarts[10]);
+    CT_CHECK(doc.IndexedLines() <= 11);
+
+    CT_CHECK_EQ(doc.LineCount(), vStarts.size());
+    CT_CHECK_EQ(doc.IndexedLines(), vStarts.size() + 1);
+}
+
+CT_TEST(GetLinesKeepsWholeLinesThatFit)
+{
+    std::vector<std::size_t> vStarts;
+    const std::string szLog = MakeLog(100, vStarts);
+    LogDocument doc;
+    doc.Attach(szLog.data(), szLog.size());
+
+    std::string_view szLines = doc.GetLines(10, 3);
+    CT_CHECK_EQ(szLines, std::string_view(szLog).substr(vStarts[10], vStarts[13] - vStarts[10]));
+
+    szLines = doc.GetLines(10, 50, 100);
+    CT_CHECK(szLines.size() <= 100);
+    CT_CHECK(szLines.starts_with("line 10"));
+    CT_CHECK(szLines.ends_with("\n"));
+
+    // A line that is longer than nMaxBytes on its own is cut
+    szLines = doc.GetLines(36, 1, 8);
+    CT_CHECK_EQ(szLines, std::string_view("line 36x"));
+
+    CT_CHECK(doc.GetLines(95, SIZE_MAX).ends_with("line 99" + std::string(99 % 37, 'x') + "\n"));
+    CT_CHECK(doc.GetLines(100, 1).empty());
+}
+
+CT_TEST(ExtendKeepsTheIndexAndSeesTheNewLines)
+{
+    std::vector<std::size_t> vStarts;
+    std::string szLog = MakeLog(2000, vStarts);
+    const std::size_t nCut = vStarts[1500] + 3;
+
+    // The first view ends in the middle of line 1500
+    LogDocument doc;
+    std::string szFirst = szLog.substr(0, nCut);
+    doc.Attach(szFirst.data(), szFirst.size());
+    CT_CHECK_EQ(doc.LineCount(), 1501u);
+    const std::size_t nIndexed = doc.IndexedLines();
+
+    doc.Extend(szLog.data(), szLog.size());
+    CT_CHECK_EQ(doc.IndexedLines(), nIndexed);
+    CT_CHECK_EQ(doc.LineCount(), 2000u);
+    CT_CHECK_EQ(doc.LineOffset(1500), vStarts[1500]);
+    CT_CHECK_EQ(doc.LineOffset(1999), vStarts[1999]);
+
+    // A shorter view is a different document
+    std::string szShort = szLog.substr(0, vStarts[10]);
+    doc.Extend(szShort.data(), szShort.size());
+    CT_CHECK_EQ(doc.LineCount(), 10u);
+}
+
+CT_TEST(EmptyDocumentHasNoLines)
+{
+    LogDocument doc;
+    doc.Attach(nullptr, 0);
+    CT_CHECK_EQ(doc.LineCount(), 0u);
+    CT_CHECK_EQ(doc.LineOffset(0), 0u);
+    CT_CHECK_EQ(doc.LineFromOffset(0), 0u);
+    CT_CHECK(doc.GetLines(0, 10).empty());
+
+    const std::string szNewLine = "\n";
+    doc.Attach(szNewLine.data(), szNewLine.size());
+    CT_CHECK_EQ(doc.LineCount(), 1u);
+    CT_CHECK_EQ(doc.GetLines(0, 1), std::string_view("\n"));
+}
+
+CT_TEST(WindowedSourceGivesTheSameLines)
+{
+    std::vector<std::size_t> vStarts;
+    CTTest::WindowSource source(MakeLog(3 * LogDocument::LINE_STRIDE, vStarts) + "end", 7);
+    LogDocument doc;
+    doc.Attach(source);
+
+    CT_CHECK_EQ(doc.LineCount(), vStarts.size() + 1);
+    for (std::size_t i = 0; i < vStarts.size(); i += 13) {
+        CT_REQUIRE_EQ(doc.LineOffset(i), vStarts[i]);
+        CT_REQUIRE_EQ(doc.LineFromOffset(vStarts[i] + 2), i);
+    }
+    CT_CHECK_EQ(doc.GetLines(10, 3), std::string_view(source.Text()).substr(vStarts[10], vStarts[13] - vStarts[10]));
+    CT_CHECK_EQ(doc.GetLines(vStarts.size(), 1), std::string_view("end"));
+
+    // Only the lines asked for are mapped, never the whole document
+    CT_CHECK(source.LargestView() < source.Size() / 10);
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Parsing a synthetic text log of 1 million lines (10 million with --full) into
+// a LogIndex in one pass, and filtering the index by level, file and time
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "CTBench.h"
+#include "LogIndex.h"
+
+using namespace CTLogView;
+
+namespace
+{
+    // nLines lines in the layout of log.c's file_callback, from three source files,
+    // with a continuation line every 50 lines
+    std::string MakeLog(std::size_t nLines)
+    {
+        static const char* LEVELS[] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR" };
+        static const char* FILES[] = { "ClassicTileWnd", "WinUtils", "ActionExecutor" };
+        std::string szLog;
+        szLog.reserve(nLines * 120);
+        for (std::size_t i = 0; i < nLines; i++) {
+            char szLine[256];
+            const int nLen = (i % 50 == 49)
+                ? std::snprintf(szLine, sizeof(szLine), "    continued: window %zu\n", i)
+                : std::snprintf(szLine, sizeof(szLine), "2023-05-%02zu %02zu:%02zu:%02zu %s C:\\src\\ClassicTileCascade\\%s.cpp:%zu: Moved window <0X%016zX> to (%zu, 20)\n",
+                    1 + (i / 86400) % 28, (i / 3600) % 24, (i / 60) % 60, i % 60, LEVELS[i % 5], FILES[(i / 7) % 3], 100 + (i % 900), i * 4096, i % 1900);
+            szLog.append(szLine, static_cast<std::size_t>(nLen));
+        }
+        return szLog;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t nLines = CTBench::IsFull(argc, argv) ? 10000000 : 1000000;
+    const std::string szLog = MakeLog(nLines);
+    const double dMB = static_cast<double>(szLog.size()) / (1 << 20);
+
+    std::size_t nParsed = 0;
+    const double dParseNs = CTBench::NsPerOp(nLines, [&] {
+        LogIndex index;
+        index.Update(szLog);
+        nParsed = index.LineCount();
+    });
+    if (nParsed != nLines) {
+        std::printf("index.parse: expected %zu lines, got %zu\n", nLines, nParsed);
+    }
+    CTBench::Report("index.parse", dParseNs, "ns/line", dMB / (dParseNs * static_cast<double>(nLines) / 1e9), "MB/s");
+
+    LogIndex index;
+    index.Update(szLog);
+    std::vector<std::size_t> vLines;
+    vLines.reserve(nLines);
+
+    auto select = [&](const char* szName, const LineFilter& filter) {
+        const double dNs = CTBench::NsPerOp(nLines, [&] {
+            vLines.clear();
+            index.Select(filter, 0, vLines);
+        });
+        char szDetails[64];
+        std::snprintf(szDetails, sizeof(szDetails), "%zu of %zu lines", vLines.size(), nLines);
+        CTBench::Report(szName, dNs * static_cast<double>(nLines) / 1e6, "ms", szDetails);
+    };
+
+    LineFilter filter;
+    filter.nLevels = (1u << 4);
+    select("index.select.level", filter);
+
+    filter = LineFilter();
+    filter.nFile = index.Line(7).nFile;
+    select("index.select.file", filter);
+
+    filter = LineFilter();
+    filter.nTimeFrom = index.Line(nLines / 2).nTime;
+    filter.nTimeTo = index.Line(nLines / 2 + 3600).nTime;
+    select("index.select.time", filter);
+    return 0;
+}
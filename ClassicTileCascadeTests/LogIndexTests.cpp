@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <string>
+#include <vector>
+#include "CTTest.h"
+#include "CTWindowSource.h"
+#include "LogDocument.h"
+#include "LogIndex.h"
+
+using namespace CTLogView;
+
+namespace
+{
+    // A line before the first prefix, file names with ':' in them, a multi-line
+    // message and a last line without '\n'
+    const std::string LOG_TEXT =
+        "junk before the first line\n"
+        "2023-05-01 12:00:00 INFO  C:\\src\\a.cpp:12: hello: 1\n"
+        "  continued\n"
+        "2023-05-01 12:00:05 ERROR b.cpp:7: bad\n"
+        "2023-05-02 00:00:00 WARN  C:\\src\\a.cpp:99: x";
+
+    std::vector<std::size_t> SelectAll(const LogIndex& index, const LineFilter& filter)
+    {
+        std::vector<std::size_t> vLines;
+        index.Select(filter, 0, vLines);
+        return vLines;
+    }
+}
+
+CT_TEST(PrefixesAreParsed)
+{
+    LogIndex index;
+    index.Update(LOG_TEXT);
+    CT_REQUIRE_EQ(index.LineCount(), 5u);
+    CT_CHECK_EQ(index.CompleteLines(), 4u);
+
+    CT_CHECK_EQ(index.Line(0).nLevel, UINT8_MAX);
+    CT_CHECK_EQ(index.Line(0).nFile, UINT32_MAX);
+
+    // 2023-05-01 12:00:00
+    CT_CHECK_EQ(index.Line(1).nTime, 1682942400);
+    CT_CHECK_EQ(index.Line(1).nLevel, 2u);
+    CT_CHECK_EQ(index.FileName(index.Line(1).nFile), std::string("C:\\src\\a.cpp"));
+
+    CT_CHECK(index.Line(2).bContinuation);
+    CT_CHECK_EQ(index.Line(2).nLevel, 2u);
+    CT_CHECK_EQ(index.Line(2).nTime, index.Line(1).nTime);
+
+    CT_CHECK_EQ(index.Line(3).nLevel, 4u);
+    CT_CHECK_EQ(index.FileName(index.Line(3).nFile), std::string("b.cpp"));
+    CT_CHECK_EQ(index.Line(3).nTime - index.Line(1).nTime, 5);
+
+    CT_CHECK_EQ(index.Line(4).nFile, index.Line(1).nFile);
+    CT_CHECK_EQ(index.Line(4).nTime - index.Line(1).nTime, 12 * 3600);
+    CT_CHECK_EQ(index.FileCount(), 2u);
+    CT_CHECK_EQ(index.LineSize(4), LOG_TEXT.size() - index.Line(4).nOffset);
+}
+
+CT_TEST(MalformedPrefixesAreContinuations)
+{
+    const std::string szText =
+        "2023-05-01 12:00:00 INFO  a.cpp:1: ok\n"
+        "2023-05-01 12:00:0x INFO  a.cpp:1: bad digit\n"
+        "2023-05-01 12:00:00 NOTE  a.cpp:1: bad level\n"
+        "2023-05-01 12:00:00 INFO  a.cpp: no line number\n"
+        "2023-05-01 12:00:00 INFO  a.cpp:: empty line number\n"
+        "2023/05/01 12:00:00 INFO  a.cpp:1: bad separator\n"
+        "2023-05-01 12:00:00 INFO\n";
+
+    LogIndex index;
+    index.Update(szText);
+    CT_REQUIRE_EQ(index.LineCount(), 7u);
+    CT_CHECK(!index.Line(0).bContinuation);
+    for (std::size_t i = 1; i < index.LineCount(); i++) {
+        CT_CHECK(index.Line(i).bContinuation);
+    }
+}
+
+CT_TEST(LineOffsetsMatchTheDocument)
+{
+    LogIndex index;
+    index.Update(LOG_TEXT);
+
+    LogDocument doc;
+    doc.Attach(LOG_TEXT.data(), LOG_TEXT.size());
+    CT_REQUIRE_EQ(doc.LineCount(), index.LineCount());
+    for (std::size_t i = 0; i < index.LineCount(); i++) {
+        CT_CHECK_EQ(index.Line(i).nOffset, doc.LineOffset(i));
+    }
+}
+
+CT_TEST(FiltersSelectByLevelFileAndTime)
+{
+    LogIndex index;
+    index.Update(LOG_TEXT);
+
+    LineFilter filter;
+    CT_CHECK(!filter.IsActive());
+    CT_CHECK_EQ(SelectAll(index, filter).size(), 5u);
+
+    filter.nLevels = 1u << 4;
+    CT_CHECK(filter.IsActive());
+    CT_CHECK(SelectAll(index, filter) == std::vector<std::size_t>{ 3 });
+
+    // Continuation lines go with the line they continue
+    filter = LineFilter();
+    filter.nFile = index.Line(1).nFile;
+    CT_CHECK((SelectAll(index, filter) == std::vector<std::size_t>{ 1, 2, 4 }));
+
+    filter = LineFilter();
+    filter.nTimeFrom = index.Line(3).nTime;
+    CT_CHECK((SelectAll(index, filter) == std::vector<std::size_t>{ 3, 4 }));
+
+    filter.nTimeTo = index.Line(3).nTime;
+    CT_CHECK((SelectAll(index, filter) == std::vector<std::size_t>{ 3 }));
+
+    // Selecting from a line on, as the viewer does after an update
+    std::vector<std::size_t> vLines;
+    index.Select(LineFilter(), 3, vLines);
+    CT_CHECK((vLines == std::vector<std::size_t>{ 3, 4 }));
+}
+
+CT_TEST(UpdateParsesOnlyWhatWasAppended)
+{
+    LogIndex index;
+    index.Update(std::string_view(LOG_TEXT).substr(0, LOG_TEXT.size() - 3));
+    CT_CHECK_EQ(index.LineCount(), 5u);
+    CT_CHECK_EQ(index.CompleteLines(), 4u);
+    const std::size_t nFiles = index.FileCount();
+
+    // The last line is parsed again now that it is longer
+    index.Update(LOG_TEXT);
+    CT_CHECK_EQ(index.LineCount(), 5u);
+    CT_CHECK_EQ(index.FileCount(), nFiles);
+
+    const std::string szMore = LOG_TEXT + "\n2023-05-02 00:00:01 FATAL c.cpp:1: end\n";
+    index.Update(szMore);
+    CT_CHECK_EQ(index.LineCount(), 6u);
+    CT_CHECK_EQ(index.CompleteLines(), 6u);
+    CT_CHECK_EQ(index.Line(5).nLevel, 5u);
+    CT_CHECK_EQ(index.LineSize(4), LOG_TEXT.size() + 1 - index.Line(4).nOffset);
+
+    index.Reset();
+    CT_CHECK_EQ(index.LineCount(), 0u);
+    CT_CHECK_EQ(index.FileCount(), 0u);
+}
+
+CT_TEST(WindowedSourceGivesTheSameIndex)
+{
+    // Enough lines for several windows, and a line longer than a window
+    std::string szText;
+    for (std::size_t i = 0; i < 5000; i++) {
+        szText += "2023-05-01 12:00:" + std::string(i % 60 < 10 ? "0" : "") + std::to_string(i % 60) + " DEBUG f" + std::to_string(i % 4) + ".cpp:" + std::to_string(i) + ": line\n";
+        if (i == 2500) {
+            szText += std::string(3 * LogIndex::LINE_BYTES, 'x') + "\n";
+        }
+    }
+
+    LogIndex expected;
+    expected.Update(szText);
+
+    CTTest::WindowSource source(szText, 100);
+    LogIndex index;
+    index.Update(source);
+    CT_REQUIRE_EQ(index.LineCount(), expected.LineCount());
+    for (std::size_t i = 0; i < index.LineCount(); i++) {
+        CT_REQUIRE_EQ(index.Line(i).nOffset, expected.Line(i).nOffset);
+        CT_REQUIRE_EQ(index.Line(i).nTime, expected.Line(i).nTime);
+        CT_REQUIRE_EQ(index.Line(i).nFile, expected.Line(i).nFile);
+        CT_REQUIRE_EQ(index.Line(i).bContinuation, expected.Line(i).bContinuation);
+    }
+    CT_CHECK(index.Line(2501).bContinuation);
+    CT_CHECK(source.LargestView() <= 4 * LogIndex::LINE_BYTES);
+}
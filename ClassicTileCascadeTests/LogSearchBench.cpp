@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Searches over a synthetic log of 64 MB (512 MB with --full) in the layout of
+// the text log for the one match in the middle: forwards from the start,
+// backwards from the end and with the trigram index, compared with
+// std::string::find
+#include <cstdio>
+#include <string>
+#include "CTBench.h"
+#include "LogSearch.h"
+
+using namespace CTLogView;
+
+namespace
+{
+    std::string MakeLog(std::size_t nBytes)
+    {
+        static const char* LEVELS[] = { "TRACE", "DEBUG", "INFO ", "WARN ", "ERROR" };
+        std::string szLog;
+        szLog.reserve(nBytes + 256);
+        for (std::size_t i = 0; szLog.size() < nBytes; i++) {
+            char szLine[256];
+            const int nLen = std::snprintf(szLine, sizeof(szLine), "2023-05-01 12:%02zu:%02zu %s ClassicTileWnd.cpp:%zu: Moved window <0X%016zX> to (%zu, 20, 800, 600)\n",
+                (i / 60) % 60, i % 60, LEVELS[i % 5], 100 + (i % 900), i * 4096, i % 1900);
+            szLog.append(szLine, static_cast<std::size_t>(nLen));
+        }
+        return szLog;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    const std::size_t nBytes = bFull ? (512u << 20) : (64u << 20);
+    std::string szLog = MakeLog(nBytes / 2);
+    const std::size_t nMatch = szLog.find('\n', szLog.size() - 200) + 1;
+    szLog.insert(nMatch, "2023-05-01 13:00:00 ERROR ClassicTileWnd.cpp:1: Needle in the haystack\n");
+    szLog += MakeLog(nBytes / 2);
+    const double dGB = static_cast<double>(szLog.size() / 2) / (1 << 30);
+
+    // Each search covers half of the log
+    auto run = [&](const char* szName, std::size_t nExpected, auto&& fnFind) {
+        std::size_t nFound = 0;
+        const double dNs = CTBench::NsPerOp(1, [&] { nFound = fnFind(); });
+        if (nFound != nExpected) {
+            std::printf("%s: expected the match at %zu, got %zu\n", szName, nExpected, nFound);
+        }
+        CTBench::Report(szName, dNs / 1e6, "ms", dGB / (dNs / 1e9), "GB/s");
+    };
+
+    const std::size_t nNeedle = nMatch + 48;
+    run("search.stdfind", nNeedle, [&] { return szLog.find("Needle"); });
+
+    LogSearch search;
+    search.SetPattern("needle", false, true);
+    run("search.forward", nNeedle, [&] { return search.FindNext(szLog, 0); });
+    run("search.backward.fromend", nNeedle, [&] { return search.FindPrev(szLog, szLog.size()); });
+
+    search.SetPattern("Needle", true, false);
+    run("search.forward.matchcase", nNeedle, [&] { return search.FindNext(szLog, 0); });
+
+    // A pattern whose first and last bytes are on every line
+    search.SetPattern("ClassicTileWnd.cpp:1:", true, false);
+    run("search.forward.frequentbytes", nMatch + 26, [&] { return search.FindNext(szLog, 0); });
+
+    search.SetPattern("needle", false, true);
+    const double dIndexNs = CTBench::NsPerOp(1, [&] {
+        search.ResetIndex();
+        search.UpdateIndex(szLog);
+    });
+    CTBench::Report("search.index.build", dIndexNs / 1e6, "ms", 2 * dGB / (dIndexNs / 1e9), "GB/s");
+    run("search.forward.indexed", nNeedle, [&] { return search.FindNext(szLog, 0); });
+    run("search.backward.indexed", nNeedle, [&] { return search.FindPrev(szLog, szLog.size()); });
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include "CTTest.h"
+#include "CTWindowSource.h"
+#include "LogSearch.h"
+
+using namespace CTLogView;
+
+namespace
+{
+    bool IsWordByte(unsigned char c)
+    {
+        return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '_') || (c >= 0x80);
+    }
+
+    unsigned char Fold(unsigned char c)
+    {
+        return ((c >= 'A') && (c <= 'Z')) ? static_cast<unsigned char>(c - 'A' + 'a') : c;
+    }
+
+    // Whether szPattern matches at nPos, compared a byte at a time
+    bool MatchesAt(const std::string& szText, std::size_t nPos, const std::string& szPattern, bool bMatchCase, bool bWholeWord)
+    {
+        if ((nPos + szPattern.size()) > szText.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < szPattern.size(); i++) {
+            unsigned char a = static_cast<unsigned char>(szText[nPos + i]);
+            unsigned char b = static_cast<unsigned char>(szPattern[i]);
+            if (!bMatchCase) {
+                a = Fold(a);
+                b = Fold(b);
+            }
+            if (a != b) {
+                return false;
+            }
+        }
+        if (bWholeWord) {
+            if ((nPos > 0) && IsWordByte(static_cast<unsigned char>(szText[nPos - 1]))) {
+                return false;
+            }
+            const std::size_t nEnd = nPos + szPattern.size();
+            if ((nEnd < szText.size()) && IsWordByte(static_cast<unsigned char>(szText[nEnd]))) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::size_t ReferenceNext(const std::string& szText, std::size_t nFrom, const std::string& szPattern, bool bMatchCase, bool bWholeWord)
+    {
+        for (std::size_t i = nFrom; i < szText.size(); i++) {
+            if (MatchesAt(szText, i, szPattern, bMatchCase, bWholeWord)) {
+                return i;
+            }
+        }
+        return LogSearch::npos;
+    }
+
+    std::size_t ReferencePrev(const std::string& szText, std::size_t nBefore, const std::string& szPattern, bool bMatchCase, bool bWholeWord)
+    {
+        for (std::size_t i = std::min(nBefore, szText.size()); i-- > 0; ) {
+            if (MatchesAt(szText, i, szPattern, bMatchCase, bWholeWord)) {
+                return i;
+            }
+        }
+        return LogSearch::npos;
+    }
+
+    // nBytes of a small alphabet, so that partial matches and word boundaries are frequent
+    std::string RandomText(std::mt19937& rng, std::size_t nBytes)
+    {
+        static const char ALPHABET[] = "abAB _x\n\xC3";
+        std::string szText(nBytes, ' ');
+        for (char& c : szText) {
+            c = ALPHABET[rng() % (sizeof(ALPHABET) - 1)];
+        }
+        return szText;
+    }
+}
+
+CT_TEST(MatchesAReferenceSearch)
+{
+    std::mt19937 rng(1);
+    for (int i = 0; i < 2000; i++) {
+        const std::string szText = RandomText(rng, rng() % ((i < 1500) ? 200 : 70000));
+        std::string szPattern = RandomText(rng, 1 + rng() % 5);
+        std::replace(szPattern.begin(), szPattern.end(), '\n', 'a');
+        const bool bMatchCase = rng() % 2;
+        const bool bWholeWord = rng() % 2;
+
+        LogSearch search;
+        search.SetPattern(szPattern, bMatchCase, bWholeWord);
+        if (rng() % 2) {
+            search.UpdateIndex(szText, (rng() % 3) ? SIZE_MAX : rng() % 40000);
+        }
+
+        const std::size_t nFrom = rng() % (szText.size() + 1);
+        CT_REQUIRE_EQ(search.FindNext(szText, nFrom), ReferenceNext(szText, nFrom, szPattern, bMatchCase, bWholeWord));
+        CT_REQUIRE_EQ(search.FindPrev(szText, nFrom), ReferencePrev(szText, nFrom, szPattern, bMatchCase, bWholeWord));
+    }
+}
+
+CT_TEST(MatchCaseAndWholeWordFlags)
+{
+    const std::string szText = "Error: error_code=5 ERROR\n\xC3\xA9rror error";
+    LogSearch search;
+
+    search.SetPattern("error", true, false);
+    CT_CHECK_EQ(search.FindNext(szText, 0), 7u);
+    CT_CHECK_EQ(search.FindPrev(szText, szText.size()), szText.size() - 5);
+
+    search.SetPattern("error", false, false);
+    CT_CHECK_EQ(search.FindNext(szText, 0), 0u);
+    CT_CHECK_EQ(search.FindNext(szText, 1), 7u);
+
+    // '_' and bytes of UTF-8 sequences belong to words
+    search.SetPattern("error", false, true);
+    CT_CHECK_EQ(search.FindNext(szText, 0), 0u);
+    CT_CHECK_EQ(search.FindNext(szText, 1), 20u);
+    CT_CHECK_EQ(search.FindNext(szText, 21), szText.size() - 5);
+
+    search.SetPattern("rror", false, true);
+    CT_CHECK_EQ(search.FindNext(szText, 0), LogSearch::npos);
+
+    search.SetPattern("missing", false, false);
+    CT_CHECK_EQ(search.FindNext(szText, 0), LogSearch::npos);
+    CT_CHECK_EQ(search.FindPrev(szText, szText.size()), LogSearch::npos);
+}
+
+CT_TEST(IndexCoversTheTextAsItGrows)
+{
+    // A match in the part that is indexed first, one across the end of that part
+    // and one in what is appended later
+    std::mt19937 rng(7);
+    std::string szText = RandomText(rng, 5 * LogSearch::INDEX_BLOCK + 100);
+    szText.replace(2 * LogSearch::INDEX_BLOCK + 10, 6, "NEEDLE");
+    szText.replace(5 * LogSearch::INDEX_BLOCK - 3, 6, "needle");
+
+    LogSearch search;
+    search.SetPattern("needle", false, false);
+    search.UpdateIndex(szText);
+    CT_CHECK_EQ(search.IndexedBytes(), 5 * LogSearch::INDEX_BLOCK);
+    CT_CHECK_EQ(search.FindNext(szText, 0), 2 * LogSearch::INDEX_BLOCK + 10);
+    CT_CHECK_EQ(search.FindNext(szText, 2 * LogSearch::INDEX_BLOCK + 11), 5 * LogSearch::INDEX_BLOCK - 3);
+
+    szText += RandomText(rng, 3 * LogSearch::INDEX_BLOCK) + "needle";
+    CT_CHECK_EQ(search.FindNext(szText, 5 * LogSearch::INDEX_BLOCK), szText.size() - 6);
+
+    // Bounded updates index whole blocks only
+    search.UpdateIndex(szText, LogSearch::INDEX_BLOCK + 1);
+    CT_CHECK_EQ(search.IndexedBytes(), 6 * LogSearch::INDEX_BLOCK);
+    search.UpdateIndex(szText);
+    CT_CHECK_EQ(search.IndexedBytes(), (szText.size() / LogSearch::INDEX_BLOCK) * LogSearch::INDEX_BLOCK);
+    CT_CHECK_EQ(search.FindPrev(szText, szText.size()), szText.size() - 6);
+    CT_CHECK_EQ(search.FindPrev(szText, szText.size() - 6), 5 * LogSearch::INDEX_BLOCK - 3);
+    CT_CHECK_EQ(search.FindPrev(szText, 5 * LogSearch::INDEX_BLOCK - 3), 2 * LogSearch::INDEX_BLOCK + 10);
+
+    // The index doesn't hide matches of a pattern set after it was built
+    search.SetPattern("NEEDLE", true, false);
+    CT_CHECK_EQ(search.FindNext(szText, 0), 2 * LogSearch::INDEX_BLOCK + 10);
+    CT_CHECK_EQ(search.FindNext(szText, 2 * LogSearch::INDEX_BLOCK + 11), LogSearch::npos);
+}
+
+CT_TEST(WindowedSourceGivesTheSameMatches)
+{
+    // Matches on both sides of the scan windows, and one cut by a window boundary
+    std::mt19937 rng(3);
+    std::string szText = RandomText(rng, 2 * LogSearch::SCAN_BYTES + 1000);
+    std::vector<std::size_t> vMatches;
+    for (std::size_t nAt : { std::size_t(5), LogSearch::SCAN_BYTES - 3, LogSearch::SCAN_BYTES + 1, 2 * LogSearch::SCAN_BYTES + 990 }) {
+        szText.replace(nAt, 5, " Wnd ");
+        vMatches.push_back(nAt + 1);
+    }
+    const std::string szPattern = "wnd";
+
+    CTTest::WindowSource source(szText, 4096);
+    for (bool bIndexed : { false, true }) {
+        LogSearch search;
+        search.SetPattern(szPattern, false, true);
+        if (bIndexed) {
+            search.UpdateIndex(source);
+        }
+
+        std::size_t nFrom = 0;
+        for (std::size_t nMatch : vMatches) {
+            nFrom = search.FindNext(source, nFrom);
+            CT_REQUIRE_EQ(nFrom, nMatch);
+            nFrom++;
+        }
+        CT_CHECK_EQ(search.FindNext(source, nFrom), LogSearch::npos);
+
+        std::size_t nBefore = szText.size();
+        for (std::size_t i = vMatches.size(); i-- > 0; ) {
+            nBefore = search.FindPrev(source, nBefore);
+            CT_REQUIRE_EQ(nBefore, vMatches[i]);
+        }
+        CT_CHECK_EQ(search.FindPrev(source, nBefore), LogSearch::npos);
+    }
+
+    // The log is read a window at a time
+    CT_CHECK(source.LargestView() < LogSearch::SCAN_BYTES + 64);
+}
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <cstdio>
+#include <string>
+#include "CTTest.h"
+#include "LogTail.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace CTLogView;
+
+namespace
+{
+    // A file in memory that the tests append to, truncate and replace
+    class FakeTailSource : public ITailSource
+    {
+    public:
+        bool Stat(FileStat& stat) override
+        {
+            stat.bExists = bExists;
+            stat.nIdentity = nIdentity;
+            stat.nSize = szData.size();
+            return true;
+        }
+
+        std::size_t Read(std::uint64_t nOffset, char* pBuf, std::size_t nBytes) override
+        {
+            if (nOffset >= szData.size()) {
+                return 0;
+            }
+            const std::size_t nRead = szData.copy(pBuf, nBytes, static_cast<std::size_t>(nOffset));
+            nBytesRead += nRead;
+            return nRead;
+        }
+
+        std::string szData;
+        std::uint64_t nIdentity = 1;
+        bool bExists = true;
+        std::size_t nBytesRead = 0;
+    };
+}
+
+CT_TEST(AppendedLinesAreHandedBackOnce)
+{
+    FakeTailSource source;
+    source.szData = "already shown\n";
+    TailReader reader(source);
+    reader.Reset(source.szData.size());
+
+    std::string szAppended;
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::None);
+
+    source.szData += "one\ntwo\n";
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+    CT_CHECK_EQ(szAppended, std::string("one\ntwo\n"));
+    CT_CHECK_EQ(reader.Consumed(), source.szData.size());
+
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::None);
+    CT_CHECK(szAppended.empty());
+
+    // Only what was appended is read, never the part that was already shown
+    CT_CHECK_EQ(source.nBytesRead, 8u);
+}
+
+CT_TEST(PartialLineWaitsForItsNewLine)
+{
+    FakeTailSource source;
+    TailReader reader(source);
+    reader.Reset(0);
+
+    std::string szAppended;
+    source.szData = "first\nsec";
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+    CT_CHECK_EQ(szAppended, std::string("first\n"));
+    CT_CHECK_EQ(reader.Consumed(), 6u);
+
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::None);
+
+    source.szData += "ond\n";
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+    CT_CHECK_EQ(szAppended, std::string("second\n"));
+    CT_CHECK_EQ(reader.Consumed(), source.szData.size());
+}
+
+CT_TEST(EachPollReadsAtMostMaxBytes)
+{
+    FakeTailSource source;
+    TailReader reader(source);
+    reader.Reset(0);
+
+    for (int i = 0; i < 1000; i++) {
+        source.szData += "line " + std::to_string(i) + "\n";
+    }
+
+    std::string szAll, szAppended;
+    std::size_t nPolls = 0, nReadBefore = 0;
+    while (reader.Poll(256, szAppended) == TailEvent::Appended) {
+        CT_REQUIRE(source.nBytesRead - nReadBefore <= 256);
+        // What is handed back may include the part line kept from the last poll
+        CT_REQUIRE(szAppended.size() <= 2 * 256);
+        nReadBefore = source.nBytesRead;
+        szAll += szAppended;
+        nPolls++;
+    }
+    CT_CHECK_EQ(szAll, source.szData);
+    CT_CHECK(nPolls >= source.szData.size() / 256);
+}
+
+CT_TEST(LongLineIsHandedBackInPieces)
+{
+    FakeTailSource source;
+    TailReader reader(source);
+    reader.Reset(0);
+
+    const std::string szLong(1000, 'x');
+    source.szData = szLong + "\n";
+
+    std::string szAll, szAppended;
+    while (reader.Poll(300, szAppended) == TailEvent::Appended) {
+        CT_REQUIRE(szAppended.size() <= 300);
+        szAll += szAppended;
+    }
+    CT_CHECK_EQ(szAll, source.szData);
+}
+
+CT_TEST(TruncationRestartsFromTheBeginning)
+{
+    FakeTailSource source;
+    source.szData = "old line 1\nold line 2\n";
+    TailReader reader(source);
+    reader.Reset(source.szData.size());
+
+    source.szData = "new\n";
+    std::string szAppended;
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Truncated);
+    CT_CHECK_EQ(reader.Consumed(), 0u);
+
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+    CT_CHECK_EQ(szAppended, std::string("new\n"));
+}
+
+CT_TEST(RotationRestartsWithTheNewFile)
+{
+    FakeTailSource source;
+    source.szData = "before rotation\npartial";
+    TailReader reader(source);
+    reader.Reset(0);
+
+    std::string szAppended;
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+
+    // A new, longer file at the same path: the pending part line is dropped
+    source.nIdentity = 2;
+    source.szData = "after rotation, a longer first line\n";
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Rotated);
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+    CT_CHECK_EQ(szAppended, source.szData);
+}
+
+CT_TEST(MissingFileIsReportedUntilItIsBack)
+{
+    FakeTailSource source;
+    source.szData = "a\n";
+    TailReader reader(source);
+    reader.Reset(source.szData.size());
+
+    std::string szAppended;
+    source.bExists = false;
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Missing);
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Missing);
+
+    source.bExists = true;
+    source.nIdentity = 2;
+    source.szData = "b\n";
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Rotated);
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+    CT_CHECK_EQ(szAppended, std::string("b\n"));
+}
+
+#ifndef _WIN32
+namespace
+{
+    // Follows a path on disk the way Win32TailSource does: the inode is the identity
+    class PosixTailSource : public ITailSource
+    {
+    public:
+        explicit PosixTailSource(std::string szPath) : m_szPath(std::move(szPath)) {}
+        ~PosixTailSource() override { Close(); }
+
+        bool Stat(FileStat& stat) override
+        {
+            struct stat st = {};
+            stat.bExists = (::stat(m_szPath.c_str(), &st) == 0);
+            if (stat.bExists) {
+                if (m_fd >= 0 && static_cast<std::uint64_t>(st.st_ino) != m_nIno) {
+                    Close();
+                }
+                if (m_fd < 0) {
+                    m_fd = ::open(m_szPath.c_str(), O_RDONLY);
+                    m_nIno = static_cast<std::uint64_t>(st.st_ino);
+                }
+                stat.nIdentity = m_nIno;
+                stat.nSize = static_cast<std::uint64_t>(st.st_size);
+            }
+            return true;
+        }
+
+        std::size_t Read(std::uint64_t nOffset, char* pBuf, std::size_t nBytes) override
+        {
+            const ssize_t nRead = (m_fd >= 0) ? ::pread(m_fd, pBuf, nBytes, static_cast<off_t>(nOffset)) : -1;
+            return (nRead > 0) ? static_cast<std::size_t>(nRead) : 0;
+        }
+
+    protected:
+        void Close()
+        {
+            if (m_fd >= 0) {
+                ::close(m_fd);
+                m_fd = -1;
+            }
+        }
+
+        std::string m_szPath;
+        int m_fd = -1;
+        std::uint64_t m_nIno = 0;
+    };
+
+    void Append(const std::string& szPath, const char* szText)
+    {
+        FILE* fp = std::fopen(szPath.c_str(), "a");
+        std::fputs(szText, fp);
+        std::fclose(fp);
+    }
+}
+
+CT_TEST(FollowsAFileThroughTruncationAndRotation)
+{
+    const std::string szPath = CTTest::TempPath("tail.log");
+    const std::string szRotated = CTTest::TempPath("tail.log.1");
+    std::remove(szPath.c_str());
+    std::remove(szRotated.c_str());
+    Append(szPath, "shown before following\n");
+
+    PosixTailSource source(szPath);
+    TailReader reader(source);
+    reader.Reset(23);
+
+    std::string szAppended;
+    Append(szPath, "appended 1\nappended 2\n");
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+    CT_CHECK_EQ(szAppended, std::string("appended 1\nappended 2\n"));
+
+    // Truncated in place, as opening the log with "w" does
+    std::fclose(std::fopen(szPath.c_str(), "w"));
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Truncated);
+    Append(szPath, "after truncation\n");
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+    CT_CHECK_EQ(szAppended, std::string("after truncation\n"));
+
+    // Renamed away and replaced by a new file
+    CT_REQUIRE_EQ(std::rename(szPath.c_str(), szRotated.c_str()), 0);
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Missing);
+    Append(szPath, "new file\n");
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Rotated);
+    CT_CHECK(reader.Poll(1024, szAppended) == TailEvent::Appended);
+    CT_CHECK_EQ(szAppended, std::string("new file\n"));
+
+    std::remove(szPath.c_str());
+    std::remove(szRotated.c_str());
+}
+#endif
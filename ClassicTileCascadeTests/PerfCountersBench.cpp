@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// Cost of counting, which the actions and the logging pay on every call: into the
+// private block, into the published one, from several threads at once, and of
+// reading the block the way a monitoring tool does
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CTBench.h"
+#include "PerfCounters.h"
+
+using namespace CTCounters;
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    const std::size_t nRuns = bFull ? 10000000 : 1000000;
+
+    PerfCounters counters;
+    const auto AddRuns = [&counters](std::size_t nAdds) {
+        for (std::size_t i = 0; i < nAdds; i++) {
+            counters.Add(Counter::LogBytes, i);
+        }
+    };
+
+    const double dPrivateNs = CTBench::NsPerOp(nRuns, [&] { AddRuns(nRuns); });
+    CTBench::Report("counters.add.private", dPrivateNs, "ns/add");
+
+    counters.Publish(std::make_unique<LocalSharedMemory>(), "Bench\\Counters", 1, 1, {});
+    const double dPublishedNs = CTBench::NsPerOp(nRuns, [&] { AddRuns(nRuns); });
+    CTBench::Report("counters.add.published", dPublishedNs, "ns/add");
+
+    const unsigned nThreads = std::max(2u, std::thread::hardware_concurrency());
+    const std::size_t nPerThread = nRuns / nThreads;
+    const double dContendedNs = CTBench::NsPerOp(nPerThread * nThreads, [&] {
+        std::vector<std::thread> vThreads;
+        for (unsigned t = 0; t < nThreads; t++) {
+            vThreads.emplace_back(AddRuns, nPerThread);
+        }
+        for (std::thread& thread : vThreads) {
+            thread.join();
+        }
+    });
+    const std::string szDetails = std::to_string(nThreads) + " threads";
+    CTBench::Report("counters.add.contended", dContendedNs, "ns/add", szDetails.c_str());
+
+    LocalSharedMemory reader;
+    const void* pData = reader.Open("Bench\\Counters", sizeof(CounterBlock));
+    const std::size_t nReads = nRuns / 100;
+    CounterSnapshot snapshot;
+    const double dReadNs = CTBench::NsPerOp(nReads, [&] {
+        for (std::size_t i = 0; i < nReads; i++) {
+            ReadCounters(pData, sizeof(CounterBlock), snapshot);
+            CTBench::DoNotOptimize(snapshot);
+        }
+    });
+    CTBench::Report("counters.read", dReadNs, "ns/snapshot");
+    return 0;
+}
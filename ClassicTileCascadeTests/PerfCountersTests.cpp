@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CTTest.h"
+#include "PerfCounters.h"
+
+using namespace CTCounters;
+
+namespace
+{
+    // LocalSharedMemory regions are shared by the whole test process, so every test
+    // publishes under its own name
+    CounterSnapshot ReadRegion(std::string_view szName)
+    {
+        LocalSharedMemory reader;
+        CounterSnapshot snapshot;
+        ReadCounters(reader.Open(szName, sizeof(CounterBlock)), sizeof(CounterBlock), snapshot);
+        return snapshot;
+    }
+
+    std::uint64_t ValueOf(const CounterSnapshot& snapshot, Counter counter)
+    {
+        return snapshot.vValues[static_cast<std::size_t>(counter)];
+    }
+
+    bool IsRunning(std::uint32_t) { return true; }
+    bool IsNotRunning(std::uint32_t) { return false; }
+}
+
+CT_TEST(PublishCarriesThePrivateCountsOver)
+{
+    constexpr std::string_view NAME = "Test\\Carry";
+    PerfCounters counters;
+    counters.Add(Counter::LogBytes, 100);
+    counters.Add(Counter::Exceptions);
+    CT_CHECK(!counters.IsPublished());
+
+    LocalSharedMemory reader;
+    CT_CHECK(reader.Open(NAME, sizeof(CounterBlock)) == nullptr);
+
+    CT_REQUIRE(counters.Publish(std::make_unique<LocalSharedMemory>(), NAME, 1234, 42, IsNotRunning));
+    CT_CHECK(counters.IsPublished());
+    CT_CHECK(!counters.Publish(std::make_unique<LocalSharedMemory>(), NAME, 1234, 43, IsNotRunning));
+    counters.Add(Counter::LogBytes, 1);
+
+    const CounterSnapshot snapshot = ReadRegion(NAME);
+    CT_CHECK_EQ(snapshot.nProcessId, 1234u);
+    CT_CHECK_EQ(snapshot.nPublished, 42u);
+    CT_CHECK_EQ(ValueOf(snapshot, Counter::LogBytes), 101u);
+    CT_CHECK_EQ(ValueOf(snapshot, Counter::Exceptions), 1u);
+    CT_CHECK_EQ(counters.Get(Counter::LogBytes), 101u);
+}
+
+CT_TEST(CountsAddedWhilePublishingAreKept)
+{
+    //An Add that read the private block just before the switch may increment it after
+    //Publish carried it over. The window is a few instructions wide, so this only
+    //catches a regression on a machine with several cores, and not every run
+    constexpr int ROUNDS = 50;
+    constexpr int THREADS = 4;
+    constexpr int ADDS = 2000;
+    for (int nRound = 0; nRound < ROUNDS; nRound++) {
+        const std::string szName = "Test\\Concurrent" + std::to_string(nRound);
+        PerfCounters counters;
+        std::atomic<int> nReady{ 0 };
+        std::vector<std::thread> vThreads;
+        for (int t = 0; t < THREADS; t++) {
+            vThreads.emplace_back([&] {
+                nReady++;
+                while (nReady.load() < THREADS + 1) {
+                    std::this_thread::yield();
+                }
+                for (int i = 0; i < ADDS; i++) {
+                    counters.Add(Counter::WindowsMoved);
+                }
+            });
+        }
+
+        nReady++;
+        while (nReady.load() < THREADS + 1) {
+            std::this_thread::yield();
+        }
+        CT_CHECK(counters.Publish(std::make_unique<LocalSharedMemory>(), szName, 1, 1, IsNotRunning));
+        for (std::thread& thread : vThreads) {
+            thread.join();
+        }
+        CT_REQUIRE_EQ(ValueOf(ReadRegion(szName), Counter::WindowsMoved), std::uint64_t{ THREADS } * ADDS);
+    }
+}
+
+CT_TEST(RunningOwnerKeepsItsCounters)
+{
+    constexpr std::string_view NAME = "Test\\Owner";
+    PerfCounters owner;
+    owner.Add(Counter::CascadeActions, 7);
+    CT_REQUIRE(owner.Publish(std::make_unique<LocalSharedMemory>(), NAME, 100, 1, IsRunning));
+
+    //E.g. a command-line run next to the notification icon
+    PerfCounters second;
+    second.Add(Counter::CascadeActions);
+    CT_CHECK(!second.Publish(std::make_unique<LocalSharedMemory>(), NAME, 200, 2, IsRunning));
+    CT_CHECK(!second.IsPublished());
+    CT_CHECK_EQ(second.Get(Counter::CascadeActions), 1u);
+
+    const CounterSnapshot snapshot = ReadRegion(NAME);
+    CT_CHECK_EQ(snapshot.nProcessId, 100u);
+    CT_CHECK_EQ(ValueOf(snapshot, Counter::CascadeActions), 7u);
+}
+
+CT_TEST(RegionOfAnExitedOwnerIsTakenOver)
+{
+    constexpr std::string_view NAME = "Test\\Exited";
+    PerfCounters owner;
+    owner.Add(Counter::CascadeActions, 7);
+    CT_REQUIRE(owner.Publish(std::make_unique<LocalSharedMemory>(), NAME, 100, 1, IsNotRunning));
+
+    PerfCounters second;
+    second.Add(Counter::StackedActions);
+    CT_REQUIRE(second.Publish(std::make_unique<LocalSharedMemory>(), NAME, 200, 2, IsNotRunning));
+
+    const CounterSnapshot snapshot = ReadRegion(NAME);
+    CT_CHECK_EQ(snapshot.nProcessId, 200u);
+    CT_CHECK_EQ(ValueOf(snapshot, Counter::CascadeActions), 0u);
+    CT_CHECK_EQ(ValueOf(snapshot, Counter::StackedActions), 1u);
+}
+
+CT_TEST(ForeignAndShortBlocksAreRejected)
+{
+    CounterSnapshot snapshot;
+    std::uint64_t vJunk[64] = {};
+    CT_CHECK(!ReadCounters(vJunk, sizeof(vJunk), snapshot));
+    CT_CHECK(!ReadCounters(nullptr, sizeof(CounterBlock), snapshot));
+
+    CounterBlock block;
+    CT_CHECK(ReadCounters(&block, sizeof(block), snapshot));
+    CT_CHECK(!ReadCounters(&block, 8, snapshot));
+    CT_CHECK(!ReadCounters(&block, sizeof(block) - sizeof(std::uint64_t), snapshot));
+}
+
+CT_TEST(OlderBlocksHaveFewerCounters)
+{
+    CounterBlock block;
+    block.nCounters = 3;
+    for (std::size_t nCounter = 0; nCounter < COUNTER_COUNT; nCounter++) {
+        block.nValues[nCounter].store(nCounter + 1);
+    }
+
+    CounterSnapshot snapshot;
+    CT_REQUIRE(ReadCounters(&block, offsetof(CounterBlock, nValues) + 3 * sizeof(std::uint64_t), snapshot));
+    CT_CHECK_EQ(snapshot.vValues[2], 3u);
+    CT_CHECK_EQ(snapshot.vValues[3], 0u);
+}
+
+CT_TEST(FormatHasALinePerCounter)
+{
+    CounterSnapshot snapshot;
+    snapshot.nProcessId = 12;
+    snapshot.vValues[static_cast<std::size_t>(Counter::LogBytes)] = 99;
+
+    std::string szText;
+    FormatCounters(snapshot, szText);
+    CT_CHECK_EQ(szText.substr(0, 11), "process 12\n");
+    CT_CHECK(szText.find("\nlog.bytes 99\n") != std::string::npos);
+    CT_CHECK_EQ(static_cast<std::size_t>(std::count(szText.begin(), szText.end(), '\n')), COUNTER_COUNT + 2);
+}
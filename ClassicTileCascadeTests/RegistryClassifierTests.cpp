@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include "CTTest.h"
+#include "RegistryClassifier.h"
+
+using Event = WindowRegistry::Event;
+using WindowIdVector = WindowRegistry::WindowIdVector;
+
+namespace
+{
+    // Poll fnDone for up to 5 seconds
+    template <typename Fn>
+    bool WaitFor(Fn&& fnDone)
+    {
+        const auto tpEnd = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!fnDone()) {
+            if (std::chrono::steady_clock::now() > tpEnd) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    void Seed(WindowRegistry& registry, std::mutex& mutex, std::size_t nCount)
+    {
+        std::lock_guard lock(mutex);
+        for (WindowRegistry::WindowId id = 1; id <= nCount; id++) {
+            registry.Seed(id, { true, false, false });
+        }
+    }
+
+    WindowIdVector Tileable(WindowRegistry& registry, std::mutex& mutex)
+    {
+        std::lock_guard lock(mutex);
+        return registry.GetTileable();
+    }
+}
+
+CT_TEST(PendingWindowsAreClassifiedOnTheThread)
+{
+    WindowRegistry registry;
+    std::mutex mutex;
+    Seed(registry, mutex, 3);
+
+    const std::thread::id idTest = std::this_thread::get_id();
+    std::atomic<bool> bOnTestThread = false;
+    RegistryClassifier classifier(registry, mutex);
+    classifier.Start([&](WindowRegistry::WindowId) {
+        if (std::this_thread::get_id() == idTest) {
+            bOnTestThread = true;
+        }
+        return true;
+    });
+    CT_CHECK(classifier.IsRunning());
+
+    //What was seeded before the start is classified without a notification
+    CT_REQUIRE(WaitFor([&] { return classifier.Classified() == 3; }));
+    CT_CHECK((Tileable(registry, mutex) == WindowIdVector{ 1, 2, 3 }));
+
+    {
+        std::lock_guard lock(mutex);
+        registry.OnEvent(Event::Create, 4);
+        registry.OnEvent(Event::Show, 4);
+    }
+    classifier.Notify();
+    CT_REQUIRE(WaitFor([&] { return classifier.Classified() == 4; }));
+    CT_CHECK((Tileable(registry, mutex) == WindowIdVector{ 4, 1, 2, 3 }));
+    CT_CHECK(!bOnTestThread);
+
+    classifier.Stop();
+    CT_CHECK(!classifier.IsRunning());
+}
+
+CT_TEST(EventsDontWaitForASlowClassifier)
+{
+    WindowRegistry registry;
+    std::mutex mutex;
+    Seed(registry, mutex, 1);
+
+    //Window 1 doesn't answer until it is released
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<bool> bEntered = false;
+    RegistryClassifier classifier(registry, mutex);
+    classifier.Start([&](WindowRegistry::WindowId id) {
+        if (id == 1) {
+            bEntered = true;
+            released.wait();
+        }
+        return true;
+    });
+    CT_REQUIRE(WaitFor([&] { return bEntered.load(); }));
+
+    //The registry is free while the classifier waits
+    const auto tpStart = std::chrono::steady_clock::now();
+    {
+        std::lock_guard lock(mutex);
+        registry.OnEvent(Event::Create, 2);
+        registry.OnEvent(Event::Show, 2);
+        registry.OnEvent(Event::Foreground, 2);
+    }
+    classifier.Notify();
+    CT_CHECK(std::chrono::steady_clock::now() - tpStart < std::chrono::seconds(1));
+    CT_CHECK(Tileable(registry, mutex).empty());
+
+    //Flush classifies window 2 right away and then waits for window 1
+    auto flushed = std::async(std::launch::async, [&] { classifier.Flush(); });
+    CT_CHECK(flushed.wait_for(std::chrono::milliseconds(50)) == std::future_status::timeout);
+    release.set_value();
+    flushed.get();
+    CT_CHECK((Tileable(registry, mutex) == WindowIdVector{ 2, 1 }));
+}
+
+CT_TEST(StaleResultsOfTheThreadAreDropped)
+{
+    WindowRegistry registry;
+    std::mutex mutex;
+    Seed(registry, mutex, 1);
+
+    //Window 1 is renamed while it is being classified: the first answer is stale
+    std::atomic<int> nCalls = 0;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    RegistryClassifier classifier(registry, mutex);
+    classifier.Start([&](WindowRegistry::WindowId) {
+        if (++nCalls == 1) {
+            released.wait();
+            return false;
+        }
+        return true;
+    });
+    CT_REQUIRE(WaitFor([&] { return nCalls == 1; }));
+
+    {
+        std::lock_guard lock(mutex);
+        registry.OnEvent(Event::NameChange, 1);
+    }
+    classifier.Notify();
+    release.set_value();
+
+    CT_REQUIRE(WaitFor([&] { return classifier.Classified() == 2; }));
+    classifier.Flush();
+    CT_CHECK((Tileable(registry, mutex) == WindowIdVector{ 1 }));
+}
+
+CT_TEST(StoppedClassifierLeavesWindowsPending)
+{
+    WindowRegistry registry;
+    std::mutex mutex;
+    RegistryClassifier classifier(registry, mutex);
+
+    //Nothing to classify with before the first start
+    Seed(registry, mutex, 2);
+    classifier.Flush();
+    CT_CHECK(Tileable(registry, mutex).empty());
+
+    classifier.Start([](WindowRegistry::WindowId) { return true; });
+    CT_REQUIRE(WaitFor([&] { return classifier.Classified() == 2; }));
+    classifier.Stop();
+    classifier.Stop();
+
+    {
+        std::lock_guard lock(mutex);
+        registry.OnEvent(Event::Show, 3);
+    }
+    classifier.Notify();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    {
+        std::lock_guard lock(mutex);
+        CT_CHECK(registry.HasPending());
+    }
+
+    //Flush still classifies on the calling thread
+    classifier.Flush();
+    CT_CHECK((Tileable(registry, mutex) == WindowIdVector{ 3, 1, 2 }));
+}
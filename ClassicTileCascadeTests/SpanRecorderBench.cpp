@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+// What a CT_SPAN costs the code it measures: a span that is recorded, one that
+// only counts as dropped because the recorder is full, and one on a disabled recorder
+#include "CTBench.h"
+#include "SpanRecorder.h"
+
+using namespace CTTrace;
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    const std::size_t nRuns = bFull ? 1000000 : 100000;
+
+    //The recorder only holds CAPACITY spans, so each batch starts by clearing it (about
+    //a nanosecond per slot, which is included)
+    SpanRecorder recorder;
+    const double dRecordedNs = CTBench::NsPerOp(SpanRecorder::CAPACITY, [&] {
+        recorder.Clear();
+        for (std::size_t i = 0; i < SpanRecorder::CAPACITY; i++) {
+            const ScopedSpan span("bench", recorder);
+        }
+    }, bFull ? 2000 : 200);
+    CTBench::Report("span.recorded", dRecordedNs, "ns/span");
+
+    const double dFullNs = CTBench::NsPerOp(nRuns, [&] {
+        for (std::size_t i = 0; i < nRuns; i++) {
+            const ScopedSpan span("bench", recorder);
+        }
+    });
+    CTBench::DoNotOptimize(recorder.Dropped());
+    CTBench::Report("span.full", dFullNs, "ns/span");
+
+    recorder.SetEnabled(false);
+    const double dDisabledNs = CTBench::NsPerOp(nRuns, [&] {
+        for (std::size_t i = 0; i < nRuns; i++) {
+            const ScopedSpan span("bench", recorder);
+        }
+    });
+    CTBench::Report("span.disabled", dDisabledNs, "ns/span");
+    return 0;
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <string>
+#include <thread>
+#include <vector>
+#include "CTTest.h"
+#include "SpanRecorder.h"
+
+using namespace CTTrace;
+
+namespace
+{
+    void RecordInner(SpanRecorder& recorder)
+    {
+        const ScopedSpan span("inner", recorder);
+    }
+}
+
+CT_TEST(NestedSpansCloseBeforeTheirParent)
+{
+    SpanRecorder recorder;
+    {
+        const ScopedSpan span("outer", recorder);
+        RecordInner(recorder);
+        RecordInner(recorder);
+    }
+
+    std::vector<SpanRecord> vRecords;
+    recorder.Snapshot(vRecords);
+    CT_REQUIRE_EQ(vRecords.size(), 3u);
+    CT_CHECK_EQ(std::string(vRecords[0].szName), "inner");
+    CT_CHECK_EQ(std::string(vRecords[2].szName), "outer");
+    CT_CHECK_EQ(vRecords[0].nDepth, 1u);
+    CT_CHECK_EQ(vRecords[2].nDepth, 0u);
+
+    //The parent covers its children
+    const SpanRecord& outer = vRecords[2];
+    for (std::size_t i = 0; i < 2; i++) {
+        CT_CHECK(vRecords[i].nStartNs >= outer.nStartNs);
+        CT_CHECK(vRecords[i].nStartNs + vRecords[i].nDurationNs <= outer.nStartNs + outer.nDurationNs);
+        CT_CHECK_EQ(vRecords[i].nThread, outer.nThread);
+    }
+}
+
+CT_TEST(DisabledRecorderRecordsNothing)
+{
+    SpanRecorder recorder;
+    recorder.SetEnabled(false);
+    {
+        const ScopedSpan span("outer", recorder);
+        RecordInner(recorder);
+    }
+
+    std::vector<SpanRecord> vRecords;
+    recorder.Snapshot(vRecords);
+    CT_CHECK(vRecords.empty());
+    CT_CHECK_EQ(recorder.Dropped(), 0u);
+
+    //A span that opened while disabled isn't recorded when it closes after enabling
+    {
+        const ScopedSpan span("opened.disabled", recorder);
+        recorder.SetEnabled(true);
+        RecordInner(recorder);
+    }
+    recorder.Snapshot(vRecords);
+    CT_REQUIRE_EQ(vRecords.size(), 1u);
+    CT_CHECK_EQ(vRecords[0].nDepth, 0u);
+}
+
+CT_TEST(SpansPastTheCapacityAreCounted)
+{
+    SpanRecorder recorder;
+    constexpr std::size_t THREADS = 8;
+    constexpr std::size_t SPANS = 300;
+    std::vector<std::thread> vThreads;
+    for (std::size_t t = 0; t < THREADS; t++) {
+        vThreads.emplace_back([&recorder] {
+            for (std::size_t i = 0; i < SPANS; i++) {
+                const ScopedSpan span("worker", recorder);
+            }
+        });
+    }
+    for (std::thread& thread : vThreads) {
+        thread.join();
+    }
+
+    std::vector<SpanRecord> vRecords;
+    recorder.Snapshot(vRecords);
+    CT_CHECK_EQ(vRecords.size(), SpanRecorder::CAPACITY);
+    CT_CHECK_EQ(recorder.Dropped(), THREADS * SPANS - SpanRecorder::CAPACITY);
+
+    recorder.Clear();
+    vRecords.clear();
+    recorder.Snapshot(vRecords);
+    CT_CHECK(vRecords.empty());
+    CT_CHECK_EQ(recorder.Dropped(), 0u);
+
+    RecordInner(recorder);
+    recorder.Snapshot(vRecords);
+    CT_CHECK_EQ(vRecords.size(), 1u);
+}
+
+CT_TEST(ChromeTraceIsSortedByStartAndEscaped)
+{
+    SpanRecorder recorder;
+    recorder.Record("second", 2500, 4000, 0);
+    recorder.Record("first \"q\"\\\n", 1000, 1001, 1);
+
+    std::string szJson;
+    recorder.ExportChromeTrace(szJson, 42);
+
+    const std::size_t nFirst = szJson.find("\"name\":\"first \\\"q\\\"\\\\\\u000a\"");
+    const std::size_t nSecond = szJson.find("\"name\":\"second\"");
+    CT_REQUIRE(nFirst != std::string::npos);
+    CT_REQUIRE(nSecond != std::string::npos);
+    CT_CHECK(nFirst < nSecond);
+    CT_CHECK(szJson.find("\"ts\":1.000,\"dur\":0.001,\"pid\":42") != std::string::npos);
+    CT_CHECK(szJson.find("\"ts\":2.500,\"dur\":1.500,\"pid\":42") != std::string::npos);
+    CT_CHECK(szJson.find("\"droppedSpans\":0") != std::string::npos);
+    CT_CHECK_EQ(szJson.substr(0, 16), "{\"traceEvents\":[");
+}
+
+CT_TEST(EmptyTraceIsValid)
+{
+    SpanRecorder recorder;
+    std::string szJson;
+    recorder.ExportChromeTrace(szJson);
+    CT_CHECK_EQ(szJson, "{\"traceEvents\":[\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedSpans\":0}}\n");
+}
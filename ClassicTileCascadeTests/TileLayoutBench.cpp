@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Cost of CTLayout::CalcLayout for hundreds of windows, and of partitioning the
+// windows of synthetic multi-monitor desktops and laying out every monitor, and
+// of the slot assignment (SolveAssignment) that keeps repeated tiles in place
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include "CTBench.h"
+#include "TileLayout.h"
+
+using namespace CTLayout;
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    const std::size_t nIterations = bFull ? 20000 : 200;
+    const LayoutRect rWorkArea = { 0, 0, 2560, 1400 };
+
+    for (std::size_t nCount : { 10, 100, 500, 1000 }) {
+        WindowDescVector vWindows(nCount);
+        for (std::size_t i = 0; i < nCount; i++) {
+            vWindows[i].id = i + 1;
+            vWindows[i].rect = { static_cast<long>(i), static_cast<long>(i), static_cast<long>(i) + 800, static_cast<long>(i) + 600 };
+        }
+
+        for (Arrangement arrangement : { Arrangement::Cascade, Arrangement::Stacked, Arrangement::SideBySide }) {
+            LayoutOptions options;
+            options.arrangement = arrangement;
+            PlacementVector vPlacements;
+
+            const double dNs = CTBench::NsPerOp(nIterations, [&] {
+                for (std::size_t i = 0; i < nIterations; i++) {
+                    CalcLayout(rWorkArea, vWindows, options, vPlacements);
+                    CTBench::DoNotOptimize(vPlacements.data());
+                }
+            });
+
+            const char* szArrangement = (arrangement == Arrangement::Cascade) ? "cascade" : (arrangement == Arrangement::Stacked) ? "stacked" : "sidebyside";
+            const std::string szName = std::string("layout.") + szArrangement + "." + std::to_string(nCount);
+            CTBench::Report(szName.c_str(), dNs / 1000.0, "us/layout", dNs / static_cast<double>(nCount), "ns/window");
+        }
+    }
+
+    //nMonitors 1920x1080 monitors in a row, with the windows spread across them
+    for (auto [nMonitors, nCount] : { std::pair<std::size_t, std::size_t>{ 1, 60 }, { 3, 60 }, { 3, 600 }, { 6, 600 } }) {
+        MonitorDescVector vMonitors;
+        for (std::size_t i = 0; i < nMonitors; i++) {
+            const long nLeft = static_cast<long>(i) * 1920;
+            vMonitors.push_back({ { nLeft, 0, nLeft + 1920, 1080 }, { nLeft, 0, nLeft + 1920, 1040 } });
+        }
+
+        WindowDescVector vWindows(nCount);
+        for (std::size_t i = 0; i < nCount; i++) {
+            const long nLeft = static_cast<long>((i * 1237) % (nMonitors * 1920 - 400));
+            vWindows[i].id = i + 1;
+            vWindows[i].rect = { nLeft, static_cast<long>(i % 400), nLeft + 800, static_cast<long>(i % 400) + 600 };
+        }
+
+        LayoutOptions options;
+        options.arrangement = Arrangement::Stacked;
+        std::vector<PlacementVector> vPerMonitor;
+        const double dNs = CTBench::NsPerOp(nIterations, [&] {
+            for (std::size_t i = 0; i < nIterations; i++) {
+                CalcLayoutPerMonitor(vMonitors, vWindows, options, vPerMonitor);
+                CTBench::DoNotOptimize(vPerMonitor.data());
+            }
+        });
+
+        const std::string szName = "layout.permonitor." + std::to_string(nMonitors) + "x" + std::to_string(nCount);
+        CTBench::Report(szName.c_str(), dNs / 1000.0, "us/layout", dNs / static_cast<double>(nCount), "ns/window");
+    }
+
+    //Windows that were tiled once and then moved a little, as the cost matrix of
+    //a repeated tile would be
+    std::mt19937 rng(1);
+    for (std::size_t nCount : { 10, 100, 500 }) {
+        std::vector<long long> vCost(nCount * nCount);
+        for (std::size_t i = 0; i < nCount; i++) {
+            for (std::size_t j = 0; j < nCount; j++) {
+                const long long nDistance = std::abs(static_cast<long long>(i) - static_cast<long long>(j)) * 200;
+                vCost[(i * nCount) + j] = nDistance + static_cast<long long>(rng() % 50);
+            }
+        }
+
+        const std::size_t nSolves = std::max<std::size_t>(1, (bFull ? 100000 : 1000) / (nCount * nCount / 100 + 1));
+        std::vector<std::size_t> vAssignment;
+        const double dNs = CTBench::NsPerOp(nSolves, [&] {
+            for (std::size_t i = 0; i < nSolves; i++) {
+                SolveAssignment(vCost, nCount, vAssignment);
+                CTBench::DoNotOptimize(vAssignment.data());
+            }
+        });
+
+        const std::string szName = "assignment." + std::to_string(nCount);
+        CTBench::Report(szName.c_str(), dNs / 1000.0, "us/solve", dNs / static_cast<double>(nCount), "ns/window");
+    }
+    return 0;
+}
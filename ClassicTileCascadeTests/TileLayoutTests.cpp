@@ -0,0 +1,359 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <numeric>
+#include <random>
+#include "CTTest.h"
+#include "TileLayout.h"
+
+using namespace CTLayout;
+
+namespace
+{
+    WindowDescVector MakeWindows(std::size_t nCount)
+    {
+        WindowDescVector vWindows(nCount);
+        for (std::size_t i = 0; i < nCount; i++) {
+            vWindows[i].id = i + 1;
+            vWindows[i].rect = { 10, 10, 410, 310 };
+        }
+        return vWindows;
+    }
+
+    PlacementVector Layout(const LayoutRect& rWorkArea, std::size_t nCount, Arrangement arrangement)
+    {
+        LayoutOptions options;
+        options.arrangement = arrangement;
+        PlacementVector vPlacements;
+        CalcLayout(rWorkArea, MakeWindows(nCount), options, vPlacements);
+        return vPlacements;
+    }
+
+    bool Overlap(const LayoutRect& a, const LayoutRect& b)
+    {
+        return (a.left < b.right) && (b.left < a.right) && (a.top < b.bottom) && (b.top < a.bottom);
+    }
+
+    bool Contains(const LayoutRect& rOuter, const LayoutRect& rInner)
+    {
+        return (rInner.left >= rOuter.left) && (rInner.top >= rOuter.top) && (rInner.right <= rOuter.right) && (rInner.bottom <= rOuter.bottom);
+    }
+}
+
+CT_TEST(EmptyInputGivesNoPlacements)
+{
+    CT_CHECK(Layout({ 0, 0, 1920, 1040 }, 0, Arrangement::Stacked).empty());
+    CT_CHECK(Layout({ 0, 0, 0, 0 }, 3, Arrangement::Cascade).empty());
+    CT_CHECK(Layout({ 100, 100, 50, 50 }, 3, Arrangement::SideBySide).empty());
+}
+
+CT_TEST(TilesLeaveNoBlankSpace)
+{
+    //The "no blank space" promise: for any count, the tiles cover the work area exactly once
+    const LayoutRect rWorkArea = { -1280, 24, 1917, 1063 };
+    const long long nArea = static_cast<long long>(rWorkArea.Width()) * rWorkArea.Height();
+
+    for (Arrangement arrangement : { Arrangement::Stacked, Arrangement::SideBySide }) {
+        for (std::size_t nCount = 1; nCount <= 40; nCount++) {
+            PlacementVector vPlacements = Layout(rWorkArea, nCount, arrangement);
+            CT_REQUIRE_EQ(vPlacements.size(), nCount);
+
+            long long nCovered = 0;
+            for (std::size_t i = 0; i < nCount; i++) {
+                const LayoutRect& r = vPlacements[i].rect;
+                CT_CHECK_EQ(vPlacements[i].id, i + 1);
+                CT_CHECK(!r.IsEmpty());
+                CT_CHECK(Contains(rWorkArea, r));
+                nCovered += static_cast<long long>(r.Width()) * r.Height();
+                for (std::size_t j = 0; j < i; j++) {
+                    CT_CHECK(!Overlap(r, vPlacements[j].rect));
+                }
+            }
+            CT_CHECK_EQ(nCovered, nArea);
+        }
+    }
+}
+
+CT_TEST(TwoWindowsSplitTheWorkAreaInHalves)
+{
+    const LayoutRect rWorkArea = { 0, 0, 1920, 1040 };
+
+    PlacementVector vStacked = Layout(rWorkArea, 2, Arrangement::Stacked);
+    CT_REQUIRE_EQ(vStacked.size(), 2u);
+    CT_CHECK((vStacked[0].rect == LayoutRect{ 0, 0, 1920, 520 }));
+    CT_CHECK((vStacked[1].rect == LayoutRect{ 0, 520, 1920, 1040 }));
+
+    PlacementVector vSideBySide = Layout(rWorkArea, 2, Arrangement::SideBySide);
+    CT_REQUIRE_EQ(vSideBySide.size(), 2u);
+    CT_CHECK((vSideBySide[0].rect == LayoutRect{ 0, 0, 960, 1040 }));
+    CT_CHECK((vSideBySide[1].rect == LayoutRect{ 960, 0, 1920, 1040 }));
+}
+
+CT_TEST(UnevenTilesGiveTheExtraWindowToTheLastLanes)
+{
+    //5 windows: two columns, the second one holding three windows
+    std::vector<LayoutRect> vSlots;
+    CalcTileSlots({ 0, 0, 1000, 900 }, 5, Arrangement::Stacked, vSlots);
+    CT_REQUIRE_EQ(vSlots.size(), 5u);
+    CT_CHECK((vSlots[0] == LayoutRect{ 0, 0, 500, 450 }));
+    CT_CHECK((vSlots[1] == LayoutRect{ 0, 450, 500, 900 }));
+    CT_CHECK((vSlots[2] == LayoutRect{ 500, 0, 1000, 300 }));
+    CT_CHECK((vSlots[3] == LayoutRect{ 500, 300, 1000, 600 }));
+    CT_CHECK((vSlots[4] == LayoutRect{ 500, 600, 1000, 900 }));
+
+    CalcTileSlots({ 0, 0, 900, 1000 }, 5, Arrangement::SideBySide, vSlots);
+    CT_REQUIRE_EQ(vSlots.size(), 5u);
+    CT_CHECK((vSlots[0] == LayoutRect{ 0, 0, 450, 500 }));
+    CT_CHECK((vSlots[4] == LayoutRect{ 600, 500, 900, 1000 }));
+}
+
+CT_TEST(CascadePutsTheTopmostWindowInFront)
+{
+    const LayoutRect rWorkArea = { 0, 0, 1920, 1040 };
+    PlacementVector vPlacements = Layout(rWorkArea, 4, Arrangement::Cascade);
+    CT_REQUIRE_EQ(vPlacements.size(), 4u);
+
+    //vWindows is topmost first, so the first window is furthest down and right
+    for (std::size_t i = 0; i < 4; i++) {
+        const long nOffset = static_cast<long>(3 - i) * 32;
+        const LayoutRect& r = vPlacements[i].rect;
+        CT_CHECK_EQ(r.left, nOffset);
+        CT_CHECK_EQ(r.top, nOffset);
+        CT_CHECK_EQ(r.Width(), 1920 - 3 * 32);
+        CT_CHECK_EQ(r.Height(), 1040 - 3 * 32);
+    }
+
+    //The front window touches the bottom-right corner
+    CT_CHECK_EQ(vPlacements[0].rect.right, rWorkArea.right);
+    CT_CHECK_EQ(vPlacements[0].rect.bottom, rWorkArea.bottom);
+}
+
+CT_TEST(CascadeWrapsBeforeWindowsGetTooSmall)
+{
+    const LayoutRect rWorkArea = { 0, 0, 1000, 800 };
+    LayoutOptions options;
+    options.arrangement = Arrangement::Cascade;
+    options.nCascadeStepX = 40;
+    options.nCascadeStepY = 40;
+    options.nCascadeMinPercent = 50;
+
+    std::vector<LayoutRect> vSlots;
+    CalcCascadeSlots(rWorkArea, 30, options, vSlots);
+    CT_REQUIRE_EQ(vSlots.size(), 30u);
+
+    //(800 - 400) / 40 + 1 = 11 windows per run
+    CT_CHECK((vSlots[0] == vSlots[11]));
+    CT_CHECK_EQ(vSlots[10].left, 400);
+    for (const LayoutRect& r : vSlots) {
+        CT_CHECK(Contains(rWorkArea, r));
+        CT_CHECK(r.Height() >= 400);
+        CT_CHECK(r.Width() >= 500);
+    }
+}
+
+namespace
+{
+    // Three monitors side by side, the middle one primary with a taskbar at the bottom
+    MonitorDescVector ThreeMonitors()
+    {
+        return {
+            { { -1920, 0, 0, 1080 }, { -1920, 0, 0, 1080 } },
+            { { 0, 0, 2560, 1440 }, { 0, 0, 2560, 1400 } },
+            { { 2560, -200, 3640, 1720 }, { 2560, -200, 3640, 1720 } }
+        };
+    }
+}
+
+CT_TEST(WindowsBelongToTheMonitorTheyOverlapMost)
+{
+    const MonitorDescVector vMonitors = ThreeMonitors();
+    CT_CHECK_EQ(MonitorFromRect(vMonitors, { -1000, 100, -200, 700 }), 0u);
+    CT_CHECK_EQ(MonitorFromRect(vMonitors, { 100, 100, 900, 700 }), 1u);
+
+    //Mostly on the right monitor
+    CT_CHECK_EQ(MonitorFromRect(vMonitors, { 2400, 100, 3200, 700 }), 2u);
+
+    //Off every monitor: the closest one
+    CT_CHECK_EQ(MonitorFromRect(vMonitors, { 500, 1500, 900, 1700 }), 1u);
+    CT_CHECK_EQ(MonitorFromRect(vMonitors, { -3000, 0, -2500, 400 }), 0u);
+    CT_CHECK_EQ(MonitorFromRect(vMonitors, { 4000, 0, 4500, 400 }), 2u);
+
+    //A tie goes to the monitor that comes first
+    CT_CHECK_EQ(MonitorFromRect(vMonitors, { -400, 100, 400, 700 }), 0u);
+}
+
+CT_TEST(PartitionKeepsTheZOrderOfEveryMonitor)
+{
+    const MonitorDescVector vMonitors = ThreeMonitors();
+    WindowDescVector vWindows;
+    for (std::size_t i = 0; i < 30; i++) {
+        const long nLeft = -1900 + static_cast<long>(i % 3) * 2200;
+        vWindows.push_back({ i + 1, { nLeft, 10, nLeft + 600, 500 } });
+    }
+
+    std::vector<WindowDescVector> vPerMonitor;
+    PartitionByMonitor(vMonitors, vWindows, vPerMonitor);
+    CT_REQUIRE_EQ(vPerMonitor.size(), 3u);
+    for (std::size_t nMonitor = 0; nMonitor < 3; nMonitor++) {
+        CT_REQUIRE_EQ(vPerMonitor[nMonitor].size(), 10u);
+        for (std::size_t i = 0; i < 10; i++) {
+            CT_CHECK_EQ(vPerMonitor[nMonitor][i].id, (i * 3) + nMonitor + 1);
+        }
+    }
+
+    PartitionByMonitor({}, vWindows, vPerMonitor);
+    CT_CHECK(vPerMonitor.empty());
+}
+
+CT_TEST(EveryMonitorIsLaidOutInItsOwnWorkArea)
+{
+    const MonitorDescVector vMonitors = ThreeMonitors();
+
+    //Five windows on the left monitor, two on the primary and none on the right
+    WindowDescVector vWindows;
+    for (std::size_t i = 0; i < 7; i++) {
+        const long nLeft = (i < 5) ? -1800 : 200;
+        vWindows.push_back({ i + 1, { nLeft, 10, nLeft + 600, 500 } });
+    }
+
+    for (Arrangement arrangement : { Arrangement::Cascade, Arrangement::Stacked, Arrangement::SideBySide }) {
+        LayoutOptions options;
+        options.arrangement = arrangement;
+        std::vector<PlacementVector> vPerMonitor;
+        CalcLayoutPerMonitor(vMonitors, vWindows, options, vPerMonitor);
+
+        CT_REQUIRE_EQ(vPerMonitor.size(), 3u);
+        CT_CHECK_EQ(vPerMonitor[0].size(), 5u);
+        CT_CHECK_EQ(vPerMonitor[1].size(), 2u);
+        CT_CHECK(vPerMonitor[2].empty());
+        for (std::size_t nMonitor = 0; nMonitor < 3; nMonitor++) {
+            for (const Placement& placement : vPerMonitor[nMonitor]) {
+                CT_CHECK(Contains(vMonitors[nMonitor].rWorkArea, placement.rect));
+            }
+        }
+
+        //The same as laying out each monitor on its own
+        PlacementVector vPlacements;
+        CalcLayout(vMonitors[0].rWorkArea, WindowDescVector(vWindows.begin(), vWindows.begin() + 5), options, vPlacements);
+        CT_REQUIRE_EQ(vPlacements.size(), 5u);
+        for (std::size_t i = 0; i < 5; i++) {
+            CT_CHECK((vPlacements[i].rect == vPerMonitor[0][i].rect));
+        }
+    }
+}
+
+namespace
+{
+    long long AssignmentCost(const std::vector<long long>& vCost, std::size_t nCount, const std::vector<std::size_t>& vAssignment)
+    {
+        long long nTotal = 0;
+        for (std::size_t nRow = 0; nRow < nCount; nRow++) {
+            nTotal += vCost[(nRow * nCount) + vAssignment[nRow]];
+        }
+        return nTotal;
+    }
+}
+
+CT_TEST(AssignmentIsAsCheapAsEveryPermutation)
+{
+    std::mt19937 rng(5);
+    for (std::size_t nCount = 1; nCount <= 7; nCount++) {
+        for (int nRound = 0; nRound < 20; nRound++) {
+            std::vector<long long> vCost(nCount * nCount);
+            for (long long& nCost : vCost) {
+                nCost = static_cast<long long>(rng() % 1000);
+            }
+
+            std::vector<std::size_t> vAssignment;
+            SolveAssignment(vCost, nCount, vAssignment);
+
+            //A permutation of the columns...
+            CT_REQUIRE_EQ(vAssignment.size(), nCount);
+            std::vector<std::size_t> vSorted = vAssignment;
+            std::sort(vSorted.begin(), vSorted.end());
+            for (std::size_t i = 0; i < nCount; i++) {
+                CT_REQUIRE_EQ(vSorted[i], i);
+            }
+
+            //...that costs no more than any other
+            std::vector<std::size_t> vPermutation(nCount);
+            std::iota(vPermutation.begin(), vPermutation.end(), std::size_t(0));
+            long long nBest = std::numeric_limits<long long>::max();
+            do {
+                nBest = std::min(nBest, AssignmentCost(vCost, nCount, vPermutation));
+            } while (std::next_permutation(vPermutation.begin(), vPermutation.end()));
+            CT_REQUIRE_EQ(AssignmentCost(vCost, nCount, vAssignment), nBest);
+        }
+    }
+
+    std::vector<std::size_t> vAssignment = { 1, 2 };
+    SolveAssignment({}, 0, vAssignment);
+    CT_CHECK(vAssignment.empty());
+}
+
+CT_TEST(RetilingATiledDesktopMovesNothing)
+{
+    const LayoutRect rWorkArea = { 0, 0, 1600, 900 };
+    for (Arrangement arrangement : { Arrangement::Stacked, Arrangement::SideBySide }) {
+        LayoutOptions options;
+        options.arrangement = arrangement;
+        options.bMinimizeMovement = true;
+
+        //Tile once, then shuffle the z-order as activating windows would
+        WindowDescVector vWindows = MakeWindows(9);
+        PlacementVector vPlacements;
+        CalcLayout(rWorkArea, vWindows, options, vPlacements);
+        for (std::size_t i = 0; i < vWindows.size(); i++) {
+            vWindows[i].rect = vPlacements[i].rect;
+        }
+        std::mt19937 rng(9);
+        std::shuffle(vWindows.begin(), vWindows.end(), rng);
+
+        CalcLayout(rWorkArea, vWindows, options, vPlacements);
+        for (std::size_t i = 0; i < vWindows.size(); i++) {
+            CT_CHECK_EQ(vPlacements[i].id, vWindows[i].id);
+            CT_CHECK((vPlacements[i].rect == vWindows[i].rect));
+        }
+
+        //One more window: the others keep their slots where they can
+        vWindows.push_back({ 100, { 10, 10, 410, 310 } });
+        CalcLayout(rWorkArea, vWindows, options, vPlacements);
+        PlacementVector vByOrder;
+        options.bMinimizeMovement = false;
+        CalcLayout(rWorkArea, vWindows, options, vByOrder);
+
+        //How far the edges of the windows move in all
+        auto moved = [&](const PlacementVector& v) {
+            long long nMoved = 0;
+            for (std::size_t i = 0; i < vWindows.size(); i++) {
+                const LayoutRect& r = vWindows[i].rect;
+                nMoved += std::abs(v[i].rect.left - r.left) + std::abs(v[i].rect.top - r.top) + std::abs(v[i].rect.right - r.right) + std::abs(v[i].rect.bottom - r.bottom);
+            }
+            return nMoved;
+        };
+        CT_CHECK(moved(vPlacements) <= moved(vByOrder));
+    }
+}
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+// Per-window cost of the filter pipeline against a mock window source whose attribute
+// queries cost about as much as the cross-process queries they stand for, with and
+// without the attribute cache, and serial vs. across the worker threads
+#include <string>
+#include <thread>
+#include "CTBench.h"
+#include "WindowFilter.h"
+
+using namespace CTFilter;
+
+namespace
+{
+    class MockSource : public IAttributeSource
+    {
+    public:
+        explicit MockSource(std::chrono::nanoseconds queryCost)
+            : m_queryCost(queryCost) {}
+
+        WindowState GetState(WindowId id) override
+        {
+            WindowState state;
+            state.bVisible = (id % 9 != 0);
+            return state;
+        }
+
+        WindowAttributes GetAttributes(WindowId id) override
+        {
+            //Busy-wait: a query is a round trip to another process, not a sleep
+            const auto tpEnd = CTBench::Clock::now() + m_queryCost;
+            while (CTBench::Clock::now() < tpEnd) {
+            }
+
+            WindowAttributes attributes;
+            attributes.bOwnerWalkIsSelf = (id % 4 != 0);
+            attributes.bHasTitle = true;
+            return attributes;
+        }
+
+    protected:
+        std::chrono::nanoseconds m_queryCost;
+    };
+}
+
+int main(int argc, char* argv[])
+{
+    const bool bFull = CTBench::IsFull(argc, argv);
+    MockSource source(std::chrono::microseconds(bFull ? 20 : 2));
+
+    for (std::size_t nCount : { 16, 64, 256, 1024 }) {
+        WindowIdVector vIn(nCount);
+        for (std::size_t i = 0; i < nCount; i++) {
+            vIn[i] = i + 1;
+        }
+        WindowIdVector vOut;
+
+        auto Run = [&](const char* szVariant, AttributeCache* pCache, std::size_t nThreshold) {
+            FilterPipeline pipeline(source, pCache);
+            pipeline.AddTileableStages();
+            if (pCache) {
+                //Measure the warm cache: the registry keeps it filled between actions
+                pipeline.Filter(vIn, vOut, nThreshold);
+            }
+
+            const double dNs = CTBench::NsPerOp(nCount, [&] { pipeline.Filter(vIn, vOut, nThreshold); });
+            const std::string szName = std::string("filter.") + szVariant + "." + std::to_string(nCount);
+            CTBench::Report(szName.c_str(), dNs, "ns/window");
+        };
+
+        AttributeCache cache(std::chrono::hours(1));
+        Run("uncached.serial", nullptr, SIZE_MAX);
+        Run("uncached.parallel", nullptr, FilterPipeline::PARALLEL_THRESHOLD);
+        Run("cached.serial", &cache, SIZE_MAX);
+    }
+    return 0;
+}
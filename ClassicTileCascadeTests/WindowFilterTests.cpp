@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include "CTTest.h"
+#include "WindowFilter.h"
+
+using namespace CTFilter;
+
+namespace
+{
+    // Window source in which id % 5 == 0 is minimized, id % 7 == 0 has no title
+    // and id % 11 == 0 doesn't respond
+    class FakeSource : public IAttributeSource
+    {
+    public:
+        WindowState GetState(WindowId id) override
+        {
+            nStates++;
+            WindowState state;
+            state.bVisible = true;
+            state.bIconic = (id % 5 == 0);
+            return state;
+        }
+
+        WindowAttributes GetAttributes(WindowId id) override
+        {
+            nAttributes++;
+            WindowAttributes attributes;
+            attributes.bOwnerWalkIsSelf = true;
+            attributes.bHasTitle = (id % 7 != 0);
+            attributes.bNotResponding = (id % 11 == 0);
+            return attributes;
+        }
+
+        std::atomic<int> nStates{ 0 };
+        std::atomic<int> nAttributes{ 0 };
+    };
+
+    bool Expected(WindowId id)
+    {
+        return (id % 5 != 0) && (id % 7 != 0) && (id % 11 != 0);
+    }
+
+    WindowIdVector Range(WindowId nFirst, WindowId nLast)
+    {
+        WindowIdVector vIds;
+        for (WindowId id = nFirst; id <= nLast; id++) {
+            vIds.push_back(id);
+        }
+        return vIds;
+    }
+}
+
+CT_TEST(TileableStagesSelectTheExpectedWindows)
+{
+    FakeSource source;
+    FilterPipeline pipeline(source);
+    pipeline.AddTileableStages();
+
+    for (WindowId id = 1; id <= 100; id++) {
+        CT_CHECK_EQ(pipeline.IsTileable(id), Expected(id));
+    }
+
+    //IsEligible ignores the state: minimized windows are eligible
+    CT_CHECK(pipeline.IsEligible(5));
+    CT_CHECK(!pipeline.IsEligible(7));
+    CT_CHECK(!pipeline.IsEligible(11));
+}
+
+CT_TEST(StateStagesRunBeforeAttributeQueries)
+{
+    FakeSource source;
+    FilterPipeline pipeline(source);
+    pipeline.AddTileableStages();
+
+    //A minimized window is rejected without fetching its attributes
+    CT_CHECK(!pipeline.IsTileable(5));
+    CT_CHECK_EQ(source.nStates.load(), 1);
+    CT_CHECK_EQ(source.nAttributes.load(), 0);
+}
+
+CT_TEST(CacheFetchesAttributesOncePerWindow)
+{
+    FakeSource source;
+    AttributeCache cache(std::chrono::hours(1));
+    FilterPipeline pipeline(source, &cache);
+    pipeline.AddTileableStages();
+
+    WindowIdVector vOut;
+    pipeline.Filter(Range(1, 50), vOut);
+    const int nFirst = source.nAttributes.load();
+    pipeline.Filter(Range(1, 50), vOut);
+
+    //Only the windows that didn't respond are queried again
+    int nNotResponding = 0;
+    for (WindowId id = 1; id <= 50; id++) {
+        nNotResponding += ((id % 5 != 0) && (id % 11 == 0)) ? 1 : 0;
+    }
+    CT_CHECK_EQ(source.nAttributes.load(), nFirst + nNotResponding);
+    CT_CHECK(cache.GetHits() > 0);
+
+    cache.Invalidate(1);
+    CT_CHECK(pipeline.IsTileable(1));
+    CT_CHECK_EQ(source.nAttributes.load(), nFirst + nNotResponding + 1);
+
+    cache.Clear();
+    pipeline.Filter(Range(1, 50), vOut);
+    CT_CHECK_EQ(source.nAttributes.load(), (2 * nFirst) + nNotResponding + 1);
+}
+
+CT_TEST(CachedAttributesExpire)
+{
+    FakeSource source;
+    AttributeCache cache(std::chrono::milliseconds(1));
+    cache.Get(source, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    cache.Get(source, 1);
+    CT_CHECK_EQ(source.nAttributes.load(), 2);
+    CT_CHECK_EQ(cache.GetMisses(), 2u);
+}
+
+CT_TEST(InvalidationDuringAFetchIsNotOverwritten)
+{
+    //Holds the first query until the window has changed and the cache was invalidated
+    class BlockingSource : public IAttributeSource
+    {
+    public:
+        WindowState GetState(WindowId) override { return {}; }
+
+        WindowAttributes GetAttributes(WindowId) override
+        {
+            WindowAttributes attributes;
+            attributes.bHasTitle = bHasTitle.load();
+            if (nQueries++ == 0) {
+                entered.set_value();
+                open.get_future().wait();
+            }
+            return attributes;
+        }
+
+        std::atomic<bool> bHasTitle{ false };
+        std::atomic<int> nQueries{ 0 };
+        std::promise<void> entered;
+        std::promise<void> open;
+    };
+
+    BlockingSource source;
+    AttributeCache cache(std::chrono::hours(1));
+    std::future<WindowAttributes> stale = std::async(std::launch::async, [&] { return cache.Get(source, 1); });
+    source.entered.get_future().wait();
+
+    //What OnWinEvent does when the title changes
+    source.bHasTitle.store(true);
+    cache.Invalidate(1);
+    source.open.set_value();
+    CT_CHECK(!stale.get().bHasTitle);
+
+    CT_CHECK(cache.Get(source, 1).bHasTitle);
+    CT_CHECK_EQ(source.nQueries.load(), 2);
+    CT_CHECK(cache.Get(source, 1).bHasTitle);
+    CT_CHECK_EQ(source.nQueries.load(), 2);
+}
+
+CT_TEST(ParallelFilterKeepsTheOrder)
+{
+    FakeSource source;
+    AttributeCache cache;
+    FilterPipeline pipeline(source, &cache);
+    pipeline.AddTileableStages();
+
+    const WindowIdVector vIn = Range(1, 1000);
+    WindowIdVector vSerial, vParallel;
+    FilterPipeline::RejectionVector vSerialReported, vParallelReported;
+    pipeline.Filter(vIn, vSerial, SIZE_MAX, &vSerialReported);
+    cache.Clear();
+    pipeline.Filter(vIn, vParallel, 1, &vParallelReported);
+
+    WindowIdVector vExpected;
+    for (WindowId id : vIn) {
+        if (Expected(id)) {
+            vExpected.push_back(id);
+        }
+    }
+    CT_CHECK(vSerial == vExpected);
+    CT_CHECK(vParallel == vExpected);
+    CT_CHECK_EQ(vSerialReported.size(), vParallelReported.size());
+}
+
+CT_TEST(ReportedStagesNameTheRejection)
+{
+    FakeSource source;
+    FilterPipeline pipeline(source);
+    pipeline.AddTileableStages();
+
+    WindowIdVector vOut;
+    FilterPipeline::RejectionVector vReported;
+    pipeline.Filter({ 7, 11, 12, 22 }, vOut, SIZE_MAX, &vReported);
+
+    //"has title" isn't a reported stage, "responding" is
+    CT_CHECK((vOut == WindowIdVector{ 12 }));
+    CT_REQUIRE_EQ(vReported.size(), 2u);
+    CT_CHECK_EQ(vReported[0].id, 11u);
+    CT_CHECK(vReported[0].szStage == "responding");
+    CT_CHECK_EQ(vReported[1].id, 22u);
+}
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include "CTTest.h"
+#include "WindowPlacement.h"
+
+using namespace CTLayout;
+using namespace CTPlacement;
+
+namespace
+{
+    // Fake window manager: moves in a transaction only take effect when it is committed
+    class FakeBackend : public IPlacementBackend
+    {
+    public:
+        bool BeginBatch(std::size_t nCount) override
+        {
+            nBegins++;
+            bOpen = !bFailBegin;
+            nReserved = nCount;
+            vPending.clear();
+            return bOpen;
+        }
+
+        bool AddToBatch(const Placement& placement) override
+        {
+            if (!bOpen || (vPending.size() == nFailAddAt)) {
+                bOpen = false;
+                return false;
+            }
+            vPending.push_back(placement);
+            return true;
+        }
+
+        bool EndBatch() override
+        {
+            nCommits++;
+            const bool bOK = bOpen && !bFailEnd;
+            if (bOK) {
+                for (const Placement& placement : vPending) {
+                    mapRects[placement.id] = placement.rect;
+                }
+            }
+            bOpen = false;
+            vPending.clear();
+            return bOK;
+        }
+
+        void AbortBatch() override
+        {
+            nAborts++;
+            bOpen = false;
+            vPending.clear();
+        }
+
+        bool MoveOne(const Placement& placement) override
+        {
+            nMoveOnes++;
+            if (placement.id == nFailMoveId) {
+                return false;
+            }
+            mapRects[placement.id] = placement.rect;
+            return true;
+        }
+
+        bool bFailBegin = false;
+        bool bFailEnd = false;
+        std::size_t nFailAddAt = SIZE_MAX;
+        WindowId nFailMoveId = 0;
+
+        bool bOpen = false;
+        std::size_t nReserved = 0;
+        PlacementVector vPending;
+        std::map<WindowId, LayoutRect> mapRects;
+        int nBegins = 0, nCommits = 0, nAborts = 0, nMoveOnes = 0;
+    };
+
+    PlacementVector MakePlacements(std::size_t nCount)
+    {
+        PlacementVector vPlacements;
+        for (std::size_t i = 0; i < nCount; i++) {
+            const long n = static_cast<long>(i);
+            vPlacements.push_back({ i + 1, { n * 100, 0, n * 100 + 100, 500 } });
+        }
+        return vPlacements;
+    }
+
+    bool AllPlaced(const FakeBackend& backend, const PlacementVector& vPlacements)
+    {
+        for (const Placement& placement : vPlacements) {
+            auto it = backend.mapRects.find(placement.id);
+            if ((it == backend.mapRects.end()) || !(it->second == placement.rect)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+CT_TEST(NothingToPlaceTouchesNothing)
+{
+    FakeBackend backend;
+    PlacementResult result = ApplyPlacements(backend, {});
+    CT_CHECK(!result.bBatched);
+    CT_CHECK_EQ(backend.nBegins, 0);
+    CT_CHECK_EQ(backend.nMoveOnes, 0);
+}
+
+CT_TEST(AllMovesAreCommittedAsOneTransaction)
+{
+    FakeBackend backend;
+    const PlacementVector vPlacements = MakePlacements(40);
+    PlacementResult result = ApplyPlacements(backend, vPlacements);
+
+    CT_CHECK(result.bBatched);
+    CT_CHECK_EQ(result.nMovedIndividually, 0u);
+    CT_CHECK_EQ(result.nFailed, 0u);
+    CT_CHECK_EQ(backend.nReserved, 40u);
+    CT_CHECK_EQ(backend.nCommits, 1);
+    CT_CHECK_EQ(backend.nAborts, 0);
+    CT_CHECK_EQ(backend.nMoveOnes, 0);
+    CT_CHECK(AllPlaced(backend, vPlacements));
+}
+
+CT_TEST(FailedBeginFallsBackToSingleMoves)
+{
+    FakeBackend backend;
+    backend.bFailBegin = true;
+    const PlacementVector vPlacements = MakePlacements(5);
+    PlacementResult result = ApplyPlacements(backend, vPlacements);
+
+    CT_CHECK(!result.bBatched);
+    CT_CHECK_EQ(result.nMovedIndividually, 5u);
+    CT_CHECK_EQ(backend.nCommits, 0);
+    CT_CHECK(AllPlaced(backend, vPlacements));
+}
+
+CT_TEST(FailedAddAbortsTheTransactionBeforeFallingBack)
+{
+    FakeBackend backend;
+    backend.nFailAddAt = 3;
+    const PlacementVector vPlacements = MakePlacements(6);
+    PlacementResult result = ApplyPlacements(backend, vPlacements);
+
+    CT_CHECK(!result.bBatched);
+    CT_CHECK_EQ(backend.nAborts, 1);
+    CT_CHECK_EQ(backend.nCommits, 0);
+    CT_CHECK_EQ(result.nMovedIndividually, 6u);
+    CT_CHECK_EQ(backend.nMoveOnes, 6);
+    CT_CHECK(AllPlaced(backend, vPlacements));
+}
+
+CT_TEST(FailedCommitFallsBackAndCountsFailedMoves)
+{
+    FakeBackend backend;
+    backend.bFailEnd = true;
+    backend.nFailMoveId = 2;
+    const PlacementVector vPlacements = MakePlacements(4);
+    PlacementResult result = ApplyPlacements(backend, vPlacements);
+
+    CT_CHECK(!result.bBatched);
+    CT_CHECK_EQ(backend.nCommits, 1);
+    CT_CHECK_EQ(result.nMovedIndividually, 4u);
+    CT_CHECK_EQ(result.nFailed, 1u);
+    CT_CHECK(backend.mapRects.find(2) == backend.mapRects.end());
+    CT_CHECK_EQ(backend.mapRects.size(), 3u);
+}
+
+namespace
+{
+    // Records how many windows its transaction committed when it is destroyed,
+    // as the backends of ApplyPlacementsParallel don't outlive the call
+    class RecordingBackend : public FakeBackend
+    {
+    public:
+        RecordingBackend(std::mutex& mutex, std::vector<std::size_t>& vCommitted) : m_mutex(mutex), m_vCommitted(vCommitted) {}
+
+        ~RecordingBackend() override
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_vCommitted.push_back((nCommits == 1) ? mapRects.size() : 0);
+        }
+
+    protected:
+        std::mutex& m_mutex;
+        std::vector<std::size_t>& m_vCommitted;
+    };
+}
+
+CT_TEST(EveryMonitorIsCommittedAsATransactionOfItsOwn)
+{
+    std::vector<PlacementVector> vBatches(4);
+    vBatches[0] = MakePlacements(3);
+    vBatches[2] = MakePlacements(5);
+    vBatches[3] = MakePlacements(1);
+
+    std::mutex mutex;
+    std::vector<std::size_t> vCommitted;
+    std::size_t nBackends = 0;
+    const PlacementResult result = ApplyPlacementsParallel([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        nBackends++;
+        return std::make_unique<RecordingBackend>(mutex, vCommitted);
+    }, vBatches);
+
+    CT_CHECK(result.bBatched);
+    CT_CHECK_EQ(result.nFailed, 0u);
+
+    //No backend for the monitor without windows
+    CT_CHECK_EQ(nBackends, 3u);
+    std::sort(vCommitted.begin(), vCommitted.end());
+    CT_CHECK((vCommitted == std::vector<std::size_t>{ 1, 3, 5 }));
+}
+
+CT_TEST(NoBatchesIsNotBatched)
+{
+    const PlacementResult result = ApplyPlacementsParallel([] { return std::make_unique<FakeBackend>(); }, {});
+    CT_CHECK(!result.bBatched);
+    CT_CHECK_EQ(result.nMovedIndividually, 0u);
+}
+
+CT_TEST(FailureOnAnyMonitorReachesTheCaller)
+{
+    // Throws for the window with id 100
+    class ThrowingBackend : public FakeBackend
+    {
+    public:
+        bool AddToBatch(const Placement& placement) override
+        {
+            if (placement.id == 100) {
+                throw std::runtime_error("window manager failed");
+            }
+            return FakeBackend::AddToBatch(placement);
+        }
+    };
+
+    for (std::size_t nFailing : { 0, 2 }) {
+        std::vector<PlacementVector> vBatches = { MakePlacements(3), MakePlacements(2), MakePlacements(4) };
+        vBatches[nFailing].push_back({ 100, { 0, 0, 10, 10 } });
+
+        bool bThrown = false;
+        try {
+            ApplyPlacementsParallel([] { return std::make_unique<ThrowingBackend>(); }, vBatches);
+        } catch (const std::runtime_error&) {
+            bThrown = true;
+        }
+        CT_CHECK(bThrown);
+    }
+}
+
+CT_TEST(PlacementsToTheCurrentRectAreSkipped)
+{
+    const WindowDescVector vWindows = {
+        { 1, { 0, 0, 100, 100 } },
+        { 2, { 0, 0, 200, 200 } },
+        { 3, { 10, 10, 50, 50 } }
+    };
+    PlacementVector vPlacements = {
+        { 1, { 0, 0, 100, 100 } },
+        { 2, { 0, 0, 100, 100 } },
+        { 3, { 10, 10, 50, 50 } }
+    };
+
+    CT_CHECK_EQ(SkipUnchanged(vWindows, vPlacements), 2u);
+    CT_REQUIRE_EQ(vPlacements.size(), 1u);
+    CT_CHECK_EQ(vPlacements[0].id, 2u);
+}
+
+CT_TEST(MaximizedAndUnknownWindowsAreAlwaysPlaced)
+{
+    //A maximized window is restored by its placement even if its rect is the target
+    const WindowDescVector vWindows = {
+        { 1, { 0, 0, 100, 100 }, true },
+        { 2, { 0, 0, 100, 100 } }
+    };
+    PlacementVector vPlacements = {
+        { 1, { 0, 0, 100, 100 } },
+        { 7, { 0, 0, 100, 100 } },
+        { 2, { 0, 0, 100, 100 } }
+    };
+
+    CT_CHECK_EQ(SkipUnchanged(vWindows, vPlacements), 1u);
+    CT_REQUIRE_EQ(vPlacements.size(), 2u);
+    CT_CHECK_EQ(vPlacements[0].id, 1u);
+    CT_CHECK_EQ(vPlacements[1].id, 7u);
+}
+
+CT_TEST(SkippingKeepsTheOrderOfTheRest)
+{
+    //Every other window is where it belongs already
+    WindowDescVector vWindows;
+    PlacementVector vPlacements;
+    for (WindowId id = 1; id <= 10; id++) {
+        const long nOffset = static_cast<long>(id) * 10;
+        vWindows.push_back({ id, { nOffset, nOffset, nOffset + 100, nOffset + 100 } });
+        vPlacements.push_back({ id, { nOffset, nOffset, nOffset + ((id % 2 == 0) ? 100 : 50), nOffset + 100 } });
+    }
+    std::ranges::reverse(vPlacements);
+
+    const std::size_t nBefore = vPlacements.size();
+    const std::size_t nSkipped = SkipUnchanged(vWindows, vPlacements);
+    CT_CHECK_EQ(nSkipped, 5u);
+    CT_CHECK_EQ(nBefore - vPlacements.size(), nSkipped);
+    CT_REQUIRE_EQ(vPlacements.size(), 5u);
+    for (std::size_t i = 0; i < vPlacements.size(); i++) {
+        CT_CHECK_EQ(vPlacements[i].id, 9 - 2 * i);
+    }
+
+    CT_CHECK_EQ(SkipUnchanged(vWindows, vPlacements), 0u);
+    CT_CHECK_EQ(SkipUnchanged({}, vPlacements), 0u);
+}
@@ -0,0 +1,277 @@
+/*
+ * Copyright (c) 2023 thf
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+
+#include <set>
+#include "CTTest.h"
+#include "WindowRegistry.h"
+
+using Event = WindowRegistry::Event;
+using WindowIdVector = WindowRegistry::WindowIdVector;
+
+namespace
+{
+    // Classifier whose answers the tests change between events
+    struct FakeClassifier
+    {
+        std::set<WindowRegistry::WindowId> setIneligible;
+        int nCalls = 0;
+
+        WindowRegistry::Classifier Get()
+        {
+            return [this](WindowRegistry::WindowId id) {
+                nCalls++;
+                return setIneligible.find(id) == setIneligible.end();
+            };
+        }
+    };
+
+    // Registry seeded with visible windows 1...nCount, 1 being the topmost, and classified
+    void SeedVisible(WindowRegistry& registry, std::size_t nCount)
+    {
+        for (WindowRegistry::WindowId id = 1; id <= nCount; id++) {
+            registry.Seed(id, { true, false, false });
+        }
+        registry.ClassifyPending();
+    }
+}
+
+CT_TEST(SeededWindowsKeepTheirZOrder)
+{
+    FakeClassifier classifier;
+    WindowRegistry registry(classifier.Get());
+    CT_CHECK(!registry.IsSeeded());
+
+    SeedVisible(registry, 4);
+    registry.Seed(5, { false, false, false });
+    registry.Seed(6, { true, true, false });
+    registry.Seed(7, { true, false, true });
+    registry.ClassifyPending();
+
+    CT_CHECK(registry.IsSeeded());
+    CT_CHECK_EQ(registry.Size(), 7u);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1, 2, 3, 4 }));
+}
+
+CT_TEST(StateEventsChangeTheTileableSet)
+{
+    FakeClassifier classifier;
+    WindowRegistry registry(classifier.Get());
+    SeedVisible(registry, 4);
+
+    registry.OnEvent(Event::MinimizeStart, 2);
+    registry.OnEvent(Event::Hide, 3);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1, 4 }));
+
+    registry.OnEvent(Event::MinimizeEnd, 2);
+    registry.OnEvent(Event::Cloak, 1);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 2, 4 }));
+
+    registry.OnEvent(Event::Uncloak, 1);
+    registry.OnEvent(Event::Show, 3);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1, 2, 3, 4 }));
+}
+
+CT_TEST(ForegroundMovesAWindowToTheTop)
+{
+    FakeClassifier classifier;
+    WindowRegistry registry(classifier.Get());
+    SeedVisible(registry, 4);
+
+    registry.OnEvent(Event::Foreground, 3);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 3, 1, 2, 4 }));
+    registry.OnEvent(Event::Foreground, 4);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 4, 3, 1, 2 }));
+
+    //Unknown windows are ignored
+    registry.OnEvent(Event::Foreground, 99);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 4, 3, 1, 2 }));
+}
+
+CT_TEST(CreatedWindowsJoinWhenShownAndLeaveWhenDestroyed)
+{
+    FakeClassifier classifier;
+    WindowRegistry registry(classifier.Get());
+    SeedVisible(registry, 2);
+
+    //Created hidden
+    registry.OnEvent(Event::Create, 10);
+    CT_CHECK_EQ(registry.Size(), 3u);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1, 2 }));
+
+    //Not tileable before it is classified
+    registry.OnEvent(Event::Show, 10);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1, 2 }));
+    registry.ClassifyPending();
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 10, 1, 2 }));
+
+    //A window shown without a create event (e.g. created before the hooks) is picked up
+    registry.OnEvent(Event::Show, 11);
+    registry.ClassifyPending();
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 11, 10, 1, 2 }));
+
+    registry.OnEvent(Event::Destroy, 10);
+    registry.OnEvent(Event::Destroy, 1);
+    registry.OnEvent(Event::Destroy, 42);
+    CT_CHECK_EQ(registry.Size(), 2u);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 11, 2 }));
+}
+
+CT_TEST(ClassifierDecidesEligibility)
+{
+    FakeClassifier classifier;
+    classifier.setIneligible = { 2 };
+    WindowRegistry registry(classifier.Get());
+    SeedVisible(registry, 3);
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1, 3 }));
+
+    //A rename (e.g. the window got a title) classifies the window again
+    classifier.setIneligible.clear();
+    registry.OnEvent(Event::NameChange, 2);
+    registry.ClassifyPending();
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1, 2, 3 }));
+
+    classifier.setIneligible = { 3 };
+    registry.Reclassify(3);
+    registry.ClassifyPending();
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1, 2 }));
+
+    //Only known windows are classified
+    const int nCalls = classifier.nCalls;
+    registry.Reclassify(77);
+    registry.OnEvent(Event::NameChange, 78);
+    CT_CHECK(!registry.HasPending());
+    registry.ClassifyPending();
+    CT_CHECK_EQ(classifier.nCalls, nCalls);
+    CT_CHECK_EQ(registry.Size(), 3u);
+}
+
+CT_TEST(StateChangesDontRunTheClassifier)
+{
+    FakeClassifier classifier;
+    WindowRegistry registry(classifier.Get());
+    SeedVisible(registry, 3);
+    const int nCalls = classifier.nCalls;
+
+    registry.OnEvent(Event::MinimizeStart, 1);
+    registry.OnEvent(Event::MinimizeEnd, 1);
+    registry.OnEvent(Event::Hide, 2);
+    registry.OnEvent(Event::Foreground, 3);
+    registry.ClassifyPending();
+    registry.GetTileable();
+    CT_CHECK_EQ(classifier.nCalls, nCalls);
+}
+
+CT_TEST(ClearForgetsEverything)
+{
+    WindowRegistry registry;
+    SeedVisible(registry, 3);
+    registry.Clear();
+    CT_CHECK(!registry.IsSeeded());
+    CT_CHECK_EQ(registry.Size(), 0u);
+    CT_CHECK(registry.GetTileable().empty());
+}
+
+CT_TEST(ClassifierMayDeliverEventsForTheWindow)
+{
+    //On Windows the classifier sends messages to the window, during which the
+    //window's own events (here: its destruction) can be delivered
+    WindowRegistry registry;
+    WindowRegistry::WindowId idDestroyed = 0;
+    registry.SetClassifier([&registry, &idDestroyed](WindowRegistry::WindowId id) {
+        if (id == idDestroyed) {
+            registry.OnEvent(Event::Destroy, id);
+        }
+        return true;
+    });
+
+    SeedVisible(registry, 2);
+    idDestroyed = 3;
+    registry.Seed(3, { true, false, false });
+    registry.ClassifyPending();
+    idDestroyed = 4;
+    registry.OnEvent(Event::Create, 4);
+    registry.OnEvent(Event::Show, 4);
+    registry.ClassifyPending();
+    idDestroyed = 2;
+    registry.OnEvent(Event::NameChange, 2);
+    registry.ClassifyPending();
+
+    //The classifications of the destroyed windows are dropped
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1 }));
+    CT_CHECK_EQ(registry.Size(), 1u);
+}
+
+CT_TEST(EventsOnlyMarkWindowsForClassification)
+{
+    FakeClassifier classifier;
+    WindowRegistry registry(classifier.Get());
+    for (WindowRegistry::WindowId id = 1; id <= 3; id++) {
+        registry.Seed(id, { true, false, false });
+    }
+    registry.OnEvent(Event::Create, 4);
+    registry.OnEvent(Event::Show, 4);
+    registry.OnEvent(Event::NameChange, 1);
+    registry.OnEvent(Event::Cloak, 2);
+    registry.OnEvent(Event::Uncloak, 2);
+    CT_CHECK_EQ(classifier.nCalls, 0);
+    CT_CHECK(registry.HasPending());
+
+    //Marked more than once, taken once
+    WindowRegistry::PendingVector vPending;
+    registry.TakePending(vPending);
+    CT_CHECK_EQ(vPending.size(), 4u);
+    CT_CHECK(!registry.HasPending());
+    CT_CHECK(registry.GetTileable().empty());
+
+    for (const WindowRegistry::PendingWindow& pending : vPending) {
+        CT_CHECK(registry.SetClassification(pending, true));
+    }
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 4, 1, 2, 3 }));
+    CT_CHECK_EQ(classifier.nCalls, 0);
+}
+
+CT_TEST(StaleClassificationsAreDropped)
+{
+    WindowRegistry registry;
+    SeedVisible(registry, 2);
+
+    //Window 1 gets a title while its classification runs, window 2 goes away
+    registry.OnEvent(Event::NameChange, 1);
+    registry.OnEvent(Event::NameChange, 2);
+    WindowRegistry::PendingVector vPending;
+    registry.TakePending(vPending);
+    CT_REQUIRE_EQ(vPending.size(), 2u);
+    registry.OnEvent(Event::NameChange, 1);
+    registry.OnEvent(Event::Destroy, 2);
+
+    CT_CHECK(!registry.SetClassification(vPending[0], false));
+    CT_CHECK(!registry.SetClassification(vPending[1], false));
+    CT_CHECK((registry.GetTileable() == WindowIdVector{ 1 }));
+
+    //The newer classification is still to come
+    vPending.clear();
+    registry.TakePending(vPending);
+    CT_REQUIRE_EQ(vPending.size(), 1u);
+    CT_CHECK(registry.SetClassification(vPending[0], false));
+    CT_CHECK(registry.GetTileable().empty());
+}